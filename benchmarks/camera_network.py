@@ -0,0 +1,309 @@
+#!/usr/bin/env python3
+"""
+Simulated Camera Network
+Brings up hundreds of fake cameras on loopback addresses (all of 127.0.0.0/8
+reaches lo on Linux, so no aliases are needed) for benchmarking CameraDiscovery
+without a physical site. Each camera answers:
+
+  - HTTP on port 80 with a recorded response from corpus/http for its brand
+    (Hikvision, CP Plus, Dahua, Axis, Vivotek); unknown paths get 404
+  - RTSP OPTIONS/DESCRIBE on port 554; only its brand's stream path returns an
+    SDP (H.264 720p, see rtsp_camera.py)
+  - with --onvif, unicast WS-Discovery probes on UDP 3702
+
+--decoys adds non-camera hosts (NAS, router) that only serve HTTP, so false
+positives show up in the score. --latency/--jitter delay every reply; --loss
+leaves that fraction of connections and probes unanswered. For packet-level
+delay and loss, --netem hands its argument to "tc qdisc ... netem".
+
+Ports 80/554 and tc need root; run everything in a throwaway user and network
+namespace instead. The command after "--" is started once the network is up,
+in the same namespace, and the simulator exits with its status:
+
+  unshare -rn python3 benchmarks/camera_network.py --cameras 300 --decoys 40 \\
+      --netem "delay 1ms 1ms loss 0.5%" --manifest /tmp/cameras.json -- \\
+      build/discovery_bench /tmp/cameras.json 3
+
+Usage: camera_network.py [--range CIDR] [--cameras N] [--decoys N] [--onvif]
+                         [--latency MS] [--jitter MS] [--loss P] [--netem SPEC]
+                         [--manifest PATH] [--seed N] [-- COMMAND...]
+"""
+
+import argparse
+import asyncio
+import ipaddress
+import json
+import os
+import random
+import re
+import resource
+import subprocess
+import sys
+import uuid
+
+from onvif_responder import PROBE_MATCH, PROBE_MATCHES, scope
+from rtsp_camera import sdp
+
+CORPUS = os.path.join(os.path.dirname(os.path.abspath(__file__)), "corpus", "http")
+
+# HTTP responses per path, RTSP stream path, ONVIF hardware name
+PROFILES = {
+    "Hikvision": ({"/": "hikvision_login.txt", "/ISAPI/System/deviceInfo": "hikvision_isapi_deviceinfo.txt"},
+                  "/Streaming/Channels/101", "DS-2CD2143G2-I"),
+    "CP Plus": ({"/": "cpplus_webservice.txt"}, "/cam/realmonitor?channel=1&subtype=0", "CP-UNC-TA21L3"),
+    "Dahua": ({"/": "dahua_webservice.txt"}, "/cam/realmonitor?channel=1&subtype=0", "IPC-HDW2431T"),
+    "Axis": ({"/": "axis_index.txt"}, "/axis-media/media.amp", "M3046-V"),
+    "Vivotek": ({"/": "vivotek_index.txt"}, "/live.sdp", "FD9167-HT"),
+}
+BRAND_WEIGHTS = {"Hikvision": 40, "CP Plus": 25, "Dahua": 20, "Axis": 10, "Vivotek": 5}
+DECOYS = ["generic_nas.txt", "generic_router.txt"]
+
+NOT_FOUND = b"HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n"
+
+
+def load_response(name):
+    """Corpus file as a wire response with Content-Length and Connection: close"""
+    with open(os.path.join(CORPUS, name), encoding="utf-8", errors="replace") as capture:
+        text = capture.read().replace("\r\n", "\n")
+    head, _, body = text.partition("\n\n")
+    lines = [line for line in head.split("\n")
+             if not line.lower().startswith(("content-length:", "connection:"))]
+    body = body.encode("utf-8")
+    lines += ["Content-Length: %d" % len(body), "Connection: close"]
+    return "\r\n".join(lines).encode("utf-8") + b"\r\n\r\n" + body
+
+
+class Host:
+    def __init__(self, address, brand, http):
+        self.address = address
+        self.brand = brand              # None for decoys
+        self.http = http                # path -> wire response
+        self.rtsp_path = PROFILES[brand][1] if brand else None
+        self.hardware = PROFILES[brand][2] if brand else None
+        self.endpoint = str(uuid.uuid4())
+
+
+class Network:
+    def __init__(self, args):
+        self.args = args
+        self.rng = random.Random(args.seed)
+        self.counts = {"http": 0, "rtsp": 0, "onvif": 0, "dropped": 0}
+
+    async def reply_delay(self):
+        """False if this exchange is lost"""
+        if self.rng.random() < self.args.loss:
+            self.counts["dropped"] += 1
+            return False
+        delay = self.args.latency + self.rng.uniform(0, self.args.jitter)
+        if delay > 0:
+            await asyncio.sleep(delay / 1000.0)
+        return True
+
+    async def hold(self, reader):
+        """A lost exchange: keep the connection open until the client gives up"""
+        try:
+            while await reader.read(4096):
+                pass
+        except (ConnectionError, OSError):
+            pass
+
+    async def serve_http(self, host, reader, writer):
+        self.counts["http"] += 1
+        try:
+            head = await asyncio.wait_for(reader.readuntil(b"\r\n\r\n"), 10)
+            if not await self.reply_delay():
+                await self.hold(reader)
+                return
+            target = head.split(b" ", 2)[1].decode("latin-1") if head.count(b" ") >= 2 else "/"
+            path = target.split("?", 1)[0]
+            writer.write(host.http.get(path, NOT_FOUND))
+            await writer.drain()
+        except (asyncio.IncompleteReadError, asyncio.LimitOverrunError, asyncio.TimeoutError,
+                ConnectionError, OSError):
+            pass
+        finally:
+            writer.close()
+
+    async def serve_rtsp(self, host, reader, writer):
+        self.counts["rtsp"] += 1
+        try:
+            while True:
+                head = await asyncio.wait_for(reader.readuntil(b"\r\n\r\n"), 30)
+                if not await self.reply_delay():
+                    await self.hold(reader)
+                    return
+                text = head.decode("latin-1")
+                request = text.split("\r\n", 1)[0].split(" ")
+                method, url = request[0], request[1] if len(request) > 1 else ""
+                cseq = re.search(r"(?im)^cseq:\s*(\S+)", text)
+                cseq = cseq.group(1) if cseq else "0"
+                path = "/" + url.split("/", 3)[3] if url.count("/") >= 3 else "/"
+
+                if method == "OPTIONS":
+                    writer.write(("RTSP/1.0 200 OK\r\nCSeq: %s\r\nPublic: OPTIONS, DESCRIBE\r\n\r\n"
+                                  % cseq).encode())
+                elif method == "DESCRIBE" and path == host.rtsp_path:
+                    body = sdp(host.address).encode()
+                    writer.write(("RTSP/1.0 200 OK\r\nCSeq: %s\r\nContent-Base: %s/\r\n"
+                                  "Content-Type: application/sdp\r\nContent-Length: %d\r\n\r\n"
+                                  % (cseq, url, len(body))).encode() + body)
+                else:
+                    writer.write(("RTSP/1.0 404 Not Found\r\nCSeq: %s\r\n\r\n" % cseq).encode())
+                await writer.drain()
+        except (asyncio.IncompleteReadError, asyncio.LimitOverrunError, asyncio.TimeoutError,
+                ConnectionError, OSError):
+            pass
+        finally:
+            writer.close()
+
+    def onvif_protocol(self, host):
+        network = self
+
+        class Responder(asyncio.DatagramProtocol):
+            def connection_made(self, transport):
+                self.transport = transport
+
+            def datagram_received(self, data, sender):
+                text = data.decode("utf-8", "replace")
+                if "Probe" not in text or "ProbeMatches" in text:
+                    return
+                network.counts["onvif"] += 1
+                message = re.search(r"MessageID[^>]*>\s*([^<\s]+)", text)
+                asyncio.ensure_future(self.answer(message.group(1) if message else "", sender))
+
+            async def answer(self, relates_to, sender):
+                if not await network.reply_delay():
+                    return
+                scopes = " ".join([
+                    "onvif://www.onvif.org/type/video_encoder",
+                    scope("name", "%s %s" % (host.brand, host.address)),
+                    scope("hardware", host.hardware),
+                    scope("mfr", host.brand),
+                ])
+                match = PROBE_MATCH.format(endpoint=host.endpoint, scopes=scopes,
+                                           xaddrs="http://%s/onvif/device_service" % host.address)
+                reply = PROBE_MATCHES.format(message_id=uuid.uuid4(), relates_to=relates_to, matches=match)
+                self.transport.sendto(reply.encode("utf-8"), sender)
+
+        return Responder
+
+    def build_hosts(self):
+        network = ipaddress.ip_network(self.args.range, strict=False)
+        addresses = [str(address) for address in network.hosts()]
+        wanted = self.args.cameras + self.args.decoys
+        if wanted > len(addresses):
+            raise SystemExit("%s has only %d addresses for %d hosts" % (self.args.range, len(addresses), wanted))
+
+        # Scattered over the range like a real site, reproducibly for a given seed
+        chosen = self.rng.sample(addresses, wanted)
+        brands = self.rng.choices(list(BRAND_WEIGHTS), weights=list(BRAND_WEIGHTS.values()), k=self.args.cameras)
+        responses = {}
+
+        def response(name):
+            if name not in responses:
+                responses[name] = load_response(name)
+            return responses[name]
+
+        hosts = []
+        for address, brand in zip(chosen, brands):
+            hosts.append(Host(address, brand, {path: response(name) for path, name in PROFILES[brand][0].items()}))
+        for address in chosen[self.args.cameras:]:
+            hosts.append(Host(address, None, {"/": response(self.rng.choice(DECOYS))}))
+        return sorted(hosts, key=lambda host: ipaddress.ip_address(host.address))
+
+    async def start(self, hosts):
+        loop = asyncio.get_running_loop()
+        servers = []
+        for host in hosts:
+            servers.append(await asyncio.start_server(
+                lambda r, w, h=host: self.serve_http(h, r, w), host.address, 80, backlog=64))
+            if host.brand:
+                servers.append(await asyncio.start_server(
+                    lambda r, w, h=host: self.serve_rtsp(h, r, w), host.address, 554, backlog=64))
+                if self.args.onvif:
+                    transport, _ = await loop.create_datagram_endpoint(
+                        self.onvif_protocol(host), local_addr=(host.address, 3702))
+                    servers.append(transport)
+        return servers
+
+
+def prepare_loopback(netem):
+    # A fresh network namespace starts with lo down
+    subprocess.run(["ip", "link", "set", "lo", "up"], stderr=subprocess.DEVNULL)
+    if netem:
+        if subprocess.run(["tc", "qdisc", "replace", "dev", "lo", "root", "netem"] + netem.split()).returncode:
+            raise SystemExit("tc netem failed; it needs root (or unshare -rn) and the sch_netem module")
+        print("netem on lo: %s" % netem)
+
+
+def write_manifest(path, args, hosts):
+    manifest = {
+        "range": args.range,
+        "hosts": [{"ip": host.address, "camera": host.brand is not None, "brand": host.brand or "",
+                   "rtspPath": host.rtsp_path or ""} for host in hosts],
+    }
+    with open(path, "w") as output:
+        json.dump(manifest, output, indent=1)
+
+
+async def run(args, command):
+    network = Network(args)
+    hosts = network.build_hosts()
+    await network.start(hosts)
+    if args.manifest:
+        write_manifest(args.manifest, args, hosts)
+
+    by_brand = {}
+    for host in hosts:
+        by_brand[host.brand or "decoy"] = by_brand.get(host.brand or "decoy", 0) + 1
+    print("%d hosts up in %s: %s%s" % (len(hosts), args.range,
+                                       ", ".join("%s %d" % item for item in sorted(by_brand.items())),
+                                       " (ONVIF on)" if args.onvif else ""), flush=True)
+
+    if not command:
+        await asyncio.Event().wait()
+        return 0
+
+    process = await asyncio.create_subprocess_exec(*command)
+    status = await process.wait()
+    print("served %(http)d HTTP, %(rtsp)d RTSP connections, %(onvif)d ONVIF probes; %(dropped)d dropped"
+          % network.counts)
+    return status
+
+
+def main():
+    argv = sys.argv[1:]
+    command = []
+    if "--" in argv:
+        command = argv[argv.index("--") + 1:]
+        argv = argv[:argv.index("--")]
+
+    parser = argparse.ArgumentParser(description="Simulated camera network on loopback")
+    parser.add_argument("--range", default="127.0.2.0/23", help="Addresses to place hosts in")
+    parser.add_argument("--cameras", type=int, default=200)
+    parser.add_argument("--decoys", type=int, default=20, help="Non-camera HTTP hosts")
+    parser.add_argument("--onvif", action="store_true", help="Answer unicast WS-Discovery probes")
+    parser.add_argument("--latency", type=float, default=0, help="ms before each reply")
+    parser.add_argument("--jitter", type=float, default=0, help="Up to this many ms more")
+    parser.add_argument("--loss", type=float, default=0, help="Fraction of exchanges left unanswered")
+    parser.add_argument("--netem", help='tc netem arguments for lo, e.g. "delay 2ms loss 1%%"')
+    parser.add_argument("--manifest", help="Write the hosts and their brands here (JSON)")
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args(argv)
+
+    # Two listeners per camera plus every open connection
+    soft, hard = resource.getrlimit(resource.RLIMIT_NOFILE)
+    resource.setrlimit(resource.RLIMIT_NOFILE, (hard, hard))
+
+    prepare_loopback(args.netem)
+    try:
+        return asyncio.run(run(args, command))
+    except KeyboardInterrupt:
+        return 0
+    except PermissionError as e:
+        print("%s: ports 80/554 need root; see the usage above for running under unshare" % e)
+        return 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
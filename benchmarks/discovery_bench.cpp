@@ -0,0 +1,182 @@
+/*
+ * Discovery Benchmark
+ * Runs CameraDiscovery against the simulated site from camera_network.py and
+ * scores each run against the simulator's manifest:
+ *
+ *   time      - start to discoveryFinished, and to the first identified camera
+ *   sweep     - connect probes per second over the whole run
+ *   accuracy  - cameras listed, with the right brand, with the right stream path
+ *               verified; decoys or unknown addresses listed are false positives
+ *
+ * The discovery cache is off so every run starts cold. With a results file, one
+ * JSON object per run is appended to it, for tracking the numbers per build.
+ *
+ * Build:   cmake -S . -B build -DVISCO_BUILD_BENCHMARKS=ON && cmake --build build --target discovery_bench
+ * Usage:   discovery_bench <manifest.json> [runs] [results.jsonl]
+ * Example: unshare -rn python3 benchmarks/camera_network.py --manifest /tmp/cameras.json -- \
+ *              build/discovery_bench /tmp/cameras.json 3 results.jsonl
+ */
+
+#include "CameraDiscovery.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <QTimer>
+#include <QUrl>
+
+namespace {
+struct SimulatedHost {
+    bool camera;
+    QString brand;
+    QString rtspPath;
+};
+
+struct RunResult {
+    qint64 elapsedMs = 0;
+    qint64 firstCameraMs = -1;
+    int probes = 0;
+    int cameras = 0;            // In the manifest
+    int found = 0;
+    int brandCorrect = 0;
+    int streamVerified = 0;
+    int falsePositives = 0;
+    bool timedOut = false;
+};
+
+const int RUN_TIMEOUT_MS = 10 * 60 * 1000;
+
+bool loadManifest(const QString& path, QString& range, QHash<QString, SimulatedHost>& hosts)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    const QJsonObject manifest = QJsonDocument::fromJson(file.readAll()).object();
+    range = manifest.value("range").toString();
+    for (const QJsonValue& value : manifest.value("hosts").toArray()) {
+        const QJsonObject host = value.toObject();
+        hosts.insert(host.value("ip").toString(),
+                     SimulatedHost{host.value("camera").toBool(), host.value("brand").toString(),
+                                   host.value("rtspPath").toString()});
+    }
+    return !range.isEmpty() && !hosts.isEmpty();
+}
+
+RunResult runDiscovery(const QString& range, const QHash<QString, SimulatedHost>& hosts)
+{
+    RunResult result;
+    CameraDiscovery discovery;
+    discovery.setUseCache(false);
+
+    QEventLoop loop;
+    QObject::connect(&discovery, &CameraDiscovery::discoveryFinished, &loop, &QEventLoop::quit);
+    QObject::connect(&discovery, &CameraDiscovery::discoveryProgress, [&result](int, int total) {
+        result.probes = total;
+    });
+    QTimer::singleShot(RUN_TIMEOUT_MS, &loop, [&]() {
+        result.timedOut = true;
+        loop.quit();
+    });
+
+    QElapsedTimer timer;
+    timer.start();
+    discovery.startDiscovery(range);
+    loop.exec();
+    result.elapsedMs = timer.elapsed();
+    result.firstCameraMs = discovery.timeToFirstCamera();
+    if (result.timedOut) {
+        discovery.stopDiscovery();
+    }
+
+    for (const SimulatedHost& host : hosts) {
+        result.cameras += host.camera ? 1 : 0;
+    }
+    for (const DiscoveredCamera& camera : discovery.getDiscoveredCameras()) {
+        auto host = hosts.constFind(camera.ipAddress);
+        if (host == hosts.constEnd() || !host.value().camera) {
+            result.falsePositives++;
+            continue;
+        }
+        result.found++;
+        if (camera.brand == host.value().brand) {
+            result.brandCorrect++;
+        }
+        const QUrl url(camera.rtspUrl);
+        QString path = url.path();
+        if (url.hasQuery()) {
+            path += "?" + url.query(QUrl::FullyEncoded);
+        }
+        if (camera.rtspVerified && path == host.value().rtspPath) {
+            result.streamVerified++;
+        }
+    }
+    return result;
+}
+
+QJsonObject toJson(const RunResult& result)
+{
+    QJsonObject object;
+    object["elapsedMs"] = result.elapsedMs;
+    object["firstCameraMs"] = result.firstCameraMs;
+    object["probesPerSecond"] = result.elapsedMs > 0 ? result.probes * 1000.0 / result.elapsedMs : 0.0;
+    object["cameras"] = result.cameras;
+    object["found"] = result.found;
+    object["brandCorrect"] = result.brandCorrect;
+    object["streamVerified"] = result.streamVerified;
+    object["falsePositives"] = result.falsePositives;
+    object["timedOut"] = result.timedOut;
+    return object;
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    const QStringList args = app.arguments();
+    if (args.size() < 2) {
+        out << "Usage: discovery_bench <manifest.json> [runs] [results.jsonl]" << Qt::endl;
+        return 2;
+    }
+    const int runs = args.size() > 2 ? qMax(1, args.at(2).toInt()) : 1;
+    const QString resultsPath = args.size() > 3 ? args.at(3) : QString();
+
+    QString range;
+    QHash<QString, SimulatedHost> hosts;
+    if (!loadManifest(args.at(1), range, hosts)) {
+        out << "Cannot read a manifest from " << args.at(1) << Qt::endl;
+        return 2;
+    }
+
+    int failures = 0;
+    for (int run = 1; run <= runs; ++run) {
+        const RunResult result = runDiscovery(range, hosts);
+        const QJsonObject json = toJson(result);
+
+        out << QString("run %1: %2 ms, first camera %3 ms, %4 probes/s; found %5/%6, brand %7, stream %8, "
+                       "%9 false positives%10")
+                   .arg(run).arg(result.elapsedMs).arg(result.firstCameraMs)
+                   .arg(json.value("probesPerSecond").toDouble(), 0, 'f', 0)
+                   .arg(result.found).arg(result.cameras).arg(result.brandCorrect).arg(result.streamVerified)
+                   .arg(result.falsePositives).arg(result.timedOut ? " (timed out)" : "") << Qt::endl;
+
+        if (!resultsPath.isEmpty()) {
+            QFile results(resultsPath);
+            if (results.open(QIODevice::WriteOnly | QIODevice::Append)) {
+                results.write(QJsonDocument(json).toJson(QJsonDocument::Compact) + '\n');
+            }
+        }
+        if (result.timedOut || result.found < result.cameras) {
+            ++failures;
+        }
+    }
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,198 @@
+#!/usr/bin/env python3
+"""
+Mock Camera API Server
+Stands in for the Visco camera API so CameraApiService can be exercised without
+the real backend or the WireGuard tunnel:
+
+  POST   /cameras/          create; returns camera_id and stream_name
+  PUT    /cameras/<id>      update or status change (404 for unknown IDs)
+  DELETE /cameras/<id>      delete
+  POST   /cameras/batch     many updates in one request: {"updates": [{"camera_id", "data"}]}
+                            answered with {"results": [{"camera_id", "status", "error"}]}
+  GET    /me/profile        connectivity check
+  POST   /streams/start     and /streams/stop/<name>, also served on --stream-port
+
+--latency adds a delay to every response, to see what batching saves over a slow
+tunnel. --no-batch answers the batch endpoint with 404, like an older server, so
+the client's fallback to one request per camera can be checked. --reject makes
+the listed camera IDs fail inside a batch. On exit (Ctrl-C or SIGTERM) the
+requests served are summed up per route, with the batch sizes seen.
+
+Point the app at it by setting "apiBaseUrl" to http://127.0.0.1:<port> in its
+config; any path prefix in front of /cameras is accepted.
+
+Usage: mock_api_server.py [--port 8086] [--stream-port 8001] [--latency MS] [--no-batch] [--reject ID,...]
+Example: mock_api_server.py --latency 120
+"""
+
+import argparse
+import json
+import re
+import signal
+import sys
+import threading
+import time
+from collections import Counter
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+CAMERA_PATH = re.compile(r"/cameras/?(?P<id>[^/?]+)?/?$")
+
+
+class ApiState:
+    def __init__(self, args):
+        self.args = args
+        self.lock = threading.Lock()
+        self.cameras = {}
+        self.next_id = 1
+        self.requests = Counter()
+        self.batch_sizes = []
+
+    def create(self, data):
+        with self.lock:
+            camera_id = self.next_id
+            self.next_id += 1
+            self.cameras[str(camera_id)] = data
+        return camera_id
+
+    def update(self, camera_id, data):
+        """HTTP status for one camera update"""
+        if camera_id in self.args.reject:
+            return 422
+        with self.lock:
+            if camera_id not in self.cameras:
+                return 404
+            self.cameras[camera_id].update(data)
+        return 200
+
+
+class Handler(BaseHTTPRequestHandler):
+    state = None
+
+    def log_message(self, fmt, *args):
+        sys.stderr.write("%s %s\n" % (time.strftime("%H:%M:%S"), fmt % args))
+
+    def read_json(self):
+        length = int(self.headers.get("Content-Length") or 0)
+        if not length:
+            return {}
+        try:
+            return json.loads(self.rfile.read(length))
+        except ValueError:
+            return None
+
+    def reply(self, status, body=None):
+        if self.state.args.latency:
+            time.sleep(self.state.args.latency / 1000.0)
+        payload = json.dumps(body).encode() if body is not None else b""
+        self.send_response(status)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(payload)))
+        self.end_headers()
+        self.wfile.write(payload)
+
+    def route(self, method):
+        path = self.path.split("?", 1)[0]
+        match = CAMERA_PATH.search(path)
+        if match:
+            camera_id = match.group("id")
+            if camera_id == "batch":
+                return f"{method} /cameras/batch", camera_id
+            return (f"{method} /cameras/<id>", camera_id) if camera_id else (f"{method} /cameras/", None)
+        if path.endswith("/me/profile"):
+            return f"{method} /me/profile", None
+        if path.endswith("/streams/start"):
+            return f"{method} /streams/start", None
+        if "/streams/stop/" in path:
+            return f"{method} /streams/stop/<name>", None
+        return f"{method} {path}", None
+
+    def handle_any(self, method):
+        route, camera_id = self.route(method)
+        self.state.requests[route] += 1
+        data = self.read_json() if method in ("POST", "PUT") else {}
+        if data is None:
+            return self.reply(400, {"error": "invalid JSON"})
+
+        if route == "GET /me/profile":
+            return self.reply(200, {"email": "mock@example.com"})
+        if route == "POST /cameras/":
+            new_id = self.state.create(data)
+            return self.reply(201, {"camera_id": new_id, "stream_name": f"camera-{new_id}"})
+        if route == "PUT /cameras/<id>":
+            status = self.state.update(camera_id, data)
+            return self.reply(status, {} if status == 200 else {"error": "rejected"})
+        if route == "DELETE /cameras/<id>":
+            with self.state.lock:
+                self.state.cameras.pop(camera_id, None)
+            return self.reply(204)
+        if route == "POST /cameras/batch":
+            if self.state.args.no_batch:
+                return self.reply(404, {"detail": "Not Found"})
+            updates = data.get("updates", [])
+            self.state.batch_sizes.append(len(updates))
+            results = []
+            for update in updates:
+                item_id = str(update.get("camera_id", ""))
+                status = self.state.update(item_id, update.get("data") or {})
+                results.append({"camera_id": item_id, "status": status,
+                                "error": "" if status == 200 else f"update rejected ({status})"})
+            return self.reply(200, {"results": results})
+        if route in ("POST /streams/start", "POST /streams/stop/<name>"):
+            return self.reply(200, {})
+        return self.reply(404, {"detail": "Not Found"})
+
+    def do_GET(self):
+        self.handle_any("GET")
+
+    def do_POST(self):
+        self.handle_any("POST")
+
+    def do_PUT(self):
+        self.handle_any("PUT")
+
+    def do_DELETE(self):
+        self.handle_any("DELETE")
+
+
+def print_summary(state):
+    print("\nrequests served:")
+    for route, count in sorted(state.requests.items()):
+        print(f"  {count:6d}  {route}")
+    if state.batch_sizes:
+        sizes = state.batch_sizes
+        print(f"batches: {len(sizes)}, {sum(sizes)} camera updates, "
+              f"{min(sizes)}-{max(sizes)} per batch (mean {sum(sizes) / len(sizes):.1f})")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Mock camera API server")
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=8086)
+    parser.add_argument("--stream-port", type=int, default=8001, help="0 to skip the streams listener")
+    parser.add_argument("--latency", type=int, default=0, help="delay added to every response, ms")
+    parser.add_argument("--no-batch", action="store_true", help="answer /cameras/batch with 404")
+    parser.add_argument("--reject", type=lambda value: set(filter(None, value.split(","))), default=set(),
+                        help="camera IDs whose updates fail")
+    args = parser.parse_args()
+
+    Handler.state = ApiState(args)
+    servers = [ThreadingHTTPServer((args.host, args.port), Handler)]
+    if args.stream_port:
+        servers.append(ThreadingHTTPServer((args.host, args.stream_port), Handler))
+    for server in servers[1:]:
+        threading.Thread(target=server.serve_forever, daemon=True).start()
+
+    print(f"mock API on http://{args.host}:{args.port}"
+          + (f" (streams on {args.stream_port})" if args.stream_port else "")
+          + (", batch endpoint disabled" if args.no_batch else ""))
+    signal.signal(signal.SIGTERM, signal.default_int_handler)
+    try:
+        servers[0].serve_forever()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        print_summary(Handler.state)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,169 @@
+#!/usr/bin/env python3
+"""
+ONVIF WS-Discovery Responder
+Stand-in for ONVIF cameras when testing OnvifDiscovery without hardware. Joins
+239.255.255.250:3702 (and answers unicast probes on the same port) and replies
+to every NetworkVideoTransmitter Probe with a ProbeMatches carrying the given
+XAddrs and scopes, after a random delay as real devices do.
+
+With --probe it acts as the client instead: sends one Probe the way the
+application does and prints each ProbeMatch with its arrival time.
+
+Usage:
+  onvif_responder.py [--name N] [--hardware H] [--manufacturer M] [--xaddr URL] [--devices K]
+  onvif_responder.py --probe [--target IP] [--window MS]
+Example:
+  onvif_responder.py --name "Lobby" --hardware DS-2CD2043G0-I --manufacturer Hikvision
+"""
+
+import argparse
+import random
+import re
+import socket
+import struct
+import sys
+import time
+import uuid
+from urllib.parse import quote
+
+MULTICAST_ADDRESS = "239.255.255.250"
+DISCOVERY_PORT = 3702
+MAX_DELAY_MS = 500  # APP_MAX_DELAY from WS-Discovery
+
+PROBE = """<?xml version="1.0" encoding="UTF-8"?>
+<s:Envelope xmlns:s="http://www.w3.org/2003/05/soap-envelope" xmlns:a="http://schemas.xmlsoap.org/ws/2004/08/addressing" xmlns:d="http://schemas.xmlsoap.org/ws/2005/04/discovery" xmlns:dn="http://www.onvif.org/ver10/network/wsdl">
+<s:Header><a:MessageID>uuid:{message_id}</a:MessageID><a:To s:mustUnderstand="1">urn:schemas-xmlsoap-org:ws:2005:04:discovery</a:To><a:Action s:mustUnderstand="1">http://schemas.xmlsoap.org/ws/2005/04/discovery/Probe</a:Action></s:Header>
+<s:Body><d:Probe><d:Types>dn:NetworkVideoTransmitter</d:Types></d:Probe></s:Body>
+</s:Envelope>"""
+
+PROBE_MATCHES = """<?xml version="1.0" encoding="UTF-8"?>
+<SOAP-ENV:Envelope xmlns:SOAP-ENV="http://www.w3.org/2003/05/soap-envelope" xmlns:wsa="http://schemas.xmlsoap.org/ws/2004/08/addressing" xmlns:wsdd="http://schemas.xmlsoap.org/ws/2005/04/discovery" xmlns:tdn="http://www.onvif.org/ver10/network/wsdl">
+<SOAP-ENV:Header><wsa:MessageID>uuid:{message_id}</wsa:MessageID><wsa:RelatesTo>{relates_to}</wsa:RelatesTo><wsa:To>http://schemas.xmlsoap.org/ws/2004/08/addressing/role/anonymous</wsa:To><wsa:Action>http://schemas.xmlsoap.org/ws/2005/04/discovery/ProbeMatches</wsa:Action></SOAP-ENV:Header>
+<SOAP-ENV:Body><wsdd:ProbeMatches>{matches}</wsdd:ProbeMatches></SOAP-ENV:Body>
+</SOAP-ENV:Envelope>"""
+
+PROBE_MATCH = """<wsdd:ProbeMatch><wsa:EndpointReference><wsa:Address>urn:uuid:{endpoint}</wsa:Address></wsa:EndpointReference><wsdd:Types>tdn:NetworkVideoTransmitter</wsdd:Types><wsdd:Scopes>{scopes}</wsdd:Scopes><wsdd:XAddrs>{xaddrs}</wsdd:XAddrs><wsdd:MetadataVersion>1</wsdd:MetadataVersion></wsdd:ProbeMatch>"""
+
+
+def local_address():
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    try:
+        sock.connect(("10.255.255.255", 1))
+        return sock.getsockname()[0]
+    except OSError:
+        return "127.0.0.1"
+    finally:
+        sock.close()
+
+
+def scope(category, value):
+    return f"onvif://www.onvif.org/{category}/{quote(value)}"
+
+
+def respond(args):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    sock.bind(("", DISCOVERY_PORT))
+    membership = struct.pack("4s4s", socket.inet_aton(MULTICAST_ADDRESS), socket.inet_aton(args.interface))
+    try:
+        sock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, membership)
+    except OSError as e:
+        print(f"Multicast join failed ({e}); answering unicast probes only")
+
+    address = local_address()
+    endpoints = [str(uuid.uuid4()) for _ in range(args.devices)]
+    matches = []
+    for index, endpoint in enumerate(endpoints):
+        suffix = f" {index + 1}" if args.devices > 1 else ""
+        scopes = [
+            "onvif://www.onvif.org/type/video_encoder",
+            "onvif://www.onvif.org/Profile/Streaming",
+            scope("name", args.name + suffix),
+            scope("hardware", args.hardware),
+            scope("mfr", args.manufacturer),
+            scope("location/city", args.location),
+        ]
+        xaddr = args.xaddr or f"http://{address}:{args.port + index}/onvif/device_service"
+        matches.append(PROBE_MATCH.format(endpoint=endpoint, scopes=" ".join(scopes), xaddrs=xaddr))
+
+    print(f"Answering WS-Discovery probes on port {DISCOVERY_PORT} as {args.devices} device(s)")
+    while True:
+        data, sender = sock.recvfrom(65536)
+        text = data.decode("utf-8", "replace")
+        if "Probe" not in text or "ProbeMatches" in text:
+            continue
+        if "NetworkVideoTransmitter" not in text and "<d:Types" in text:
+            continue
+
+        message = re.search(r"MessageID[^>]*>\s*([^<\s]+)", text)
+        relates_to = message.group(1) if message else ""
+        time.sleep(random.uniform(0, min(args.max_delay, MAX_DELAY_MS)) / 1000.0)
+
+        reply = PROBE_MATCHES.format(message_id=uuid.uuid4(), relates_to=relates_to, matches="".join(matches))
+        sock.sendto(reply.encode("utf-8"), sender)
+        print(f"{time.strftime('%H:%M:%S')} probe from {sender[0]}:{sender[1]}, answered")
+
+
+def probe(args):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, 1)
+    sock.bind(("", 0))
+    sock.settimeout(0.05)
+
+    target = args.target or MULTICAST_ADDRESS
+    payload = PROBE.format(message_id=uuid.uuid4()).encode("utf-8")
+    start = time.monotonic()
+    sock.sendto(payload, (target, DISCOVERY_PORT))
+
+    seen = set()
+    while time.monotonic() - start < args.window / 1000.0:
+        try:
+            data, sender = sock.recvfrom(65536)
+        except socket.timeout:
+            continue
+        text = data.decode("utf-8", "replace")
+        elapsed = (time.monotonic() - start) * 1000.0
+        for match in re.findall(r"<[\w-]*:?ProbeMatch>(.*?)</[\w-]*:?ProbeMatch>", text, re.S):
+            endpoint = re.search(r"Address>([^<]+)<", match)
+            endpoint = endpoint.group(1) if endpoint else sender[0]
+            if endpoint in seen:
+                continue
+            seen.add(endpoint)
+            xaddrs = re.search(r"XAddrs>([^<]+)<", match)
+            scopes = re.search(r"Scopes>([^<]+)<", match)
+            print(f"{elapsed:7.1f} ms  {sender[0]}  {xaddrs.group(1) if xaddrs else '-'}")
+            if scopes:
+                for item in scopes.group(1).split():
+                    print(f"            {item}")
+
+    print(f"{len(seen)} device(s) answered within {args.window} ms")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="WS-Discovery responder / probe for ONVIF testing")
+    parser.add_argument("--probe", action="store_true", help="Send a probe and list the replies")
+    parser.add_argument("--target", help="Unicast probe target (probe mode)")
+    parser.add_argument("--window", type=int, default=1500, help="Collection window in ms (probe mode)")
+    parser.add_argument("--interface", default="0.0.0.0", help="Interface address for the multicast join")
+    parser.add_argument("--name", default="Test Camera")
+    parser.add_argument("--hardware", default="DS-2CD2043G0-I")
+    parser.add_argument("--manufacturer", default="Hikvision")
+    parser.add_argument("--location", default="Lab")
+    parser.add_argument("--xaddr", help="Device service URL (default: this host)")
+    parser.add_argument("--port", type=int, default=80, help="Device service port for the default XAddr")
+    parser.add_argument("--devices", type=int, default=1, help="Number of devices to announce")
+    parser.add_argument("--max-delay", type=int, default=MAX_DELAY_MS, help="Upper bound of reply delay in ms")
+    args = parser.parse_args()
+
+    try:
+        if args.probe:
+            probe(args)
+        else:
+            respond(args)
+    except KeyboardInterrupt:
+        pass
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
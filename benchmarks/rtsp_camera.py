@@ -0,0 +1,241 @@
+#!/usr/bin/env python3
+"""
+Fake RTSP Camera
+Answers DESCRIBE the way an IP camera does, for exercising the stream URL probe
+that CameraDiscovery runs on each camera it finds:
+
+  - only --path returns an SDP (H.264 with sprop-parameter-sets, so codec and
+    resolution can be read from it); every other path gets 404
+  - with --user, requests must carry a Digest Authorization (401 first)
+  - --delay adds a per-reply latency, like a busy embedded server
+  - SETUP/PLAY over TCP start interleaved media: RTP on channel 0 at 25 fps and an
+    RTCP sender report on channel 1 every second; with --rtp-seconds the RTP stops
+    after that long while RTCP carries on, like a camera whose encoder hung
+
+With --probe it instead acts as the client: it sends DESCRIBE for the Generic
+candidate list to a camera, sequentially and then N at a time, answering
+Digest challenges, and prints which path answered and how long the probe took.
+
+Usage: rtsp_camera.py [--port 8554] [--path /stream1] [--user admin --password 12345] [--delay MS] [--rtp-seconds S]
+       rtsp_camera.py --probe HOST [--port 554] [--user U --password P] [--parallel N]
+"""
+
+import argparse
+import base64
+import hashlib
+import os
+import re
+import socket
+import struct
+import threading
+import time
+from concurrent.futures import ThreadPoolExecutor
+
+# Baseline profile, 1280x720
+SPS = bytes.fromhex("6742001fd9405005b9")
+PPS = bytes.fromhex("68ce3c80")
+
+# Counted across connections, for tests running the camera in-process
+stats = {"connections": 0, "plays": 0}
+stats_lock = threading.Lock()
+
+GENERIC_PATHS = ["/stream1", "/video1", "/cam1", "/live.sdp", "/axis-media/media.amp",
+                 "/videoMain", "/streaming/channels/1", "/h264", "/mjpeg"]
+
+
+def md5(text):
+    return hashlib.md5(text.encode()).hexdigest()
+
+
+def read_message(conn):
+    data = b""
+    while b"\r\n\r\n" not in data:
+        chunk = conn.recv(4096)
+        if not chunk:
+            return None
+        data += chunk
+    head, _, body = data.partition(b"\r\n\r\n")
+    length = int(re.search(rb"(?im)^content-length:\s*(\d+)", head).group(1)) if b"ontent-" in head else 0
+    while len(body) < length:
+        chunk = conn.recv(4096)
+        if not chunk:
+            break
+        body += chunk
+    return head.decode(errors="replace"), body
+
+
+def header(head, name):
+    match = re.search(r"(?im)^" + name + r":\s*(.*)$", head)
+    return match.group(1).strip() if match else ""
+
+
+def sdp(host):
+    sprop = base64.b64encode(SPS).decode() + "," + base64.b64encode(PPS).decode()
+    return ("v=0\r\no=- 1 1 IN IP4 {0}\r\ns=Media Presentation\r\nc=IN IP4 0.0.0.0\r\nt=0 0\r\n"
+            "m=video 0 RTP/AVP 96\r\na=rtpmap:96 H264/90000\r\n"
+            "a=fmtp:96 packetization-mode=1;sprop-parameter-sets={1}\r\na=control:trackID=1\r\n").format(host, sprop)
+
+
+def stream_media(conn, send_lock, stop, rtp_seconds):
+    """Interleaved RTP (SPS, PPS, then one slice per frame) and RTCP sender reports"""
+    ssrc = int.from_bytes(os.urandom(4), "big")
+    seq, timestamp, packets = 0, 0, 0
+    started = time.monotonic()
+    next_report = started
+    nals = [SPS, PPS]
+    while not stop.is_set():
+        now = time.monotonic()
+        try:
+            if not rtp_seconds or now - started < rtp_seconds:
+                # Parameter sets first, then an IDR every 2 s between plain slices
+                slice_nal = not nals
+                nal = nals.pop(0) if nals else bytes([0x65 if seq % 50 == 2 else 0x41]) + os.urandom(200)
+                marker = 0x80 if slice_nal else 0
+                rtp = struct.pack("!BBHII", 0x80, 96 | marker, seq & 0xFFFF, timestamp, ssrc) + nal
+                with send_lock:
+                    conn.sendall(struct.pack("!BBH", 0x24, 0, len(rtp)) + rtp)
+                seq += 1
+                packets += 1
+                if slice_nal:
+                    timestamp = (timestamp + 3600) & 0xFFFFFFFF
+            if now >= next_report:
+                sr = struct.pack("!BBHIIIIII", 0x80, 200, 6, ssrc, 0, 0, timestamp, packets, packets * 200)
+                with send_lock:
+                    conn.sendall(struct.pack("!BBH", 0x24, 1, len(sr)) + sr)
+                next_report += 1.0
+        except OSError:
+            return
+        stop.wait(0.04)
+
+
+def serve_client(conn, args):
+    nonce = os.urandom(8).hex()
+    realm = "IP Camera"
+    session = os.urandom(4).hex()
+    send_lock = threading.Lock()
+    stop = threading.Event()
+    with stats_lock:
+        stats["connections"] += 1
+    with conn:
+        try:
+            handle_requests(conn, args, nonce, realm, session, send_lock, stop)
+        finally:
+            stop.set()
+
+
+def handle_requests(conn, args, nonce, realm, session, send_lock, stop):
+    def reply(text, body=b""):
+        with send_lock:
+            conn.sendall(text.encode() + body)
+
+    while True:
+        message = read_message(conn)
+        if message is None:
+            return
+        head, _ = message
+        request_line = head.split("\r\n")[0].split(" ")
+        method, url = request_line[0], request_line[1]
+        cseq = header(head, "CSeq")
+        time.sleep(args.delay / 1000.0)
+
+        if args.user:
+            auth = header(head, "Authorization")
+            params = dict(re.findall(r'(\w+)="?([^",]*)"?', auth))
+            ha1 = md5("%s:%s:%s" % (args.user, realm, args.password))
+            ha2 = md5("%s:%s" % (method, params.get("uri", "")))
+            if not auth.startswith("Digest") or params.get("response") != md5("%s:%s:%s" % (ha1, nonce, ha2)):
+                reply("RTSP/1.0 401 Unauthorized\r\nCSeq: %s\r\n"
+                      "WWW-Authenticate: Digest realm=\"%s\", nonce=\"%s\"\r\n\r\n"
+                      % (cseq, realm, nonce))
+                continue
+
+        path = "/" + url.split("/", 3)[3] if url.count("/") >= 3 else "/"
+        if method == "DESCRIBE" and path == args.path:
+            body = sdp(args.bind).encode()
+            reply("RTSP/1.0 200 OK\r\nCSeq: %s\r\nContent-Base: %s/\r\n"
+                  "Content-Type: application/sdp\r\nContent-Length: %d\r\n\r\n"
+                  % (cseq, url, len(body)), body)
+        elif method == "OPTIONS":
+            reply("RTSP/1.0 200 OK\r\nCSeq: %s\r\nPublic: OPTIONS, DESCRIBE, SETUP, PLAY, TEARDOWN\r\n\r\n" % cseq)
+        elif method == "SETUP" and path.startswith(args.path):
+            reply("RTSP/1.0 200 OK\r\nCSeq: %s\r\nTransport: RTP/AVP/TCP;unicast;interleaved=0-1\r\n"
+                  "Session: %s;timeout=60\r\n\r\n" % (cseq, session))
+        elif method == "PLAY" and path.startswith(args.path):
+            reply("RTSP/1.0 200 OK\r\nCSeq: %s\r\nSession: %s\r\n\r\n" % (cseq, session))
+            with stats_lock:
+                stats["plays"] += 1
+            threading.Thread(target=stream_media, args=(conn, send_lock, stop, args.rtp_seconds),
+                             daemon=True).start()
+        elif method in ("TEARDOWN", "GET_PARAMETER"):
+            reply("RTSP/1.0 200 OK\r\nCSeq: %s\r\nSession: %s\r\n\r\n" % (cseq, session))
+            if method == "TEARDOWN":
+                stop.set()
+        else:
+            reply("RTSP/1.0 404 Not Found\r\nCSeq: %s\r\n\r\n" % cseq)
+
+
+def serve(args):
+    server = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    server.bind((args.bind, args.port))
+    server.listen(64)
+    print("Fake camera on rtsp://%s:%d%s%s" % (args.bind, args.port, args.path,
+                                               " (Digest %s)" % args.user if args.user else ""))
+    while True:
+        conn, _ = server.accept()
+        threading.Thread(target=serve_client, args=(conn, args), daemon=True).start()
+
+
+def describe(host, port, path, user, password):
+    url = "rtsp://%s:%d%s" % (host, port, path)
+    started = time.monotonic()
+    try:
+        with socket.create_connection((host, port), timeout=3) as conn:
+            conn.sendall(("DESCRIBE %s RTSP/1.0\r\nCSeq: 1\r\nAccept: application/sdp\r\n\r\n" % url).encode())
+            head, body = read_message(conn)
+            if " 401 " in head.split("\r\n")[0] and user:
+                params = dict(re.findall(r'(\w+)="?([^",]*)"?', header(head, "WWW-Authenticate")))
+                ha1 = md5("%s:%s:%s" % (user, params.get("realm", ""), password))
+                response = md5("%s:%s:%s" % (ha1, params.get("nonce", ""), md5("DESCRIBE:" + url)))
+                auth = ('Digest username="%s", realm="%s", nonce="%s", uri="%s", response="%s"'
+                        % (user, params.get("realm", ""), params.get("nonce", ""), url, response))
+                conn.sendall(("DESCRIBE %s RTSP/1.0\r\nCSeq: 2\r\nAccept: application/sdp\r\n"
+                              "Authorization: %s\r\n\r\n" % (url, auth)).encode())
+                head, body = read_message(conn)
+            ok = " 200 " in head.split("\r\n")[0] and b"m=video" in body
+    except (OSError, TypeError):
+        ok = False
+    return path, ok, (time.monotonic() - started) * 1000
+
+
+def probe(args):
+    for parallel in (1, args.parallel):
+        started = time.monotonic()
+        with ThreadPoolExecutor(max_workers=parallel) as pool:
+            results = list(pool.map(lambda p: describe(args.probe, args.port, p, args.user, args.password),
+                                    GENERIC_PATHS))
+        found = next((path for path, ok, _ in results if ok), None)
+        print("%d at a time: %s in %.0f ms" % (parallel, found or "no stream", (time.monotonic() - started) * 1000))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Fake RTSP camera / stream URL probe")
+    parser.add_argument("--bind", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=8554)
+    parser.add_argument("--path", default="/streaming/channels/1")
+    parser.add_argument("--user", default="")
+    parser.add_argument("--password", default="")
+    parser.add_argument("--delay", type=int, default=100, help="ms before each reply")
+    parser.add_argument("--rtp-seconds", type=float, default=0, help="stop RTP (not RTCP) after this long, 0 = never")
+    parser.add_argument("--probe", metavar="HOST")
+    parser.add_argument("--parallel", type=int, default=2)
+    args = parser.parse_args()
+
+    if args.probe:
+        probe(args)
+    else:
+        serve(args)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,168 @@
+#!/usr/bin/env python3
+"""
+Network Sweep Timing Script
+Compares the two port-sweep strategies used by NetworkScanner:
+
+  blocking - the old scanner: a 50-thread pool, one task per host, each task
+             trying the ports one after another with a 200 ms blocking connect
+  async    - the current scanner: non-blocking connects from one thread with a
+             sliding window of concurrent probes and a per-probe deadline
+
+Besides the sweep time it prints when the first open port became available to
+identification: the old scanner only emitted hits after the whole sweep, the
+current one emits each hit as soon as its connect succeeds.
+
+With --neighbors the async sweep is ordered the way CameraDiscovery seeds it
+from the Linux ARP cache: live neighbors first ("seed"), and additionally
+without addresses whose ARP resolution failed ("skip"). Run it twice in a row
+on a busy segment to see the rescan case, where the cache is warm.
+
+Usage: scan_sweep.py <cidr> [--mode blocking|async|both] [--window N] [--timeout MS] [--neighbors seed|skip]
+Example: scan_sweep.py 192.168.1.0/24 --mode both
+"""
+
+import argparse
+import asyncio
+import ipaddress
+import socket
+import sys
+import time
+from concurrent.futures import ThreadPoolExecutor
+
+PRIORITY_PORTS = [80, 554]
+OTHER_PORTS = [8080, 8081, 443, 8000, 8443, 88, 8088]
+
+
+def read_neighbors(path="/proc/net/arp"):
+    """(live, failed) address sets from the kernel ARP cache"""
+    live, failed = set(), set()
+    try:
+        with open(path) as arp:
+            next(arp)
+            for line in arp:
+                fields = line.split()
+                if len(fields) < 6:
+                    continue
+                (live if int(fields[2], 16) & 0x2 else failed).add(fields[0])
+    except (OSError, StopIteration, ValueError):
+        pass
+    return live, failed
+
+
+def order_by_neighbors(hosts, mode):
+    live, failed = read_neighbors()
+    first = [h for h in hosts if h in live]
+    rest = [h for h in hosts if h not in live and not (mode == "skip" and h in failed)]
+    print(f"neighbors: {len(first)} live first, {len(hosts) - len(first) - len(rest)} unresolved skipped")
+    return first, rest
+
+
+def blocking_probe(host, port, timeout):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    sock.settimeout(timeout)
+    try:
+        sock.connect((host, port))
+        return True
+    except OSError:
+        return False
+    finally:
+        sock.close()
+
+
+def blocking_host(host, timeout):
+    """One thread-pool task of the old scanner"""
+    for port in PRIORITY_PORTS:
+        if blocking_probe(host, port, timeout):
+            return [(host, port)]
+    return [(host, port) for port in OTHER_PORTS if blocking_probe(host, port, timeout)]
+
+
+def sweep_blocking(hosts, threads=50, timeout=0.2):
+    found = []
+    with ThreadPoolExecutor(max_workers=threads) as pool:
+        for result in pool.map(lambda h: blocking_host(h, timeout), hosts):
+            found.extend(result)
+    return found
+
+
+async def async_probe(host, port, timeout):
+    try:
+        _, writer = await asyncio.wait_for(asyncio.open_connection(host, port), timeout)
+        writer.close()
+        return True
+    except (OSError, asyncio.TimeoutError):
+        return False
+
+
+async def sweep_async(hosts, window_size=1024, timeout=0.3, first_hit=None, seeds=()):
+    found = []
+    answered = set()
+
+    # Same order as NetworkScanner: priority ports of seeded hosts, priority ports for
+    # every other host, then the rest; hosts that already answered on a priority port
+    # are skipped when dequeued
+    def generate():
+        for p in PRIORITY_PORTS:
+            for h in seeds:
+                yield h, p
+        for p in PRIORITY_PORTS:
+            for h in hosts:
+                yield h, p
+        for p in OTHER_PORTS:
+            for h in list(seeds) + list(hosts):
+                yield h, p
+
+    targets = generate()
+
+    async def worker():
+        for host, port in targets:
+            if host in answered:
+                continue
+            if await async_probe(host, port, timeout):
+                if first_hit is not None and not first_hit:
+                    first_hit.append(time.monotonic())
+                answered.add(host)
+                found.append((host, port))
+
+    await asyncio.gather(*(worker() for _ in range(window_size)))
+    return found
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Time a camera port sweep")
+    parser.add_argument("cidr")
+    parser.add_argument("--mode", choices=["blocking", "async", "both"], default="both")
+    parser.add_argument("--window", type=int, default=1024, help="Concurrent probes (async)")
+    parser.add_argument("--timeout", type=int, default=300, help="Probe deadline in ms (async)")
+    parser.add_argument("--neighbors", choices=["seed", "skip"], help="Use the ARP cache (async)")
+    args = parser.parse_args()
+
+    try:
+        hosts = [str(h) for h in ipaddress.ip_network(args.cidr, strict=False).hosts()]
+    except ValueError as e:
+        print(f"Invalid range: {e}")
+        return 1
+
+    print(f"Sweeping {len(hosts)} hosts x {len(PRIORITY_PORTS) + len(OTHER_PORTS)} ports in {args.cidr}")
+
+    if args.mode in ("blocking", "both"):
+        start = time.monotonic()
+        found = sweep_blocking(hosts)
+        elapsed = time.monotonic() - start
+        first = f", first hit after {elapsed:.2f} s" if found else ""
+        print(f"blocking: {elapsed:8.2f} s, {len(found)} open ports{first}")
+
+    if args.mode in ("async", "both"):
+        start = time.monotonic()
+        first_hit = []
+        seeds, rest = order_by_neighbors(hosts, args.neighbors) if args.neighbors else ([], hosts)
+        found = asyncio.run(sweep_async(rest, args.window, args.timeout / 1000.0, first_hit, seeds))
+        elapsed = time.monotonic() - start
+        first = f", first hit after {first_hit[0] - start:.2f} s" if first_hit else ""
+        print(f"async:    {elapsed:8.2f} s, {len(found)} open ports{first}")
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,193 @@
+/*
+ * Device Signature Benchmark
+ * Compares brand/model/name detection on captured HTTP responses:
+ *
+ *   legacy   - the old CameraDiscovery code: lower-case a copy of body + headers,
+ *              run a chain of contains() calls, and build every QRegularExpression
+ *              on each call
+ *   engine   - DeviceSignatures: one Aho-Corasick pass over the raw bytes, with
+ *              precompiled expressions run only when their keyword occurred
+ *
+ * Both must agree on every response; disagreements are printed and make the exit
+ * status non-zero.
+ *
+ * Build:   cmake -S . -B build -DVISCO_BUILD_BENCHMARKS=ON && cmake --build build --target signature_bench
+ * Usage:   signature_bench [corpus-dir] [iterations]
+ * Example: signature_bench benchmarks/corpus/http 20000
+ */
+
+#include "DeviceSignatures.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QElapsedTimer>
+#include <QRegularExpression>
+#include <QTextStream>
+
+namespace {
+struct Sample {
+    QString name;
+    QByteArray body;
+    QByteArray headers;         // "Name: value\n" per header, as CameraDiscovery builds them
+};
+
+// Verbatim copy of the detection removed from CameraDiscovery
+QString legacyBrand(const QString& response, const QString& headers)
+{
+    QString combined = (response + " " + headers).toLower();
+    if (combined.contains("hikvision") || combined.contains("hik-connect") || combined.contains("webrec.htm") ||
+        combined.contains("server: app-webs/") || combined.contains("ds-") || combined.contains("/PSIA/")) {
+        return "Hikvision";
+    }
+    if (combined.contains("cp plus") || combined.contains("cpplus") || combined.contains("cp-plus") ||
+        combined.contains("aditya") || combined.contains("guard") || combined.contains("realmonitor")) {
+        return "CP Plus";
+    }
+    if (combined.contains("dahua")) return "Dahua";
+    if (combined.contains("axis")) return "Axis";
+    if (combined.contains("vivotek")) return "Vivotek";
+    if (combined.contains("foscam")) return "Foscam";
+    if (combined.contains("acti")) return "ACTi";
+    if (combined.contains("bosch")) return "Bosch";
+    if (combined.contains("panasonic")) return "Panasonic";
+    if (combined.contains("sony")) return "Sony";
+    return "Generic";
+}
+
+QString legacyModel(const QString& response, const QString& brand)
+{
+    if (brand == "Hikvision") {
+        QRegularExpressionMatch match = QRegularExpression(R"((DS-\w+[\w-]*))").match(response);
+        return match.hasMatch() ? match.captured(1) : QString("Hikvision Camera");
+    } else if (brand == "CP Plus") {
+        QRegularExpressionMatch match = QRegularExpression(R"((CP-[\w-]+))").match(response);
+        return match.hasMatch() ? match.captured(1) : QString("CP Plus Camera");
+    }
+    QRegularExpression modelRegex(R"(model["\s]*[:=]["\s]*([^"<>\s]+))", QRegularExpression::CaseInsensitiveOption);
+    QRegularExpressionMatch match = modelRegex.match(response);
+    return match.hasMatch() ? match.captured(1).trimmed() : QString("Unknown");
+}
+
+QString legacyName(const QString& response)
+{
+    QRegularExpression titleRegex(R"(<title[^>]*>([^<]+)</title>)", QRegularExpression::CaseInsensitiveOption);
+    QRegularExpressionMatch match = titleRegex.match(response);
+    if (match.hasMatch()) {
+        QString title = match.captured(1).trimmed();
+        if (!title.isEmpty() && title != "Document") {
+            return title;
+        }
+    }
+    QRegularExpression nameRegex(R"(device[_\s]*name["\s]*[:=]["\s]*([^"<>\s]+))", QRegularExpression::CaseInsensitiveOption);
+    match = nameRegex.match(response);
+    if (match.hasMatch()) {
+        return match.captured(1).trimmed();
+    }
+    return QString("Camera_%1").arg(QString(response.left(100).toUtf8().toHex()).left(8));
+}
+
+DeviceIdentity legacyIdentify(const Sample& sample)
+{
+    // The old onHttpResponse decoded both buffers before analysis
+    QString response = QString::fromUtf8(sample.body);
+    QString headers = QString::fromUtf8(sample.headers);
+    DeviceIdentity identity;
+    identity.brand = legacyBrand(response, headers);
+    identity.model = legacyModel(response, identity.brand);
+    identity.deviceName = legacyName(response);
+    return identity;
+}
+
+bool loadSample(const QString& path, Sample& sample)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QByteArray raw = file.readAll();
+    raw.replace("\r\n", "\n");
+    int split = raw.indexOf("\n\n");
+    if (split < 0) {
+        return false;
+    }
+
+    sample.name = QFileInfo(path).fileName();
+    sample.body = raw.mid(split + 2);
+    const QList<QByteArray> lines = raw.left(split).split('\n');
+    for (int i = 1; i < lines.size(); ++i) {    // Skip the status line
+        int colon = lines.at(i).indexOf(':');
+        if (colon > 0) {
+            sample.headers += lines.at(i).left(colon) + ": " + lines.at(i).mid(colon + 1).trimmed() + '\n';
+        }
+    }
+    return true;
+}
+
+template <typename Identify>
+double microsecondsPerResponse(const QVector<Sample>& corpus, int iterations, Identify identify)
+{
+    int sink = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < iterations; ++i) {
+        for (const Sample& sample : corpus) {
+            sink += identify(sample).brand.size();
+        }
+    }
+    qint64 elapsed = timer.nsecsElapsed();
+    return sink ? elapsed / 1000.0 / (double(iterations) * corpus.size()) : 0.0;
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    const QStringList args = app.arguments();
+    const QString corpusDir = args.size() > 1 ? args.at(1) : QString("benchmarks/corpus/http");
+    const int iterations = args.size() > 2 ? qMax(1, args.at(2).toInt()) : 10000;
+
+    QVector<Sample> corpus;
+    QDir dir(corpusDir);
+    for (const QString& file : dir.entryList(QStringList() << "*.txt", QDir::Files, QDir::Name)) {
+        Sample sample;
+        if (loadSample(dir.filePath(file), sample)) {
+            corpus.append(sample);
+        }
+    }
+    if (corpus.isEmpty()) {
+        out << "No responses found in " << corpusDir << Qt::endl;
+        return 1;
+    }
+
+    const DeviceSignatures& signatures = DeviceSignatures::instance();
+    auto engineIdentify = [&signatures](const Sample& sample) {
+        return signatures.identifyHttp(sample.body, sample.headers);
+    };
+
+    int mismatches = 0;
+    for (const Sample& sample : corpus) {
+        DeviceIdentity legacy = legacyIdentify(sample);
+        DeviceIdentity engine = engineIdentify(sample);
+        const bool same = legacy.brand == engine.brand && legacy.model == engine.model &&
+                          legacy.deviceName == engine.deviceName;
+        out << QString("%1 %2  %3 / %4 / %5").arg(same ? "  " : "!!").arg(sample.name, -36)
+                   .arg(engine.brand, engine.model, engine.deviceName) << Qt::endl;
+        if (!same) {
+            out << QString("     legacy: %1 / %2 / %3").arg(legacy.brand, legacy.model, legacy.deviceName) << Qt::endl;
+            ++mismatches;
+        }
+    }
+
+    double legacyUs = microsecondsPerResponse(corpus, iterations, legacyIdentify);
+    double engineUs = microsecondsPerResponse(corpus, iterations, engineIdentify);
+    out << Qt::endl;
+    out << QString("%1 responses x %2 iterations").arg(corpus.size()).arg(iterations) << Qt::endl;
+    out << QString("  legacy: %1 us/response").arg(legacyUs, 0, 'f', 2) << Qt::endl;
+    out << QString("  engine: %1 us/response (%2x)").arg(engineUs, 0, 'f', 2)
+               .arg(engineUs > 0 ? legacyUs / engineUs : 0.0, 0, 'f', 1) << Qt::endl;
+
+    return mismatches ? 1 : 0;
+}
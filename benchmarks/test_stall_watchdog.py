@@ -0,0 +1,104 @@
+#!/usr/bin/env python3
+"""
+Upstream Stall Watchdog Test
+Runs the fake camera from rtsp_camera.py in-process with RTP that stops after
+--rtp-seconds while RTCP sender reports keep coming, plays its stream through the
+relay over interleaved TCP, and checks that the relay still treats the camera as
+stalled: it has to reconnect upstream (a second PLAY reaches the camera) within
+--timeout seconds, although RTCP never stopped.
+
+Set up a camera in the app pointing at 127.0.0.1:<camera-port> before running;
+its stall timeout (10 s unless the brand sets another) has to fit in --timeout.
+
+Usage: test_stall_watchdog.py <relay_host> <relay_port> [--camera-port 8554] [--rtp-seconds 3] [--timeout 30]
+Example: test_stall_watchdog.py 127.0.0.1 8551
+"""
+
+import argparse
+import socket
+import struct
+import sys
+import threading
+import time
+
+import rtsp_camera
+
+
+def request(sock, method, url, cseq, extra=""):
+    sock.sendall(("%s %s RTSP/1.0\r\nCSeq: %d\r\n%s\r\n" % (method, url, cseq, extra)).encode())
+    message = rtsp_camera.read_message(sock)
+    if message is None or " 200 " not in message[0].split("\r\n")[0]:
+        raise RuntimeError("%s failed: %s" % (method, message[0] if message else "connection closed"))
+    return message[0]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Check that an RTCP-only stream still trips the stall watchdog")
+    parser.add_argument("host")
+    parser.add_argument("port", type=int)
+    parser.add_argument("--camera-port", type=int, default=8554)
+    parser.add_argument("--path", default="/streaming/channels/1")
+    parser.add_argument("--rtp-seconds", type=float, default=3)
+    parser.add_argument("--timeout", type=float, default=30)
+    args = parser.parse_args()
+
+    camera_args = argparse.Namespace(bind="127.0.0.1", port=args.camera_port, path=args.path, user="",
+                                     password="", delay=0, rtp_seconds=args.rtp_seconds)
+    threading.Thread(target=rtsp_camera.serve, args=(camera_args,), daemon=True).start()
+    time.sleep(0.5)
+
+    url = "rtsp://%s:%d%s" % (args.host, args.port, args.path)
+    sock = socket.create_connection((args.host, args.port), timeout=5)
+    request(sock, "DESCRIBE", url, 1, "Accept: application/sdp\r\n")
+    head = request(sock, "SETUP", url + "/trackID=1", 2, "Transport: RTP/AVP/TCP;unicast;interleaved=0-1\r\n")
+    session = rtsp_camera.header(head, "Session").split(";")[0]
+    request(sock, "PLAY", url, 3, "Session: %s\r\n" % session)
+    print("Playing %s through the relay; RTP stops after %.0f s, RTCP continues" % (url, args.rtp_seconds))
+
+    # Count interleaved frames per channel until the relay brings up a new upstream
+    counts = {0: 0, 1: 0}
+    last_rtp = time.monotonic()
+    rtcp_during_gap = 0
+    buffer = b""
+    started = time.monotonic()
+    sock.settimeout(0.5)
+    while time.monotonic() - started < args.timeout:
+        with rtsp_camera.stats_lock:
+            plays = rtsp_camera.stats["plays"]
+        if plays >= 2:
+            break
+        try:
+            chunk = sock.recv(65536)
+        except socket.timeout:
+            continue
+        if not chunk:
+            break
+        buffer += chunk
+        while len(buffer) >= 4 and buffer[0] == 0x24:
+            channel, length = buffer[1], struct.unpack("!H", buffer[2:4])[0]
+            if len(buffer) < 4 + length:
+                break
+            buffer = buffer[4 + length:]
+            counts[channel % 2] += 1
+            if channel % 2 == 0:
+                last_rtp = time.monotonic()
+            elif time.monotonic() - last_rtp > 1.0:
+                rtcp_during_gap += 1
+        if buffer and buffer[0] != 0x24:
+            buffer = buffer[buffer.find(b"$") if b"$" in buffer else len(buffer):]
+    sock.close()
+
+    elapsed = time.monotonic() - started
+    print("RTP packets: %d, RTCP reports: %d (%d after RTP stopped), camera PLAYs: %d"
+          % (counts[0], counts[1], rtcp_during_gap, plays))
+    if plays < 2:
+        print("FAIL: no upstream reconnect within %.0f s" % args.timeout)
+        sys.exit(1)
+    if rtcp_during_gap == 0:
+        print("FAIL: reconnected, but no RTCP arrived while RTP was stopped, so the case was not exercised")
+        sys.exit(1)
+    print("PASS: upstream reconnected after %.1f s while only RTCP was flowing" % elapsed)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,44 @@
+# Compiles resources/camera_oui.txt into a sorted C++ initializer list for OuiTable.
+# Run as: cmake -DINPUT=<camera_oui.txt> -DOUTPUT=<CameraOuiTable.inc> -P GenerateOuiTable.cmake
+
+if(NOT INPUT OR NOT OUTPUT)
+    message(FATAL_ERROR "GenerateOuiTable.cmake needs -DINPUT and -DOUTPUT")
+endif()
+
+file(STRINGS "${INPUT}" LINES)
+
+set(ENTRIES "")
+set(SEEN "")
+foreach(LINE IN LISTS LINES)
+    string(STRIP "${LINE}" LINE)
+    if(LINE STREQUAL "" OR LINE MATCHES "^#")
+        continue()
+    endif()
+
+    if(NOT LINE MATCHES "^([0-9A-Fa-f][0-9A-Fa-f])[:-]?([0-9A-Fa-f][0-9A-Fa-f])[:-]?([0-9A-Fa-f][0-9A-Fa-f])[ \t]*,[ \t]*(.+)$")
+        message(FATAL_ERROR "${INPUT}: cannot parse '${LINE}'")
+    endif()
+    string(TOUPPER "${CMAKE_MATCH_1}${CMAKE_MATCH_2}${CMAKE_MATCH_3}" OUI)
+    string(STRIP "${CMAKE_MATCH_4}" BRAND)
+
+    list(FIND SEEN "${OUI}" DUPLICATE)
+    if(NOT DUPLICATE EQUAL -1)
+        message(FATAL_ERROR "${INPUT}: OUI ${OUI} is listed twice")
+    endif()
+    list(APPEND SEEN "${OUI}")
+
+    # Fixed-width upper-case hex sorts in numeric order
+    list(APPEND ENTRIES "${OUI}|${BRAND}")
+endforeach()
+
+list(SORT ENTRIES)
+
+set(CONTENT "// Generated from camera_oui.txt by GenerateOuiTable.cmake - do not edit\n")
+foreach(ENTRY IN LISTS ENTRIES)
+    string(REPLACE "|" ";" FIELDS "${ENTRY}")
+    list(GET FIELDS 0 OUI)
+    list(GET FIELDS 1 BRAND)
+    string(APPEND CONTENT "    {0x${OUI}, \"${BRAND}\"},\n")
+endforeach()
+
+file(WRITE "${OUTPUT}" "${CONTENT}")
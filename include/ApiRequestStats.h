@@ -0,0 +1,70 @@
+#ifndef APIREQUESTSTATS_H
+#define APIREQUESTSTATS_H
+
+#include <QHash>
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+
+// Timing of one API request, in ms from when it was issued; -1 where the phase did
+// not happen (a reused keep-alive connection has no lookup or handshake) or Qt
+// does not report it
+struct ApiRequestTiming {
+    qint64 connectStartMs = -1;     // A socket started connecting: DNS lookup and any wait for a connection before it
+    qint64 encryptedMs = -1;        // TLS handshake done
+    qint64 requestSentMs = -1;
+    qint64 firstByteMs = -1;        // Response headers in
+    qint64 totalMs = 0;
+};
+
+// Latency histograms and error counts per API operation (create, update, ...).
+// Each request contributes its phases: dns (until a socket started connecting),
+// connect (socket connecting until the request was written, TCP and TLS
+// handshakes included), tls (socket connecting until encrypted), first byte
+// (request written, or issued, until the response headers) and total.
+class ApiRequestStats
+{
+public:
+    enum ErrorClass {
+        NoError,
+        NetworkError,           // No response: refused, unreachable, reset
+        Timeout,
+        ClientError,            // 4xx
+        ServerError             // 5xx
+    };
+
+    void record(const QString& operation, const ApiRequestTiming& timing, ErrorClass error);
+    void clear() { m_operations.clear(); }
+
+    int requestCount(const QString& operation) const;
+    int percentile(const QString& operation, int percent) const;    // Total ms, estimated from buckets; -1 without data
+    QJsonObject toJson() const;
+    QString summary() const;        // "create 12 req p50 85 ms p95 240 ms, 1 errors; ..." for the log
+
+private:
+    struct Histogram {
+        QList<int> buckets;         // Counts per BUCKET_BOUNDS_MS entry, plus one for anything slower
+        int count = 0;
+        qint64 sumMs = 0;
+        qint64 maxMs = 0;
+
+        void add(qint64 milliseconds);
+        int percentile(int percent) const;
+        QJsonObject toJson() const;
+    };
+
+    struct Operation {
+        Histogram dns;
+        Histogram connect;
+        Histogram tls;
+        Histogram firstByte;
+        Histogram total;
+        int errors[ServerError + 1] = {};
+    };
+
+    QHash<QString, Operation> m_operations;
+
+    static const QList<int> BUCKET_BOUNDS_MS;
+};
+
+#endif // APIREQUESTSTATS_H
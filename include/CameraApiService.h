@@ -4,15 +4,23 @@
 #include <QObject>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
-#include <QQueue>
+#include <QList>
+#include <QStringList>
 #include <QTimer>
 #include <QJsonObject>
 #include <QDateTime>
 #include <QString>
 #include <QHash>
+#include <QSet>
+#include <QElapsedTimer>
 #include "CameraConfig.h"
+#include "CircuitBreaker.h"
+#include "ApiRequestStats.h"
 #include "WireGuardManager.h"
 
+class SyncJournal;
+class NetworkInterfaceManager;
+
 // Enum for sync operation types
 enum class SyncOperationType {
     CREATE,
@@ -30,10 +38,13 @@ struct SyncOperation {
     QString status; // For status updates
     QString serverCameraId; // Server-assigned camera ID
     int timestamp;
+    quint64 journalId; // Key in the sync journal; 0 if not journaled
+    int attempts; // Sends the server answered with an error, this run
+    qint64 retryAtMs; // Not resent before this time on the service's clock
     
-    SyncOperation() : timestamp(QDateTime::currentSecsSinceEpoch()) {}
+    SyncOperation() : timestamp(QDateTime::currentSecsSinceEpoch()), journalId(0), attempts(0), retryAtMs(0) {}
     SyncOperation(SyncOperationType t, const QString& id, const CameraConfig& cam = CameraConfig(), const QString& st = QString(), const QString& sId = QString())
-        : type(t), localCameraId(id), camera(cam), status(st), serverCameraId(sId), timestamp(QDateTime::currentSecsSinceEpoch()) {}
+        : type(t), localCameraId(id), camera(cam), status(st), serverCameraId(sId), timestamp(QDateTime::currentSecsSinceEpoch()), journalId(0), attempts(0), retryAtMs(0) {}
 };
 
 class CameraApiService : public QObject
@@ -55,8 +66,12 @@ public:
 
     // Sync management
     void processSyncQueue();
+    void setSyncConcurrency(int count);     // Requests in flight while draining the queue
     bool isOnline() const { return m_isOnline; }
-    int pendingSyncCount() const { return m_syncQueue.size(); }
+    int pendingSyncCount() const { return m_syncQueueSize + m_syncInFlight.size(); }
+    void setNetworkInterfaceManager(NetworkInterfaceManager* manager);  // Interface changes prompt a connectivity check
+    const ApiRequestStats& requestStatistics() const { return m_requestStats; }   // Latency and errors per operation
+    void resetRequestStatistics() { m_requestStats.clear(); }
 
     // Utility methods
     static QString constructRtspUrl(const CameraConfig& camera);
@@ -85,28 +100,117 @@ private slots:
     void onConfigChanged();
 
 private:
+    // The camera API and the stream service on port 8001 fail independently
+    enum class ApiEndpoint {
+        Cameras,
+        Streams
+    };
+    
+    void trackReply(QNetworkReply* reply, ApiEndpoint endpoint, const QString& operation);
+    void recordEndpointResult(ApiEndpoint endpoint, bool success, bool healthCheck);
+    void scheduleEndpointRetry(ApiEndpoint endpoint);
+    void onEndpointRetryTimeout(ApiEndpoint endpoint);
+    CircuitBreaker& breakerFor(ApiEndpoint endpoint);
+    void setOnline(bool online);
+    void onConnectivityHint(const QString& reason);
+    void checkConnectivityNow();
+    static bool isEndpointFailure(QNetworkReply* reply);
+    static ApiRequestStats::ErrorClass classifyReply(QNetworkReply* reply);
+    
     void queueOperation(const SyncOperation& operation);
-    void processNextSyncOperation();
+    void dispatchSyncOperations();
+    void reportSyncProgress();
+    void onSyncOperationFinished(QNetworkReply* reply);
+    void scheduleSyncRetry(qint64 retryAtMs);
+    bool canSendSyncOperation(const SyncOperation& operation) const;
+    QNetworkReply* sendSyncOperation(const SyncOperation& operation, const QString& token);
+    void assignServerCameraId(const QString& localCameraId, const QString& serverCameraId);
+    
+    // Requests without the queue/offline checks, shared by the public calls and the sync queue
+    QNetworkReply* sendCreateCamera(const CameraConfig& camera, const QString& token);
+    QNetworkReply* sendUpdateCamera(const CameraConfig& camera, const QString& token);
+    QNetworkReply* sendDeleteCamera(const QString& localCameraId, const QString& serverCameraId, const QString& token);
+    QNetworkReply* sendStartStream(const CameraConfig& camera, const QString& token);
     void handleApiResponse(QNetworkReply* reply, const QString& operation, const QString& cameraId);
-    void showApiError(const QString& operation, const QString& error);
+    void showApiError(QNetworkReply* reply, const QString& operation, const QString& error);
+    void markBackgroundReply(QNetworkReply* reply);
     QJsonObject cameraToApiJson(const CameraConfig& camera) const;
     QString getStatusString(bool isEnabled) const;
     QString getWireGuardIP() const;
-    void performCameraStatusUpdate(const QString& localCameraId, const QString& serverCameraId, const QString& status);
-    void performCameraStatusUpdateWithFullData(const CameraConfig& camera, bool isActive);
+    QNetworkReply* performCameraStatusUpdate(const QString& localCameraId, const QString& serverCameraId, const QString& status);
+    QNetworkReply* performCameraStatusUpdateWithFullData(const CameraConfig& camera, bool isActive);
+    
+    // Camera updates sent while online are collected for BATCH_WINDOW_MS and go out
+    // as POST /cameras/batch requests of up to BATCH_SIZE cameras each
+    struct BatchUpdate {
+        CameraConfig camera;
+        bool statusOnly;                        // Reported through cameraStatusUpdated, not cameraUpdated
+    };
+    void queueBatchUpdate(const CameraConfig& camera, bool statusOnly);
+    void flushBatchUpdates();
+    QNetworkReply* sendBatchUpdate(const QList<BatchUpdate>& updates, const QString& token);
+    void onBatchUpdateFinished(QNetworkReply* reply);
+    QNetworkReply* sendUpdateIndividually(const BatchUpdate& update, const QString& token);
+    void reportBatchUpdate(const BatchUpdate& update, bool success, const QString& error);
     
     QNetworkAccessManager* m_networkManager;
-    QQueue<SyncOperation> m_syncQueue;
+    
+    // Pending operations per camera, coalesced as they are queued: a later update or
+    // status change replaces an earlier one, a delete cancels an unsent create, and a
+    // repeated stream start is kept once
+    QHash<QString, QList<SyncOperation>> m_syncQueue;  // Local camera ID -> its operations, in send order
+    QStringList m_syncCameraOrder;              // Cameras in the order they were first queued
+    int m_syncQueueSize;                        // Operations across all cameras
+    SyncJournal* m_journal;                     // On-disk copy of the queue, replayed at startup
+    quint64 m_nextJournalId;
     QTimer* m_syncTimer;
     QTimer* m_connectivityTimer;
-    bool m_isOnline;
+    bool m_isOnline;                            // The camera API's breaker is closed
     bool m_isSyncing;
+    
+    // Per-service circuit breakers; while one is open, its retry timer fires at the
+    // breaker's jittered retry time to let the half-open probe through
+    CircuitBreaker m_camerasBreaker;
+    CircuitBreaker m_streamsBreaker;
+    QTimer* m_camerasRetryTimer;
+    QTimer* m_streamsRetryTimer;
+    QElapsedTimer m_clock;
+    ApiRequestStats m_requestStats;
+    
+    // Tunnel and interface changes, debounced into one immediate check; the
+    // connectivity timer is only a long-interval fallback
+    NetworkInterfaceManager* m_interfaceManager;
+    QTimer* m_connectivityHintTimer;
+    QString m_connectivityHintReason;
+    
+    // Sync queue executor: at most m_syncConcurrency requests in flight, one per camera
+    int m_syncConcurrency;
+    int m_syncCompleted;
+    QTimer* m_syncRetryTimer;                   // For the earliest operation held back after a server error
+    QHash<QNetworkReply*, SyncOperation> m_syncInFlight;
+    QSet<QString> m_syncBusyCameras;
     QString m_baseUrl;
     WireGuardManager* m_wireGuardManager;
     
     // Track ongoing operations to associate responses
     QHash<QNetworkReply*, QString> m_replyToOperationMap;
     QHash<QNetworkReply*, QString> m_replyCameraIdMap;
+    QSet<QNetworkReply*> m_backgroundReplies;   // Sync queue and batch requests: failures are logged, not shown
+    
+    QList<BatchUpdate> m_batchUpdates;          // Waiting for the batch window to close
+    QTimer* m_batchTimer;
+    bool m_batchEndpointAvailable;              // Until the server says otherwise; reset when the URL changes
+    QHash<QNetworkReply*, QList<BatchUpdate>> m_batchInFlight;
+    
+    static const int DEFAULT_SYNC_CONCURRENCY = 6;  // QNetworkAccessManager's connections per host
+    static const int MAX_SYNC_ATTEMPTS = 10;        // Server errors before an operation is given up on
+    static const int SYNC_RETRY_BASE_MS = 2000;     // Doubles with each server error
+    static const int SYNC_RETRY_MAX_MS = 5 * 60 * 1000;
+    static const int BATCH_SIZE = 50;               // Cameras per POST /cameras/batch request
+    static const int BATCH_WINDOW_MS = 50;
+    static const int REQUEST_TIMEOUT_MS = 30000;    // So a probe to a silent server still fails
+    static const int CONNECTIVITY_FALLBACK_MS = 10 * 60 * 1000;
+    static const int CONNECTIVITY_HINT_DELAY_MS = 250;  // Interface changes come in bursts
 };
 
 #endif // CAMERAAPISERVICE_H
@@ -22,7 +22,8 @@ public:
     QString model() const { return m_model; }
     int serverId() const { return m_serverId; }
     QString serverCameraId() const { return m_serverCameraId; }
-    QString streamName() const { return m_streamName; }    // Setters
+    QString streamName() const { return m_streamName; }
+    bool adaptiveSubstream() const { return m_adaptiveSubstream; }    // Setters
     void setName(const QString& name) { m_name = name; }
     void setIpAddress(const QString& ipAddress) { m_ipAddress = ipAddress; }
     void setPort(int port) { m_port = port; }
@@ -35,6 +36,7 @@ public:
     void setServerId(int serverId) { m_serverId = serverId; }
     void setServerCameraId(const QString& serverCameraId) { m_serverCameraId = serverCameraId; }
     void setStreamName(const QString& streamName) { m_streamName = streamName; }
+    void setAdaptiveSubstream(bool adaptive) { m_adaptiveSubstream = adaptive; }
 
     // JSON serialization
     QJsonObject toJson() const;
@@ -57,6 +59,7 @@ private:
     int m_serverId;
     QString m_serverCameraId;
     QString m_streamName;
+    bool m_adaptiveSubstream;   // Relay may fall back to the substream under bandwidth pressure
 };
 
 #endif // CAMERACONFIG_H
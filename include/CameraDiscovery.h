@@ -11,6 +11,23 @@
 #include <QThread>
 #include <QMutex>
 #include <QStringList>
+#include <QHash>
+#include <QSet>
+#include <QQueue>
+#include <QMap>
+#include <QElapsedTimer>
+#include <QScopedPointer>
+#include "ScanTargetSpace.h"
+#include "NeighborTable.h"
+#include "OnvifDiscovery.h"
+#include "SsdpDiscovery.h"
+#include "MdnsDiscovery.h"
+#include "RtspUrlProber.h"
+#include "RttEstimator.h"
+
+class DiscoveryCache;
+
+class QEventLoop;
 
 // Discovered camera information
 struct DiscoveredCamera
@@ -22,13 +39,26 @@ struct DiscoveredCamera
     QString macAddress;
     QString deviceName;
     QString rtspUrl;        // Suggested RTSP URL format
+    bool rtspVerified;      // rtspUrl answered DESCRIBE with a video SDP
+    QString videoCodec;     // From that SDP
+    int videoWidth;         // 0 if unknown
+    int videoHeight;
     QStringList supportedPorts; // Common ports found open
     bool isOnline;
-    int responseTime;       // Ping response time in ms
+    int responseTime;       // TCP connect round trip in ms, -1 if not measured
 
-    DiscoveredCamera() : port(554), isOnline(false), responseTime(-1) {}
+    DiscoveredCamera() : port(554), rtspVerified(false), videoWidth(0), videoHeight(0), isOnline(false), responseTime(-1) {}
 };
 
+// Port sweep over a set of address ranges (see ScanTargetSpace). All connect probes
+// are non-blocking and driven from the scanner thread's own event loop, so thousands
+// can be in flight at once without a thread per host; a sliding window bounds how
+// many run concurrently. Each /24 gets a connect timeout derived from the round
+// trips measured there (see RttEstimator), so a silent address on the local switch
+// is given up on in tens of milliseconds while a routed site keeps a longer wait.
+// Targets come from a seeded permutation rather than a list, so a stopped sweep can
+// be resumed from a small ScanCursor. Priority hosts (known to be alive) get their
+// priority-port probes before the sweep proper starts.
 class NetworkScanner : public QThread
 {
     Q_OBJECT
@@ -36,21 +66,79 @@ class NetworkScanner : public QThread
 public:
     explicit NetworkScanner(const QString& networkRange, QObject *parent = nullptr);
     void setPortRange(const QList<int>& ports);
+    void setMaxConcurrentProbes(int count);
+    void setProbeTimeout(int milliseconds);     // Used until a subnet's round trips are measured
+    void setResumeCursor(const ScanCursor& cursor);
+    void setPriorityHosts(const QList<quint32>& addresses);    // Probed before the sweep, e.g. known neighbors
+    void skipHost(quint32 address);     // Already identified another way; may be called while running
     void stop();
+    
+    // Valid after a stopped sweep has finished running
+    ScanCursor resumeCursor() const;
 
 protected:
     void run() override;
 
 signals:
-    void deviceFound(const QString& ipAddress, int port);
+    void deviceFound(const QString& ipAddress, int port, int connectMs);
     void scanProgress(int current, int total);
     void scanFinished();
 
 private:
+    struct Probe {
+        QTcpSocket* socket;
+        quint32 address;
+        int port;
+        quint64 position;               // ScanOrder position that produced it
+        bool seed;                      // Priority host probe, not from the permutation
+        qint64 launchedAt;              // m_clock time
+    };
+    
+    void startPhase(int phase, quint64 position);
+    void launchProbes();
+    void finishProbe(quint64 probeId, bool open, bool refused = false);
+    void expireProbes();
+    bool isStopping();
+
     QString m_networkRange;
     QList<int> m_ports;
+    int m_maxConcurrentProbes;
+    int m_probeTimeout;
     bool m_shouldStop;
-    QMutex m_mutex;
+    mutable QMutex m_mutex;
+    
+    QList<quint32> m_priorityHosts;
+    ScanCursor m_resumeFrom;
+    ScanCursor m_stoppedAt;
+    
+    // Scan state, only touched from the scanner thread. Priority ports for every
+    // host are swept first, then the remaining ports of hosts that stayed silent.
+    ScanTargetSpace m_space;
+    QList<int> m_phasePorts[2];
+    int m_phase;
+    quint64 m_seed;
+    ScanOrder m_order;
+    int m_total;
+    QHash<quint64, Probe> m_inFlight;
+    QMultiMap<qint64, quint64> m_deadlines;       // Deadline -> probe id; timeouts differ per subnet
+    RttEstimator m_rtt;
+    QSet<quint32> m_hostsFound;
+    QList<QPair<quint32, int>> m_seedTargets;     // Priority hosts x priority ports
+    int m_nextSeed;
+    int m_seedsInFlight;
+    QSet<quint32> m_seededHosts;                  // Left out of the priority-port phase
+    QSet<quint32> m_skipHosts;
+    QSet<quint32> m_pendingSkips;                 // Handed over from other threads under m_mutex
+    quint64 m_nextProbeId;
+    int m_completed;
+    bool m_launching;
+    QElapsedTimer m_clock;
+    QEventLoop* m_loop;
+    
+    static const int DEFAULT_MAX_CONCURRENT_PROBES = 1024;
+    static const int DEFAULT_PROBE_TIMEOUT_MS = 300;
+    static const int DEADLINE_CHECK_INTERVAL_MS = 20;
+    static const int PROGRESS_INTERVAL = 64;
 };
 
 class CameraDiscovery : public QObject
@@ -70,16 +158,30 @@ public:
     void setNetworkRange(const QString& range);
     void setTimeout(int milliseconds);
     void setMaxConcurrentRequests(int count);
+    void setScanConcurrency(int probes);
+    void setProbeTimeout(int milliseconds);
+    void setSkipUnresolvedNeighbors(bool skip);     // Leave out addresses whose ARP resolution failed
+    void setRtspCredentials(const QString& username, const QString& password);   // For stream URL probes
+    void setUseCache(bool use);         // Confirm cameras from earlier runs before sweeping (default on)
+
+    // Range syntax: "10.0.0.0/16, 192.168.1.10-192.168.1.50, !10.0.5.0/24"
+    static bool validateNetworkRange(const QString& range, QString* error = nullptr);
+    
+    // A stopped discovery can continue where its sweep left off
+    bool canResume() const;
+    void resumeDiscovery();
 
     // State
     bool isDiscovering() const;
     QList<DiscoveredCamera> getDiscoveredCameras() const;
     void clearDiscoveredCameras();
+    qint64 timeToFirstCamera() const;   // ms from start, -1 until a camera is identified
 
     // Static utility methods
     static QString detectNetworkRange();
     static QString brandFromResponse(const QString& response, const QString& userAgent = QString());
     static QString generateRtspUrl(const QString& brand, const QString& ipAddress, int port = 554);
+    static QString normalizeMacAddress(const QString& macAddress);
     static QStringList getCommonRtspPaths(const QString& brand);
 
 signals:
@@ -87,51 +189,108 @@ signals:
     void discoveryFinished();
     void discoveryProgress(int current, int total);
     void cameraDiscovered(const DiscoveredCamera& camera);
+    void cameraUpdated(const DiscoveredCamera& camera);     // Same IP identified again with more detail
     void error(const QString& errorMessage);
 
 private slots:
-    void onDeviceFound(const QString& ipAddress, int port);
+    void onDeviceFound(const QString& ipAddress, int port, int connectMs);
+    void onHttpHeaders();
+    void onHttpReadyRead();
     void onHttpResponse();
-    void onHttpError(QNetworkReply::NetworkError error);
     void onScanProgress(int current, int total);
     void onScanFinished();
     void onPingFinished();
+    void onOnvifDeviceFound(const OnvifDevice& device);
+    void onSsdpDeviceFound(const SsdpDevice& device);
+    void onMdnsServiceFound(const MdnsService& service);
+    void onRtspProbeFinished(const RtspProbeResult& result);
 
 private:
     // Network scanning
-    void initializeScanner();
+    void beginDiscovery(const QString& networkRange, const ScanCursor& cursor);
+    void initializeScanner(const ScanCursor& cursor);
     void startNetworkScan();
+    void startSweep(const ScanCursor& cursor);
+    bool revalidateCachedCameras();     // False if there was nothing to confirm
+    void finishRevalidation(QTcpSocket* socket, bool open);
+    void persistDiscoveredCameras();
     QString getDefaultNetworkRange();
     
-    // Device identification
-    void identifyDevice(const QString& ipAddress, int port);
-    void sendHttpRequest(const QString& ipAddress, int port, const QString& path = "/");
-    void sendOnvifDiscovery(const QString& ipAddress);
+    // Device identification, fed port hits as the scanner finds them
+    struct IdentifyRequest {
+        QString ipAddress;
+        int port;
+        QString path;                   // Empty for an RTSP OPTIONS probe
+        bool brandProbe;                // Only asks which vendor this is; dropped once that is known
+    };
+    
+    struct HttpProbe {
+        IdentifyRequest request;
+        QByteArray body;                // At most HTTP_READ_LIMIT bytes
+    };
+    
+    void identifyDevice(const QString& ipAddress, int port, bool probeVendorPaths = true);
+    QString brandFromNeighbor(const QString& ipAddress);    // By MAC OUI; empty if unknown
+    void dispatchRequests();
+    void sendHttpRequest(const IdentifyRequest& request, int timeout);
+    void completeHttpProbe(QNetworkReply* reply, bool analyze);
+    void cancelBrandProbes(const QString& ipAddress);
+    void releaseRequest(const QString& ipAddress);
+    void sendRtspOptions(const QString& ipAddress, int port, int timeout);
+    void handleRtspReply(QTcpSocket* socket);
+    void finishRtspProbe(QTcpSocket* socket);
+    void recordCamera(const DiscoveredCamera& camera);
+    static bool mergeCamera(DiscoveredCamera& existing, const DiscoveredCamera& update);
+    static bool isPlaceholderName(const QString& deviceName);
+    void recordAnnouncedCamera(const DiscoveredCamera& camera);
+    void probeRtspUrl(const DiscoveredCamera& camera);
+    void startAnnouncementSources();
+    void sendOnvifDiscovery(const QString& ipAddress = QString());   // Empty: multicast to every segment
     void performDevicePing(const QString& ipAddress);
     
     // Response analysis
     DiscoveredCamera analyzeHttpResponse(const QString& ipAddress, int port, 
-                                       const QString& response, const QString& headers);
-    QString detectBrand(const QString& response, const QString& headers);
-    QString detectModel(const QString& response, const QString& headers, const QString& brand);
-    QString extractDeviceName(const QString& response, const QString& headers);
-    
-    // Brand-specific detection
-    bool isHikvision(const QString& response, const QString& headers);
-    bool isCPPlus(const QString& response, const QString& headers);
-    QString getHikvisionModel(const QString& response);
-    QString getCPPlusModel(const QString& response);
+                                       const QByteArray& response, const QByteArray& headers);
 
 private:
     QNetworkAccessManager* m_networkManager;
     NetworkScanner* m_scanner;
+    
+    // Sources that hear cameras announce themselves; hosts they cover are left out of the sweep
+    OnvifDiscovery* m_onvif;
+    SsdpDiscovery* m_ssdp;
+    MdnsDiscovery* m_mdns;
+    RtspUrlProber* m_rtspProber;        // Replaces the brand's guessed stream URL with one that works
+    struct Announcement {
+        DiscoveredCamera camera;
+        qint64 heardAt;                 // ms since epoch
+    };
+    QHash<QString, Announcement> m_announcedCameras;    // Heard between discoveries, by IP
+    QSet<QString> m_coveredHosts;
+    
     QList<DiscoveredCamera> m_discoveredCameras;
     
     // Configuration
     QString m_networkRange;
+    ScanTargetSpace m_targetSpace;      // Parsed m_networkRange, filters multicast replies
     int m_timeout;
     int m_maxConcurrentRequests;
     int m_currentRequests;
+    int m_scanConcurrency;
+    int m_probeTimeout;
+    bool m_skipUnresolvedNeighbors;
+    NeighborTable m_neighbors;          // Live hosts to probe first, and MAC addresses
+    
+    // Cameras from earlier discoveries; each gets one connect before the sweep starts,
+    // and the ones that answer are listed at once and left out of the sweep
+    QScopedPointer<DiscoveryCache> m_cache;
+    bool m_useCache;
+    struct Revalidation {
+        DiscoveredCamera camera;
+        qint64 startedAt;               // m_discoveryClock time
+    };
+    QHash<QTcpSocket*, Revalidation> m_revalidations;
+    QHash<QString, int> m_connectTimes; // IP -> sweep connect round trip in ms
     
     // State
     bool m_isDiscovering;
@@ -141,8 +300,24 @@ private:
     // Common camera ports
     QList<int> m_cameraPorts;
       // Pending operations
-    QHash<QNetworkReply*, QPair<QString, int>> m_pendingRequests;
+    QHash<QNetworkReply*, HttpProbe> m_pendingRequests;
+    QHash<QTcpSocket*, QPair<QString, int>> m_pendingRtsp;
+    QQueue<IdentifyRequest> m_requestQueue;
+    QHash<QString, int> m_hostRequests;     // IP -> requests in flight
+    QHash<QString, qint64> m_hostDeadlines; // IP -> m_discoveryClock time after which it gets no more requests
+    QHash<QString, int> m_cameraIndex;  // IP -> position in m_discoveredCameras
+    QHash<QString, int> m_macIndex;     // MAC -> position in m_discoveredCameras
+    QElapsedTimer m_discoveryClock;
+    qint64 m_timeToFirstCamera;
+    ScanCursor m_resumeCursor;
     mutable QMutex m_dataMutex;
+    
+    static const qint64 ANNOUNCEMENT_MAX_AGE_MS = 30 * 60 * 1000;    // Typical SSDP max-age
+    static const qint64 NEIGHBOR_REFRESH_MS = 1000;     // Probes keep adding entries during a sweep
+    static const int HTTP_READ_LIMIT = 4096;            // Title, Server header and model strings come early
+    static const int MAX_REQUESTS_PER_HOST = 2;         // Embedded web servers handle few connections
+    static const int HOST_DEADLINE_TIMEOUTS = 3;        // Identification budget per host, in m_timeout units
+    static const qint64 CACHE_MAX_AGE_MS = 7LL * 24 * 60 * 60 * 1000;   // Cameras unseen this long are forgotten
 };
 
 #endif // CAMERADISCOVERY_H
@@ -3,6 +3,7 @@
 
 #include <QObject>
 #include <QHash>
+#include <QJsonObject>
 #include "CameraConfig.h"
 #include "PortForwarder.h"
 
@@ -40,6 +41,7 @@ public:
     bool isCameraRunning(const QString& id) const;
     QStringList getRunningCameras() const;
     QList<CameraConfig> getAllCameras() const;
+    QJsonObject exportStatistics() const;   // Relay usage and API request latency, for saving as JSON
     
     // Access to port forwarder for network interface management
     PortForwarder* getPortForwarder() const { return m_portForwarder; }
@@ -0,0 +1,49 @@
+#ifndef CIRCUITBREAKER_H
+#define CIRCUITBREAKER_H
+
+#include <QtGlobal>
+
+// Failure state of one API service. After FAILURE_THRESHOLD failed requests in a
+// row the breaker opens and requests are held back until its retry time; then a
+// single probe request goes through (half-open). The probe succeeding closes the
+// breaker; failing reopens it with twice the backoff, up to MAX_BACKOFF_MS. A
+// health check closes it without resetting that backoff, which only a real
+// request succeeding does, so an endpoint that answers health checks but fails
+// everything else keeps backing off. The
+// backoff is jittered so clients that lost the server together do not all come
+// back at the same moment. Times are ms on a monotonic clock supplied by the caller.
+class CircuitBreaker
+{
+public:
+    enum State {
+        Closed,
+        Open,
+        HalfOpen        // Probe in flight
+    };
+
+    CircuitBreaker();
+
+    bool allowRequest(qint64 now);      // Lets the probe through once an open breaker's retry time has come
+    bool recordSuccess();               // True if this closed the breaker
+    bool recordHealthCheckSuccess();    // Same, but the backoff keeps growing if failures resume
+    bool recordFailure(qint64 now);     // True if this (re)opened it
+    void retryNow(qint64 now);          // An open breaker's next probe may go now; the backoff stays
+    void cancelProbe();                 // The request allowRequest() let through was never sent
+    void reset();
+
+    State state() const { return m_state; }
+    qint64 retryAt() const { return m_retryAt; }
+    int consecutiveFailures() const { return m_failures; }
+
+private:
+    State m_state;
+    int m_failures;
+    int m_opens;            // Since the breaker last closed; doubles the backoff each time
+    qint64 m_retryAt;
+
+    static const int FAILURE_THRESHOLD = 3;
+    static const int BASE_BACKOFF_MS = 2000;
+    static const int MAX_BACKOFF_MS = 5 * 60 * 1000;
+};
+
+#endif // CIRCUITBREAKER_H
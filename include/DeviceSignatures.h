@@ -0,0 +1,61 @@
+#ifndef DEVICESIGNATURES_H
+#define DEVICESIGNATURES_H
+
+#include <QString>
+#include <QByteArray>
+#include <QRegularExpression>
+#include <QVector>
+#include "MultiPatternMatcher.h"
+
+// Brand, model and name of a device as read from one of its responses
+struct DeviceIdentity
+{
+    QString brand;              // "Generic" when no signature matched
+    QString model;              // "Unknown" when no model pattern matched
+    QString deviceName;
+};
+
+// Data-driven camera fingerprints. All brand keywords, plus the keywords that gate
+// each model and name expression, are compiled once into a single Aho-Corasick
+// automaton; a response is scanned once as raw bytes, and a regular expression only
+// runs when its keyword occurred. Expressions are compiled and optimized once.
+class DeviceSignatures
+{
+public:
+    // Where the text came from; HTTP pages get the broader keyword set
+    enum Source {
+        HttpResponse,
+        Announcement            // RTSP Server header, SSDP/mDNS/ONVIF descriptions
+    };
+
+    static const DeviceSignatures& instance();
+
+    QString brand(const QByteArray& text, Source source) const;
+    DeviceIdentity identifyHttp(const QByteArray& body, const QByteArray& headers) const;
+
+private:
+    struct BrandKeyword {
+        int brand;              // Index into m_brands, which is in priority order
+        bool httpOnly;
+        QByteArray keyword;
+    };
+
+    struct Extractor {
+        int keyword;            // Pattern id that must occur in the body
+        QRegularExpression expression;
+        int brand;              // -1: any brand
+        QString fallback;       // Model to report for the brand when nothing matches
+    };
+
+    DeviceSignatures();
+    int brandFor(const MultiPatternMatcher::Matches& matches, Source source) const;
+    int addKeyword(const QByteArray& keyword);
+
+    MultiPatternMatcher m_matcher;
+    QStringList m_brands;
+    QVector<BrandKeyword> m_keywords;       // Indexed by pattern id; brand -1 for gate-only keywords
+    QVector<Extractor> m_modelExtractors;   // First match wins
+    QVector<Extractor> m_nameExtractors;
+};
+
+#endif // DEVICESIGNATURES_H
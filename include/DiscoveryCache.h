@@ -0,0 +1,55 @@
+#ifndef DISCOVERYCACHE_H
+#define DISCOVERYCACHE_H
+
+#include <QString>
+#include <QList>
+#include <QHash>
+
+struct DiscoveredCamera;
+
+// Cameras found by earlier discoveries, kept on disk between runs so a rescan can
+// confirm each of them with a single connect instead of sweeping and identifying it
+// again. The file is a small versioned binary stream (QDataStream), replaced
+// atomically on save; entries not seen for longer than the caller's TTL are dropped.
+class DiscoveryCache
+{
+public:
+    explicit DiscoveryCache(const QString& filePath = defaultFilePath());
+
+    bool load();
+    bool save() const;
+
+    void update(const DiscoveredCamera& camera, qint64 seenAt);     // ms since epoch
+    int expire(qint64 now, qint64 maxAgeMs);                        // Entries dropped
+    QList<DiscoveredCamera> cameras() const;
+    int size() const { return m_entries.size(); }
+
+    static QString defaultFilePath();
+
+private:
+    struct Entry {
+        quint32 address;
+        quint64 macAddress;         // 48 bits; 0 if unknown
+        quint16 port;               // Port the camera was identified on
+        QList<quint16> openPorts;
+        QString brand;
+        QString model;
+        QString deviceName;
+        QString rtspUrl;
+        bool rtspVerified;
+        QString videoCodec;
+        quint16 videoWidth;
+        quint16 videoHeight;
+        qint64 lastSeen;            // ms since epoch
+        qint32 rttMs;               // -1 if never measured
+    };
+
+    QString m_filePath;
+    QHash<quint32, Entry> m_entries;    // By IPv4 address
+
+    static const quint32 FILE_MAGIC = 0x56444331;   // "VDC1"
+    static const quint16 FILE_VERSION = 1;
+    static const int MAX_ENTRIES = 4096;
+};
+
+#endif // DISCOVERYCACHE_H
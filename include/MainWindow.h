@@ -64,6 +64,7 @@ private slots:
     void stopAllCameras();
     void toggleAutoStart();
     void showAbout();
+    void exportStatistics();
     void onCameraSelectionChanged();
     void onCameraStarted(const QString& id);
     void onCameraStopped(const QString& id);    void onCameraError(const QString& id, const QString& error);
@@ -94,7 +95,8 @@ private:
     void createStatusBar();
     void createCentralWidget();
     void setupConnections();
-    void updateCameraTable();    void updateButtons();    void loadSettings();
+    void updateCameraTable();    void updateStreamItem(QTableWidgetItem* item, const QString& cameraId, bool isRunning);
+    void updateButtons();    void loadSettings();
     void saveSettings();
     void updateNetworkStatus();
     void restartEchoServer();
@@ -138,6 +140,7 @@ private:
     QMenu* m_fileMenu;
     QMenu* m_serviceMenu;
     QMenu* m_helpMenu;
+    QAction* m_exportStatisticsAction;
     QAction* m_exitAction;
     QAction* m_installServiceAction;
     QAction* m_uninstallServiceAction;
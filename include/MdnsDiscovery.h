@@ -0,0 +1,70 @@
+#ifndef MDNSDISCOVERY_H
+#define MDNSDISCOVERY_H
+
+#include <QObject>
+#include <QUdpSocket>
+#include <QHostAddress>
+#include <QTimer>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+
+// One service instance resolved from mDNS PTR/SRV/TXT/A records
+struct MdnsService
+{
+    QString ipAddress;
+    QString instanceName;       // "Lobby._rtsp._tcp.local"
+    QString serviceType;        // "_rtsp._tcp.local"
+    QString hostName;           // SRV target
+    int port;
+    QHash<QString, QString> txt;
+    QString macAddress;         // From a mac/macaddress TXT key, if any
+
+    MdnsService() : port(0) {}
+    QString displayName() const;    // First label of the instance name
+};
+
+// mDNS (Bonjour/Avahi) source for camera discovery. query() sends one PTR question
+// for the camera service types from an ephemeral port, so responders answer it
+// directly (RFC 6762 legacy unicast); startListening() joins 224.0.0.251:5353 to
+// pick up unsolicited announcements for as long as the object lives.
+class MdnsDiscovery : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MdnsDiscovery(QObject *parent = nullptr);
+
+    bool startListening();
+    void query(int windowMs = DEFAULT_WINDOW_MS);
+    void stop();                // Ends the query window; the listener stays
+    bool isActive() const;
+
+    static QStringList cameraServiceTypes();
+    static QByteArray buildQuery(const QStringList& serviceTypes);
+    static QList<MdnsService> parseResponse(const QByteArray& packet, const QHostAddress& sender);
+
+    static const int DEFAULT_WINDOW_MS = 1500;
+    static const quint16 MDNS_PORT = 5353;
+
+signals:
+    void serviceFound(const MdnsService& service);
+    void finished(int serviceCount);
+
+private slots:
+    void readDatagrams();
+    void onWindowElapsed();
+
+private:
+    static bool readName(const QByteArray& packet, int& offset, QString& name);
+
+    QUdpSocket* m_querySocket;
+    QUdpSocket* m_listenSocket;
+    QTimer* m_windowTimer;
+    QSet<QString> m_seenInstances;
+    int m_serviceCount;
+
+    static const int MAX_DATAGRAM_SIZE = 9000;     // RFC 6762 limit for mDNS messages
+};
+
+#endif // MDNSDISCOVERY_H
@@ -0,0 +1,34 @@
+#ifndef MULTIPATTERNMATCHER_H
+#define MULTIPATTERNMATCHER_H
+
+#include <QByteArray>
+#include <QVector>
+#include <bitset>
+
+// Aho-Corasick automaton over bytes, ASCII case-insensitive. build() turns the
+// pattern trie into a dense transition table over the byte classes that occur in
+// the patterns, so a scan costs one table lookup per input byte however many
+// patterns there are, and the input is never copied or lower-cased.
+class MultiPatternMatcher
+{
+public:
+    static const int MAX_PATTERNS = 256;
+    typedef std::bitset<MAX_PATTERNS> Matches;
+
+    int addPattern(const QByteArray& pattern);     // Pattern id, in order of addition
+    void build();
+    int patternCount() const { return m_patterns.size(); }
+
+    // Scans can be chained over several buffers by passing the returned state back in
+    int scan(const char* data, int length, int state, Matches& matches) const;
+    Matches scan(const QByteArray& text) const;
+
+private:
+    QVector<QByteArray> m_patterns;
+    quint8 m_classes[256] = {};         // Byte -> class; 0 for bytes in no pattern
+    int m_classCount = 1;
+    QVector<qint32> m_transitions;      // state * m_classCount + class -> state
+    QVector<QVector<int>> m_outputs;    // Patterns ending in each state
+};
+
+#endif // MULTIPATTERNMATCHER_H
@@ -0,0 +1,47 @@
+#ifndef NEIGHBORTABLE_H
+#define NEIGHBORTABLE_H
+
+#include <QString>
+#include <QList>
+#include <QHash>
+#include <QElapsedTimer>
+
+// One IPv4 entry of the operating system's ARP cache
+struct NeighborEntry
+{
+    enum State {
+        Reachable,      // Resolved and usable (may be stale, the host answered recently)
+        Incomplete,     // Resolution in progress
+        Failed          // Resolution failed: nothing answered at this address
+    };
+
+    quint32 address = 0;
+    QString macAddress;         // "AA:BB:CC:DD:EE:FF", empty unless resolved
+    State state = Incomplete;
+    QString interfaceName;
+};
+
+// Snapshot of the OS neighbor table (/proc/net/arp on Linux, GetIpNetTable2 on
+// Windows). It tells which addresses on the attached segments answered ARP
+// recently, and with which MAC, without sending a single packet.
+class NeighborTable
+{
+public:
+    bool load();                                // false where the table cannot be read
+    bool refreshIfOlderThan(qint64 milliseconds);
+    bool isLoaded() const { return m_loaded.isValid(); }
+
+    QList<NeighborEntry> entries() const { return m_entries.values(); }
+    QList<quint32> liveAddresses() const;
+    QList<quint32> failedAddresses() const;
+    QString macAddress(quint32 address) const;
+    int size() const { return m_entries.size(); }
+
+    static QList<NeighborEntry> parseProcNetArp(const QByteArray& text);
+
+private:
+    QHash<quint32, NeighborEntry> m_entries;
+    QElapsedTimer m_loaded;
+};
+
+#endif // NEIGHBORTABLE_H
@@ -23,6 +23,7 @@ public:
     // Interface information
     QList<QNetworkInterface> getAllInterfaces() const;
     QList<QNetworkInterface> getActiveInterfaces() const;
+    static QList<QNetworkInterface> getMulticastInterfaces();  // Up, multicast-capable, with an IPv4 address
     QNetworkInterface getWireGuardInterface() const;
     bool hasWireGuardInterface() const;
     
@@ -0,0 +1,74 @@
+#ifndef ONVIFDISCOVERY_H
+#define ONVIFDISCOVERY_H
+
+#include <QObject>
+#include <QUdpSocket>
+#include <QHostAddress>
+#include <QNetworkInterface>
+#include <QTimer>
+#include <QStringList>
+#include <QSet>
+
+// One ONVIF device as announced in a WS-Discovery ProbeMatch
+struct OnvifDevice
+{
+    QString endpoint;           // EndpointReference address, stable per device (urn:uuid:...)
+    QString ipAddress;
+    int port;                   // Port of the first device service XAddr
+    QStringList xaddrs;         // Device service URLs
+    QStringList scopes;
+    QString manufacturer;
+    QString hardware;           // Model as reported in the hardware scope
+    QString name;
+    QString location;
+
+    OnvifDevice() : port(80) {}
+};
+
+// WS-Discovery client: multicasts one Probe for NetworkVideoTransmitter on every
+// IPv4 interface and collects the unicast ProbeMatches that come back during a
+// short window. A unicast probe can be sent to hosts on routed segments that the
+// multicast does not reach; replies to either land on the same socket.
+class OnvifDiscovery : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit OnvifDiscovery(QObject *parent = nullptr);
+
+    void probe(int windowMs = DEFAULT_WINDOW_MS);
+    void probeHost(const QHostAddress& address, int windowMs = DEFAULT_WINDOW_MS);
+    void stop();
+    bool isActive() const;
+
+    static QByteArray buildProbe(const QString& messageId);
+    static QList<OnvifDevice> parseProbeMatches(const QByteArray& xml, const QHostAddress& sender);
+
+    static const int DEFAULT_WINDOW_MS = 1500;
+    static const quint16 DISCOVERY_PORT = 3702;
+
+signals:
+    void deviceFound(const OnvifDevice& device);
+    void finished(int deviceCount);
+
+private slots:
+    void readDatagrams();
+    void onWindowElapsed();
+
+private:
+    bool ensureSocket();
+    void extendWindow(int windowMs);
+    int sendMulticast(const QByteArray& payload);
+    static void applyScope(OnvifDevice& device, const QString& scope);
+    static void resolveAddress(OnvifDevice& device, const QHostAddress& sender);
+
+    QUdpSocket* m_socket;
+    QTimer* m_windowTimer;
+    QSet<QString> m_seenEndpoints;
+    int m_deviceCount;
+
+    static const int REPEAT_DELAY_MS = 150;        // Probes are repeated once in case the first is dropped
+    static const int MAX_DATAGRAM_SIZE = 65536;
+};
+
+#endif // ONVIFDISCOVERY_H
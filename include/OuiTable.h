@@ -0,0 +1,23 @@
+#ifndef OUITABLE_H
+#define OUITABLE_H
+
+#include <QString>
+
+// Camera vendors by MAC OUI, compiled at build time from resources/camera_oui.txt
+// into a sorted constant array. Looking a brand up costs a binary search over a
+// few dozen entries, so discovery can classify a host from its neighbor-table MAC
+// before sending it any request.
+class OuiTable
+{
+public:
+    struct Entry {
+        quint32 oui;            // First three octets, 0xAABBCC
+        const char* brand;
+    };
+
+    static const char* brandFor(quint32 oui);               // nullptr when not a known camera vendor
+    static QString brandForMac(const QString& macAddress);   // Any common MAC notation; empty when unknown
+    static int size();
+};
+
+#endif // OUITABLE_H
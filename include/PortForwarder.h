@@ -8,10 +8,35 @@
 #include <QTimer>
 #include <QHash>
 #include <QHostAddress>
+#include <QJsonObject>
 #include "CameraConfig.h"
+#include "RtpInterleavedParser.h"
+#include "StreamAnalyzer.h"
 
 class NetworkInterfaceManager;
 
+// Snapshot of relay resource usage across all forwarding sessions
+struct RelayStatistics {
+    int activeSessions = 0;
+    int activeConnections = 0;
+    int drainingConnections = 0;
+    qint64 bufferedBytes = 0;           // Application and socket write buffers, all connections
+    qint64 memoryBudget = 0;
+    int maxViewersPerCamera = 0;
+    int maxConnectionsPerSourceIp = 0;
+    int pausedConnections = 0;          // Connections currently held back by backpressure
+    int refusedMaxViewers = 0;
+    int refusedSourceIpLimit = 0;
+    int refusedMemoryBudget = 0;
+    int backpressureEvents = 0;
+    int upstreamStalls = 0;
+    int upstreamReconnects = 0;
+    int substreamSwitches = 0;
+    int connectionsOnSubstream = 0;
+    
+    QJsonObject toJson() const;
+};
+
 class PortForwarder : public QObject
 {
     Q_OBJECT
@@ -19,10 +44,27 @@ class PortForwarder : public QObject
 public:
     explicit PortForwarder(QObject *parent = nullptr);    ~PortForwarder();
       bool startForwarding(const CameraConfig& camera);
-    void stopForwarding(const QString& cameraId);
-    void stopAllForwarding();
+    void stopForwarding(const QString& cameraId, bool drain = true);
+    void stopAllForwarding(bool drain = true);
     void restartForwarding(const QString& cameraId);
     
+    // Graceful draining (0 disables draining and closes connections immediately)
+    void setDrainTimeout(int milliseconds);
+    int drainTimeout() const { return m_drainTimeoutMs; }
+    int getDrainingConnectionCount() const { return m_drainingConnections.size(); }
+    
+    // Admission control (0 disables the respective limit)
+    void setMemoryBudget(qint64 bytes);
+    void setMaxViewersPerCamera(int viewers);
+    void setMaxConnectionsPerSourceIp(int connections);
+    qint64 memoryBudget() const { return m_memoryBudget; }
+    int maxViewersPerCamera() const { return m_maxViewersPerCamera; }
+    int maxConnectionsPerSourceIp() const { return m_maxConnectionsPerSourceIp; }
+    
+    // Media inactivity watchdog, keyed by brand (matched like CameraApiService, 0 disables)
+    void setStallTimeout(const QString& brand, int milliseconds);
+    int stallTimeout(const QString& brand) const;
+    
     bool isForwarding(const QString& cameraId) const;
     QStringList getActiveForwards() const;
     
@@ -35,6 +77,14 @@ public:
     qint64 getBytesTransferred(const QString& cameraId) const;
     QString getConnectionStatus(const QString& cameraId) const;
     QString getBindingInfo(const QString& cameraId) const;
+    qint64 getBufferedBytes(const QString& cameraId) const;
+    int getStallCount(const QString& cameraId) const;
+    int getUpstreamReconnectCount(const QString& cameraId) const;
+    int getSubstreamSwitchCount(const QString& cameraId) const;
+    bool isOnSubstream(const QString& cameraId) const;
+    StreamEstimate getStreamEstimate(const QString& cameraId, StreamAnalyzer::Window window) const;
+    qint64 getKeyframeIntervalMs(const QString& cameraId) const;  // Between the two most recent keyframes
+    RelayStatistics getRelayStatistics() const;
 
     // Network interface management
     void setNetworkInterfaceManager(NetworkInterfaceManager* manager);
@@ -49,6 +99,11 @@ signals:
     void dataTransferred(const QString& cameraId, qint64 bytes, const QString& direction);
     void reconnectionAttempt(const QString& cameraId, int attemptNumber);
     void portChanged(const QString& cameraId, int oldPort, int newPort);
+    void connectionDrained(const QString& cameraId, const QString& clientAddress, bool clean);
+    void connectionRefused(const QString& cameraId, const QString& clientAddress, int rtspStatus, const QString& reason);
+    void upstreamStalled(const QString& cameraId, const QString& clientAddress, int stallCount);
+    void upstreamReconnected(const QString& cameraId, const QString& clientAddress);
+    void substreamSwitched(const QString& cameraId, const QString& clientAddress, bool onSubstream);
 
 private slots:
     void handleNewConnection();
@@ -62,9 +117,25 @@ private slots:
     void onNetworkInterfacesChanged();
     void onWireGuardStateChanged(bool active);
     void handleHealthCheck();
+    void handleStreamWatchdog();
     void handleBytesWritten();  // Handle buffered data when socket is ready
 
-private:    struct ConnectionInfo {
+private:
+    static const int RTP_TRACKED_CHANNELS = 8;
+    
+    // Per interleaved channel numbering the client has seen, kept continuous across upstream switches
+    struct RtpChannelState {
+        bool seen;
+        bool remapPending;              // Next packet comes from a new upstream
+        quint32 ssrc;                   // SSRC the client knows
+        quint16 lastSeq;
+        quint32 lastTimestamp;
+        quint32 timestampStep;
+        quint16 seqOffset;
+        quint32 timestampOffset;
+    };
+    
+    struct ConnectionInfo {
         QTcpSocket* clientSocket;
         QTcpSocket* targetSocket;
         QString clientAddress;
@@ -74,6 +145,65 @@ private:    struct ConnectionInfo {
         QByteArray pendingClientData;  // Buffer for data received before target connection
         QByteArray pendingTargetWrite;  // Buffer for target->client writes (non-blocking)
         QByteArray pendingClientWrite;  // Buffer for client->target writes (non-blocking)
+        QByteArray rtspUrl;             // Last request URL sent by the client
+        QByteArray rtspSessionId;       // Session ID assigned by the camera
+        int lastCSeq;                   // Last CSeq sent by the client
+        bool clientReadPaused;          // Target cannot keep up, client data left in socket
+        bool targetReadPaused;          // Client cannot keep up, camera data left in socket
+        QByteArray clientSessionId;     // Session ID the client uses (differs after an upstream reconnect)
+        QList<QByteArray> handshakeRequests; // DESCRIBE/SETUP/PLAY as sent by the client, replayed on reconnect
+        bool handshakeComplete;
+        bool interleaved;               // RTP flows through this connection (RTSP over TCP)
+        bool playing;
+        qint64 lastMediaMs;             // Last interleaved RTP packet from the camera
+        bool upstreamReconnecting;
+        int reconnectFailures;
+        RtpInterleavedParser rtpParser;
+        RtpChannelState rtpChannels[RTP_TRACKED_CHANNELS];
+        bool rtpRewrite;                // Set once the client is fed from a replacement upstream
+        QList<QByteArray> upstreamChallenges;   // The replacement upstream's, to re-sign client requests
+        int upstreamNonceCount;
+        QByteArray rtpCarry;            // Incomplete frame held back while rewriting
+        QByteArray videoEncoding;       // From the SDP the client received
+        int videoPayloadType;
+        RtpInterleavedParser::VideoCodec videoCodec;
+        bool analyzed;                  // Feeds the camera's stream analyzer
+        bool onSubstream;
+        int pressureTicks;
+        int headroomTicks;
+        int switchHoldoffMs;
+        qint64 lastSwitchMs;
+    };
+    
+    struct DrainingConnection {
+        QString cameraId;
+        ConnectionInfo* info;
+        QTimer* deadlineTimer;
+        int teardownCSeq;               // -1 when no TEARDOWN reply is awaited
+        bool teardownSent;
+    };
+    
+    // New upstream connection being brought up by replaying the client's handshake
+    struct UpstreamReplay {
+        QString cameraId;
+        ConnectionInfo* info;
+        QTcpSocket* socket;
+        QTimer* deadlineTimer;
+        QList<QByteArray> requests;
+        int index;                      // Request currently awaiting its reply
+        int cseq;
+        bool authRetried;
+        QList<QByteArray> challenges;   // WWW-Authenticate values, reused for later requests
+        int nonceCount;                 // Digest nc: requests answered on the current challenges
+        QByteArray buffer;
+        QByteArray sessionId;
+        bool streamSwitch;              // Substream switch rather than stall recovery
+        bool toSubstream;
+        bool awaitingKeyframe;
+        RtpInterleavedParser keyframeScanner;
+        RtpInterleavedParser::VideoCodec videoCodec;
+        int videoPayloadType;
+        QList<QByteArray> parameterSets;    // From the replayed DESCRIBE, sent ahead of a bare IDR
     };
     
     struct ForwardingSession {
@@ -82,6 +212,12 @@ private:    struct ConnectionInfo {
         QHash<QTcpSocket*, ConnectionInfo*> connections; // client -> connection info
         QTimer* reconnectTimer;
         QTimer* healthCheckTimer;
+        QTimer* stallTimer;
+        int stallCount;
+        int upstreamReconnects;
+        int substreamSwitches;
+        bool substreamUnsupported;      // No substream URL or incompatible codec
+        StreamAnalyzer analyzer;        // Fed by one playing connection at a time
         bool isReconnecting;
         int reconnectAttempts;
         qint64 totalBytesTransferred;
@@ -91,21 +227,92 @@ private:    struct ConnectionInfo {
       void setupReconnectTimer(const QString& cameraId);
     void setupHealthCheckTimer(const QString& cameraId);
     void cleanupSession(const QString& cameraId);
-    void cleanupConnection(const QString& cameraId, QTcpSocket* clientSocket);    void forwardData(QTcpSocket* from, QTcpSocket* to, const QString& cameraId, const QString& direction);
+    void cleanupConnection(const QString& cameraId, QTcpSocket* clientSocket);
+    void forwardData(ConnectionInfo* info, QTcpSocket* from, QTcpSocket* to, const QString& cameraId, const QString& direction);
+    void inspectRtspMessage(ConnectionInfo* info, const QByteArray& data, const QString& direction);
+    void beginDrain(const QString& cameraId, ConnectionInfo* info);
+    void handleDrainTargetData(DrainingConnection* drain);
+    void checkDrainComplete(DrainingConnection* drain);
+    void finishDrain(DrainingConnection* drain, bool clean);
     void optimizeSocketForStreaming(QTcpSocket* socket);
     bool bindToAllInterfaces(QTcpServer* server, quint16 port);
     void restartAllForwarding();
     void updateSessionStatus(const QString& cameraId, const QString& status);
     void logConnectionDetails(const QString& cameraId, const ConnectionInfo* info, const QString& event);
     
+    // Admission control and memory accounting
+    bool admitConnection(const QString& cameraId, ForwardingSession* session, QTcpSocket* clientSocket);
+    void refuseConnection(const QString& cameraId, QTcpSocket* clientSocket, int statusCode, const QByteArray& reason);
+    int countConnectionsFrom(const QHostAddress& address) const;
+    qint64 totalBufferedBytes() const;
+    static qint64 connectionBufferedBytes(const ConnectionInfo* info);
+    void applyBackpressure(ConnectionInfo* info, QTcpSocket* to, const QString& cameraId, const QString& direction);
+    
+    // Upstream stall recovery
+    void bindTargetSocket(QTcpSocket* socket, const CameraConfig& camera);
+    void connectTargetSignals(QTcpSocket* socket);
+    int stallTimeoutFor(const CameraConfig& camera) const;
+    void startUpstreamReconnect(const QString& cameraId, ConnectionInfo* info);
+    UpstreamReplay* beginUpstreamReplay(const QString& cameraId, ConnectionInfo* info, const QList<QByteArray>& requests);
+    void sendReplayRequest(UpstreamReplay* replay);
+    void handleReplayData(UpstreamReplay* replay);
+    void finishUpstreamReplay(UpstreamReplay* replay, bool success);
+    void cancelUpstreamReplay(ConnectionInfo* info);
+    void cutOverUpstream(const QString& cameraId, ConnectionInfo* info, QTcpSocket* socket,
+                         const QByteArray& sessionId, QByteArray initialData, bool retireOld);
+    void retireUpstream(ConnectionInfo* info, QTcpSocket* socket);
+    
+    // RTP continuity and adaptive substream
+    void processTargetMedia(ConnectionInfo* info, QByteArray& data, StreamAnalyzer* analyzer = nullptr);
+    StreamAnalyzer* streamAnalyzerFor(ForwardingSession* session, ConnectionInfo* info);
+    static RtpInterleavedParser::VideoCodec videoCodecFor(const QByteArray& encoding);
+    static void updateRtpChannel(RtpChannelState* channels, int channel, unsigned char* prefix, int length, bool rewrite);
+    static QByteArray upstreamUrl(const ConnectionInfo* info);
+    static QList<QByteArray> substreamHandshake(const QList<QByteArray>& requests);
+    static QByteArray parameterSetPackets(const QList<QByteArray>& parameterSets, int channel,
+                                          const unsigned char* keyframeHeader);
+    void checkStreamPressure(const QString& cameraId, ForwardingSession* session);
+    void startStreamSwitch(const QString& cameraId, ConnectionInfo* info, bool toSubstream);
+    bool scanForKeyframe(UpstreamReplay* replay);
+    
     QHash<QString, ForwardingSession*> m_sessions;
     QHash<QTcpSocket*, QString> m_socketToCameraMap;
+    QList<DrainingConnection*> m_drainingConnections;
+    QList<UpstreamReplay*> m_upstreamReplays;
+    QHash<QString, int> m_stallTimeouts;  // lower-case brand -> ms
     NetworkInterfaceManager* m_networkManager;
+    int m_drainTimeoutMs;
+    qint64 m_memoryBudget;
+    int m_maxViewersPerCamera;
+    int m_maxConnectionsPerSourceIp;
+    int m_refusedMaxViewers;
+    int m_refusedSourceIpLimit;
+    int m_refusedMemoryBudget;
+    int m_backpressureEvents;
     
     // Constants
     static const int MAX_RECONNECT_ATTEMPTS = 10;
     static const int RECONNECT_INTERVAL_MS = 5000;
     static const int HEALTH_CHECK_INTERVAL_MS = 30000;
+    static const int DRAIN_TIMEOUT_MS = 3000;
+    static const qint64 DEFAULT_MEMORY_BUDGET_BYTES = 64 * 1024 * 1024;
+    static const int DEFAULT_MAX_VIEWERS_PER_CAMERA = 8;
+    static const int DEFAULT_MAX_CONNECTIONS_PER_SOURCE_IP = 16;
+    static const qint64 BACKPRESSURE_HIGH_WATERMARK = 2 * 1024 * 1024;  // Stop reading the other side
+    static const qint64 BACKPRESSURE_LOW_WATERMARK = 512 * 1024;        // Resume reading
+    static const int REFUSAL_TIMEOUT_MS = 2000;  // Wait for the client's request so its CSeq can be echoed
+    static const int STALL_CHECK_INTERVAL_MS = 1000;
+    static const int DEFAULT_STALL_TIMEOUT_MS = 10000;
+    static const int UPSTREAM_REPLAY_TIMEOUT_MS = 10000;
+    static const int MAX_UPSTREAM_RECONNECT_ATTEMPTS = 3;
+    static const int DEFAULT_RTP_TIMESTAMP_STEP = 3000;  // One frame at 90 kHz / 30 fps
+    static const qint64 PRESSURE_QUEUE_BYTES = 1024 * 1024;  // Client queue that counts as falling behind
+    static const qint64 HEADROOM_QUEUE_BYTES = 64 * 1024;
+    static const int PRESSURE_TICKS = 3;
+    static const int SWITCH_COOLDOWN_MS = 10000;
+    static const int SUBSTREAM_MIN_HOLDOFF_MS = 30000;
+    static const int SUBSTREAM_MAX_HOLDOFF_MS = 600000;
+    static const int KEYFRAME_WAIT_MS = 10000;
 };
 
 #endif // PORTFORWARDER_H
@@ -0,0 +1,265 @@
+#ifndef RTPINTERLEAVEDPARSER_H
+#define RTPINTERLEAVEDPARSER_H
+
+#include <cstring>
+
+// Incremental framer for RTSP-interleaved media ('$', channel, 16-bit length, packet).
+// Sits on the relay's hot path, so it never allocates: each frame is reported once
+// its first PREFIX_SIZE bytes (RTP header, extensions and the first payload bytes)
+// are known, and the payload itself is skipped.
+//
+// Read-only mode copies a prefix that spans reads into a fixed carry buffer.
+// Hold mode instead stops at a frame whose prefix is incomplete and leaves those
+// bytes unconsumed, so every reported prefix points into the caller's buffer and
+// may be rewritten in place before the data is forwarded.
+class RtpInterleavedParser
+{
+public:
+    enum VideoCodec {
+        CodecUnknown,
+        CodecH264,
+        CodecH265
+    };
+
+    static const int PREFIX_SIZE = 96;
+    static const int MAX_CHANNEL = 31;  // Anything higher is treated as stray RTSP text
+
+    RtpInterleavedParser() { reset(); }
+
+    void reset()
+    {
+        m_headerFill = 0;
+        m_remaining = 0;
+        m_prefixFill = 0;
+        m_prefixWanted = 0;
+        m_channel = 0;
+        m_frameLength = 0;
+        m_skippedBytes = 0;
+    }
+
+    void setHoldIncompleteFrames(bool hold) { m_hold = hold; }
+    bool holdsIncompleteFrames() const { return m_hold; }
+    bool atFrameBoundary() const { return m_headerFill == 0 && m_remaining == 0; }
+    long long skippedBytes() const { return m_skippedBytes; }
+
+    // Walks a chunk of target->client data and calls
+    //   onFrame(int channel, unsigned char* prefix, int prefixLength, int frameLength, bool inPlace)
+    // once per frame. Returns the number of bytes consumed, which is always 'size'
+    // unless hold mode left an incomplete frame prefix at the end of the chunk.
+    template <typename Callback>
+    int feed(char* data, int size, Callback&& onFrame)
+    {
+        unsigned char* bytes = reinterpret_cast<unsigned char*>(data);
+        int pos = 0;
+
+        while (pos < size) {
+            // Skip the rest of the current frame's payload
+            if (m_remaining > 0 && m_prefixFill >= m_prefixWanted) {
+                int skip = (size - pos < m_remaining) ? size - pos : m_remaining;
+                pos += skip;
+                m_remaining -= skip;
+                continue;
+            }
+
+            // Finish a prefix that started in an earlier chunk (read-only mode)
+            if (m_remaining > 0) {
+                int copy = m_prefixWanted - m_prefixFill;
+                if (copy > size - pos) {
+                    copy = size - pos;
+                }
+                std::memcpy(m_prefix + m_prefixFill, bytes + pos, copy);
+                m_prefixFill += copy;
+                m_remaining -= copy;
+                pos += copy;
+                if (m_prefixFill == m_prefixWanted) {
+                    onFrame(m_channel, m_prefix, m_prefixFill, m_frameLength, false);
+                }
+                continue;
+            }
+
+            if (m_hold) {
+                if (bytes[pos] != '$') {
+                    pos++;
+                    m_skippedBytes++;
+                    continue;
+                }
+                if (size - pos < 4) {
+                    return pos;
+                }
+                if (bytes[pos + 1] > MAX_CHANNEL) {
+                    pos++;
+                    m_skippedBytes++;
+                    continue;
+                }
+
+                int length = (bytes[pos + 2] << 8) | bytes[pos + 3];
+                int wanted = length < PREFIX_SIZE ? length : PREFIX_SIZE;
+                if (size - pos - 4 < wanted) {
+                    return pos;
+                }
+
+                m_channel = bytes[pos + 1];
+                m_frameLength = length;
+                onFrame(m_channel, bytes + pos + 4, wanted, length, true);
+                pos += 4;
+                m_remaining = length;
+                m_prefixFill = m_prefixWanted = 0;
+                continue;
+            }
+
+            // Collect the 4-byte interleave header, possibly across chunks
+            if (m_headerFill == 0 && bytes[pos] != '$') {
+                pos++;
+                m_skippedBytes++;
+                continue;
+            }
+            m_header[m_headerFill++] = bytes[pos++];
+            if (m_headerFill == 2 && m_header[1] > MAX_CHANNEL) {
+                m_skippedBytes += 2;
+                m_headerFill = 0;
+                continue;
+            }
+            if (m_headerFill < 4) {
+                continue;
+            }
+
+            m_headerFill = 0;
+            m_channel = m_header[1];
+            m_frameLength = (m_header[2] << 8) | m_header[3];
+            m_remaining = m_frameLength;
+            m_prefixWanted = m_frameLength < PREFIX_SIZE ? m_frameLength : PREFIX_SIZE;
+            m_prefixFill = 0;
+
+            // Report in place when the whole prefix is already in this chunk
+            if (size - pos >= m_prefixWanted) {
+                onFrame(m_channel, bytes + pos, m_prefixWanted, m_frameLength, true);
+                m_prefixFill = m_prefixWanted;
+            } else if (m_prefixWanted == 0) {
+                onFrame(m_channel, m_prefix, 0, 0, false);
+            }
+        }
+
+        return pos;
+    }
+
+    // Bytes the client still expects when the stream is cut mid-frame: 'header'
+    // receives the missing interleave header bytes (count returned), followed by
+    // 'padding' zero bytes of payload. Keeps the client's framing intact across
+    // an upstream switch at the cost of one damaged packet.
+    int frameCompletion(unsigned char* header, int& padding) const
+    {
+        padding = 0;
+        switch (m_headerFill) {
+        case 1:
+            header[0] = m_channel;
+            header[1] = 0;
+            header[2] = 0;
+            return 3;
+        case 2:
+            header[0] = 0;
+            header[1] = 0;
+            return 2;
+        case 3:
+            header[0] = 0;
+            padding = m_header[2] << 8;
+            return 1;
+        default:
+            padding = m_remaining;
+            return 0;
+        }
+    }
+
+    // Offset of the RTP payload within a packet prefix, -1 if it lies beyond the prefix
+    static int payloadOffset(const unsigned char* packet, int length)
+    {
+        if (length < 12 || (packet[0] >> 6) != 2) {
+            return -1;
+        }
+
+        int offset = 12 + 4 * (packet[0] & 0x0F);
+        if (packet[0] & 0x10) {
+            if (length < offset + 4) {
+                return -1;
+            }
+            offset += 4 + 4 * ((packet[offset + 2] << 8) | packet[offset + 3]);
+        }
+        return offset < length ? offset : -1;
+    }
+
+    // True when the packet starts a keyframe: H.264 IDR/SPS (single, STAP-A, FU-A start)
+    // or H.265 IRAP/VPS/SPS (single, AP, FU start)
+    static bool isKeyframeStart(const unsigned char* packet, int length, VideoCodec codec)
+    {
+        int type = firstNalType(packet, length, codec);
+        if (codec == CodecH264) {
+            return type == 5 || type == 7;
+        }
+        return (type >= 16 && type <= 21) || type == 32 || type == 33;
+    }
+
+    // True when the packet starts an access unit that carries its own parameter sets:
+    // H.264 SPS, H.265 VPS
+    static bool isParameterSetStart(const unsigned char* packet, int length, VideoCodec codec)
+    {
+        int type = firstNalType(packet, length, codec);
+        return type >= 0 && type == (codec == CodecH264 ? 7 : 32);
+    }
+
+private:
+    // Type of the first NAL unit the packet starts, -1 for a continuation fragment,
+    // an unknown codec or a payload beyond the prefix
+    static int firstNalType(const unsigned char* packet, int length, VideoCodec codec)
+    {
+        int offset = payloadOffset(packet, length);
+        if (offset < 0) {
+            return -1;
+        }
+
+        const unsigned char* payload = packet + offset;
+        int available = length - offset;
+
+        if (codec == CodecH264) {
+            int type = payload[0] & 0x1F;
+            if (type == 24 && available >= 4) {          // STAP-A: first aggregated NAL
+                type = payload[3] & 0x1F;
+            } else if (type == 28 && available >= 2) {   // FU-A: start fragment only
+                if (!(payload[1] & 0x80)) {
+                    return -1;
+                }
+                type = payload[1] & 0x1F;
+            }
+            return type;
+        }
+
+        if (codec == CodecH265) {
+            if (available < 2) {
+                return -1;
+            }
+            int type = (payload[0] >> 1) & 0x3F;
+            if (type == 48 && available >= 5) {          // AP: first aggregated NAL
+                type = (payload[4] >> 1) & 0x3F;
+            } else if (type == 49 && available >= 3) {   // FU: start fragment only
+                if (!(payload[2] & 0x80)) {
+                    return -1;
+                }
+                type = payload[2] & 0x3F;
+            }
+            return type;
+        }
+
+        return -1;
+    }
+
+    bool m_hold = false;
+    unsigned char m_header[4];
+    int m_headerFill;
+    int m_remaining;
+    unsigned char m_prefix[PREFIX_SIZE];
+    int m_prefixFill;
+    int m_prefixWanted;
+    int m_channel;
+    int m_frameLength;
+    long long m_skippedBytes;
+};
+
+#endif // RTPINTERLEAVEDPARSER_H
@@ -0,0 +1,70 @@
+#ifndef RTSPPROTOCOL_H
+#define RTSPPROTOCOL_H
+
+#include <QByteArray>
+#include <QList>
+#include <QPair>
+#include <QString>
+
+// Lightweight helpers for inspecting and building RTSP/1.0 messages that pass
+// through the relay. The relay never fully parses the stream; these helpers
+// only look at the text portion of individual request/response chunks.
+class RtspProtocol
+{
+public:
+    typedef QList<QPair<QByteArray, QByteArray>> HeaderList;
+
+    // Message classification
+    static bool isRequest(const QByteArray& data);
+    static bool isResponse(const QByteArray& data);
+
+    // Request line / status line fields
+    static QByteArray requestMethod(const QByteArray& message);
+    static QByteArray requestUrl(const QByteArray& message);
+    static int statusCode(const QByteArray& message);
+
+    // Header access (case-insensitive header names, header section only)
+    static QByteArray headerValue(const QByteArray& message, const QByteArray& name);
+    static QList<QByteArray> headerValues(const QByteArray& message, const QByteArray& name);
+    static int cseq(const QByteArray& message);
+    static QByteArray sessionId(const QByteArray& message);  // Without ";timeout=" suffix
+    static int contentLength(const QByteArray& message);
+
+    // Length of the first complete message (headers + body) in a buffer, -1 if incomplete
+    static int messageLength(const QByteArray& buffer);
+
+    // Header rewriting (header section only; an empty value removes the header)
+    static QByteArray withHeader(const QByteArray& message, const QByteArray& name, const QByteArray& value);
+    static bool replaceSessionId(QByteArray& data, const QByteArray& from, const QByteArray& to);  // Session header only
+
+    static QByteArray withRequestUrl(const QByteArray& request, const QByteArray& url);
+
+    // Main/sub stream URL conventions (Hikvision Channels/N01 -> N02, Dahua/CP Plus
+    // subtype=0 -> 1, .../main/... -> .../sub/..., stream1 -> stream2); empty if none apply
+    static QByteArray substreamUrl(const QByteArray& url);
+
+    // First video format announced in an SDP body ("H264", "H265", ...)
+    static bool sdpVideoFormat(const QByteArray& sdp, int& payloadType, QByteArray& encoding);
+
+    // Picture size of the first video stream, from a=framesize / a=x-dimensions or the
+    // H.264 SPS in sprop-parameter-sets; false if the SDP does not tell
+    static bool sdpVideoResolution(const QByteArray& sdp, int& width, int& height);
+
+    // Out-of-band parameter sets of the first video stream as NAL units: H.264
+    // sprop-parameter-sets, or H.265 sprop-vps/-sps/-pps in that order
+    static QList<QByteArray> sdpParameterSets(const QByteArray& sdp);
+
+    // Authentication: answers a WWW-Authenticate challenge (Digest or Basic). With
+    // qop=auth, nonceCount is the nc value and must grow with each request on a nonce
+    static QByteArray authorization(const QList<QByteArray>& challenges, const QByteArray& method,
+                                    const QByteArray& uri, const QString& username, const QString& password,
+                                    int nonceCount = 1);
+
+    // Message construction
+    static QByteArray buildRequest(const QByteArray& method, const QByteArray& url, int cseq,
+                                   const HeaderList& headers = HeaderList());
+    static QByteArray buildResponse(int statusCode, const QByteArray& reason, int cseq,
+                                    const HeaderList& headers = HeaderList());  // cseq < 0 omits CSeq
+};
+
+#endif // RTSPPROTOCOL_H
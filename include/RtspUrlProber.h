@@ -0,0 +1,100 @@
+#ifndef RTSPURLPROBER_H
+#define RTSPURLPROBER_H
+
+#include <QObject>
+#include <QTcpSocket>
+#include <QStringList>
+#include <QList>
+#include <QHash>
+#include <QElapsedTimer>
+
+// Outcome of probing one camera's candidate stream paths
+struct RtspProbeResult
+{
+    QString ipAddress;
+    int port;
+    QString url;                // First candidate that returned an SDP; empty if none did
+    QString codec;              // Video encoding from the SDP ("H264", "H265", ...)
+    int width;                  // 0 if the SDP does not tell
+    int height;
+    bool authFailed;            // Some candidate still answered 401 with the credentials given
+    int connectMs;              // Fastest TCP connect to the camera, -1 if none succeeded
+
+    RtspProbeResult() : port(554), width(0), height(0), authFailed(false), connectMs(-1) {}
+};
+
+// Finds a working stream URL by sending DESCRIBE for each candidate path. A host's
+// candidates are tried a few at a time; 401 Digest/Basic challenges are answered
+// with the configured credentials on the same connection. The result is the first
+// candidate in list order whose reply carries a video SDP, so probing in parallel
+// picks the same path a sequential probe would.
+class RtspUrlProber : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RtspUrlProber(QObject *parent = nullptr);
+
+    void setCredentials(const QString& username, const QString& password);
+    void setTimeout(int milliseconds) { m_timeout = milliseconds; }
+    void setMaxParallelPerHost(int count) { m_maxParallelPerHost = qMax(1, count); }
+    void setMaxParallel(int count) { m_maxParallel = qMax(1, count); }
+
+    // No-op while the same host is still being probed
+    void probe(const QString& ipAddress, int port, const QStringList& paths);
+    void stop();
+    bool isActive() const { return !m_hosts.isEmpty(); }
+
+signals:
+    void probeFinished(const RtspProbeResult& result);
+
+private:
+    enum CandidateState {
+        Pending,
+        Failed,
+        Described
+    };
+
+    struct HostProbe {
+        RtspProbeResult result;
+        QStringList paths;
+        QList<CandidateState> states;
+        QList<QByteArray> sdps;
+        int nextPath;
+        int inFlight;
+    };
+
+    struct Attempt {
+        QString host;               // "ip:port" key into m_hosts
+        int candidate;
+        QByteArray url;
+        QByteArray buffer;
+        int cseq;
+        bool authorized;            // DESCRIBE was resent with credentials
+        QElapsedTimer started;
+    };
+
+    void launchAttempts();
+    void startAttempt(HostProbe& probe, const QString& key);
+    void handleReply(QTcpSocket* socket);
+    void finishAttempt(QTcpSocket* socket, CandidateState state, const QByteArray& sdp = QByteArray());
+    void settleHost(const QString& key);
+    QByteArray describeRequest(const Attempt& attempt, const QList<QByteArray>& challenges) const;
+
+    QString m_username;
+    QString m_password;
+    int m_timeout;
+    int m_maxParallelPerHost;
+    int m_maxParallel;
+    int m_inFlight;
+    QHash<QString, HostProbe> m_hosts;
+    QStringList m_hostOrder;            // Hosts are served in the order they were queued
+    QHash<QTcpSocket*, Attempt> m_attempts;
+
+    static const int DEFAULT_TIMEOUT_MS = 3000;
+    static const int DEFAULT_MAX_PARALLEL_PER_HOST = 2;    // Embedded RTSP servers allow few sessions
+    static const int DEFAULT_MAX_PARALLEL = 32;
+    static const int MAX_REPLY_SIZE = 16384;
+};
+
+#endif // RTSPURLPROBER_H
@@ -0,0 +1,46 @@
+#ifndef RTTESTIMATOR_H
+#define RTTESTIMATOR_H
+
+#include <QHash>
+#include <QList>
+#include <QString>
+
+// Connect round trips seen by the sweep, kept per /24 so a local segment and a
+// routed site link each get a timeout of their own. A probe that completed the
+// handshake or was refused is a sample; a probe that timed out is not. Until a
+// subnet has enough samples it keeps the fallback timeout.
+class RttEstimator
+{
+public:
+    explicit RttEstimator(int fallbackTimeout = DEFAULT_FALLBACK_TIMEOUT_MS);
+
+    void setFallbackTimeout(int milliseconds) { m_fallbackTimeout = qMax(1, milliseconds); }
+    void clear() { m_subnets.clear(); }
+
+    void addSample(quint32 address, int milliseconds);
+    int timeoutFor(quint32 address) const;      // ms
+    int p95(quint32 address) const;             // ms, -1 while the subnet has too few samples
+    QString summary() const;                    // "10.0.1.0/24 p95 1 ms -> 50 ms, ..." for the log
+
+private:
+    struct Subnet {
+        QList<int> samples;         // Ring of the most recent round trips
+        int next = 0;
+        int p95 = -1;
+        int timeout = 0;
+    };
+
+    static quint32 subnetOf(quint32 address) { return address & 0xFFFFFF00u; }
+
+    int m_fallbackTimeout;
+    QHash<quint32, Subnet> m_subnets;
+
+    static const int DEFAULT_FALLBACK_TIMEOUT_MS = 300;
+    static const int MIN_SAMPLES = 8;
+    static const int MAX_SAMPLES = 64;
+    static const int TIMEOUT_P95_MULTIPLE = 4;
+    static const int MIN_TIMEOUT_MS = 50;       // Scanner deadlines are checked every 20 ms
+    static const int MAX_TIMEOUT_MS = 2000;
+};
+
+#endif // RTTESTIMATOR_H
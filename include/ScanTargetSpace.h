@@ -0,0 +1,79 @@
+#ifndef SCANTARGETSPACE_H
+#define SCANTARGETSPACE_H
+
+#include <QString>
+#include <QList>
+#include <QPair>
+
+// Set of IPv4 hosts to sweep, described by a list of ranges:
+//   "10.0.0.0/16, 192.168.1.10-192.168.1.50, 172.16.4.7, !10.0.5.0/24"
+// Entries prefixed with '!' are excluded. Ranges are kept as merged intervals,
+// so memory depends on the length of the description, never on the number of
+// hosts, and any host can be addressed by its index.
+class ScanTargetSpace
+{
+public:
+    bool parse(const QString& spec, QString* error = nullptr);
+    void clear();
+
+    quint64 hostCount() const { return m_hostCount; }
+    quint32 hostAt(quint64 index) const;
+    bool contains(quint32 address) const;
+    QString description() const;
+
+    static const int MIN_PREFIX_LENGTH = 8;
+
+private:
+    typedef QPair<quint32, quint32> Interval;   // Inclusive
+
+    static bool parseEntry(const QString& entry, Interval& interval, QString* error);
+    static QList<Interval> merged(QList<Interval> intervals);
+    static QList<Interval> subtract(const QList<Interval>& from, const QList<Interval>& excluded);
+
+    QList<Interval> m_intervals;
+    QList<quint64> m_offsets;                   // Hosts before each interval
+    quint64 m_hostCount = 0;
+};
+
+// Pseudo-random permutation of [0, size) with O(1) state: a full-period LCG
+// modulo the next power of two, scrambled by a bijective mixer and walked until
+// it lands inside the range. Consecutive indices land far apart, so a sweep does
+// not march through one subnet (and one access switch) at a time.
+class ScanOrder
+{
+public:
+    ScanOrder(quint64 size = 0, quint64 seed = 0);
+
+    bool next(quint64& value);
+    quint64 position() const { return m_steps; }   // Raw generator steps taken
+    void seek(quint64 position);
+    quint64 size() const { return m_size; }
+
+private:
+    quint64 mix(quint64 x) const;
+
+    quint64 m_size;
+    quint64 m_mask;
+    int m_bits;
+    quint64 m_increment;
+    quint64 m_start;
+    quint64 m_state;
+    quint64 m_steps;
+};
+
+// Where a stopped sweep left off; passed back to NetworkScanner to resume it
+struct ScanCursor
+{
+    QString networkRange;
+    QList<int> ports;
+    quint64 seed = 0;
+    int phase = 0;                  // 0 = priority ports, 1 = remaining ports
+    quint64 position = 0;           // ScanOrder position within the phase
+    int completed = 0;              // Probes finished, for progress reporting
+    QList<quint32> answeredHosts;   // Skipped in the remaining-ports phase
+    QList<quint32> seededHosts;     // Probed ahead of the sweep; empty if that stage did not finish
+
+    bool isValid() const { return !networkRange.isEmpty(); }
+};
+
+#endif // SCANTARGETSPACE_H
@@ -0,0 +1,80 @@
+#ifndef SSDPDISCOVERY_H
+#define SSDPDISCOVERY_H
+
+#include <QObject>
+#include <QUdpSocket>
+#include <QHostAddress>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QTimer>
+#include <QHash>
+#include <QSet>
+
+// One UPnP root device, from an SSDP announcement plus its description document
+struct SsdpDevice
+{
+    QString ipAddress;
+    QString usn;                // Unique service name, stable per device
+    QString location;           // Description document URL
+    QString server;             // SERVER header: OS, UPnP and product versions
+    QString deviceType;
+    QString friendlyName;
+    QString manufacturer;
+    QString modelName;
+    QString modelNumber;
+    QString serialNumber;
+    QString presentationUrl;
+    QString macAddress;         // Only when the description carries one
+};
+
+// SSDP (UPnP) source for camera discovery. search() multicasts an M-SEARCH and
+// collects the unicast responses for a short window; startListening() joins the
+// SSDP group and picks up ssdp:alive NOTIFYs for as long as the object lives.
+// Each new LOCATION is fetched once so the device can be named and classified.
+class SsdpDiscovery : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SsdpDiscovery(QObject *parent = nullptr);
+
+    bool startListening();
+    void search(int windowMs = DEFAULT_WINDOW_MS);
+    void stop();                // Ends the search window; the listener stays
+    bool isActive() const;      // Search window open or descriptions still loading
+
+    static QByteArray buildSearch(int maxWaitSeconds);
+    static QHash<QByteArray, QByteArray> parseHeaders(const QByteArray& message, QByteArray* startLine = nullptr);
+    static bool parseDescription(const QByteArray& xml, SsdpDevice& device);
+
+    static const int DEFAULT_WINDOW_MS = 1500;
+    static const quint16 SSDP_PORT = 1900;
+
+signals:
+    void deviceFound(const SsdpDevice& device);
+    void finished(int deviceCount);
+
+private slots:
+    void readDatagrams();
+    void onWindowElapsed();
+    void onDescriptionReply();
+
+private:
+    void handleMessage(const QByteArray& message, const QHostAddress& sender);
+    void fetchDescription(const SsdpDevice& device);
+    void checkFinished();
+
+    QUdpSocket* m_searchSocket;
+    QUdpSocket* m_listenSocket;
+    QNetworkAccessManager* m_networkManager;
+    QTimer* m_windowTimer;
+    QSet<QString> m_seenLocations;
+    QHash<QNetworkReply*, SsdpDevice> m_pendingDescriptions;
+    bool m_searching;
+    int m_deviceCount;
+
+    static const int DESCRIPTION_TIMEOUT_MS = 2000;
+    static const int MAX_DATAGRAM_SIZE = 65536;
+};
+
+#endif // SSDPDISCOVERY_H
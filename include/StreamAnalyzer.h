@@ -0,0 +1,81 @@
+#ifndef STREAMANALYZER_H
+#define STREAMANALYZER_H
+
+#include <QtGlobal>
+#include <QJsonObject>
+#include "RtpInterleavedParser.h"
+
+// Rolling video stream estimate for one window
+struct StreamEstimate
+{
+    qint64 bitsPerSecond = 0;
+    double framesPerSecond = 0.0;
+    double gopFrames = 0.0;                 // Average frames per keyframe in the window
+    double keyframeIntervalSeconds = 0.0;   // Average time between keyframes in the window
+    double coveredSeconds = 0.0;            // Portion of the window that has data (0 = no estimate yet)
+
+    QJsonObject toJson() const;
+};
+
+// Derives bitrate, frame rate and keyframe interval from the video RTP packets the
+// relay already frames. Packets are accounted into fixed per-second and per-minute
+// rings, so the 1 s / 1 min / 1 h windows cost a constant amount of memory and
+// nothing is allocated per packet.
+class StreamAnalyzer
+{
+public:
+    enum Window {
+        WindowSecond,
+        WindowMinute,
+        WindowHour
+    };
+
+    StreamAnalyzer();
+
+    void reset();
+    void setVideoFormat(int payloadType, RtpInterleavedParser::VideoCodec codec);
+    int videoPayloadType() const { return m_payloadType; }
+
+    // One interleaved frame as reported by RtpInterleavedParser; non-video channels are ignored
+    void addPacket(qint64 nowMs, int channel, const unsigned char* prefix, int prefixLength, int packetLength);
+
+    StreamEstimate estimate(Window window, qint64 nowMs) const;
+
+    // Exact values from RTP timestamps of the two most recent keyframes
+    int lastGopFrames() const { return m_lastGopFrames; }
+    qint64 lastKeyframeIntervalMs() const { return m_lastKeyframeIntervalMs; }
+
+private:
+    struct Bucket {
+        qint64 index = -1;
+        qint64 bytes = 0;
+        quint32 frames = 0;
+        quint32 keyframes = 0;
+    };
+
+    static Bucket& slot(Bucket* ring, qint64 index);
+    static void sumBuckets(const Bucket* ring, qint64 first, qint64 last, Bucket& total);
+    void countFrame(qint64 nowMs);
+
+    static const int WINDOW_BUCKETS = 60;
+    static const int RING_SIZE = 64;            // Room for the bucket being filled beside a full window
+    static const int VIDEO_CLOCK_RATE = 90000;  // H.264/H.265 RTP clock
+
+    Bucket m_seconds[RING_SIZE];
+    Bucket m_minutes[RING_SIZE];
+
+    int m_payloadType;
+    RtpInterleavedParser::VideoCodec m_codec;
+    qint64 m_firstMs;
+
+    bool m_havePacket;
+    bool m_lastMarker;
+    quint32 m_lastTimestamp;
+    quint32 m_lastKeyframeTimestamp;
+    bool m_haveKeyframe;
+    int m_framesSinceKeyframe;
+    int m_lastGopFrames;
+    qint64 m_lastKeyframeIntervalMs;
+};
+
+#endif // STREAMANALYZER_H
@@ -0,0 +1,85 @@
+#ifndef SYNCJOURNAL_H
+#define SYNCJOURNAL_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QByteArray>
+#include <QList>
+#include <QHash>
+#include <QString>
+
+class QTimer;
+struct SyncOperation;
+
+// Write-ahead journal of the API sync queue, so operations queued while offline
+// survive a restart. The file is a header followed by length- and CRC-32-framed
+// records: "put" stores an operation under its journal ID (again when it changes),
+// "remove" drops it once it was sent or superseded. Records are collected on the
+// caller's thread and handed to a writer thread in batches, one write and one
+// fsync per batch. Once most of the file is dead records it is rewritten from the
+// live set.
+class SyncJournal : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit SyncJournal(const QString& filePath = defaultFilePath(), QObject *parent = nullptr);
+    ~SyncJournal();
+
+    // Pending operations in journal ID order; call once, before start(). A torn or
+    // corrupt tail is cut off.
+    QList<SyncOperation> replay();
+    quint64 lastJournalId() const { return m_lastJournalId; }
+
+    void put(const SyncOperation& operation);
+    void remove(quint64 journalId);
+    void close();                       // Writes what is batched and stops the writer
+
+    static QString defaultFilePath();
+
+protected:
+    void run() override;
+
+private:
+    enum RecordKind : quint8 {
+        PutRecord = 1,
+        RemoveRecord = 2
+    };
+
+    struct Batch {
+        QByteArray records;
+        QByteArray snapshot;            // If compacting: the whole new file, records included
+    };
+
+    void append(const QByteArray& record);
+    void flushBatch();
+    void compactIfWasteful();
+    static QByteArray frame(const QByteArray& payload);
+    static QByteArray fileHeader();
+
+    QString m_filePath;
+    quint64 m_lastJournalId;
+
+    // Caller's thread
+    QHash<quint64, QByteArray> m_live;  // Journal ID -> its latest framed put record
+    qint64 m_liveBytes;
+    qint64 m_fileBytes;                 // Including batches not yet written
+    QByteArray m_batch;
+    QTimer* m_flushTimer;
+
+    // Shared with the writer thread
+    QMutex m_mutex;
+    QWaitCondition m_wakeWriter;
+    QList<Batch> m_batches;
+    bool m_stopping;
+
+    static const quint32 FILE_MAGIC = 0x56534A31;   // "VSJ1"
+    static const quint16 FILE_VERSION = 1;
+    static const int FLUSH_DELAY_MS = 200;
+    static const int MAX_RECORD_SIZE = 1024 * 1024;
+    static const qint64 COMPACT_MIN_BYTES = 256 * 1024;
+    static const int COMPACT_DEAD_RATIO = 4;        // Rewrite once the file is this many times the live set
+};
+
+#endif // SYNCJOURNAL_H
@@ -0,0 +1,130 @@
+#include "ApiRequestStats.h"
+#include <QJsonArray>
+#include <QStringList>
+#include <algorithm>
+
+const QList<int> ApiRequestStats::BUCKET_BOUNDS_MS = {5, 10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 30000};
+
+namespace {
+const char* const ERROR_CLASS_NAMES[] = {"ok", "network", "timeout", "client", "server"};
+}
+
+void ApiRequestStats::Histogram::add(qint64 milliseconds)
+{
+    if (buckets.isEmpty()) {
+        buckets.fill(0, BUCKET_BOUNDS_MS.size() + 1);
+    }
+    milliseconds = qMax(qint64(0), milliseconds);
+    const int bucket = std::lower_bound(BUCKET_BOUNDS_MS.begin(), BUCKET_BOUNDS_MS.end(), milliseconds)
+                       - BUCKET_BOUNDS_MS.begin();
+    buckets[bucket]++;
+    count++;
+    sumMs += milliseconds;
+    maxMs = qMax(maxMs, milliseconds);
+}
+
+int ApiRequestStats::Histogram::percentile(int percent) const
+{
+    if (count == 0) {
+        return -1;
+    }
+    // Upper bound of the bucket holding the nearest-rank sample, capped by the maximum seen
+    const int rank = qMax(1, (count * percent + 99) / 100);
+    int seen = 0;
+    for (int i = 0; i < buckets.size(); ++i) {
+        seen += buckets.at(i);
+        if (seen >= rank) {
+            return int(i < BUCKET_BOUNDS_MS.size() ? qMin(qint64(BUCKET_BOUNDS_MS.at(i)), maxMs) : maxMs);
+        }
+    }
+    return int(maxMs);
+}
+
+QJsonObject ApiRequestStats::Histogram::toJson() const
+{
+    QJsonObject json;
+    json["count"] = count;
+    json["meanMs"] = count > 0 ? double(sumMs) / count : 0.0;
+    json["p50Ms"] = percentile(50);
+    json["p95Ms"] = percentile(95);
+    json["p99Ms"] = percentile(99);
+    json["maxMs"] = maxMs;
+
+    QJsonArray histogram;
+    for (int i = 0; i < buckets.size(); ++i) {
+        QJsonObject bucket;
+        bucket["le"] = i < BUCKET_BOUNDS_MS.size() ? QJsonValue(BUCKET_BOUNDS_MS.at(i)) : QJsonValue("inf");
+        bucket["count"] = buckets.at(i);
+        histogram.append(bucket);
+    }
+    json["buckets"] = histogram;
+    return json;
+}
+
+void ApiRequestStats::record(const QString& operation, const ApiRequestTiming& timing, ErrorClass error)
+{
+    Operation& stats = m_operations[operation];
+    stats.errors[error]++;
+    stats.total.add(timing.totalMs);
+
+    if (timing.connectStartMs >= 0) {
+        stats.dns.add(timing.connectStartMs);
+        if (timing.requestSentMs >= 0) {
+            stats.connect.add(timing.requestSentMs - timing.connectStartMs);
+        }
+        if (timing.encryptedMs >= 0) {
+            stats.tls.add(timing.encryptedMs - timing.connectStartMs);
+        }
+    }
+    if (timing.firstByteMs >= 0) {
+        stats.firstByte.add(timing.firstByteMs - qMax(qint64(0), timing.requestSentMs));
+    }
+}
+
+int ApiRequestStats::requestCount(const QString& operation) const
+{
+    return m_operations.value(operation).total.count;
+}
+
+int ApiRequestStats::percentile(const QString& operation, int percent) const
+{
+    return m_operations.value(operation).total.percentile(percent);
+}
+
+QJsonObject ApiRequestStats::toJson() const
+{
+    QJsonObject json;
+    for (auto it = m_operations.constBegin(); it != m_operations.constEnd(); ++it) {
+        const Operation& stats = it.value();
+        QJsonObject errors;
+        for (int i = NoError; i <= ServerError; ++i) {
+            errors[ERROR_CLASS_NAMES[i]] = stats.errors[i];
+        }
+
+        QJsonObject operation;
+        operation["requests"] = stats.total.count;
+        operation["results"] = errors;
+        operation["dns"] = stats.dns.toJson();
+        operation["connect"] = stats.connect.toJson();
+        operation["tls"] = stats.tls.toJson();
+        operation["firstByte"] = stats.firstByte.toJson();
+        operation["total"] = stats.total.toJson();
+        json[it.key()] = operation;
+    }
+    return json;
+}
+
+QString ApiRequestStats::summary() const
+{
+    QStringList names = m_operations.keys();
+    names.sort();
+    QStringList parts;
+    for (const QString& name : names) {
+        const Operation& stats = m_operations.value(name);
+        const int errors = stats.total.count - stats.errors[NoError];
+        parts.append(QString("%1 %2 req p50 %3 ms p95 %4 ms, %5 errors")
+                     .arg(name).arg(stats.total.count).arg(stats.total.percentile(50))
+                     .arg(stats.total.percentile(95)).arg(errors));
+    }
+    return parts.isEmpty() ? QString("no requests") : parts.join("; ");
+}
@@ -2,49 +2,189 @@
 #include "AuthDialog.h"
 #include "ConfigManager.h"
 #include "Logger.h"
+#include "SyncJournal.h"
+#include "NetworkInterfaceManager.h"
 #include <QNetworkRequest>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QJsonArray>
+#include <QSharedPointer>
 #include <QApplication>
 #include <QMessageBox>
 #include <QUrl>
 #include <QUrlQuery>
+#include <algorithm>
+
+namespace {
+// Folds a new operation into a camera's pending ones; returns the index of the
+// operation added or changed, or -1 if none was. An operation changed in place
+// keeps its journal ID.
+int coalesceOperation(QList<SyncOperation>& pending, const SyncOperation& operation)
+{
+    auto findType = [&pending](SyncOperationType type) {
+        for (int i = 0; i < pending.size(); ++i) {
+            if (pending.at(i).type == type) {
+                return i;
+            }
+        }
+        return -1;
+    };
+    auto removeTypes = [&pending](std::initializer_list<SyncOperationType> types) {
+        pending.erase(std::remove_if(pending.begin(), pending.end(), [types](const SyncOperation& queued) {
+            return std::find(types.begin(), types.end(), queued.type) != types.end();
+        }), pending.end());
+    };
+
+    switch (operation.type) {
+        case SyncOperationType::CREATE:
+            pending.append(operation);
+            return pending.size() - 1;
+        case SyncOperationType::UPDATE: {
+            // The full camera data supersedes earlier updates and status changes; a
+            // create that has not gone out yet simply sends the newer data
+            removeTypes({SyncOperationType::UPDATE, SyncOperationType::STATUS_UPDATE});
+            const int create = findType(SyncOperationType::CREATE);
+            if (create >= 0) {
+                pending[create].camera = operation.camera;
+                return create;
+            }
+            pending.append(operation);
+            return pending.size() - 1;
+        }
+        case SyncOperationType::STATUS_UPDATE:
+            removeTypes({SyncOperationType::STATUS_UPDATE});
+            pending.append(operation);
+            return pending.size() - 1;
+        case SyncOperationType::DELETE_CAMERA: {
+            // A camera the server never heard of needs no delete either
+            const bool created = findType(SyncOperationType::CREATE) >= 0;
+            pending.clear();
+            if (created) {
+                return -1;
+            }
+            pending.append(operation);
+            return 0;
+        }
+        case SyncOperationType::START_STREAM: {
+            const int start = findType(SyncOperationType::START_STREAM);
+            if (start >= 0) {
+                const quint64 journalId = pending.at(start).journalId;
+                pending[start] = operation;
+                pending[start].journalId = journalId;
+                return start;
+            }
+            pending.append(operation);
+            return pending.size() - 1;
+        }
+    }
+    return -1;
+}
+}
 
 CameraApiService::CameraApiService(WireGuardManager* wireGuardManager, QObject *parent)
     : QObject(parent)
     , m_networkManager(new QNetworkAccessManager(this))
+    , m_syncQueueSize(0)
+    , m_journal(new SyncJournal(SyncJournal::defaultFilePath(), this))
+    , m_nextJournalId(1)
     , m_syncTimer(new QTimer(this))
     , m_connectivityTimer(new QTimer(this))
     , m_isOnline(true) // Start as online, will be updated by connectivity check
     , m_isSyncing(false)
+    , m_camerasRetryTimer(new QTimer(this))
+    , m_streamsRetryTimer(new QTimer(this))
+    , m_interfaceManager(nullptr)
+    , m_connectivityHintTimer(new QTimer(this))
+    , m_syncConcurrency(DEFAULT_SYNC_CONCURRENCY)
+    , m_syncCompleted(0)
+    , m_syncRetryTimer(new QTimer(this))
     , m_baseUrl(ConfigManager::instance().getApiBaseUrl())
     , m_wireGuardManager(wireGuardManager)
+    , m_batchTimer(new QTimer(this))
+    , m_batchEndpointAvailable(true)
 {
+    // Operations still queued when the app last stopped go out with the next sync
+    const QList<SyncOperation> journaled = m_journal->replay();
+    for (const SyncOperation& operation : journaled) {
+        auto pending = m_syncQueue.find(operation.localCameraId);
+        if (pending == m_syncQueue.end()) {
+            pending = m_syncQueue.insert(operation.localCameraId, QList<SyncOperation>());
+            m_syncCameraOrder.append(operation.localCameraId);
+        }
+        pending.value().append(operation);
+    }
+    m_syncQueueSize = journaled.size();
+    m_nextJournalId = m_journal->lastJournalId() + 1;
+    m_journal->start();
+    if (!journaled.isEmpty()) {
+        LOG_INFO(QString("Restored %1 queued sync operations for %2 cameras from the journal")
+                 .arg(journaled.size()).arg(m_syncQueue.size()), "CameraApiService");
+    }
+    
     // Setup sync timer for processing queued operations
     m_syncTimer->setSingleShot(false);
     m_syncTimer->setInterval(60000); // Check every 60 seconds (reduced from 30)
     connect(m_syncTimer, &QTimer::timeout, this, &CameraApiService::onSyncTimerTimeout);
     m_syncTimer->start();
     
-    // Setup connectivity check timer - less frequent
+    m_networkManager->setTransferTimeout(REQUEST_TIMEOUT_MS);
+    m_clock.start();
+    m_camerasRetryTimer->setSingleShot(true);
+    connect(m_camerasRetryTimer, &QTimer::timeout, this, [this]() { onEndpointRetryTimeout(ApiEndpoint::Cameras); });
+    m_streamsRetryTimer->setSingleShot(true);
+    connect(m_streamsRetryTimer, &QTimer::timeout, this, [this]() { onEndpointRetryTimeout(ApiEndpoint::Streams); });
+    
+    m_syncRetryTimer->setSingleShot(true);
+    connect(m_syncRetryTimer, &QTimer::timeout, this, [this]() {
+        if (m_isSyncing) {
+            dispatchSyncOperations();
+        } else {
+            processSyncQueue();
+        }
+    });
+    
+    m_batchTimer->setSingleShot(true);
+    m_batchTimer->setInterval(BATCH_WINDOW_MS);
+    connect(m_batchTimer, &QTimer::timeout, this, &CameraApiService::flushBatchUpdates);
+    
+    // Connectivity follows replies, the tunnel and interface changes; polling is the fallback
     m_connectivityTimer->setSingleShot(false);
-    m_connectivityTimer->setInterval(120000); // Check every 2 minutes (reduced from 15 seconds)
+    m_connectivityTimer->setInterval(CONNECTIVITY_FALLBACK_MS);
     connect(m_connectivityTimer, &QTimer::timeout, this, &CameraApiService::checkNetworkConnectivity);
     m_connectivityTimer->start();
     
+    m_connectivityHintTimer->setSingleShot(true);
+    m_connectivityHintTimer->setInterval(CONNECTIVITY_HINT_DELAY_MS);
+    connect(m_connectivityHintTimer, &QTimer::timeout, this, &CameraApiService::checkConnectivityNow);
+    if (m_wireGuardManager) {
+        connect(m_wireGuardManager, &WireGuardManager::connectionStatusChanged, this,
+                [this](WireGuardManager::ConnectionStatus status) {
+            if (status == WireGuardManager::Connected || status == WireGuardManager::Disconnected) {
+                onConnectivityHint(status == WireGuardManager::Connected ? "tunnel connected" : "tunnel disconnected");
+            }
+        });
+    }
+    
     // Initial connectivity check after a short delay to let the app initialize
     QTimer::singleShot(5000, this, &CameraApiService::checkNetworkConnectivity);
     
     // Listen for config changes to update base URL
     connect(&ConfigManager::instance(), &ConfigManager::configChanged, this, &CameraApiService::onConfigChanged);
     
-    LOG_INFO(QString("Camera API Service initialized with base URL: %1 - Connectivity checks every 2 minutes").arg(m_baseUrl), "CameraApiService");
+    LOG_INFO(QString("Camera API Service initialized with base URL: %1").arg(m_baseUrl), "CameraApiService");
 }
 
 CameraApiService::~CameraApiService()
 {
     m_syncTimer->stop();
     m_connectivityTimer->stop();
+    m_batchTimer->stop();
+    
+    // Updates still waiting for their batch are retried from the journal next time
+    for (const BatchUpdate& update : m_batchUpdates) {
+        queueOperation(SyncOperation(SyncOperationType::UPDATE, update.camera.id(), update.camera));
+    }
+    m_journal->close();
 }
 
 void CameraApiService::createCamera(const CameraConfig& camera)
@@ -59,11 +199,15 @@ void CameraApiService::createCamera(const CameraConfig& camera)
     if (!m_isOnline) {
         queueOperation(SyncOperation(SyncOperationType::CREATE, camera.id(), camera));
         LOG_INFO(QString("Queued camera creation (offline): %1").arg(camera.name()), "CameraApiService");
-        // Trigger a connectivity check to see if we can go online
-        QTimer::singleShot(1000, this, &CameraApiService::checkNetworkConnectivity);
+        scheduleEndpointRetry(ApiEndpoint::Cameras);
         return;
     }
     
+    sendCreateCamera(camera, token);
+}
+
+QNetworkReply* CameraApiService::sendCreateCamera(const CameraConfig& camera, const QString& token)
+{
     QNetworkRequest request(QUrl(m_baseUrl + "/cameras/"));
     request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
     request.setRawHeader("Authorization", QString("Bearer %1").arg(token).toUtf8());
@@ -80,8 +224,10 @@ void CameraApiService::createCamera(const CameraConfig& camera)
     connect(reply, &QNetworkReply::finished, this, &CameraApiService::onCreateCameraFinished);
     connect(reply, QOverload<QNetworkReply::NetworkError>::of(&QNetworkReply::errorOccurred),
             this, &CameraApiService::onNetworkError);
+    trackReply(reply, ApiEndpoint::Cameras, "create");
     
     LOG_INFO(QString("Creating camera on server: %1").arg(camera.name()), "CameraApiService");
+    return reply;
 }
 
 void CameraApiService::updateCamera(const CameraConfig& camera)
@@ -97,6 +243,11 @@ void CameraApiService::updateCamera(const CameraConfig& camera)
         return;
     }
     
+    queueBatchUpdate(camera, false);
+}
+
+QNetworkReply* CameraApiService::sendUpdateCamera(const CameraConfig& camera, const QString& token)
+{
     QNetworkRequest request(QUrl(QString("%1/cameras/%2").arg(m_baseUrl).arg(camera.serverCameraId())));
     request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
     request.setRawHeader("Authorization", QString("Bearer %1").arg(token).toUtf8());
@@ -112,23 +263,31 @@ void CameraApiService::updateCamera(const CameraConfig& camera)
     connect(reply, &QNetworkReply::finished, this, &CameraApiService::onUpdateCameraFinished);
     connect(reply, QOverload<QNetworkReply::NetworkError>::of(&QNetworkReply::errorOccurred),
             this, &CameraApiService::onNetworkError);
+    trackReply(reply, ApiEndpoint::Cameras, "update");
     
     LOG_INFO(QString("Updating camera on server: %1 (Server Camera ID: %2)").arg(camera.name()).arg(camera.serverCameraId()), "CameraApiService");
+    return reply;
 }
 
 void CameraApiService::deleteCamera(const QString& localCameraId, const QString& serverCameraId)
 {
     QString token = AuthDialog::getCurrentAuthToken();
+    // The sync queue can only delete what it has a server ID for
     if (token.isEmpty()) {
-        queueOperation(SyncOperation(SyncOperationType::DELETE_CAMERA, localCameraId));
+        queueOperation(SyncOperation(SyncOperationType::DELETE_CAMERA, localCameraId, CameraConfig(), QString(), serverCameraId));
         return;
     }
     
     if (!m_isOnline || serverCameraId.isEmpty()) {
-        queueOperation(SyncOperation(SyncOperationType::DELETE_CAMERA, localCameraId));
+        queueOperation(SyncOperation(SyncOperationType::DELETE_CAMERA, localCameraId, CameraConfig(), QString(), serverCameraId));
         return;
     }
     
+    sendDeleteCamera(localCameraId, serverCameraId, token);
+}
+
+QNetworkReply* CameraApiService::sendDeleteCamera(const QString& localCameraId, const QString& serverCameraId, const QString& token)
+{
     QNetworkRequest request(QUrl(QString("%1/cameras/%2").arg(m_baseUrl).arg(serverCameraId)));
     request.setRawHeader("Authorization", QString("Bearer %1").arg(token).toUtf8());
     
@@ -140,8 +299,10 @@ void CameraApiService::deleteCamera(const QString& localCameraId, const QString&
     connect(reply, &QNetworkReply::finished, this, &CameraApiService::onDeleteCameraFinished);
     connect(reply, QOverload<QNetworkReply::NetworkError>::of(&QNetworkReply::errorOccurred),
             this, &CameraApiService::onNetworkError);
+    trackReply(reply, ApiEndpoint::Cameras, "delete");
     
-        LOG_INFO(QString("Deleting camera on server: %1 (Server Camera ID: %2)").arg(localCameraId).arg(serverCameraId), "CameraApiService");
+    LOG_INFO(QString("Deleting camera on server: %1 (Server Camera ID: %2)").arg(localCameraId).arg(serverCameraId), "CameraApiService");
+    return reply;
 }
 
 void CameraApiService::updateCameraStatus(const QString& localCameraId, const QString& serverCameraId, bool isActive)
@@ -159,8 +320,7 @@ void CameraApiService::updateCameraStatus(const QString& localCameraId, const QS
         queueOperation(SyncOperation(SyncOperationType::STATUS_UPDATE, localCameraId, CameraConfig(), status, serverCameraId));
         LOG_INFO(QString("Queued camera status update (offline/no server ID): %1 -> %2 (Server Camera ID: %3)")
                  .arg(localCameraId, status).arg(serverCameraId), "CameraApiService");
-        // Trigger a connectivity check to see if we can go online
-        QTimer::singleShot(1000, this, &CameraApiService::checkNetworkConnectivity);
+        scheduleEndpointRetry(ApiEndpoint::Cameras);
         return;
     }
     
@@ -172,6 +332,31 @@ void CameraApiService::updateCameraStatus(const QString& localCameraId, const QS
 void CameraApiService::startStream(const CameraConfig& camera)
 {
     QString token = AuthDialog::getCurrentAuthToken();
+    QString serverCameraId = camera.serverCameraId();
+    if (serverCameraId.isEmpty()) {
+        serverCameraId = camera.id(); // Fallback
+    }
+
+    if (token.isEmpty()) {
+        SyncOperation op(SyncOperationType::START_STREAM, camera.id(), camera, QString(), serverCameraId);
+        queueOperation(op);
+        LOG_INFO(QString("Queued stream start (no token): Stream Name %1").arg(camera.streamName()), "CameraApiService");
+        return;
+    }
+    
+    if (!m_isOnline || !m_streamsBreaker.allowRequest(m_clock.elapsed())) {
+        SyncOperation op(SyncOperationType::START_STREAM, camera.id(), camera, QString(), serverCameraId);
+        queueOperation(op);
+        LOG_INFO(QString("Queued stream start (offline): Stream Name %1").arg(camera.streamName()), "CameraApiService");
+        scheduleEndpointRetry(m_isOnline ? ApiEndpoint::Streams : ApiEndpoint::Cameras);
+        return;
+    }
+    
+    sendStartStream(camera, token);
+}
+
+QNetworkReply* CameraApiService::sendStartStream(const CameraConfig& camera, const QString& token)
+{
     QJsonObject json;
     
     // Use the stream_name from the camera config (retrieved from server during creation)
@@ -197,22 +382,6 @@ void CameraApiService::startStream(const CameraConfig& camera)
     if (serverCameraId.isEmpty()) {
         serverCameraId = camera.id(); // Fallback
     }
-
-    if (token.isEmpty()) {
-        SyncOperation op(SyncOperationType::START_STREAM, camera.id(), camera, QString(), serverCameraId);
-        queueOperation(op);
-        LOG_INFO(QString("Queued stream start (no token): Stream Name %1").arg(json["stream_name"].toString()), "CameraApiService");
-        return;
-    }
-    
-    if (!m_isOnline) {
-        SyncOperation op(SyncOperationType::START_STREAM, camera.id(), camera, QString(), serverCameraId);
-        queueOperation(op);
-        LOG_INFO(QString("Queued stream start (offline): Stream Name %1").arg(json["stream_name"].toString()), "CameraApiService");
-        // Trigger a connectivity check to see if we can go online
-        QTimer::singleShot(1000, this, &CameraApiService::checkNetworkConnectivity);
-        return;
-    }
     
     // Endpoint: /streams/start on Port 8001
     QUrl baseUrl(m_baseUrl);
@@ -232,8 +401,10 @@ void CameraApiService::startStream(const CameraConfig& camera)
     connect(reply, &QNetworkReply::finished, this, &CameraApiService::onStartStreamFinished);
     connect(reply, QOverload<QNetworkReply::NetworkError>::of(&QNetworkReply::errorOccurred),
             this, &CameraApiService::onNetworkError);
+    trackReply(reply, ApiEndpoint::Streams, "start_stream");
     
     LOG_INFO(QString("Starting stream on server: Stream Name: %1, RTSP: %2").arg(json["stream_name"].toString(), json["rtsp_url"].toString()), "CameraApiService");
+    return reply;
 }
 
 void CameraApiService::stopStream(const QString& streamName)
@@ -244,6 +415,14 @@ void CameraApiService::stopStream(const QString& streamName)
         return;
     }
     
+    if (!m_streamsBreaker.allowRequest(m_clock.elapsed())) {
+        QString error = QString("Stream service unavailable, next attempt in %1 s")
+                        .arg(qMax(qint64(0), m_streamsBreaker.retryAt() - m_clock.elapsed()) / 1000);
+        LOG_WARNING(QString("Not stopping stream %1: %2").arg(streamName, error), "CameraApiService");
+        emit streamStopped(streamName, false, error);
+        return;
+    }
+    
     // Use port 8001 for stream operations
     QUrl baseUrl(m_baseUrl);
     baseUrl.setPort(8001);
@@ -272,12 +451,13 @@ void CameraApiService::stopStream(const QString& streamName)
         } else {
             error = reply->errorString();
             LOG_ERROR(QString("Failed to stop stream on server: %1 - %2").arg(streamName, error), "CameraApiService");
-            showApiError("stop stream", error);
+            showApiError(reply, "stop stream", error);
         }
         
         reply->deleteLater();
         emit streamStopped(streamName, success, error);
     });
+    trackReply(reply, ApiEndpoint::Streams, "stop_stream");
 }
 
 void CameraApiService::onCreateCameraFinished()
@@ -339,6 +519,9 @@ void CameraApiService::onCreateCameraFinished()
             
             LOG_INFO(QString("Camera created successfully on server: %1 (Server Camera ID: %2, Stream Name: %3)")
                      .arg(cameraId).arg(serverCameraId).arg(streamName), "CameraApiService");
+            
+            // Operations queued for this camera while it had no server ID can go out now
+            assignServerCameraId(cameraId, serverCameraId);
                      
             emit cameraCreated(cameraId, serverCameraId, streamName, true, QString());
         } else {
@@ -349,7 +532,7 @@ void CameraApiService::onCreateCameraFinished()
         QString error = QString("Server returned status code: %1, Response: %2").arg(statusCode).arg(QString::fromUtf8(data));
         LOG_ERROR(QString("Failed to create camera on server: %1 - %2").arg(cameraId, error), "CameraApiService");
         emit cameraCreated(cameraId, QString(), QString(), false, error);
-        showApiError("create camera", error);
+        showApiError(reply, "create camera", error);
     }
 }
 
@@ -371,7 +554,7 @@ void CameraApiService::onUpdateCameraFinished()
         QString error = QString("Server returned status code: %1").arg(statusCode);
         LOG_ERROR(QString("Failed to update camera on server: %1 - %2").arg(cameraId, error), "CameraApiService");
         emit cameraUpdated(cameraId, false, error);
-        showApiError("update camera", error);
+        showApiError(reply, "update camera", error);
     }
 }
 
@@ -420,7 +603,7 @@ void CameraApiService::onStatusUpdateFinished()
         QString error = QString("Server returned status code: %1").arg(statusCode);
         LOG_ERROR(QString("Failed to update camera status on server: %1 - %2").arg(cameraId, error), "CameraApiService");
         emit cameraStatusUpdated(cameraId, false, error);
-        showApiError("update camera status", error);
+        showApiError(reply, "update camera status", error);
     }
 }
 
@@ -459,18 +642,8 @@ void CameraApiService::onNetworkError(QNetworkReply::NetworkError error)
     QString errorString = reply->errorString();
     reply->deleteLater();
     
-    // If this is a connectivity error, mark as offline and queue the operation
-    if (error == QNetworkReply::NetworkSessionFailedError || 
-        error == QNetworkReply::HostNotFoundError ||
-        error == QNetworkReply::ConnectionRefusedError) {
-        
-        if (m_isOnline) {
-            m_isOnline = false;
-            LOG_INFO("Network error detected, switching to offline mode", "CameraApiService");
-            emit networkStatusChanged(m_isOnline);
-        }
-    }
-    
+    // Going offline is up to the endpoint's circuit breaker, which sees this reply too
+    Q_UNUSED(error);
     LOG_ERROR(QString("Network error during %1 for camera %2: %3").arg(operation, cameraId, errorString), "CameraApiService");
     
     // Emit appropriate signals based on operation type
@@ -486,28 +659,66 @@ void CameraApiService::onNetworkError(QNetworkReply::NetworkError error)
         emit streamStarted(cameraId, false, errorString);
     }
     
-    showApiError(operation, errorString);
+    showApiError(reply, operation, errorString);
 }
 
 void CameraApiService::queueOperation(const SyncOperation& operation)
 {
-    m_syncQueue.enqueue(operation);
-    LOG_INFO(QString("Queued sync operation: %1 for camera %2 (Queue size: %3)")
+    auto pending = m_syncQueue.find(operation.localCameraId);
+    if (pending == m_syncQueue.end()) {
+        pending = m_syncQueue.insert(operation.localCameraId, QList<SyncOperation>());
+        m_syncCameraOrder.append(operation.localCameraId);
+    }
+    QList<SyncOperation>& operations = pending.value();
+    const QList<SyncOperation> before = operations;
+    SyncOperation journaled = operation;
+    journaled.journalId = m_nextJournalId++;
+    const int changed = coalesceOperation(operations, journaled);
+    m_syncQueueSize += operations.size() - before.size();
+    
+    // Journal what coalescing dropped, then the operation it added or changed
+    for (const SyncOperation& previous : before) {
+        const bool kept = std::any_of(operations.cbegin(), operations.cend(), [&previous](const SyncOperation& queued) {
+            return queued.journalId == previous.journalId;
+        });
+        if (!kept) {
+            m_journal->remove(previous.journalId);
+        }
+    }
+    if (changed >= 0) {
+        m_journal->put(operations.at(changed));
+    }
+    
+    LOG_INFO(QString("Queued sync operation: %1 for camera %2 (%3 pending for it, queue size: %4)")
              .arg(static_cast<int>(operation.type))
              .arg(operation.localCameraId)
-             .arg(m_syncQueue.size()), "CameraApiService");
+             .arg(pending.value().size())
+             .arg(m_syncQueueSize), "CameraApiService");
+    if (m_isSyncing) {
+        reportSyncProgress();
+    }
+}
+
+void CameraApiService::reportSyncProgress()
+{
+    emit syncProgress(m_syncCompleted, m_syncCompleted + m_syncInFlight.size() + m_syncQueueSize);
+}
+
+void CameraApiService::setSyncConcurrency(int count)
+{
+    m_syncConcurrency = qMax(1, count);
 }
 
 void CameraApiService::onSyncTimerTimeout()
 {
-    if (m_isOnline && !m_syncQueue.isEmpty() && !m_isSyncing) {
+    if (m_isOnline && m_syncQueueSize > 0 && !m_isSyncing) {
         processSyncQueue();
     }
 }
 
 void CameraApiService::processSyncQueue()
 {
-    if (m_syncQueue.isEmpty() || m_isSyncing) {
+    if (m_syncQueueSize == 0 || m_isSyncing) {
         return;
     }
     
@@ -518,139 +729,463 @@ void CameraApiService::processSyncQueue()
     }
     
     m_isSyncing = true;
-    LOG_INFO(QString("Processing sync queue with %1 operations").arg(m_syncQueue.size()), "CameraApiService");
+    m_syncCompleted = 0;
+    LOG_INFO(QString("Processing sync queue with %1 operations for %2 cameras, up to %3 at a time")
+             .arg(m_syncQueueSize).arg(m_syncQueue.size()).arg(m_syncConcurrency), "CameraApiService");
+    reportSyncProgress();
     
-    processNextSyncOperation();
+    dispatchSyncOperations();
 }
 
-void CameraApiService::processNextSyncOperation()
+void CameraApiService::dispatchSyncOperations()
 {
-    if (m_syncQueue.isEmpty()) {
+    if (!m_isSyncing) {
+        return;
+    }
+    
+    // A camera's operations go out one at a time and in queue order (create before
+    // update before status); operations for other cameras fill the remaining slots.
+    // Cameras whose operations have all gone out are dropped from the order here.
+    QString token = AuthDialog::getCurrentAuthToken();
+    const QStringList cameras = m_syncCameraOrder;
+    QStringList order;
+    for (const QString& localCameraId : cameras) {
+        auto pending = m_syncQueue.find(localCameraId);
+        if (pending == m_syncQueue.end()) {
+            continue;
+        }
+        if (pending.value().isEmpty()) {
+            m_syncQueue.erase(pending);
+            continue;
+        }
+        order.append(localCameraId);
+        
+        while (m_isOnline && !token.isEmpty() && m_syncInFlight.size() < m_syncConcurrency &&
+               !m_syncBusyCameras.contains(localCameraId)) {
+            pending = m_syncQueue.find(localCameraId);
+            if (pending == m_syncQueue.end() || pending.value().isEmpty()) {
+                break;
+            }
+            
+            // An operation the server failed on waits out its own backoff, and the
+            // camera's later operations wait behind it
+            const SyncOperation& next = pending.value().first();
+            if (next.retryAtMs > m_clock.elapsed()) {
+                scheduleSyncRetry(next.retryAtMs);
+                break;
+            }
+            // One that can never be sent is dropped before it could take a breaker's probe slot
+            if (!canSendSyncOperation(next)) {
+                m_journal->remove(next.journalId);
+                pending.value().removeFirst();
+                m_syncQueueSize--;
+                m_syncCompleted++;
+                reportSyncProgress();
+                continue;
+            }
+            // A stream start waits while the stream service's breaker is open
+            if (next.type == SyncOperationType::START_STREAM && !m_streamsBreaker.allowRequest(m_clock.elapsed())) {
+                scheduleEndpointRetry(ApiEndpoint::Streams);
+                break;
+            }
+            
+            SyncOperation operation = pending.value().takeFirst();
+            m_syncQueueSize--;
+            QNetworkReply* reply = sendSyncOperation(operation, token);
+            if (!reply) {
+                // No request carries the probe allowRequest() may have let through
+                if (operation.type == SyncOperationType::START_STREAM) {
+                    m_streamsBreaker.cancelProbe();
+                }
+                m_journal->remove(operation.journalId);
+                m_syncCompleted++;
+                reportSyncProgress();
+                continue;
+            }
+            
+            markBackgroundReply(reply);
+            m_syncInFlight.insert(reply, operation);
+            m_syncBusyCameras.insert(localCameraId);
+            connect(reply, &QNetworkReply::finished, this, [this, reply]() { onSyncOperationFinished(reply); });
+        }
+    }
+    
+    // Cameras queued while this ran were appended behind the ones walked here
+    order += m_syncCameraOrder.mid(cameras.size());
+    m_syncCameraOrder = order;
+    
+    if (m_syncInFlight.isEmpty()) {
         m_isSyncing = false;
+        reportSyncProgress();
         emit syncCompleted();
-        LOG_INFO("Sync queue processing completed", "CameraApiService");
-        return;
+        LOG_INFO(QString("Sync queue processing completed: %1 operations done, %2 left for the next pass")
+                 .arg(m_syncCompleted).arg(m_syncQueueSize), "CameraApiService");
+    }
+}
+
+void CameraApiService::onSyncOperationFinished(QNetworkReply* reply)
+{
+    // Runs after the operation's own finished handler, so a create has already
+    // handed its server ID to the operations queued behind it. An operation that
+    // never reached the server, or that the server failed or refused under load,
+    // goes back to the front of its camera's queue; only a success or a permanent
+    // rejection takes it out of the queue and the journal. A server error may be
+    // about this operation alone, so it also backs the operation off, and past
+    // MAX_SYNC_ATTEMPTS gives up on it.
+    SyncOperation operation = m_syncInFlight.take(reply);
+    m_syncBusyCameras.remove(operation.localCameraId);
+    bool requeue = isEndpointFailure(reply);
+    const int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (requeue && statusCode != 0) {
+        operation.attempts++;
+        if (operation.attempts >= MAX_SYNC_ATTEMPTS) {
+            LOG_ERROR(QString("Giving up on sync operation %1 for camera %2 after %3 server errors (last status %4)")
+                      .arg(static_cast<int>(operation.type)).arg(operation.localCameraId)
+                      .arg(operation.attempts).arg(statusCode), "CameraApiService");
+            requeue = false;
+        } else {
+            const qint64 delay = qMin(qint64(SYNC_RETRY_MAX_MS), qint64(SYNC_RETRY_BASE_MS) << qMin(operation.attempts - 1, 16));
+            operation.retryAtMs = m_clock.elapsed() + delay;
+            LOG_WARNING(QString("Sync operation %1 for camera %2 got status %3; retrying it in %4 ms")
+                        .arg(static_cast<int>(operation.type)).arg(operation.localCameraId)
+                        .arg(statusCode).arg(delay), "CameraApiService");
+        }
     }
     
-    SyncOperation operation = m_syncQueue.dequeue();
+    if (requeue) {
+        auto pending = m_syncQueue.find(operation.localCameraId);
+        if (pending == m_syncQueue.end()) {
+            pending = m_syncQueue.insert(operation.localCameraId, QList<SyncOperation>());
+            m_syncCameraOrder.append(operation.localCameraId);
+        }
+        pending.value().prepend(operation);
+        m_syncQueueSize++;
+    } else {
+        m_journal->remove(operation.journalId);
+        m_syncCompleted++;
+    }
+    reportSyncProgress();
     
+    dispatchSyncOperations();
+}
+
+void CameraApiService::scheduleSyncRetry(qint64 retryAtMs)
+{
+    const int delay = int(qMax(qint64(0), retryAtMs - m_clock.elapsed()));
+    if (!m_syncRetryTimer->isActive() || m_syncRetryTimer->remainingTime() > delay) {
+        m_syncRetryTimer->start(delay);
+    }
+}
+
+bool CameraApiService::canSendSyncOperation(const SyncOperation& operation) const
+{
+    switch (operation.type) {
+        case SyncOperationType::CREATE:
+            return true;
+        case SyncOperationType::UPDATE:
+            // A create queued ahead would have filled in the server ID before this went
+            // out; without one (its create finished or failed earlier, possibly in a
+            // previous run) nothing will
+            if (operation.camera.serverCameraId().isEmpty()) {
+                LOG_WARNING(QString("Cannot update camera - no server ID: %1").arg(operation.localCameraId), "CameraApiService");
+                return false;
+            }
+            return true;
+        case SyncOperationType::DELETE_CAMERA:
+            if (operation.serverCameraId.isEmpty()) {
+                LOG_WARNING(QString("Cannot delete camera - no server ID: %1").arg(operation.localCameraId), "CameraApiService");
+                return false;
+            }
+            return true;
+        case SyncOperationType::STATUS_UPDATE:
+            if (operation.serverCameraId.isEmpty()) {
+                LOG_WARNING(QString("Cannot update camera status - no server ID: %1").arg(operation.localCameraId), "CameraApiService");
+                return false;
+            }
+            return true;
+        case SyncOperationType::START_STREAM:
+            if (operation.camera.id().isEmpty()) {
+                LOG_WARNING("Cannot sync start stream - missing camera config", "CameraApiService");
+                return false;
+            }
+            return true;
+    }
+    return false;
+}
+
+QNetworkReply* CameraApiService::sendSyncOperation(const SyncOperation& operation, const QString& token)
+{
     LOG_INFO(QString("Processing sync operation: Type=%1, Camera=%2")
              .arg(static_cast<int>(operation.type))
              .arg(operation.localCameraId), "CameraApiService");
+    if (!canSendSyncOperation(operation)) {
+        return nullptr;
+    }
     
     // Process the operation based on type
     switch (operation.type) {
         case SyncOperationType::CREATE:
             LOG_INFO(QString("Syncing camera creation: %1").arg(operation.camera.name()), "CameraApiService");
-            createCamera(operation.camera);
-            break;
+            return sendCreateCamera(operation.camera, token);
         case SyncOperationType::UPDATE:
             LOG_INFO(QString("Syncing camera update: %1").arg(operation.camera.name()), "CameraApiService");
-            updateCamera(operation.camera);
-            break;
+            return sendUpdateCamera(operation.camera, token);
         case SyncOperationType::DELETE_CAMERA:
             LOG_INFO(QString("Syncing camera deletion: %1").arg(operation.localCameraId), "CameraApiService");
-            // For delete operations, we need the server ID from the stored camera
-            if (!operation.serverCameraId.isEmpty()) {
-                deleteCamera(operation.localCameraId, operation.serverCameraId);
-            } else {
-                LOG_WARNING(QString("Cannot delete camera - no server ID: %1").arg(operation.localCameraId), "CameraApiService");
-            }
-            break;
+            return sendDeleteCamera(operation.localCameraId, operation.serverCameraId, token);
         case SyncOperationType::STATUS_UPDATE:
             LOG_INFO(QString("Syncing camera status: %1 -> %2 (Server ID: %3)")
                      .arg(operation.localCameraId, operation.status).arg(operation.serverCameraId), "CameraApiService");
-            if (!operation.serverCameraId.isEmpty()) {
-                // Check if we have a full camera config for this operation
-                if (!operation.camera.id().isEmpty()) {
-                    // We have full camera data, use the full data update method
-                    bool isActive = (operation.status == "active");
-                    performCameraStatusUpdateWithFullData(operation.camera, isActive);
-                } else {
-                    // Fallback to status-only update
-                    performCameraStatusUpdate(operation.localCameraId, operation.serverCameraId, operation.status);
-                }
-            } else {
-                LOG_WARNING(QString("Cannot update camera status - no server ID: %1").arg(operation.localCameraId), "CameraApiService");
+            // Full camera data if the operation carries it, else a status-only update
+            if (!operation.camera.id().isEmpty()) {
+                return performCameraStatusUpdateWithFullData(operation.camera, operation.status == "active");
             }
-            break;
+            return performCameraStatusUpdate(operation.localCameraId, operation.serverCameraId, operation.status);
         case SyncOperationType::START_STREAM:
             LOG_INFO(QString("Syncing start stream: Stream Name %1").arg(operation.serverCameraId), "CameraApiService");
-            if (!operation.camera.id().isEmpty()) {
-                startStream(operation.camera);
-            } else {
-                LOG_WARNING("Cannot sync start stream - missing camera config", "CameraApiService");
-            }
-            break;
+            return sendStartStream(operation.camera, token);
+    }
+    return nullptr;
+}
+
+void CameraApiService::assignServerCameraId(const QString& localCameraId, const QString& serverCameraId)
+{
+    auto pending = m_syncQueue.find(localCameraId);
+    if (pending == m_syncQueue.end()) {
+        return;
+    }
+    for (SyncOperation& operation : pending.value()) {
+        bool changed = false;
+        if (operation.serverCameraId.isEmpty()) {
+            operation.serverCameraId = serverCameraId;
+            changed = true;
+        }
+        if (!operation.camera.id().isEmpty() && operation.camera.serverCameraId().isEmpty()) {
+            operation.camera.setServerCameraId(serverCameraId);
+            changed = true;
+        }
+        if (changed) {
+            m_journal->put(operation);
+        }
     }
-    
-    // Continue processing after a short delay to avoid overwhelming the server
-    QTimer::singleShot(2000, this, &CameraApiService::processNextSyncOperation);
 }
 
 void CameraApiService::checkNetworkConnectivity()
 {
     // Skip connectivity check if we don't have pending operations and we're considered online
-    if (m_syncQueue.isEmpty() && m_isOnline) {
+    if (m_syncQueueSize == 0 && m_isOnline) {
         LOG_DEBUG("Skipping connectivity check - no pending operations and currently online", "CameraApiService");
         return;
     }
     
-    // Check connectivity using a lightweight request
+    // While the breaker is open only its retry timer probes, and only one probe at a time
+    if (!m_camerasBreaker.allowRequest(m_clock.elapsed())) {
+        scheduleEndpointRetry(ApiEndpoint::Cameras);
+        return;
+    }
+    
+    LOG_DEBUG(QString("Performing connectivity check - Queue: %1 items, Current status: %2")
+              .arg(m_syncQueueSize)
+              .arg(m_isOnline ? "Online" : "Offline"), "CameraApiService");
+    
+    // Any HTTP response, 401 included, shows the server is reachable
+    QNetworkRequest request(QUrl(m_baseUrl + "/me/profile"));
     QString token = AuthDialog::getCurrentAuthToken();
-    if (token.isEmpty()) {
-        // If no token, assume online but can't sync
-        bool wasOnline = m_isOnline;
-        m_isOnline = true; // Consider online but unable to authenticate
+    if (!token.isEmpty()) {
+        request.setRawHeader("Authorization", QString("Bearer %1").arg(token).toUtf8());
+    }
+    request.setRawHeader("User-Agent", "CameraServer/1.0");
+    
+    QNetworkReply* reply = m_networkManager->get(request);
+    connect(reply, &QNetworkReply::finished, reply, &QObject::deleteLater);
+    trackReply(reply, ApiEndpoint::Cameras, "connectivity");
+}
+
+bool CameraApiService::isEndpointFailure(QNetworkReply* reply)
+{
+    // No response at all (transfer timeouts included), a server error, or the
+    // server shedding load
+    int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (statusCode == 0) {
+        return reply->error() != QNetworkReply::NoError;
+    }
+    return statusCode >= 500 || statusCode == 429;
+}
+
+void CameraApiService::trackReply(QNetworkReply* reply, ApiEndpoint endpoint, const QString& operation)
+{
+    // Phase marks as Qt reports them; called right after the request was issued
+    QSharedPointer<ApiRequestTiming> timing(new ApiRequestTiming);
+    QSharedPointer<QElapsedTimer> elapsed(new QElapsedTimer);
+    elapsed->start();
+#if QT_VERSION >= QT_VERSION_CHECK(6, 3, 0)
+    connect(reply, &QNetworkReply::socketStartedConnecting, this, [timing, elapsed]() {
+        if (timing->connectStartMs < 0) {
+            timing->connectStartMs = elapsed->elapsed();
+        }
+    });
+    connect(reply, &QNetworkReply::requestSent, this, [timing, elapsed]() {
+        timing->requestSentMs = elapsed->elapsed();
+    });
+#endif
+#if QT_CONFIG(ssl)
+    connect(reply, &QNetworkReply::encrypted, this, [timing, elapsed]() {
+        timing->encryptedMs = elapsed->elapsed();
+    });
+#endif
+    connect(reply, &QNetworkReply::metaDataChanged, this, [timing, elapsed]() {
+        if (timing->firstByteMs < 0) {
+            timing->firstByteMs = elapsed->elapsed();
+        }
+    });
+    
+    // Connected after the operation's own handlers, so they run before a state change
+    connect(reply, &QNetworkReply::finished, this, [this, reply, endpoint, operation, timing, elapsed]() {
+        timing->totalMs = elapsed->elapsed();
+        m_requestStats.record(operation, *timing, classifyReply(reply));
+        recordEndpointResult(endpoint, !isEndpointFailure(reply), operation == "connectivity");
+    });
+}
+
+ApiRequestStats::ErrorClass CameraApiService::classifyReply(QNetworkReply* reply)
+{
+    int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (statusCode >= 500) {
+        return ApiRequestStats::ServerError;
+    }
+    if (statusCode >= 400) {
+        return ApiRequestStats::ClientError;
+    }
+    if (statusCode > 0 || reply->error() == QNetworkReply::NoError) {
+        return ApiRequestStats::NoError;
+    }
+    // The transfer timeout aborts the reply, which reports it as canceled
+    return reply->error() == QNetworkReply::OperationCanceledError ? ApiRequestStats::Timeout
+                                                                   : ApiRequestStats::NetworkError;
+}
+
+CircuitBreaker& CameraApiService::breakerFor(ApiEndpoint endpoint)
+{
+    return endpoint == ApiEndpoint::Cameras ? m_camerasBreaker : m_streamsBreaker;
+}
+
+void CameraApiService::recordEndpointResult(ApiEndpoint endpoint, bool success, bool healthCheck)
+{
+    CircuitBreaker& breaker = breakerFor(endpoint);
+    QString name = endpoint == ApiEndpoint::Cameras ? "camera API" : "stream service";
+    
+    if (success) {
+        // A health check answering says nothing about the requests that were failing
+        if (!(healthCheck ? breaker.recordHealthCheckSuccess() : breaker.recordSuccess())) {
+            return;
+        }
+        LOG_INFO(QString("The %1 is reachable again").arg(name), "CameraApiService");
+        (endpoint == ApiEndpoint::Cameras ? m_camerasRetryTimer : m_streamsRetryTimer)->stop();
+        if (endpoint == ApiEndpoint::Cameras) {
+            setOnline(true);
+        }
         
-        if (wasOnline != m_isOnline) {
-            LOG_INFO("Network status: Online but no authentication token", "CameraApiService");
-            emit networkStatusChanged(m_isOnline);
+        // Drain what queued up during the outage right away
+        if (m_isSyncing) {
+            dispatchSyncOperations();
+        } else {
+            processSyncQueue();
         }
         return;
     }
     
-    // Only do a full connectivity check if we have queued operations or think we're offline
-    if (!m_syncQueue.isEmpty() || !m_isOnline) {
-        LOG_DEBUG(QString("Performing connectivity check - Queue: %1 items, Current status: %2")
-                  .arg(m_syncQueue.size())
-                  .arg(m_isOnline ? "Online" : "Offline"), "CameraApiService");
-        
-        QNetworkRequest request(QUrl(m_baseUrl + "/me/profile"));
-        request.setRawHeader("Authorization", QString("Bearer %1").arg(token).toUtf8());
-        request.setRawHeader("User-Agent", "CameraServer/1.0");
-        
-        QNetworkReply* reply = m_networkManager->get(request);
-        
-        connect(reply, &QNetworkReply::finished, [this, reply]() {
-            bool wasOnline = m_isOnline;
-            int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
-            
-            // Consider online if we get any HTTP response (200, 401, etc.)
-            // Only consider offline for network errors (no response at all)
-            m_isOnline = (reply->error() == QNetworkReply::NoError || 
-                         reply->error() == QNetworkReply::AuthenticationRequiredError ||
-                         statusCode > 0); // Any HTTP status code means server is reachable
-            
-            reply->deleteLater();
-            
-            if (wasOnline != m_isOnline) {
-                LOG_INFO(QString("Network status changed: %1 (HTTP Status: %2)")
-                         .arg(m_isOnline ? "Online" : "Offline")
-                         .arg(statusCode), "CameraApiService");
-                emit networkStatusChanged(m_isOnline);
-                
-                // If we just came online, try to process sync queue
-                if (m_isOnline && !m_syncQueue.isEmpty()) {
-                    LOG_INFO(QString("Coming online, scheduling sync queue processing (%1 items)")
-                             .arg(m_syncQueue.size()), "CameraApiService");
-                    QTimer::singleShot(3000, this, &CameraApiService::processSyncQueue);
-                }
-            }
+    if (!breaker.recordFailure(m_clock.elapsed())) {
+        return;
+    }
+    LOG_WARNING(QString("The %1 is failing (%2 errors in a row); next attempt in %3 ms")
+                .arg(name).arg(breaker.consecutiveFailures())
+                .arg(breaker.retryAt() - m_clock.elapsed()), "CameraApiService");
+    if (endpoint == ApiEndpoint::Cameras) {
+        setOnline(false);
+    }
+    scheduleEndpointRetry(endpoint);
+}
+
+void CameraApiService::scheduleEndpointRetry(ApiEndpoint endpoint)
+{
+    CircuitBreaker& breaker = breakerFor(endpoint);
+    QTimer* timer = endpoint == ApiEndpoint::Cameras ? m_camerasRetryTimer : m_streamsRetryTimer;
+    if (breaker.state() != CircuitBreaker::Open || timer->isActive()) {
+        return;
+    }
+    timer->start(int(qMax(qint64(0), breaker.retryAt() - m_clock.elapsed())));
+}
+
+void CameraApiService::onEndpointRetryTimeout(ApiEndpoint endpoint)
+{
+    if (endpoint == ApiEndpoint::Cameras) {
+        checkNetworkConnectivity();
+        return;
+    }
+    
+    // The stream service has no health check; a queued stream start is the probe
+    if (m_isSyncing) {
+        dispatchSyncOperations();
+    } else {
+        processSyncQueue();
+    }
+}
+
+void CameraApiService::setNetworkInterfaceManager(NetworkInterfaceManager* manager)
+{
+    if (m_interfaceManager) {
+        disconnect(m_interfaceManager, nullptr, this, nullptr);
+    }
+    
+    m_interfaceManager = manager;
+    
+    if (m_interfaceManager) {
+        connect(m_interfaceManager, &NetworkInterfaceManager::interfacesChanged, this, [this]() {
+            onConnectivityHint("network interfaces changed");
         });
+        connect(m_interfaceManager, &NetworkInterfaceManager::wireGuardInterfaceStateChanged, this, [this](bool active) {
+            onConnectivityHint(active ? "WireGuard interface up" : "WireGuard interface down");
+        });
+    }
+}
+
+void CameraApiService::onConnectivityHint(const QString& reason)
+{
+    m_connectivityHintReason = reason;
+    if (!m_connectivityHintTimer->isActive()) {
+        m_connectivityHintTimer->start();
+    }
+}
+
+void CameraApiService::checkConnectivityNow()
+{
+    // A changed network makes the backoff stale: open breakers may probe at once
+    LOG_INFO(QString("Checking API connectivity: %1").arg(m_connectivityHintReason), "CameraApiService");
+    const qint64 now = m_clock.elapsed();
+    m_camerasBreaker.retryNow(now);
+    m_streamsBreaker.retryNow(now);
+    m_camerasRetryTimer->stop();
+    m_streamsRetryTimer->stop();
+    
+    if (!m_isOnline) {
+        checkNetworkConnectivity();
+    } else if (m_streamsBreaker.state() == CircuitBreaker::Open) {
+        onEndpointRetryTimeout(ApiEndpoint::Streams);
+    } else if (m_syncQueueSize > 0 && !m_isSyncing) {
+        processSyncQueue();
     }
 }
 
+void CameraApiService::setOnline(bool online)
+{
+    if (m_isOnline == online) {
+        return;
+    }
+    m_isOnline = online;
+    LOG_INFO(QString("Network status changed: %1").arg(m_isOnline ? "Online" : "Offline"), "CameraApiService");
+    emit networkStatusChanged(m_isOnline);
+}
+
 QJsonObject CameraApiService::cameraToApiJson(const CameraConfig& camera) const
 {
     QJsonObject json;
@@ -787,21 +1322,32 @@ QString CameraApiService::constructRtspUrlWithExternalEndpoint(const CameraConfi
 }
 
 
-void CameraApiService::showApiError(const QString& operation, const QString& error)
+void CameraApiService::showApiError(QNetworkReply* reply, const QString& operation, const QString& error)
 {
+    // Background requests can fail several at a time, and a modal dialog would run
+    // their finished handlers re-entrantly; the callers have logged the failure
+    if (m_backgroundReplies.contains(reply)) {
+        return;
+    }
     QMessageBox::warning(nullptr, 
                         "Visco Connect - API Error",
                         QString("Failed to %1:\n\n%2\n\nThe operation has been queued for retry when connection is restored.")
                         .arg(operation, error));
 }
 
-void CameraApiService::performCameraStatusUpdate(const QString& localCameraId, const QString& serverCameraId, const QString& status)
+void CameraApiService::markBackgroundReply(QNetworkReply* reply)
+{
+    m_backgroundReplies.insert(reply);
+    connect(reply, &QObject::destroyed, this, [this, reply]() { m_backgroundReplies.remove(reply); });
+}
+
+QNetworkReply* CameraApiService::performCameraStatusUpdate(const QString& localCameraId, const QString& serverCameraId, const QString& status)
 {
     QString token = AuthDialog::getCurrentAuthToken();
     if (token.isEmpty()) {
         LOG_ERROR("Cannot perform status update - no authentication token", "CameraApiService");
         emit cameraStatusUpdated(localCameraId, false, "No authentication token");
-        return;
+        return nullptr;
     }
     
     QNetworkRequest request(QUrl(QString("%1/cameras/%2").arg(m_baseUrl).arg(serverCameraId)));
@@ -820,9 +1366,11 @@ void CameraApiService::performCameraStatusUpdate(const QString& localCameraId, c
     connect(reply, &QNetworkReply::finished, this, &CameraApiService::onStatusUpdateFinished);
     connect(reply, QOverload<QNetworkReply::NetworkError>::of(&QNetworkReply::errorOccurred),
             this, &CameraApiService::onNetworkError);
+    trackReply(reply, ApiEndpoint::Cameras, "status");
     
     LOG_INFO(QString("Performing camera status update on server: %1 -> %2 (Server Camera ID: %3)")
              .arg(localCameraId, status).arg(serverCameraId), "CameraApiService");
+    return reply;
 }
 
 void CameraApiService::updateCameraStatusWithFullData(const CameraConfig& camera, bool isActive)
@@ -842,20 +1390,22 @@ void CameraApiService::updateCameraStatusWithFullData(const CameraConfig& camera
         cameraCopy.setEnabled(isActive);
         queueOperation(SyncOperation(SyncOperationType::UPDATE, camera.id(), cameraCopy));
         LOG_INFO(QString("Queued camera full data status update (offline): %1").arg(camera.name()), "CameraApiService");
-        QTimer::singleShot(1000, this, &CameraApiService::checkNetworkConnectivity);
+        scheduleEndpointRetry(ApiEndpoint::Cameras);
         return;
     }
     
-    performCameraStatusUpdateWithFullData(camera, isActive);
+    CameraConfig updatedCamera = camera;
+    updatedCamera.setEnabled(isActive);
+    queueBatchUpdate(updatedCamera, true);
 }
 
-void CameraApiService::performCameraStatusUpdateWithFullData(const CameraConfig& camera, bool isActive)
+QNetworkReply* CameraApiService::performCameraStatusUpdateWithFullData(const CameraConfig& camera, bool isActive)
 {
     QString token = AuthDialog::getCurrentAuthToken();
     if (token.isEmpty()) {
         LOG_ERROR("Cannot perform full data status update - no authentication token", "CameraApiService");
         emit cameraStatusUpdated(camera.id(), false, "No authentication token");
-        return;
+        return nullptr;
     }
     
     QNetworkRequest request(QUrl(QString("%1/cameras/%2").arg(m_baseUrl).arg(camera.serverCameraId())));
@@ -878,9 +1428,185 @@ void CameraApiService::performCameraStatusUpdateWithFullData(const CameraConfig&
     connect(reply, &QNetworkReply::finished, this, &CameraApiService::onStatusUpdateFinished);
     connect(reply, QOverload<QNetworkReply::NetworkError>::of(&QNetworkReply::errorOccurred),
             this, &CameraApiService::onNetworkError);
+    trackReply(reply, ApiEndpoint::Cameras, "status");
     
     LOG_INFO(QString("Performing camera full data status update on server: %1 -> %2 (Server Camera ID: %3)")
              .arg(camera.name()).arg(isActive ? "active" : "inactive").arg(camera.serverCameraId()), "CameraApiService");
+    return reply;
+}
+
+void CameraApiService::queueBatchUpdate(const CameraConfig& camera, bool statusOnly)
+{
+    // A camera already waiting is sent once, with the newer data
+    for (BatchUpdate& update : m_batchUpdates) {
+        if (update.camera.id() == camera.id()) {
+            update.camera = camera;
+            update.statusOnly = update.statusOnly && statusOnly;
+            return;
+        }
+    }
+    
+    m_batchUpdates.append(BatchUpdate{camera, statusOnly});
+    if (m_batchUpdates.size() >= BATCH_SIZE) {
+        flushBatchUpdates();
+    } else if (!m_batchTimer->isActive()) {
+        m_batchTimer->start();
+    }
+}
+
+void CameraApiService::flushBatchUpdates()
+{
+    m_batchTimer->stop();
+    QList<BatchUpdate> updates;
+    updates.swap(m_batchUpdates);
+    if (updates.isEmpty()) {
+        return;
+    }
+    
+    QString token = AuthDialog::getCurrentAuthToken();
+    if (token.isEmpty() || !m_isOnline) {
+        for (const BatchUpdate& update : updates) {
+            queueOperation(SyncOperation(SyncOperationType::UPDATE, update.camera.id(), update.camera));
+        }
+        LOG_INFO(QString("Queued %1 batched camera updates (offline or no token)").arg(updates.size()), "CameraApiService");
+        return;
+    }
+    
+    for (int start = 0; start < updates.size(); start += BATCH_SIZE) {
+        const QList<BatchUpdate> chunk = updates.mid(start, BATCH_SIZE);
+        if (chunk.size() == 1 || !m_batchEndpointAvailable) {
+            for (const BatchUpdate& update : chunk) {
+                QNetworkReply* reply = sendUpdateIndividually(update, token);
+                if (reply && chunk.size() > 1) {
+                    markBackgroundReply(reply);
+                }
+            }
+        } else {
+            sendBatchUpdate(chunk, token);
+        }
+    }
+}
+
+QNetworkReply* CameraApiService::sendBatchUpdate(const QList<BatchUpdate>& updates, const QString& token)
+{
+    QNetworkRequest request(QUrl(m_baseUrl + "/cameras/batch"));
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    request.setRawHeader("Authorization", QString("Bearer %1").arg(token).toUtf8());
+    
+    QJsonArray items;
+    for (const BatchUpdate& update : updates) {
+        QJsonObject item;
+        item["camera_id"] = update.camera.serverCameraId();
+        item["data"] = cameraToApiJson(update.camera);
+        items.append(item);
+    }
+    QJsonObject body;
+    body["updates"] = items;
+    
+    QNetworkReply* reply = m_networkManager->post(request, QJsonDocument(body).toJson(QJsonDocument::Compact));
+    m_batchInFlight.insert(reply, updates);
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() { onBatchUpdateFinished(reply); });
+    trackReply(reply, ApiEndpoint::Cameras, "batch_update");
+    
+    LOG_INFO(QString("Updating %1 cameras on server in one batch").arg(updates.size()), "CameraApiService");
+    return reply;
+}
+
+void CameraApiService::onBatchUpdateFinished(QNetworkReply* reply)
+{
+    const QList<BatchUpdate> updates = m_batchInFlight.take(reply);
+    int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    const bool endpointFailure = isEndpointFailure(reply);
+    QString errorString = reply->errorString();
+    QByteArray data = reply->readAll();
+    reply->deleteLater();
+    
+    if (statusCode == 404 || statusCode == 405 || statusCode == 501) {
+        // A server without the batch endpoint gets one request per camera from now on
+        LOG_INFO(QString("Server has no batch endpoint (status code %1); sending camera updates one at a time")
+                 .arg(statusCode), "CameraApiService");
+        m_batchEndpointAvailable = false;
+        QString token = AuthDialog::getCurrentAuthToken();
+        for (const BatchUpdate& update : updates) {
+            if (QNetworkReply* individual = sendUpdateIndividually(update, token)) {
+                markBackgroundReply(individual);
+            }
+        }
+        return;
+    }
+    
+    if (statusCode != 200 && statusCode != 207) {
+        QString error = statusCode == 0 ? errorString : QString("Server returned status code: %1").arg(statusCode);
+        if (endpointFailure) {
+            // Never reached the server, or it failed or shed load: the updates wait
+            // in the sync queue instead
+            for (const BatchUpdate& update : updates) {
+                queueOperation(SyncOperation(SyncOperationType::UPDATE, update.camera.id(), update.camera));
+            }
+        }
+        LOG_ERROR(QString("Batch update of %1 cameras failed: %2").arg(updates.size()).arg(error), "CameraApiService");
+        for (const BatchUpdate& update : updates) {
+            reportBatchUpdate(update, false, error);
+        }
+        return;
+    }
+    
+    // One result per camera, matched on its server ID
+    QHash<QString, int> statusByServerId;
+    QHash<QString, QString> errorByServerId;
+    const QJsonArray results = QJsonDocument::fromJson(data).object().value("results").toArray();
+    for (const QJsonValue& value : results) {
+        const QJsonObject result = value.toObject();
+        QJsonValue cameraIdValue = result.value("camera_id");
+        QString serverCameraId = cameraIdValue.isDouble() ? QString::number(cameraIdValue.toInt()) : cameraIdValue.toString();
+        statusByServerId.insert(serverCameraId, result.value("status").toInt());
+        errorByServerId.insert(serverCameraId, result.value("error").toString());
+    }
+    
+    int failed = 0;
+    for (const BatchUpdate& update : updates) {
+        const QString serverCameraId = update.camera.serverCameraId();
+        if (!statusByServerId.contains(serverCameraId)) {
+            reportBatchUpdate(update, false, "No result for this camera in the batch response");
+            failed++;
+            continue;
+        }
+        int itemStatus = statusByServerId.value(serverCameraId);
+        // As with single status updates, a camera the server no longer has is not an error
+        if (itemStatus == 200 || itemStatus == 204 || (itemStatus == 404 && update.statusOnly)) {
+            reportBatchUpdate(update, true, QString());
+        } else {
+            QString error = errorByServerId.value(serverCameraId);
+            if (error.isEmpty()) {
+                error = QString("Server returned status code: %1").arg(itemStatus);
+            }
+            reportBatchUpdate(update, false, error);
+            failed++;
+        }
+    }
+    
+    LOG_INFO(QString("Batch update finished: %1 of %2 cameras updated").arg(updates.size() - failed).arg(updates.size()),
+             "CameraApiService");
+}
+
+QNetworkReply* CameraApiService::sendUpdateIndividually(const BatchUpdate& update, const QString& token)
+{
+    if (update.statusOnly) {
+        return performCameraStatusUpdateWithFullData(update.camera, update.camera.isEnabled());
+    }
+    return sendUpdateCamera(update.camera, token);
+}
+
+void CameraApiService::reportBatchUpdate(const BatchUpdate& update, bool success, const QString& error)
+{
+    if (!success) {
+        LOG_ERROR(QString("Failed to update camera on server: %1 - %2").arg(update.camera.id(), error), "CameraApiService");
+    }
+    if (update.statusOnly) {
+        emit cameraStatusUpdated(update.camera.id(), success, error);
+    } else {
+        emit cameraUpdated(update.camera.id(), success, error);
+    }
 }
 
 void CameraApiService::onConfigChanged()
@@ -889,6 +1615,11 @@ void CameraApiService::onConfigChanged()
     if (m_baseUrl != newBaseUrl) {
         LOG_INFO(QString("API base URL updated from %1 to %2").arg(m_baseUrl, newBaseUrl), "CameraApiService");
         m_baseUrl = newBaseUrl;
+        m_batchEndpointAvailable = true;
+        m_camerasBreaker.reset();
+        m_streamsBreaker.reset();
+        m_camerasRetryTimer->stop();
+        m_streamsRetryTimer->stop();
         
         // Trigger a connectivity check with the new URL
         QTimer::singleShot(1000, this, &CameraApiService::checkNetworkConnectivity);
@@ -10,6 +10,7 @@ CameraConfig::CameraConfig()
     , m_brand("Generic")
     , m_serverId(-1)
     , m_serverCameraId("")
+    , m_adaptiveSubstream(false)
 {
     m_id = QUuid::createUuid().toString(QUuid::WithoutBraces);
 }
@@ -26,6 +27,7 @@ CameraConfig::CameraConfig(const QString& name, const QString& ipAddress, int po
     , m_brand("Generic")
     , m_serverId(-1)
     , m_serverCameraId("")
+    , m_adaptiveSubstream(false)
 {
     m_id = QUuid::createUuid().toString(QUuid::WithoutBraces);
 }
@@ -46,6 +48,7 @@ QJsonObject CameraConfig::toJson() const
     json["serverId"] = m_serverId;
     json["serverCameraId"] = m_serverCameraId;
     json["streamName"] = m_streamName;
+    json["adaptiveSubstream"] = m_adaptiveSubstream;
     return json;
 }
 
@@ -64,6 +67,7 @@ void CameraConfig::fromJson(const QJsonObject& json)
     m_serverId = json["serverId"].toInt(-1);
     m_serverCameraId = json["serverCameraId"].toString("");
     m_streamName = json["streamName"].toString("");
+    m_adaptiveSubstream = json["adaptiveSubstream"].toBool(false);
     
     // Generate ID if not present (for backward compatibility)
     if (m_id.isEmpty()) {
@@ -1,5 +1,9 @@
 #include "CameraDiscovery.h"
 #include "Logger.h"
+#include "RtspProtocol.h"
+#include "OuiTable.h"
+#include "DeviceSignatures.h"
+#include "DiscoveryCache.h"
 #include <QNetworkInterface>
 #include <QHostInfo>
 #include <QProcess>
@@ -10,17 +14,31 @@
 #include <QEventLoop>
 #include <QApplication>
 #include <QThread>
-#include <QThreadPool>
-#include <QRunnable>
-#include <QAtomicInteger>
 #include <QMutex>
 #include <QMutexLocker>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QDateTime>
+#include <QUrl>
+#include <climits>
+#include <algorithm>
 
 // NetworkScanner Implementation
 NetworkScanner::NetworkScanner(const QString& networkRange, QObject *parent)
     : QThread(parent)
     , m_networkRange(networkRange)
+    , m_maxConcurrentProbes(DEFAULT_MAX_CONCURRENT_PROBES)
+    , m_probeTimeout(DEFAULT_PROBE_TIMEOUT_MS)
     , m_shouldStop(false)
+    , m_phase(0)
+    , m_seed(0)
+    , m_total(0)
+    , m_nextSeed(0)
+    , m_seedsInFlight(0)
+    , m_nextProbeId(0)
+    , m_completed(0)
+    , m_launching(false)
+    , m_loop(nullptr)
 {
     // Default camera ports - prioritized order (most common first)
     m_ports = {80, 554, 8080, 8081, 443, 8000, 8443, 88, 8088};
@@ -32,129 +50,321 @@ void NetworkScanner::setPortRange(const QList<int>& ports)
     m_ports = ports;
 }
 
+void NetworkScanner::setMaxConcurrentProbes(int count)
+{
+    QMutexLocker locker(&m_mutex);
+    m_maxConcurrentProbes = qMax(1, count);
+}
+
+void NetworkScanner::setProbeTimeout(int milliseconds)
+{
+    QMutexLocker locker(&m_mutex);
+    m_probeTimeout = qMax(1, milliseconds);
+}
+
+void NetworkScanner::setResumeCursor(const ScanCursor& cursor)
+{
+    QMutexLocker locker(&m_mutex);
+    m_resumeFrom = cursor;
+}
+
+void NetworkScanner::setPriorityHosts(const QList<quint32>& addresses)
+{
+    QMutexLocker locker(&m_mutex);
+    m_priorityHosts = addresses;
+}
+
+void NetworkScanner::skipHost(quint32 address)
+{
+    QMutexLocker locker(&m_mutex);
+    m_pendingSkips.insert(address);
+}
+
+ScanCursor NetworkScanner::resumeCursor() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_stoppedAt;
+}
+
 void NetworkScanner::stop()
 {
     QMutexLocker locker(&m_mutex);
     m_shouldStop = true;
 }
 
+bool NetworkScanner::isStopping()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_shouldStop;
+}
+
 void NetworkScanner::run()
 {
-    QRegularExpression ipRegex(R"((\d+)\.(\d+)\.(\d+)\.(\d+)(?:/(\d+))?)");
-    QRegularExpressionMatch match = ipRegex.match(m_networkRange);
-    
-    if (!match.hasMatch()) {
+    QString error;
+    if (!m_space.parse(m_networkRange, &error)) {
+        LOG_ERROR(QString("Cannot scan '%1': %2").arg(m_networkRange, error), "CameraDiscovery");
         emit scanFinished();
         return;
     }
-
-    QString baseIp = QString("%1.%2.%3").arg(match.captured(1), match.captured(2), match.captured(3));
-    int subnetMask = match.captured(5).isEmpty() ? 24 : match.captured(5).toInt();
     
-    int hostCount = (1 << (32 - subnetMask)) - 2; // Exclude network and broadcast
-    int startHost = 1;
-    int endHost = qMin(254, hostCount);
+    // Priority ports (80, 554) for every host go first; a host that answers
+    // on one of them is not probed on the remaining ports
+    ScanCursor resume;
+    QList<int> ports;
+    QList<quint32> priorityHosts;
+    {
+        QMutexLocker locker(&m_mutex);
+        ports = m_ports;
+        priorityHosts = m_priorityHosts;
+        if (m_resumeFrom.networkRange == m_networkRange && m_resumeFrom.ports == m_ports) {
+            resume = m_resumeFrom;
+        }
+        m_stoppedAt = ScanCursor();
+    }
+    m_phasePorts[0].clear();
+    m_phasePorts[1].clear();
+    for (int port : ports) {
+        m_phasePorts[port == 80 || port == 554 ? 0 : 1].append(port);
+    }
     
-    int totalOperations = (endHost - startHost + 1) * m_ports.size();
-    int currentOperation = 0;
+    m_total = int(qMin<quint64>(m_space.hostCount() * (m_phasePorts[0].size() + m_phasePorts[1].size()), INT_MAX));
+    m_inFlight.clear();
+    m_deadlines.clear();
+    m_hostsFound.clear();
+    m_skipHosts.clear();
+    m_rtt.clear();
+    m_clock.start();
     
-    // Use QThreadPool for parallel scanning
-    QThreadPool *pool = QThreadPool::globalInstance();
-    pool->setMaxThreadCount(qMin(50, QThread::idealThreadCount() * 4)); // Increase thread count
+    // Hosts known to be alive are probed first; the sweep then leaves out their priority ports
+    m_seedTargets.clear();
+    m_seededHosts.clear();
+    m_nextSeed = 0;
+    m_seedsInFlight = 0;
+    if (resume.isValid() && !resume.seededHosts.isEmpty()) {
+        for (quint32 address : resume.seededHosts) {
+            m_seededHosts.insert(address);
+        }
+    } else if (!resume.isValid() || resume.phase == 0) {
+        for (quint32 address : priorityHosts) {
+            if (!m_space.contains(address) || m_seededHosts.contains(address)) {
+                continue;
+            }
+            m_seededHosts.insert(address);
+            for (int port : m_phasePorts[0]) {
+                m_seedTargets.append(qMakePair(address, port));
+            }
+        }
+    }
     
-    QAtomicInteger<int> completedOperations(0);
-    QMutex progressMutex;
+    if (resume.isValid()) {
+        m_seed = resume.seed;
+        m_completed = resume.completed;
+        for (quint32 address : resume.answeredHosts) {
+            m_hostsFound.insert(address);
+        }
+        startPhase(resume.phase, resume.position);
+        LOG_INFO(QString("Resuming scan of %1 at %2/%3 probes").arg(m_networkRange).arg(m_completed).arg(m_total), 
+                 "CameraDiscovery");
+    } else {
+        m_seed = QRandomGenerator::global()->generate64();
+        m_completed = 0;
+        startPhase(0, 0);
+        LOG_INFO(QString("Scanning %1 hosts (%2)").arg(m_space.hostCount()).arg(m_space.description()), 
+                 "CameraDiscovery");
+    }
+    if (!m_seedTargets.isEmpty()) {
+        LOG_INFO(QString("Probing %1 known live hosts first").arg(m_seededHosts.size()), "CameraDiscovery");
+    }
     
-    // Collect results to emit later
-    QMutex resultsMutex;
-    QList<QPair<QString, int>> foundDevices;
+    QEventLoop loop;
+    m_loop = &loop;
     
-    for (int host = startHost; host <= endHost && !m_shouldStop; ++host) {
-        QString ipAddress = QString("%1.%2").arg(baseIp).arg(host);
-        
-        // Create a single task per IP that scans all ports with early termination
-        QRunnable* task = QRunnable::create([this, ipAddress, &completedOperations, &progressMutex, &resultsMutex, &foundDevices, totalOperations]() {
-            bool deviceFound = false;
-            
-            // Scan priority ports first (80, 554) with shorter timeout
-            QList<int> priorityPorts = {80, 554};
-            QList<int> remainingPorts = m_ports;
-            
-            // Remove priority ports from remaining list
-            for (int priority : priorityPorts) {
-                remainingPorts.removeAll(priority);
+    // One timer sweeps all probe deadlines instead of a timer per socket
+    QTimer deadlineTimer;
+    deadlineTimer.setInterval(DEADLINE_CHECK_INTERVAL_MS);
+    connect(&deadlineTimer, &QTimer::timeout, [this]() { expireProbes(); });
+    deadlineTimer.start();
+    
+    launchProbes();
+    if (!m_inFlight.isEmpty()) {
+        loop.exec();
+    }
+    deadlineTimer.stop();
+    
+    // Stopped early: resume from the oldest probe that has not finished
+    if (isStopping()) {
+        ScanCursor cursor;
+        cursor.networkRange = m_networkRange;
+        cursor.ports = ports;
+        cursor.seed = m_seed;
+        cursor.phase = m_phase;
+        cursor.position = m_order.position();
+        for (const Probe& probe : m_inFlight) {
+            if (!probe.seed) {
+                cursor.position = qMin(cursor.position, probe.position - 1);
             }
-            
-            // Scan priority ports first
-            for (int port : priorityPorts) {
-                if (m_shouldStop || deviceFound) break;
-                
-                QTcpSocket socket;
-                socket.connectToHost(ipAddress, port);
-                
-                if (socket.waitForConnected(200)) { // Reduced timeout to 200ms
-                    {
-                        QMutexLocker locker(&resultsMutex);
-                        foundDevices.append(qMakePair(ipAddress, port));
-                    }
-                    socket.disconnectFromHost();
-                    deviceFound = true; // Found on priority port, skip remaining
-                    break;
-                }
-                
-                int completed = completedOperations.fetchAndAddAcquire(1) + 1;
-                if (completed % 25 == 0) { // Update progress less frequently
-                    QMutexLocker locker(&progressMutex);
-                    QMetaObject::invokeMethod(this, "scanProgress", Qt::QueuedConnection,
-                                            Q_ARG(int, completed), Q_ARG(int, totalOperations));
+        }
+        cursor.completed = qMax(0, m_completed - m_inFlight.size());
+        cursor.answeredHosts = m_hostsFound.values();
+        if (m_nextSeed >= m_seedTargets.size() && m_seedsInFlight == 0) {
+            cursor.seededHosts = m_seededHosts.values();
+        }
+        
+        QMutexLocker locker(&m_mutex);
+        m_stoppedAt = cursor;
+    }
+    
+    for (const Probe& probe : m_inFlight) {
+        probe.socket->abort();
+        delete probe.socket;
+    }
+    m_inFlight.clear();
+    m_deadlines.clear();
+    m_loop = nullptr;
+    
+    LOG_INFO(QString("Network scan of %1 %2 after %3 ms (%4 probes, %5 hosts answered; timeouts: %6)")
+             .arg(m_networkRange).arg(isStopping() ? "stopped" : "finished").arg(m_clock.elapsed())
+             .arg(m_completed).arg(m_hostsFound.size()).arg(m_rtt.summary()), "CameraDiscovery");
+    
+    emit scanProgress(isStopping() ? m_completed : m_total, m_total);
+    emit scanFinished();
+}
+
+void NetworkScanner::startPhase(int phase, quint64 position)
+{
+    m_phase = phase;
+    
+    // Each phase gets its own permutation so port order differs between them
+    m_order = ScanOrder(m_space.hostCount() * m_phasePorts[phase].size(), m_seed + phase * 0x9E3779B97F4A7C15ULL);
+    m_order.seek(position);
+}
+
+void NetworkScanner::launchProbes()
+{
+    // A probe failing synchronously inside connectToHost() calls back in here
+    if (m_launching) {
+        return;
+    }
+    m_launching = true;
+    
+    const bool stopping = isStopping();
+    int maxProbes;
+    {
+        QMutexLocker locker(&m_mutex);
+        maxProbes = m_maxConcurrentProbes;
+        m_rtt.setFallbackTimeout(m_probeTimeout);
+        if (!m_pendingSkips.isEmpty()) {
+            m_skipHosts.unite(m_pendingSkips);
+            m_pendingSkips.clear();
+        }
+    }
+    
+    while (!stopping && m_inFlight.size() < maxProbes) {
+        quint32 address;
+        int port;
+        const bool seed = m_nextSeed < m_seedTargets.size();
+        
+        if (seed) {
+            address = m_seedTargets.at(m_nextSeed).first;
+            port = m_seedTargets.at(m_nextSeed).second;
+            m_nextSeed++;
+        } else {
+            quint64 index;
+            if (!m_order.next(index)) {
+                // The remaining-ports phase needs every priority answer first
+                if (m_phase == 0 && m_inFlight.isEmpty()) {
+                    startPhase(1, 0);
+                    continue;
                 }
+                break;
             }
             
-            // Only scan remaining ports if not found on priority ports
-            if (!deviceFound && !m_shouldStop) {
-                for (int port : remainingPorts) {
-                    if (m_shouldStop) break;
-                    
-                    QTcpSocket socket;
-                    socket.connectToHost(ipAddress, port);
-                    
-                    if (socket.waitForConnected(200)) { // Reduced timeout
-                        {
-                            QMutexLocker locker(&resultsMutex);
-                            foundDevices.append(qMakePair(ipAddress, port));
-                        }
-                        socket.disconnectFromHost();
-                        deviceFound = true;
-                    }
-                    
-                    int completed = completedOperations.fetchAndAddAcquire(1) + 1;
-                    if (completed % 25 == 0) {
-                        QMutexLocker locker(&progressMutex);
-                        QMetaObject::invokeMethod(this, "scanProgress", Qt::QueuedConnection,
-                                                Q_ARG(int, completed), Q_ARG(int, totalOperations));
-                    }
-                }
-            } else {
-                // If found on priority port, still increment counter for remaining ports
-                completedOperations.fetchAndAddAcquire(remainingPorts.size());
+            const QList<int>& ports = m_phasePorts[m_phase];
+            address = m_space.hostAt(index / ports.size());
+            port = ports.at(int(index % ports.size()));
+            
+            // Probed (and counted) ahead of the sweep
+            if (m_phase == 0 && m_seededHosts.contains(address)) {
+                continue;
             }
-        });
+        }
+        
+        // Already answered on a priority port, or identified without the sweep
+        if ((m_phase == 1 && m_hostsFound.contains(address)) || m_skipHosts.contains(address)) {
+            m_completed++;
+            continue;
+        }
         
-        pool->start(task);
+        const quint64 probeId = m_nextProbeId++;
+        QTcpSocket* socket = new QTcpSocket;
+        m_inFlight.insert(probeId, Probe{socket, address, port, m_order.position(), seed, m_clock.elapsed()});
+        if (seed) {
+            m_seedsInFlight++;
+        }
+        m_deadlines.insert(m_clock.elapsed() + m_rtt.timeoutFor(address), probeId);
+        
+        // A refused connect (RST) is as good a round trip sample as an accepted one
+        connect(socket, &QTcpSocket::connected, socket, [this, probeId]() { finishProbe(probeId, true); });
+        connect(socket, &QAbstractSocket::errorOccurred, socket, [this, probeId, socket]() {
+            finishProbe(probeId, false, socket->error() == QAbstractSocket::ConnectionRefusedError);
+        });
+        socket->connectToHost(QHostAddress(address), port);
+    }
+    m_launching = false;
+    
+    if (m_loop && (m_inFlight.isEmpty() || stopping)) {
+        m_loop->quit();
+    }
+}
+
+void NetworkScanner::finishProbe(quint64 probeId, bool open, bool refused)
+{
+    auto it = m_inFlight.find(probeId);
+    if (it == m_inFlight.end()) {
+        return;
     }
     
-    // Wait for all tasks to complete
-    pool->waitForDone();
+    Probe probe = it.value();
+    m_inFlight.erase(it);
+    if (probe.seed) {
+        m_seedsInFlight--;
+    }
     
-    // Emit all found devices
-    for (const auto& device : foundDevices) {
-        if (!m_shouldStop) {
-            emit deviceFound(device.first, device.second);
-        }
+    // Called from the socket's own signal; it must not be deleted synchronously
+    probe.socket->disconnect();
+    probe.socket->abort();
+    probe.socket->deleteLater();
+    
+    const int roundTrip = int(m_clock.elapsed() - probe.launchedAt);
+    if (open || refused) {
+        m_rtt.addSample(probe.address, roundTrip);
     }
     
-    emit scanProgress(totalOperations, totalOperations);
-    emit scanFinished();
+    if (open && !isStopping()) {
+        m_hostsFound.insert(probe.address);
+        emit deviceFound(QHostAddress(probe.address).toString(), probe.port, roundTrip);
+    }
+    
+    if (++m_completed % PROGRESS_INTERVAL == 0) {
+        emit scanProgress(qMin(m_completed, m_total), m_total);
+    }
+    
+    launchProbes();
+}
+
+void NetworkScanner::expireProbes()
+{
+    const qint64 now = m_clock.elapsed();
+    while (!m_deadlines.isEmpty() && m_deadlines.firstKey() <= now) {
+        const quint64 probeId = m_deadlines.first();
+        m_deadlines.erase(m_deadlines.begin());
+        finishProbe(probeId, false);
+    }
+    
+    // Make sure a stop request ends the loop even while nothing completes
+    if (isStopping() && m_loop) {
+        m_loop->quit();
+    }
 }
 
 // CameraDiscovery Implementation
@@ -162,15 +372,42 @@ CameraDiscovery::CameraDiscovery(QObject *parent)
     : QObject(parent)
     , m_networkManager(nullptr)
     , m_scanner(nullptr)
+    , m_onvif(nullptr)
+    , m_ssdp(nullptr)
+    , m_mdns(nullptr)
+    , m_rtspProber(nullptr)
     , m_timeout(2000) // Reduced from 5000ms to 2000ms
     , m_maxConcurrentRequests(50) // Increased from 10 to 50
     , m_currentRequests(0)
+    , m_scanConcurrency(1024)
+    , m_probeTimeout(300)
+    , m_skipUnresolvedNeighbors(false)
+    , m_cache(new DiscoveryCache)
+    , m_useCache(true)
     , m_isDiscovering(false)
     , m_totalHosts(0)
     , m_scannedHosts(0)
+    , m_timeToFirstCamera(-1)
 {
     m_networkManager = new QNetworkAccessManager(this);
     
+    m_onvif = new OnvifDiscovery(this);
+    connect(m_onvif, &OnvifDiscovery::deviceFound, this, &CameraDiscovery::onOnvifDeviceFound);
+    m_ssdp = new SsdpDiscovery(this);
+    connect(m_ssdp, &SsdpDiscovery::deviceFound, this, &CameraDiscovery::onSsdpDeviceFound);
+    m_mdns = new MdnsDiscovery(this);
+    connect(m_mdns, &MdnsDiscovery::serviceFound, this, &CameraDiscovery::onMdnsServiceFound);
+    m_rtspProber = new RtspUrlProber(this);
+    connect(m_rtspProber, &RtspUrlProber::probeFinished, this, &CameraDiscovery::onRtspProbeFinished);
+    
+    // Announcements heard before the first scan are kept for it
+    m_ssdp->startListening();
+    m_mdns->startListening();
+    
+    if (m_cache->load()) {
+        LOG_INFO(QString("Loaded %1 cameras from the discovery cache").arg(m_cache->size()), "CameraDiscovery");
+    }
+    
     // Initialize common camera ports in priority order
     m_cameraPorts = {80, 554, 8080, 8081, 443, 8000, 8443, 88, 8088, 8888, 9999};
     
@@ -195,18 +432,152 @@ void CameraDiscovery::startDiscovery(const QString& networkRange)
         return;
     }
     
+    m_discoveredCameras.clear();
+    m_cameraIndex.clear();
+    m_macIndex.clear();
+    m_coveredHosts.clear();
+    m_connectTimes.clear();
+    m_timeToFirstCamera = -1;
+    beginDiscovery(networkRange, ScanCursor());
+}
+
+bool CameraDiscovery::canResume() const
+{
+    return !m_isDiscovering && m_resumeCursor.isValid();
+}
+
+void CameraDiscovery::resumeDiscovery()
+{
+    if (!canResume()) {
+        return;
+    }
+    
+    // Cameras found before the stop stay in the list
+    beginDiscovery(m_resumeCursor.networkRange, m_resumeCursor);
+}
+
+void CameraDiscovery::beginDiscovery(const QString& networkRange, const ScanCursor& cursor)
+{
+    QString rangeError;
+    if (!m_targetSpace.parse(networkRange, &rangeError)) {
+        LOG_WARNING(QString("Invalid network range: %1").arg(rangeError), "CameraDiscovery");
+        emit error(QString("Invalid network range: %1").arg(rangeError));
+        return;
+    }
+    
     m_networkRange = networkRange;
     m_isDiscovering = true;
     m_scannedHosts = 0;
-    m_discoveredCameras.clear();
+    m_requestQueue.clear();
+    m_hostDeadlines.clear();
+    m_resumeCursor = ScanCursor();
+    m_discoveryClock.start();
     
-    LOG_INFO(QString("Starting camera discovery on network: %1").arg(networkRange), "CameraDiscovery");
+    LOG_INFO(QString("%1 camera discovery on network: %2")
+             .arg(cursor.isValid() ? "Resuming" : "Starting", networkRange), "CameraDiscovery");
     emit discoveryStarted();
     
-    initializeScanner();
+    // Cameras on the attached segments answer a multicast query within about a second,
+    // long before the sweep reaches them; hosts they identify are dropped from the sweep
+    startAnnouncementSources();
+    
+    // A resumed sweep keeps the cameras it already listed; a new one first confirms
+    // the cameras found last time, and sweeps once they have answered
+    if (cursor.isValid() || !m_useCache || !revalidateCachedCameras()) {
+        startSweep(cursor);
+    }
+}
+
+void CameraDiscovery::startSweep(const ScanCursor& cursor)
+{
+    initializeScanner(cursor);
     startNetworkScan();
 }
 
+bool CameraDiscovery::revalidateCachedCameras()
+{
+    int dropped = m_cache->expire(QDateTime::currentMSecsSinceEpoch(), CACHE_MAX_AGE_MS);
+    if (dropped > 0) {
+        LOG_INFO(QString("Forgot %1 cached cameras not seen for a week").arg(dropped), "CameraDiscovery");
+    }
+    
+    for (const DiscoveredCamera& cached : m_cache->cameras()) {
+        if (!m_targetSpace.contains(QHostAddress(cached.ipAddress).toIPv4Address())) {
+            continue;
+        }
+        
+        QTcpSocket* socket = new QTcpSocket(this);
+        m_revalidations.insert(socket, Revalidation{cached, m_discoveryClock.elapsed()});
+        
+        QTimer* timer = new QTimer(socket);
+        timer->setSingleShot(true);
+        connect(timer, &QTimer::timeout, this, [this, socket]() { finishRevalidation(socket, false); });
+        timer->start(m_timeout);
+        
+        connect(socket, &QTcpSocket::connected, this, [this, socket]() { finishRevalidation(socket, true); });
+        connect(socket, &QAbstractSocket::errorOccurred, this, [this, socket]() { finishRevalidation(socket, false); });
+        socket->connectToHost(cached.ipAddress, cached.port);
+    }
+    
+    if (!m_revalidations.isEmpty()) {
+        LOG_INFO(QString("Confirming %1 cached cameras before the sweep").arg(m_revalidations.size()), 
+                 "CameraDiscovery");
+    }
+    return !m_revalidations.isEmpty();
+}
+
+void CameraDiscovery::finishRevalidation(QTcpSocket* socket, bool open)
+{
+    auto it = m_revalidations.find(socket);
+    if (it == m_revalidations.end()) {
+        return;
+    }
+    Revalidation revalidation = it.value();
+    m_revalidations.erase(it);
+    
+    socket->disconnect(this);
+    socket->abort();
+    socket->deleteLater();
+    
+    if (!m_isDiscovering) {
+        return;
+    }
+    
+    if (open) {
+        // The address may have been handed to another device since
+        DiscoveredCamera camera = revalidation.camera;
+        QString macAddress;
+        if (m_neighbors.refreshIfOlderThan(NEIGHBOR_REFRESH_MS)) {
+            macAddress = m_neighbors.macAddress(QHostAddress(camera.ipAddress).toIPv4Address());
+        }
+        if (camera.macAddress.isEmpty() || macAddress.isEmpty() || macAddress == camera.macAddress) {
+            camera.isOnline = true;
+            camera.responseTime = int(m_discoveryClock.elapsed() - revalidation.startedAt);
+            m_coveredHosts.insert(camera.ipAddress);
+            recordCamera(camera);
+        }
+    }
+    
+    // Cameras that did not answer are swept like any other address
+    if (m_revalidations.isEmpty()) {
+        startSweep(ScanCursor());
+    }
+}
+
+void CameraDiscovery::persistDiscoveredCameras()
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    {
+        QMutexLocker locker(&m_dataMutex);
+        for (const DiscoveredCamera& camera : m_discoveredCameras) {
+            if (camera.isOnline) {
+                m_cache->update(camera, now);
+            }
+        }
+    }
+    m_cache->save();
+}
+
 void CameraDiscovery::stopDiscovery()
 {
     if (!m_isDiscovering) return;
@@ -215,22 +586,51 @@ void CameraDiscovery::stopDiscovery()
     
     if (m_scanner) {
         m_scanner->stop();
-        m_scanner->wait(3000); // Wait up to 3 seconds
+        if (m_scanner->wait(3000)) { // Wait up to 3 seconds
+            m_resumeCursor = m_scanner->resumeCursor();
+        }
         m_scanner->deleteLater();
         m_scanner = nullptr;
     }
-    
-    // Cancel pending HTTP requests
-    for (auto it = m_pendingRequests.begin(); it != m_pendingRequests.end(); ++it) {
+    m_onvif->stop();
+    m_ssdp->stop();
+    m_mdns->stop();
+    m_rtspProber->stop();
+    for (auto it = m_revalidations.begin(); it != m_revalidations.end(); ++it) {
+        it.key()->disconnect(this);
         it.key()->abort();
+        it.key()->deleteLater();
     }
+    m_revalidations.clear();
+    
+    // Cancel pending HTTP requests and RTSP probes
+    m_requestQueue.clear();
+    QList<QNetworkReply*> replies = m_pendingRequests.keys();
     m_pendingRequests.clear();
+    for (QNetworkReply* reply : replies) {
+        reply->abort();
+    }
+    for (auto it = m_pendingRtsp.begin(); it != m_pendingRtsp.end(); ++it) {
+        it.key()->disconnect(this);
+        it.key()->abort();
+        it.key()->deleteLater();
+    }
+    m_pendingRtsp.clear();
+    m_hostRequests.clear();
+    m_hostDeadlines.clear();
     m_currentRequests = 0;
+    persistDiscoveredCameras();
     
     LOG_INFO("Camera discovery stopped", "CameraDiscovery");
     emit discoveryFinished();
 }
 
+bool CameraDiscovery::validateNetworkRange(const QString& range, QString* error)
+{
+    ScanTargetSpace space;
+    return space.parse(range, error);
+}
+
 void CameraDiscovery::setNetworkRange(const QString& range)
 {
     m_networkRange = range;
@@ -246,6 +646,31 @@ void CameraDiscovery::setMaxConcurrentRequests(int count)
     m_maxConcurrentRequests = count;
 }
 
+void CameraDiscovery::setScanConcurrency(int probes)
+{
+    m_scanConcurrency = probes;
+}
+
+void CameraDiscovery::setProbeTimeout(int milliseconds)
+{
+    m_probeTimeout = milliseconds;
+}
+
+void CameraDiscovery::setSkipUnresolvedNeighbors(bool skip)
+{
+    m_skipUnresolvedNeighbors = skip;
+}
+
+void CameraDiscovery::setUseCache(bool use)
+{
+    m_useCache = use;
+}
+
+void CameraDiscovery::setRtspCredentials(const QString& username, const QString& password)
+{
+    m_rtspProber->setCredentials(username, password);
+}
+
 bool CameraDiscovery::isDiscovering() const
 {
     return m_isDiscovering;
@@ -261,6 +686,13 @@ void CameraDiscovery::clearDiscoveredCameras()
 {
     QMutexLocker locker(&m_dataMutex);
     m_discoveredCameras.clear();
+    m_cameraIndex.clear();
+    m_macIndex.clear();
+}
+
+qint64 CameraDiscovery::timeToFirstCamera() const
+{
+    return m_timeToFirstCamera;
 }
 
 QString CameraDiscovery::detectNetworkRange()
@@ -275,10 +707,16 @@ QString CameraDiscovery::detectNetworkRange()
             for (const QNetworkAddressEntry& entry : interface.addressEntries()) {
                 if (entry.ip().protocol() == QAbstractSocket::IPv4Protocol) {
                     quint32 ip = entry.ip().toIPv4Address();
-                    quint32 netmask = entry.netmask().toIPv4Address();
+                    int prefix = entry.prefixLength();
+                    
+                    // Large site networks are scanned on request; default to the local /24 there
+                    if (prefix < 22 || prefix > 30) {
+                        prefix = 24;
+                    }
+                    quint32 netmask = ~quint32(0) << (32 - prefix);
                     quint32 network = ip & netmask;
                     
-                    return QHostAddress(network).toString() + "/24";
+                    return QHostAddress(network).toString() + QString("/%1").arg(prefix);
                 }
             }
         }
@@ -289,44 +727,12 @@ QString CameraDiscovery::detectNetworkRange()
 
 QString CameraDiscovery::brandFromResponse(const QString& response, const QString& userAgent)
 {
-    QString lowerResponse = response.toLower();
-    QString lowerAgent = userAgent.toLower();
-    
-    // Hikvision detection
-    if (lowerResponse.contains("hikvision") || 
-        lowerResponse.contains("hik-connect") ||
-        lowerResponse.contains("webrec.htm") ||
-        lowerAgent.contains("hikvision")) {
-        return "Hikvision";
-    }
-    
-    // CP Plus detection
-    if (lowerResponse.contains("cp plus") || 
-        lowerResponse.contains("cpplus") ||
-        lowerResponse.contains("cp-plus") ||
-        lowerResponse.contains("aditya") ||
-        lowerAgent.contains("cpplus")) {
-        return "CP Plus";
-    }
-    
-    // Additional brand detection patterns
-    if (lowerResponse.contains("dahua") || lowerAgent.contains("dahua")) {
-        return "Dahua";
-    }
-    
-    if (lowerResponse.contains("axis") || lowerAgent.contains("axis")) {
-        return "Axis";
+    QByteArray text = response.toUtf8();
+    if (!userAgent.isEmpty() && userAgent != response) {
+        text += ' ';
+        text += userAgent.toUtf8();
     }
-    
-    if (lowerResponse.contains("vivotek") || lowerAgent.contains("vivotek")) {
-        return "Vivotek";
-    }
-    
-    if (lowerResponse.contains("foscam") || lowerAgent.contains("foscam")) {
-        return "Foscam";
-    }
-    
-    return "Generic";
+    return DeviceSignatures::instance().brand(text, DeviceSignatures::Announcement);
 }
 
 QString CameraDiscovery::generateRtspUrl(const QString& brand, const QString& ipAddress, int port)
@@ -391,76 +797,156 @@ QStringList CameraDiscovery::getCommonRtspPaths(const QString& brand)
     }
 }
 
-void CameraDiscovery::onDeviceFound(const QString& ipAddress, int port)
+void CameraDiscovery::onDeviceFound(const QString& ipAddress, int port, int connectMs)
 {
     if (!m_isDiscovering) return;
     
-    LOG_INFO(QString("Device found at %1:%2").arg(ipAddress).arg(port), "CameraDiscovery");
+    auto connectTime = m_connectTimes.find(ipAddress);
+    if (connectTime == m_connectTimes.end() || connectMs < connectTime.value()) {
+        m_connectTimes.insert(ipAddress, connectMs);
+    }
     
-    // Limit concurrent requests but be more aggressive
-    if (m_currentRequests >= m_maxConcurrentRequests) {
-        QTimer::singleShot(50, this, [this, ipAddress, port]() { // Reduced delay from 100ms to 50ms
-            onDeviceFound(ipAddress, port);
-        });
+    LOG_INFO(QString("Device found at %1:%2 after %3 ms")
+             .arg(ipAddress).arg(port).arg(m_discoveryClock.elapsed()), "CameraDiscovery");
+    
+    // Announced cameras are identified already; just note the open port
+    if (m_coveredHosts.contains(ipAddress)) {
+        DiscoveredCamera camera;
+        camera.ipAddress = ipAddress;
+        camera.port = port;
+        camera.brand = "Generic";
+        camera.supportedPorts.append(QString::number(port));
+        recordCamera(camera);
         return;
     }
     
-    identifyDevice(ipAddress, port);
+    // A camera vendor's MAC identifies the brand without a request; the camera is
+    // listed right away and identification only has to find its name and model
+    QString ouiBrand = brandFromNeighbor(ipAddress);
+    if (!ouiBrand.isEmpty()) {
+        DiscoveredCamera camera;
+        camera.ipAddress = ipAddress;
+        camera.port = port;
+        camera.isOnline = true;
+        camera.brand = ouiBrand;
+        camera.model = "Unknown";
+        camera.deviceName = QString("Camera_%1").arg(ipAddress);
+        camera.rtspUrl = generateRtspUrl(ouiBrand, ipAddress, 554);
+        camera.supportedPorts.append(QString::number(port));
+        recordCamera(camera);
+    }
+    
+    // Identification starts while the sweep is still running
+    identifyDevice(ipAddress, port, ouiBrand.isEmpty());
 }
 
-void CameraDiscovery::onHttpResponse()
+void CameraDiscovery::onHttpHeaders()
+{
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    if (!reply) return;
+    
+    auto it = m_pendingRequests.find(reply);
+    if (it == m_pendingRequests.end() || !it.value().request.brandProbe) {
+        return;
+    }
+    
+    // A vendor path probe only has to tell the brand; once the headers do, skip the body
+    QByteArray headers;
+    for (const auto& header : reply->rawHeaderList()) {
+        headers += header + ": " + reply->rawHeader(header) + '\n';
+    }
+    if (DeviceSignatures::instance().brand(headers, DeviceSignatures::HttpResponse) != "Generic") {
+        completeHttpProbe(reply, true);
+        reply->abort();
+    }
+}
+
+void CameraDiscovery::onHttpReadyRead()
 {
     QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
     if (!reply) return;
     
     auto it = m_pendingRequests.find(reply);
     if (it == m_pendingRequests.end()) {
-        reply->deleteLater();
         return;
     }
     
-    QString ipAddress = it.value().first;
-    int port = it.value().second;
-    m_pendingRequests.erase(it);
-    m_currentRequests--;
+    // Servers that ignore the Range header would send the whole page
+    QByteArray& body = it.value().body;
+    body += reply->read(HTTP_READ_LIMIT - body.size());
+    if (body.size() >= HTTP_READ_LIMIT) {
+        completeHttpProbe(reply, true);
+        reply->abort();
+    }
+}
+
+void CameraDiscovery::onHttpResponse()
+{
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    if (!reply) return;
     
-    if (reply->error() == QNetworkReply::NoError) {
-        QString response = reply->readAll();
-        QString headers;
-        
+    // Replies completed early were aborted and are no longer pending
+    auto it = m_pendingRequests.find(reply);
+    if (it != m_pendingRequests.end()) {
+        if (reply->error() == QNetworkReply::NoError) {
+            it.value().body += reply->read(HTTP_READ_LIMIT - it.value().body.size());
+        }
+        completeHttpProbe(reply, reply->error() == QNetworkReply::NoError);
+    }
+    
+    reply->deleteLater();
+}
+
+void CameraDiscovery::completeHttpProbe(QNetworkReply* reply, bool analyze)
+{
+    HttpProbe probe = m_pendingRequests.take(reply);
+    releaseRequest(probe.request.ipAddress);
+    
+    if (analyze) {
+        QByteArray headers;
         for (const auto& header : reply->rawHeaderList()) {
-            headers += QString("%1: %2\n").arg(QString(header), QString(reply->rawHeader(header)));
+            headers += header + ": " + reply->rawHeader(header) + '\n';
         }
         
-        DiscoveredCamera camera = analyzeHttpResponse(ipAddress, port, response, headers);
+        DiscoveredCamera camera = analyzeHttpResponse(probe.request.ipAddress, probe.request.port, 
+                                                      probe.body, headers);
         if (!camera.brand.isEmpty()) {
             camera.isOnline = true;
-            
-            QMutexLocker locker(&m_dataMutex);
-            m_discoveredCameras.append(camera);
-            
-            LOG_INFO(QString("Discovered %1 camera at %2:%3 - Model: %4")
-                     .arg(camera.brand, ipAddress).arg(port).arg(camera.model), "CameraDiscovery");
-            
-            emit cameraDiscovered(camera);
+            recordCamera(camera);
         }
     }
     
-    reply->deleteLater();
+    dispatchRequests();
 }
 
-void CameraDiscovery::onHttpError(QNetworkReply::NetworkError error)
+void CameraDiscovery::cancelBrandProbes(const QString& ipAddress)
 {
-    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
-    if (!reply) return;
-    
-    auto it = m_pendingRequests.find(reply);
-    if (it != m_pendingRequests.end()) {
-        m_pendingRequests.erase(it);
-        m_currentRequests--;
+    for (int i = m_requestQueue.size() - 1; i >= 0; --i) {
+        const IdentifyRequest& request = m_requestQueue.at(i);
+        if (request.brandProbe && request.ipAddress == ipAddress) {
+            m_requestQueue.removeAt(i);
+        }
     }
     
-    reply->deleteLater();
+    QList<QNetworkReply*> replies;
+    for (auto it = m_pendingRequests.cbegin(); it != m_pendingRequests.cend(); ++it) {
+        if (it.value().request.brandProbe && it.value().request.ipAddress == ipAddress) {
+            replies.append(it.key());
+        }
+    }
+    for (QNetworkReply* reply : replies) {
+        completeHttpProbe(reply, false);
+        reply->abort();
+    }
+}
+
+void CameraDiscovery::releaseRequest(const QString& ipAddress)
+{
+    m_currentRequests--;
+    auto it = m_hostRequests.find(ipAddress);
+    if (it != m_hostRequests.end() && --it.value() <= 0) {
+        m_hostRequests.erase(it);
+    }
 }
 
 void CameraDiscovery::onScanProgress(int current, int total)
@@ -472,18 +958,30 @@ void CameraDiscovery::onScanProgress(int current, int total)
 
 void CameraDiscovery::onScanFinished()
 {
+    if (!m_isDiscovering) {
+        return;     // Stopped; the scanner already handed over its resume cursor
+    }
+    
     if (m_scanner) {
         m_scanner->deleteLater();
         m_scanner = nullptr;
+        m_resumeCursor = ScanCursor();
     }
     
     // Wait for pending HTTP requests to complete with shorter timeout
     QTimer::singleShot(1000, this, [this]() { // Reduced from 2000ms to 1000ms
-        if (m_currentRequests == 0) {
+        if (!m_isDiscovering) {
+            return;
+        }
+        if (m_currentRequests == 0 && m_requestQueue.isEmpty() &&
+            !m_onvif->isActive() && !m_ssdp->isActive() && !m_mdns->isActive() &&
+            !m_rtspProber->isActive()) {
             m_isDiscovering = false;
+            persistDiscoveredCameras();
             
-            LOG_INFO(QString("Camera discovery finished. Found %1 cameras.")
-                     .arg(m_discoveredCameras.size()), "CameraDiscovery");
+            LOG_INFO(QString("Camera discovery finished in %1 ms. Found %2 cameras (first after %3 ms).")
+                     .arg(m_discoveryClock.elapsed()).arg(m_discoveredCameras.size()).arg(m_timeToFirstCamera), 
+                     "CameraDiscovery");
             
             emit discoveryFinished();
         } else {
@@ -493,7 +991,7 @@ void CameraDiscovery::onScanFinished()
     });
 }
 
-void CameraDiscovery::initializeScanner()
+void CameraDiscovery::initializeScanner(const ScanCursor& cursor)
 {
     if (m_scanner) {
         m_scanner->deleteLater();
@@ -501,6 +999,32 @@ void CameraDiscovery::initializeScanner()
     
     m_scanner = new NetworkScanner(m_networkRange, this);
     m_scanner->setPortRange(m_cameraPorts);
+    m_scanner->setMaxConcurrentProbes(m_scanConcurrency);
+    m_scanner->setProbeTimeout(m_probeTimeout);
+    if (cursor.isValid()) {
+        m_scanner->setResumeCursor(cursor);
+    }
+    for (const QString& host : m_coveredHosts) {
+        m_scanner->skipHost(QHostAddress(host).toIPv4Address());
+    }
+    
+    // The ARP cache already knows which hosts on the attached segments are up
+    if (m_neighbors.load()) {
+        // Hosts with a camera vendor's MAC go first of all
+        QList<quint32> liveHosts = m_neighbors.liveAddresses();
+        std::stable_partition(liveHosts.begin(), liveHosts.end(), [this](quint32 address) {
+            return !OuiTable::brandForMac(m_neighbors.macAddress(address)).isEmpty();
+        });
+        m_scanner->setPriorityHosts(liveHosts);
+        if (m_skipUnresolvedNeighbors) {
+            for (quint32 address : m_neighbors.failedAddresses()) {
+                m_scanner->skipHost(address);
+            }
+        }
+        LOG_INFO(QString("Neighbor table: %1 live, %2 unresolved entries")
+                 .arg(m_neighbors.liveAddresses().size()).arg(m_neighbors.failedAddresses().size()), 
+                 "CameraDiscovery");
+    }
     
     connect(m_scanner, &NetworkScanner::deviceFound, this, &CameraDiscovery::onDeviceFound);
     connect(m_scanner, &NetworkScanner::scanProgress, this, &CameraDiscovery::onScanProgress);
@@ -514,180 +1038,527 @@ void CameraDiscovery::startNetworkScan()
     }
 }
 
-void CameraDiscovery::identifyDevice(const QString& ipAddress, int port)
+QString CameraDiscovery::brandFromNeighbor(const QString& ipAddress)
 {
+    if (!m_neighbors.refreshIfOlderThan(NEIGHBOR_REFRESH_MS)) {
+        return QString();
+    }
+    return OuiTable::brandForMac(m_neighbors.macAddress(QHostAddress(ipAddress).toIPv4Address()));
+}
+
+void CameraDiscovery::identifyDevice(const QString& ipAddress, int port, bool probeVendorPaths)
+{
+    // Another open port is new evidence; the host gets a fresh budget for it
+    m_hostDeadlines.remove(ipAddress);
+    
+    // RTSP ports answer OPTIONS, not HTTP
+    if (port == 554 || port == 8554) {
+        m_requestQueue.enqueue({ipAddress, port, QString(), false});
+        dispatchRequests();
+        return;
+    }
+    
     // Try HTTP first on discovered port
-    sendHttpRequest(ipAddress, port, "/");
+    m_requestQueue.enqueue({ipAddress, port, "/", false});
     
-    // For common web ports, also try camera-specific paths immediately
-    if (port == 80 || port == 8080) {
-        QTimer::singleShot(100, this, [this, ipAddress, port]() { // Reduced delay
-            sendHttpRequest(ipAddress, port, "/cgi-bin/hi3510/param.cgi");
-        });
-        QTimer::singleShot(200, this, [this, ipAddress, port]() {
-            sendHttpRequest(ipAddress, port, "/PSIA/Custom/SelfExt/userCheck");
-        });
-        QTimer::singleShot(300, this, [this, ipAddress, port]() {
-            sendHttpRequest(ipAddress, port, "/onvif/device_service");
-        });
+    // For common web ports, also try camera-specific paths unless the brand is known
+    if (probeVendorPaths && (port == 80 || port == 8080)) {
+        m_requestQueue.enqueue({ipAddress, port, "/cgi-bin/hi3510/param.cgi", true});
+        m_requestQueue.enqueue({ipAddress, port, "/PSIA/Custom/SelfExt/userCheck", true});
+        m_requestQueue.enqueue({ipAddress, port, "/onvif/device_service", true});
+        
+        // Routed segments never see the multicast probe; ask the host directly
+        sendOnvifDiscovery(ipAddress);
     }
+    
+    dispatchRequests();
 }
 
-void CameraDiscovery::sendHttpRequest(const QString& ipAddress, int port, const QString& path)
+void CameraDiscovery::dispatchRequests()
 {
-    if (m_currentRequests >= m_maxConcurrentRequests) return;
-    
-    QString url = QString("http://%1:%2%3").arg(ipAddress).arg(port).arg(path);
+    // Requests go out in queue order, except that a host already busy with
+    // MAX_REQUESTS_PER_HOST of them is passed over, so one slow camera cannot
+    // hold the shared slots while others wait
+    const qint64 now = m_discoveryClock.elapsed();
+    for (int i = 0; m_isDiscovering && m_currentRequests < m_maxConcurrentRequests && i < m_requestQueue.size(); ) {
+        const IdentifyRequest& queued = m_requestQueue.at(i);
+        if (m_hostRequests.value(queued.ipAddress) >= MAX_REQUESTS_PER_HOST) {
+            ++i;
+            continue;
+        }
+        
+        IdentifyRequest request = m_requestQueue.takeAt(i);
+        
+        // Each host gets a fixed budget from its first request on; whatever is
+        // still queued for it afterwards is dropped
+        auto deadline = m_hostDeadlines.find(request.ipAddress);
+        if (deadline == m_hostDeadlines.end()) {
+            deadline = m_hostDeadlines.insert(request.ipAddress, now + qint64(m_timeout) * HOST_DEADLINE_TIMEOUTS);
+        }
+        const int timeout = int(qMin<qint64>(m_timeout, deadline.value() - now));
+        if (timeout <= 0) {
+            continue;
+        }
+        
+        m_hostRequests[request.ipAddress]++;
+        m_currentRequests++;
+        if (request.path.isEmpty()) {
+            sendRtspOptions(request.ipAddress, request.port, timeout);
+        } else {
+            sendHttpRequest(request, timeout);
+        }
+    }
+}
+
+void CameraDiscovery::sendHttpRequest(const IdentifyRequest& identify, int timeout)
+{
+    QString url = QString("http://%1:%2%3").arg(identify.ipAddress).arg(identify.port).arg(identify.path);
     QNetworkRequest request(url);
     
     // Set headers to identify camera responses
     request.setHeader(QNetworkRequest::UserAgentHeader, "CameraDiscovery/1.0");
     request.setRawHeader("Accept", "text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8");
     
+    // Only the start of the page is analyzed; a slow camera should not have to send the rest
+    request.setRawHeader("Range", QByteArray("bytes=0-") + QByteArray::number(HTTP_READ_LIMIT - 1));
+    
     QNetworkReply* reply = m_networkManager->get(request);
     reply->setParent(this);
+    reply->setReadBufferSize(HTTP_READ_LIMIT);
     
     // Set timeout
     QTimer* timer = new QTimer(reply);
     timer->setSingleShot(true);
-    timer->setInterval(m_timeout);
     connect(timer, &QTimer::timeout, reply, &QNetworkReply::abort);
-    timer->start();
+    timer->start(timeout);
     
+    connect(reply, &QNetworkReply::metaDataChanged, this, &CameraDiscovery::onHttpHeaders);
+    connect(reply, &QNetworkReply::readyRead, this, &CameraDiscovery::onHttpReadyRead);
     connect(reply, &QNetworkReply::finished, this, &CameraDiscovery::onHttpResponse);
-    connect(reply, QOverload<QNetworkReply::NetworkError>::of(&QNetworkReply::errorOccurred),
-            this, &CameraDiscovery::onHttpError);
     
-    m_pendingRequests[reply] = qMakePair(ipAddress, port);
-    m_currentRequests++;
+    m_pendingRequests.insert(reply, HttpProbe{identify, QByteArray()});
 }
 
-DiscoveredCamera CameraDiscovery::analyzeHttpResponse(const QString& ipAddress, int port, 
-                                                    const QString& response, const QString& headers)
+void CameraDiscovery::sendRtspOptions(const QString& ipAddress, int port, int timeout)
+{
+    QTcpSocket* socket = new QTcpSocket(this);
+    m_pendingRtsp[socket] = qMakePair(ipAddress, port);
+    
+    QTimer* timer = new QTimer(socket);
+    timer->setSingleShot(true);
+    connect(timer, &QTimer::timeout, this, [this, socket]() { finishRtspProbe(socket); });
+    timer->start(timeout);
+    
+    connect(socket, &QTcpSocket::connected, this, [socket, ipAddress, port]() {
+        QByteArray url = QString("rtsp://%1:%2/").arg(ipAddress).arg(port).toUtf8();
+        socket->write(RtspProtocol::buildRequest("OPTIONS", url, 1));
+    });
+    connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { handleRtspReply(socket); });
+    connect(socket, &QAbstractSocket::errorOccurred, this, [this, socket]() { finishRtspProbe(socket); });
+    
+    socket->connectToHost(ipAddress, port);
+}
+
+void CameraDiscovery::handleRtspReply(QTcpSocket* socket)
 {
+    auto it = m_pendingRtsp.find(socket);
+    if (it == m_pendingRtsp.end()) {
+        return;
+    }
+    
+    // Keep the reply in the socket until it is complete
+    QByteArray reply = socket->peek(8192);
+    if (RtspProtocol::messageLength(reply) < 0 && reply.size() < 8192) {
+        return;
+    }
+    
+    QString ipAddress = it.value().first;
+    int port = it.value().second;
+    finishRtspProbe(socket);
+    
+    if (!RtspProtocol::isResponse(reply)) {
+        return;
+    }
+    
+    // The Server header usually names the vendor's streaming stack
+    QString server = QString::fromUtf8(RtspProtocol::headerValue(reply, "Server"));
+    
     DiscoveredCamera camera;
     camera.ipAddress = ipAddress;
     camera.port = port;
     camera.isOnline = true;
+    camera.brand = brandFromResponse(server, server);
+    camera.model = "Unknown";
+    camera.deviceName = server.isEmpty() ? QString("RTSP device %1").arg(ipAddress) : server;
+    camera.rtspUrl = generateRtspUrl(camera.brand, ipAddress, port);
+    camera.supportedPorts.append(QString::number(port));
+    recordCamera(camera);
+}
+
+void CameraDiscovery::finishRtspProbe(QTcpSocket* socket)
+{
+    auto it = m_pendingRtsp.find(socket);
+    if (it == m_pendingRtsp.end()) {
+        return;
+    }
+    QString ipAddress = it.value().first;
+    m_pendingRtsp.erase(it);
+    
+    socket->disconnect(this);
+    socket->abort();
+    socket->deleteLater();
+    releaseRequest(ipAddress);
+    dispatchRequests();
+}
+
+void CameraDiscovery::recordCamera(const DiscoveredCamera& identified)
+{
+    // Our own probes keep filling the ARP cache, so hosts on attached segments resolve
+    DiscoveredCamera camera = identified;
+    if (camera.macAddress.isEmpty() && m_neighbors.refreshIfOlderThan(NEIGHBOR_REFRESH_MS)) {
+        camera.macAddress = m_neighbors.macAddress(QHostAddress(camera.ipAddress).toIPv4Address());
+    }
+    if (camera.responseTime < 0) {
+        camera.responseTime = m_connectTimes.value(camera.ipAddress, -1);
+    }
+    if (camera.brand == "Generic") {
+        QString ouiBrand = OuiTable::brandForMac(camera.macAddress);
+        if (!ouiBrand.isEmpty()) {
+            camera.brand = ouiBrand;
+            camera.rtspUrl = generateRtspUrl(ouiBrand, camera.ipAddress, QUrl(camera.rtspUrl).port(554));
+        }
+    }
+    if (camera.brand != "Generic") {
+        cancelBrandProbes(camera.ipAddress);
+    }
     
-    // Detect brand
-    camera.brand = detectBrand(response, headers);
+    QMutexLocker locker(&m_dataMutex);
     
-    // Detect model
-    camera.model = detectModel(response, headers, camera.brand);
+    // Several probes and sources can identify the same host, possibly at another of its
+    // addresses; report it once and refine it afterwards
+    int index = m_cameraIndex.value(camera.ipAddress, -1);
+    if (index < 0 && !camera.macAddress.isEmpty()) {
+        index = m_macIndex.value(camera.macAddress, -1);
+        if (index >= 0) {
+            m_cameraIndex.insert(camera.ipAddress, index);
+        }
+    }
     
-    // Extract device name
-    camera.deviceName = extractDeviceName(response, headers);
+    if (index >= 0) {
+        DiscoveredCamera& existing = m_discoveredCameras[index];
+        const QString previousBrand = existing.brand;
+        if (mergeCamera(existing, camera)) {
+            if (!existing.macAddress.isEmpty()) {
+                m_macIndex.insert(existing.macAddress, index);
+            }
+            DiscoveredCamera updated = existing;
+            locker.unlock();
+            emit cameraUpdated(updated);
+            
+            // The new brand brings its own stream paths
+            if (updated.brand != previousBrand && !updated.rtspVerified) {
+                probeRtspUrl(updated);
+            }
+        }
+        return;
+    }
     
-    // Generate RTSP URL
-    camera.rtspUrl = generateRtspUrl(camera.brand, ipAddress, 554);
+    m_cameraIndex.insert(camera.ipAddress, m_discoveredCameras.size());
+    if (!camera.macAddress.isEmpty()) {
+        m_macIndex.insert(camera.macAddress, m_discoveredCameras.size());
+    }
+    m_discoveredCameras.append(camera);
+    locker.unlock();
     
-    // Set supported ports (we found this port open)
-    camera.supportedPorts.append(QString::number(port));
+    if (m_timeToFirstCamera < 0) {
+        m_timeToFirstCamera = m_discoveryClock.elapsed();
+        LOG_INFO(QString("First camera identified %1 ms after discovery started").arg(m_timeToFirstCamera), 
+                 "CameraDiscovery");
+    }
     
-    return camera;
+    LOG_INFO(QString("Discovered %1 camera at %2:%3 - Model: %4")
+             .arg(camera.brand, camera.ipAddress).arg(camera.port).arg(camera.model), "CameraDiscovery");
+    
+    emit cameraDiscovered(camera);
+    probeRtspUrl(camera);
 }
 
-QString CameraDiscovery::detectBrand(const QString& response, const QString& headers)
+void CameraDiscovery::probeRtspUrl(const DiscoveredCamera& camera)
 {
-    QString combined = (response + " " + headers).toLower();
-    
-    // Hikvision patterns
-    if (combined.contains("hikvision") || 
-        combined.contains("hik-connect") ||
-        combined.contains("webrec.htm") ||
-        combined.contains("server: app-webs/") ||
-        combined.contains("ds-") ||
-        combined.contains("/PSIA/")) {
-        return "Hikvision";
+    if (camera.rtspVerified) {
+        return;     // Confirmed by an earlier discovery
     }
     
-    // CP Plus patterns
-    if (combined.contains("cp plus") || 
-        combined.contains("cpplus") ||
-        combined.contains("cp-plus") ||
-        combined.contains("aditya") ||
-        combined.contains("guard") ||
-        combined.contains("realmonitor")) {
-        return "CP Plus";
+    // The brand's own paths first, then the generic ones in case the brand guess is wrong
+    QStringList paths = getCommonRtspPaths(camera.brand);
+    for (const QString& path : getCommonRtspPaths("Generic")) {
+        if (!paths.contains(path)) {
+            paths.append(path);
+        }
+    }
+    m_rtspProber->probe(camera.ipAddress, QUrl(camera.rtspUrl).port(554), paths);
+}
+
+void CameraDiscovery::onRtspProbeFinished(const RtspProbeResult& result)
+{
+    QMutexLocker locker(&m_dataMutex);
+    int index = m_cameraIndex.value(result.ipAddress, -1);
+    if (index < 0) {
+        return;
     }
     
-    // Other brands
-    if (combined.contains("dahua")) return "Dahua";
-    if (combined.contains("axis")) return "Axis";
-    if (combined.contains("vivotek")) return "Vivotek";
-    if (combined.contains("foscam")) return "Foscam";
-    if (combined.contains("acti")) return "ACTi";
-    if (combined.contains("bosch")) return "Bosch";
-    if (combined.contains("panasonic")) return "Panasonic";
-    if (combined.contains("sony")) return "Sony";
+    // Cameras announced by ONVIF/SSDP/mDNS are left out of the sweep, so this
+    // connect is their only round trip measurement
+    DiscoveredCamera& camera = m_discoveredCameras[index];
+    const bool measured = camera.responseTime < 0 && result.connectMs >= 0;
+    if (measured) {
+        camera.responseTime = result.connectMs;
+    }
+    if (result.url.isEmpty() && !measured) {
+        return;
+    }
+    if (!result.url.isEmpty()) {
+        camera.rtspUrl = result.url;
+        camera.rtspVerified = true;
+        camera.videoCodec = result.codec;
+        camera.videoWidth = result.width;
+        camera.videoHeight = result.height;
+    }
+    DiscoveredCamera updated = camera;
+    locker.unlock();
     
-    return "Generic";
+    emit cameraUpdated(updated);
 }
 
-QString CameraDiscovery::detectModel(const QString& response, const QString& headers, const QString& brand)
+bool CameraDiscovery::mergeCamera(DiscoveredCamera& existing, const DiscoveredCamera& update)
 {
-    if (brand == "Hikvision") {
-        return getHikvisionModel(response);
-    } else if (brand == "CP Plus") {
-        return getCPPlusModel(response);
+    bool changed = false;
+    
+    for (const QString& port : update.supportedPorts) {
+        if (!existing.supportedPorts.contains(port)) {
+            existing.supportedPorts.append(port);
+            changed = true;
+        }
+    }
+    
+    // CP Plus cameras are Dahua OEM hardware and carry Dahua MACs
+    if ((existing.brand == "Generic" && update.brand != "Generic") ||
+        (existing.brand == "Dahua" && update.brand == "CP Plus")) {
+        existing.brand = update.brand;
+        if (!existing.rtspVerified) {
+            existing.rtspUrl = update.rtspUrl;
+        }
+        changed = true;
+    }
+    
+    if ((existing.model.isEmpty() || existing.model == "Unknown") &&
+        !update.model.isEmpty() && update.model != "Unknown") {
+        existing.model = update.model;
+        changed = true;
+    }
+    
+    if (existing.macAddress.isEmpty() && !update.macAddress.isEmpty()) {
+        existing.macAddress = update.macAddress;
+        changed = true;
+    }
+    
+    if (existing.responseTime < 0 && update.responseTime >= 0) {
+        existing.responseTime = update.responseTime;
+        changed = true;
     }
-      // Generic model detection
-    QRegularExpression modelRegex(R"(model["\s]*[:=]["\s]*([^"<>\s]+))", QRegularExpression::CaseInsensitiveOption);
-    QRegularExpressionMatch match = modelRegex.match(response);
-    if (match.hasMatch()) {
-        return match.captured(1).trimmed();
+    
+    if (isPlaceholderName(existing.deviceName) && !isPlaceholderName(update.deviceName)) {
+        existing.deviceName = update.deviceName;
+        changed = true;
     }
     
-    return "Unknown";
+    return changed;
 }
 
-QString CameraDiscovery::extractDeviceName(const QString& response, const QString& headers)
-{    // Try to extract device name from title tag
-    QRegularExpression titleRegex(R"(<title[^>]*>([^<]+)</title>)", QRegularExpression::CaseInsensitiveOption);
-    QRegularExpressionMatch match = titleRegex.match(response);
-    if (match.hasMatch()) {
-        QString title = match.captured(1).trimmed();
-        if (!title.isEmpty() && title != "Document") {
-            return title;
-        }
+bool CameraDiscovery::isPlaceholderName(const QString& deviceName)
+{
+    // Names generated from a response hash or a bare address
+    return deviceName.isEmpty() ||
+           deviceName.startsWith("Camera_") ||
+           deviceName.startsWith("RTSP device ") ||
+           deviceName.startsWith("ONVIF device ") ||
+           deviceName.startsWith("UPnP device ");
+}
+
+DiscoveredCamera CameraDiscovery::analyzeHttpResponse(const QString& ipAddress, int port, 
+                                                    const QByteArray& response, const QByteArray& headers)
+{
+    DiscoveredCamera camera;
+    camera.ipAddress = ipAddress;
+    camera.port = port;
+    camera.isOnline = true;
+    
+    // Brand, model and device name from one scan of the raw response
+    DeviceIdentity identity = DeviceSignatures::instance().identifyHttp(response, headers);
+    camera.brand = identity.brand;
+    camera.model = identity.model;
+    camera.deviceName = identity.deviceName;
+    
+    // Generate RTSP URL
+    camera.rtspUrl = generateRtspUrl(camera.brand, ipAddress, 554);
+    
+    // Set supported ports (we found this port open)
+    camera.supportedPorts.append(QString::number(port));
+    
+    return camera;
+}
+
+void CameraDiscovery::onPingFinished()
+{
+    // Implementation for ping completion if needed
+}
+
+void CameraDiscovery::sendOnvifDiscovery(const QString& ipAddress)
+{
+    if (ipAddress.isEmpty()) {
+        m_onvif->probe();
+    } else {
+        m_onvif->probeHost(QHostAddress(ipAddress));
     }
+}
+
+void CameraDiscovery::onOnvifDeviceFound(const OnvifDevice& device)
+{
+    QString description = QString("%1 %2 %3 %4")
+                          .arg(device.manufacturer, device.name, device.hardware, device.scopes.join(' '));
     
-    // Try device name field
-    QRegularExpression nameRegex(R"(device[_\s]*name["\s]*[:=]["\s]*([^"<>\s]+))", QRegularExpression::CaseInsensitiveOption);
-    match = nameRegex.match(response);
-    if (match.hasMatch()) {
-        return match.captured(1).trimmed();
+    DiscoveredCamera camera;
+    camera.ipAddress = device.ipAddress;
+    camera.port = device.port;
+    camera.isOnline = true;
+    camera.brand = brandFromResponse(description);
+    camera.model = device.hardware.isEmpty() ? "Unknown" : device.hardware;
+    camera.deviceName = device.name.isEmpty() ? QString("ONVIF device %1").arg(device.ipAddress) : device.name;
+    camera.rtspUrl = generateRtspUrl(camera.brand, device.ipAddress, 554);
+    camera.supportedPorts.append(QString::number(device.port));
+    recordAnnouncedCamera(camera);
+}
+
+void CameraDiscovery::onSsdpDeviceFound(const SsdpDevice& device)
+{
+    // Routers, TVs and media servers answer SSDP too; keep what looks like a camera or recorder
+    QString description = QString("%1 %2 %3 %4 %5 %6")
+                          .arg(device.manufacturer, device.modelName, device.modelNumber,
+                               device.friendlyName, device.deviceType, device.server);
+    QString brand = brandFromResponse(description);
+    static const QRegularExpression cameraPattern(
+        R"(camera|ipcam|netcam|\bipc\b|\bnvr\b|\bdvr\b|network video)", QRegularExpression::CaseInsensitiveOption);
+    if (brand == "Generic" && !cameraPattern.match(description).hasMatch()) {
+        return;
     }
     
-    return QString("Camera_%1").arg(QString(response.left(100).toUtf8().toHex()).left(8));
+    QUrl presentation(device.presentationUrl);
+    int port = presentation.isRelative() ? 80 : presentation.port(presentation.scheme() == "https" ? 443 : 80);
+    
+    DiscoveredCamera camera;
+    camera.ipAddress = device.ipAddress;
+    camera.port = port;
+    camera.isOnline = true;
+    camera.brand = brand;
+    camera.model = !device.modelName.isEmpty() ? device.modelName
+                 : !device.modelNumber.isEmpty() ? device.modelNumber : QString("Unknown");
+    camera.macAddress = normalizeMacAddress(device.macAddress);
+    camera.deviceName = device.friendlyName.isEmpty() ? QString("UPnP device %1").arg(device.ipAddress)
+                                                      : device.friendlyName;
+    camera.rtspUrl = generateRtspUrl(brand, device.ipAddress, 554);
+    camera.supportedPorts.append(QString::number(port));
+    recordAnnouncedCamera(camera);
 }
 
-QString CameraDiscovery::getHikvisionModel(const QString& response)
+void CameraDiscovery::onMdnsServiceFound(const MdnsService& service)
 {
-    // Hikvision specific model patterns
-    QRegularExpression modelRegex(R"((DS-\w+[\w-]*))");
-    QRegularExpressionMatch match = modelRegex.match(response);
-    if (match.hasMatch()) {
-        return match.captured(1);
+    QString description = QString("%1 %2 %3").arg(service.displayName(), service.hostName,
+                                                   QStringList(service.txt.values()).join(' '));
+    bool isAxis = service.serviceType.startsWith("_axis-video", Qt::CaseInsensitive);
+    bool isRtsp = service.serviceType.startsWith("_rtsp", Qt::CaseInsensitive);
+    
+    DiscoveredCamera camera;
+    camera.ipAddress = service.ipAddress;
+    camera.port = service.port;
+    camera.isOnline = true;
+    camera.brand = isAxis ? QString("Axis") : brandFromResponse(description);
+    camera.model = service.txt.value("model", service.txt.value("md", "Unknown"));
+    camera.macAddress = normalizeMacAddress(service.macAddress);
+    camera.deviceName = service.displayName();
+    
+    // An RTSP service may publish its stream path in TXT
+    QString path = service.txt.value("path");
+    if (isRtsp && !path.isEmpty()) {
+        camera.rtspUrl = QString("rtsp://%1:%2%3%4").arg(service.ipAddress).arg(service.port)
+                         .arg(path.startsWith('/') ? "" : "/", path);
+    } else {
+        camera.rtspUrl = generateRtspUrl(camera.brand, service.ipAddress, isRtsp ? service.port : 554);
     }
+    camera.supportedPorts.append(QString::number(service.port));
+    recordAnnouncedCamera(camera);
+}
+
+void CameraDiscovery::startAnnouncementSources()
+{
+    // Listeners keep running between discoveries; retried here in case the port was busy
+    m_ssdp->startListening();
+    m_mdns->startListening();
+    
+    sendOnvifDiscovery();
+    m_ssdp->search();
+    m_mdns->query();
     
-    return "Hikvision Camera";
+    // Cameras that announced themselves since the last discovery; the queries above refresh the rest
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    const QList<Announcement> announced = m_announcedCameras.values();
+    m_announcedCameras.clear();
+    for (const Announcement& announcement : announced) {
+        if (now - announcement.heardAt <= ANNOUNCEMENT_MAX_AGE_MS) {
+            recordAnnouncedCamera(announcement.camera);
+        }
+    }
 }
 
-QString CameraDiscovery::getCPPlusModel(const QString& response)
+void CameraDiscovery::recordAnnouncedCamera(const DiscoveredCamera& camera)
 {
-    // CP Plus specific model patterns
-    QRegularExpression modelRegex(R"((CP-[\w-]+))");
-    QRegularExpressionMatch match = modelRegex.match(response);
-    if (match.hasMatch()) {
-        return match.captured(1);
+    // Heard while idle: kept for the next discovery
+    if (!m_isDiscovering) {
+        auto it = m_announcedCameras.find(camera.ipAddress);
+        if (it == m_announcedCameras.end()) {
+            m_announcedCameras.insert(camera.ipAddress, Announcement{camera, QDateTime::currentMSecsSinceEpoch()});
+        } else {
+            mergeCamera(it.value().camera, camera);
+            it.value().heardAt = QDateTime::currentMSecsSinceEpoch();
+        }
+        return;
+    }
+    
+    // Multicast reaches every attached segment, not only the requested range
+    quint32 address = QHostAddress(camera.ipAddress).toIPv4Address();
+    if (!m_targetSpace.contains(address)) {
+        return;
     }
     
-    return "CP Plus Camera";
+    if (!m_coveredHosts.contains(camera.ipAddress)) {
+        m_coveredHosts.insert(camera.ipAddress);
+        if (m_scanner) {
+            m_scanner->skipHost(address);
+        }
+    }
+    recordCamera(camera);
 }
 
-void CameraDiscovery::onPingFinished()
+QString CameraDiscovery::normalizeMacAddress(const QString& macAddress)
 {
-    // Implementation for ping completion if needed
+    QString hex = macAddress.toUpper();
+    hex.remove(QRegularExpression("[^0-9A-F]"));
+    if (hex.size() != 12) {
+        return QString();
+    }
+    
+    QStringList octets;
+    for (int i = 0; i < 12; i += 2) {
+        octets.append(hex.mid(i, 2));
+    }
+    return octets.join(':');
 }
@@ -2,6 +2,7 @@
 #include "CameraApiService.h"
 #include "ConfigManager.h"
 #include "Logger.h"
+#include <QDateTime>
 
 CameraManager::CameraManager(WireGuardManager* wireGuardManager, QObject *parent)
     : QObject(parent)
@@ -239,6 +240,15 @@ QList<CameraConfig> CameraManager::getAllCameras() const
     return m_cameras.values();
 }
 
+QJsonObject CameraManager::exportStatistics() const
+{
+    QJsonObject stats;
+    stats["exportedAt"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    stats["relay"] = m_portForwarder->getRelayStatistics().toJson();
+    stats["api"] = m_apiService->requestStatistics().toJson();
+    return stats;
+}
+
 void CameraManager::handleForwardingStarted(const QString& cameraId, int externalPort)
 {
     m_cameraStatus[cameraId] = true;
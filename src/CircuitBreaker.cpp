@@ -0,0 +1,83 @@
+#include "CircuitBreaker.h"
+#include <QRandomGenerator>
+
+CircuitBreaker::CircuitBreaker()
+    : m_state(Closed)
+    , m_failures(0)
+    , m_opens(0)
+    , m_retryAt(0)
+{
+}
+
+bool CircuitBreaker::allowRequest(qint64 now)
+{
+    switch (m_state) {
+        case Closed:
+            return true;
+        case Open:
+            if (now < m_retryAt) {
+                return false;
+            }
+            m_state = HalfOpen;
+            return true;
+        case HalfOpen:
+            return false;
+    }
+    return false;
+}
+
+bool CircuitBreaker::recordSuccess()
+{
+    const bool wasOpen = m_state != Closed;
+    reset();
+    return wasOpen;
+}
+
+bool CircuitBreaker::recordHealthCheckSuccess()
+{
+    if (m_state == Closed) {
+        return false;
+    }
+    m_state = Closed;
+    m_failures = 0;
+    m_retryAt = 0;
+    return true;
+}
+
+bool CircuitBreaker::recordFailure(qint64 now)
+{
+    m_failures++;
+    if (m_state == Open || (m_state == Closed && m_failures < FAILURE_THRESHOLD)) {
+        return false;
+    }
+
+    // Equal jitter: half the backoff fixed, the other half random
+    const qint64 backoff = qMin(qint64(MAX_BACKOFF_MS), qint64(BASE_BACKOFF_MS) << qMin(m_opens, 16));
+    m_retryAt = now + backoff / 2 + QRandomGenerator::global()->bounded(int(backoff / 2) + 1);
+    m_opens++;
+    m_state = Open;
+    return true;
+}
+
+void CircuitBreaker::retryNow(qint64 now)
+{
+    if (m_state == Open) {
+        m_retryAt = qMin(m_retryAt, now);
+    }
+}
+
+void CircuitBreaker::cancelProbe()
+{
+    // Back to open with the retry time already passed, so the next request is the probe
+    if (m_state == HalfOpen) {
+        m_state = Open;
+    }
+}
+
+void CircuitBreaker::reset()
+{
+    m_state = Closed;
+    m_failures = 0;
+    m_opens = 0;
+    m_retryAt = 0;
+}
@@ -0,0 +1,178 @@
+#include "DeviceSignatures.h"
+#include <climits>
+#include <iterator>
+
+namespace {
+// Brands in priority order: when keywords of several brands occur, the first wins.
+// Keywords are matched case-insensitively anywhere in the text.
+struct BrandSignature {
+    const char* brand;
+    const char* keywords;       // Any source, '|'-separated
+    const char* httpKeywords;   // HTTP responses only
+};
+
+const BrandSignature BRAND_SIGNATURES[] = {
+    {"Hikvision", "hikvision|hik-connect|webrec.htm", "server: app-webs/|ds-|/psia/"},
+    {"CP Plus",   "cp plus|cpplus|cp-plus|aditya",    "guard|realmonitor"},
+    {"Dahua",     "dahua",                            ""},
+    {"Axis",      "axis",                             ""},
+    {"Vivotek",   "vivotek",                          ""},
+    {"Foscam",    "foscam",                           ""},
+    {"ACTi",      "",                                 "acti"},
+    {"Bosch",     "",                                 "bosch"},
+    {"Panasonic", "",                                 "panasonic"},
+    {"Sony",      "",                                 "sony"},
+};
+
+// Model and name expressions, each run only when its keyword occurs in the body
+struct ExtractorSignature {
+    const char* brand;          // nullptr: any brand without an expression of its own
+    const char* keyword;
+    const char* pattern;
+    bool caseInsensitive;
+    const char* fallback;
+};
+
+const ExtractorSignature MODEL_SIGNATURES[] = {
+    {"Hikvision", "ds-",   R"((DS-\w+[\w-]*))",                          false, "Hikvision Camera"},
+    {"CP Plus",   "cp-",   R"((CP-[\w-]+))",                             false, "CP Plus Camera"},
+    {nullptr,     "model", R"(model["\s]*[:=]["\s]*([^"<>\s]+))",        true,  nullptr},
+};
+
+const ExtractorSignature NAME_SIGNATURES[] = {
+    {nullptr, "<title", R"(<title[^>]*>([^<]+)</title>)",                          true, nullptr},
+    {nullptr, "device", R"(device[_\s]*name["\s]*[:=]["\s]*([^"<>\s]+))",          true, nullptr},
+};
+}
+
+const DeviceSignatures& DeviceSignatures::instance()
+{
+    static const DeviceSignatures signatures;
+    return signatures;
+}
+
+DeviceSignatures::DeviceSignatures()
+{
+    for (const BrandSignature& signature : BRAND_SIGNATURES) {
+        const int brand = m_brands.size();
+        m_brands.append(QString::fromLatin1(signature.brand));
+
+        for (int httpOnly = 0; httpOnly < 2; ++httpOnly) {
+            const QByteArray list(httpOnly ? signature.httpKeywords : signature.keywords);
+            for (const QByteArray& keyword : list.split('|')) {
+                if (keyword.isEmpty()) {
+                    continue;
+                }
+                const int id = addKeyword(keyword);
+                m_keywords[id].brand = brand;
+                m_keywords[id].httpOnly = httpOnly != 0;
+            }
+        }
+    }
+
+    auto addExtractors = [this](const ExtractorSignature* signatures, int count, QVector<Extractor>& extractors) {
+        for (int i = 0; i < count; ++i) {
+            const ExtractorSignature& signature = signatures[i];
+            Extractor extractor;
+            extractor.keyword = addKeyword(signature.keyword);
+            extractor.expression = QRegularExpression(QString::fromLatin1(signature.pattern),
+                signature.caseInsensitive ? QRegularExpression::CaseInsensitiveOption
+                                          : QRegularExpression::NoPatternOption);
+            extractor.expression.optimize();
+            extractor.brand = signature.brand ? int(m_brands.indexOf(QString::fromLatin1(signature.brand))) : -1;
+            extractor.fallback = signature.fallback ? QString::fromLatin1(signature.fallback) : QString();
+            extractors.append(extractor);
+        }
+    };
+    addExtractors(MODEL_SIGNATURES, int(std::size(MODEL_SIGNATURES)), m_modelExtractors);
+    addExtractors(NAME_SIGNATURES, int(std::size(NAME_SIGNATURES)), m_nameExtractors);
+
+    m_matcher.build();
+}
+
+int DeviceSignatures::addKeyword(const QByteArray& keyword)
+{
+    // A keyword can both name a brand and gate an expression ("ds-")
+    for (int id = 0; id < m_matcher.patternCount(); ++id) {
+        if (m_keywords.at(id).keyword == keyword) {
+            return id;
+        }
+    }
+    m_keywords.append(BrandKeyword{-1, false, keyword});
+    return m_matcher.addPattern(keyword);
+}
+
+int DeviceSignatures::brandFor(const MultiPatternMatcher::Matches& matches, Source source) const
+{
+    int best = INT_MAX;
+    for (int id = 0; id < m_keywords.size(); ++id) {
+        const BrandKeyword& keyword = m_keywords.at(id);
+        if (matches.test(id) && keyword.brand >= 0 && (source == HttpResponse || !keyword.httpOnly)) {
+            best = qMin(best, keyword.brand);
+        }
+    }
+    return best == INT_MAX ? -1 : best;
+}
+
+QString DeviceSignatures::brand(const QByteArray& text, Source source) const
+{
+    int brand = brandFor(m_matcher.scan(text), source);
+    return brand < 0 ? QString("Generic") : m_brands.at(brand);
+}
+
+DeviceIdentity DeviceSignatures::identifyHttp(const QByteArray& body, const QByteArray& headers) const
+{
+    // One pass over body and headers; expressions only look at the body
+    MultiPatternMatcher::Matches bodyMatches;
+    int state = m_matcher.scan(body.constData(), body.size(), 0, bodyMatches);
+    MultiPatternMatcher::Matches allMatches = bodyMatches;
+    state = m_matcher.scan(" ", 1, state, allMatches);
+    m_matcher.scan(headers.constData(), headers.size(), state, allMatches);
+
+    DeviceIdentity identity;
+    const int brand = brandFor(allMatches, HttpResponse);
+    identity.brand = brand < 0 ? QString("Generic") : m_brands.at(brand);
+
+    // Decoded only if some expression has to run
+    QString text;
+    bool decoded = false;
+    auto capture = [&](const Extractor& extractor) {
+        if (!bodyMatches.test(extractor.keyword)) {
+            return QString();
+        }
+        if (!decoded) {
+            text = QString::fromUtf8(body);
+            decoded = true;
+        }
+        QRegularExpressionMatch match = extractor.expression.match(text);
+        return match.hasMatch() ? match.captured(1).trimmed() : QString();
+    };
+
+    // A brand with its own model expression never falls back to the generic one
+    const Extractor* modelExtractor = nullptr;
+    for (const Extractor& extractor : m_modelExtractors) {
+        if (extractor.brand == brand || (extractor.brand < 0 && !modelExtractor)) {
+            modelExtractor = &extractor;
+            if (extractor.brand == brand) {
+                break;
+            }
+        }
+    }
+    identity.model = modelExtractor ? capture(*modelExtractor) : QString();
+    if (identity.model.isEmpty()) {
+        identity.model = (modelExtractor && !modelExtractor->fallback.isEmpty()) ? modelExtractor->fallback
+                                                                                 : QString("Unknown");
+    }
+
+    for (const Extractor& extractor : m_nameExtractors) {
+        QString name = capture(extractor);
+        if (!name.isEmpty() && name != "Document") {
+            identity.deviceName = name;
+            break;
+        }
+    }
+    if (identity.deviceName.isEmpty()) {
+        identity.deviceName = QString("Camera_%1").arg(QString::fromLatin1(body.left(4).toHex()));
+    }
+    return identity;
+}
@@ -0,0 +1,166 @@
+#include "DiscoveryCache.h"
+#include "CameraDiscovery.h"
+#include "Logger.h"
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <algorithm>
+
+DiscoveryCache::DiscoveryCache(const QString& filePath)
+    : m_filePath(filePath)
+{
+}
+
+QString DiscoveryCache::defaultFilePath()
+{
+    QString appDataPath = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
+    return appDataPath + "/discovery_cache.dat";
+}
+
+bool DiscoveryCache::load()
+{
+    m_entries.clear();
+
+    QFile file(m_filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    quint32 count = 0;
+    in >> magic >> version >> count;
+    if (magic != FILE_MAGIC || version != FILE_VERSION || count > quint32(MAX_ENTRIES)) {
+        LOG_WARNING(QString("Ignoring discovery cache %1: unknown format").arg(m_filePath), "DiscoveryCache");
+        return false;
+    }
+
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        Entry entry;
+        in >> entry.address >> entry.macAddress >> entry.port >> entry.openPorts
+           >> entry.brand >> entry.model >> entry.deviceName >> entry.rtspUrl >> entry.rtspVerified
+           >> entry.videoCodec >> entry.videoWidth >> entry.videoHeight >> entry.lastSeen >> entry.rttMs;
+        if (in.status() == QDataStream::Ok) {
+            m_entries.insert(entry.address, entry);
+        }
+    }
+
+    if (in.status() != QDataStream::Ok) {
+        LOG_WARNING(QString("Discovery cache %1 is truncated; keeping %2 entries")
+                    .arg(m_filePath).arg(m_entries.size()), "DiscoveryCache");
+    }
+    return true;
+}
+
+bool DiscoveryCache::save() const
+{
+    QDir().mkpath(QFileInfo(m_filePath).absolutePath());
+
+    QSaveFile file(m_filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        LOG_WARNING(QString("Cannot write discovery cache %1: %2").arg(m_filePath, file.errorString()),
+                    "DiscoveryCache");
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << FILE_MAGIC << FILE_VERSION << quint32(m_entries.size());
+    for (const Entry& entry : m_entries) {
+        out << entry.address << entry.macAddress << entry.port << entry.openPorts
+            << entry.brand << entry.model << entry.deviceName << entry.rtspUrl << entry.rtspVerified
+            << entry.videoCodec << entry.videoWidth << entry.videoHeight << entry.lastSeen << entry.rttMs;
+    }
+    return file.commit();
+}
+
+void DiscoveryCache::update(const DiscoveredCamera& camera, qint64 seenAt)
+{
+    const quint32 address = QHostAddress(camera.ipAddress).toIPv4Address();
+    if (address == 0) {
+        return;
+    }
+
+    Entry entry;
+    entry.address = address;
+    bool ok = false;
+    entry.macAddress = CameraDiscovery::normalizeMacAddress(camera.macAddress).remove(':').toULongLong(&ok, 16);
+    if (!ok) {
+        entry.macAddress = 0;
+    }
+    entry.port = quint16(camera.port);
+    for (const QString& port : camera.supportedPorts) {
+        entry.openPorts.append(quint16(port.toUInt()));
+    }
+    entry.brand = camera.brand;
+    entry.model = camera.model;
+    entry.deviceName = camera.deviceName;
+    entry.rtspUrl = camera.rtspUrl;
+    entry.rtspVerified = camera.rtspVerified;
+    entry.videoCodec = camera.videoCodec;
+    entry.videoWidth = quint16(qBound(0, camera.videoWidth, 65535));
+    entry.videoHeight = quint16(qBound(0, camera.videoHeight, 65535));
+    entry.lastSeen = seenAt;
+    entry.rttMs = camera.responseTime;
+    auto previous = m_entries.constFind(address);
+    if (entry.rttMs < 0 && previous != m_entries.constEnd()) {
+        entry.rttMs = previous.value().rttMs;
+    }
+    m_entries.insert(address, entry);
+
+    // Beyond the cap, the entries seen longest ago go first
+    if (m_entries.size() > MAX_ENTRIES) {
+        auto oldest = std::min_element(m_entries.begin(), m_entries.end(), [](const Entry& a, const Entry& b) {
+            return a.lastSeen < b.lastSeen;
+        });
+        m_entries.erase(oldest);
+    }
+}
+
+int DiscoveryCache::expire(qint64 now, qint64 maxAgeMs)
+{
+    int dropped = 0;
+    for (auto it = m_entries.begin(); it != m_entries.end(); ) {
+        if (now - it.value().lastSeen > maxAgeMs) {
+            it = m_entries.erase(it);
+            dropped++;
+        } else {
+            ++it;
+        }
+    }
+    return dropped;
+}
+
+QList<DiscoveredCamera> DiscoveryCache::cameras() const
+{
+    QList<DiscoveredCamera> cameras;
+    for (const Entry& entry : m_entries) {
+        DiscoveredCamera camera;
+        camera.ipAddress = QHostAddress(entry.address).toString();
+        camera.port = entry.port;
+        if (entry.macAddress != 0) {
+            camera.macAddress = CameraDiscovery::normalizeMacAddress(
+                QString("%1").arg(entry.macAddress, 12, 16, QChar('0')));
+        }
+        for (quint16 port : entry.openPorts) {
+            camera.supportedPorts.append(QString::number(port));
+        }
+        camera.brand = entry.brand;
+        camera.model = entry.model;
+        camera.deviceName = entry.deviceName;
+        camera.rtspUrl = entry.rtspUrl;
+        camera.rtspVerified = entry.rtspVerified;
+        camera.videoCodec = entry.videoCodec;
+        camera.videoWidth = entry.videoWidth;
+        camera.videoHeight = entry.videoHeight;
+        camera.responseTime = entry.rttMs;
+        cameras.append(camera);
+    }
+    return cameras;
+}
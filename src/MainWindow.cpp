@@ -6,6 +6,7 @@
 #include "VpnWidget.h"
 #include "UserProfileWidget.h"
 #include "NetworkInterfaceManager.h"
+#include "CameraApiService.h"
 #include "EchoServer.h"
 #include "PingResponder.h"
 #include "CameraPreviewWidget.h"
@@ -41,6 +42,11 @@
 #include <QListWidget>
 #include <QClipboard>
 #include <QScrollArea>
+#include <QUrl>
+#include <QFile>
+#include <QFileDialog>
+#include <QJsonDocument>
+#include <QDateTime>
 
 Q_DECLARE_METATYPE(DiscoveredCamera)
 
@@ -179,6 +185,9 @@ private:    void setupUI()
         
         m_enabledCheckBox = new QCheckBox(contentWidget);
         m_enabledCheckBox->setChecked(true);
+        
+        m_adaptiveSubstreamCheckBox = new QCheckBox("Switch to substream when bandwidth is short", contentWidget);
+        m_adaptiveSubstreamCheckBox->setToolTip("Relay the camera's lower-resolution substream while the main stream cannot keep up");
           layout->addRow("Camera Name:", m_nameEdit);
         layout->addRow("IP Address:", m_ipEdit);
         layout->addRow("Port:", m_portSpinBox);
@@ -187,6 +196,7 @@ private:    void setupUI()
         layout->addRow("Model:", m_modelEdit);
         layout->addRow(credentialsGroup);
         layout->addRow("Enabled:", m_enabledCheckBox);
+        layout->addRow("Adaptive Stream:", m_adaptiveSubstreamCheckBox);
         
         // RTSP URL preview
         m_rtspPreviewGroup = new QGroupBox("RTSP URL Preview", contentWidget);
@@ -235,6 +245,7 @@ private:    void setupUI()
         m_usernameEdit->setText(m_camera.username());
         m_passwordEdit->setText(m_camera.password());
         m_enabledCheckBox->setChecked(m_camera.isEnabled());
+        m_adaptiveSubstreamCheckBox->setChecked(m_camera.adaptiveSubstream());
         
         // Update RTSP preview after loading
         updateRtspPreview();
@@ -250,6 +261,7 @@ private:    void setupUI()
         m_camera.setUsername(m_usernameEdit->text().trimmed());
         m_camera.setPassword(m_passwordEdit->text());
         m_camera.setEnabled(m_enabledCheckBox->isChecked());
+        m_camera.setAdaptiveSubstream(m_adaptiveSubstreamCheckBox->isChecked());
     }CameraConfig m_camera;
     QLineEdit* m_nameEdit;
     QLineEdit* m_ipEdit;
@@ -261,6 +273,7 @@ private:    void setupUI()
     QLineEdit* m_usernameEdit;
     QLineEdit* m_passwordEdit;
     QCheckBox* m_enabledCheckBox;
+    QCheckBox* m_adaptiveSubstreamCheckBox;
     
     // UI enhancement elements
     QPushButton* m_passwordVisibilityButton;
@@ -836,6 +849,8 @@ public:
     }
     
     QList<DiscoveredCamera> getSelectedCameras() const { return m_selectedCameras; }
+    QString username() const { return m_usernameEdit->text().trimmed(); }
+    QString password() const { return m_passwordEdit->text(); }
 
 private slots:
     void startDiscovery()
@@ -844,6 +859,7 @@ private slots:
         
         m_isScanning = true;
         m_discoveredCamerasWidget->clear();
+        m_cameraItems.clear();
         m_selectedCameras.clear();
         m_progressBar->setValue(0);
         m_progressBar->setVisible(true);
@@ -857,9 +873,33 @@ private slots:
             m_networkEdit->setText(networkRange);
         }
         
+        QString rangeError;
+        if (!CameraDiscovery::validateNetworkRange(networkRange, &rangeError)) {
+            m_isScanning = false;
+            m_progressBar->setVisible(false);
+            m_statusLabel->setText(QString("Invalid range: %1").arg(rangeError));
+            m_scanButton->setText("Start Scan");
+            return;
+        }
+        
+        m_resumeButton->setVisible(false);
+        m_discovery->setRtspCredentials(username(), password());
         m_discovery->startDiscovery(networkRange);
     }
     
+    void resumeDiscovery()
+    {
+        if (m_isScanning || !m_discovery->canResume()) return;
+        
+        m_isScanning = true;
+        m_resumeButton->setVisible(false);
+        m_progressBar->setVisible(true);
+        m_statusLabel->setText("Resuming scan...");
+        m_scanButton->setText("Stop Scan");
+        m_discovery->setRtspCredentials(username(), password());
+        m_discovery->resumeDiscovery();
+    }
+    
     void stopDiscovery()
     {
         if (!m_isScanning) return;
@@ -869,6 +909,7 @@ private slots:
         m_progressBar->setVisible(false);
         m_statusLabel->setText("Scan stopped");
         m_scanButton->setText("Start Scan");
+        m_resumeButton->setVisible(m_discovery->canResume());
     }
     
     void onDiscoveryStarted()
@@ -881,9 +922,14 @@ private slots:
     {
         m_isScanning = false;
         m_progressBar->setVisible(false);
-        m_statusLabel->setText(QString("Scan completed. Found %1 cameras.").arg(m_discoveredCamerasWidget->count()));
+        QString summary = QString("Scan completed. Found %1 cameras.").arg(m_discoveredCamerasWidget->count());
+        if (m_discovery->timeToFirstCamera() >= 0) {
+            summary += QString(" First after %1 s.").arg(m_discovery->timeToFirstCamera() / 1000.0, 0, 'f', 1);
+        }
+        m_statusLabel->setText(summary);
         m_scanButton->setText("Start Scan");
         m_scanButton->setEnabled(true);
+        m_resumeButton->setVisible(m_discovery->canResume());
     }
     
     void onDiscoveryProgress(int current, int total)
@@ -891,8 +937,8 @@ private slots:
         if (total > 0) {
             int percentage = (current * 100) / total;
             m_progressBar->setValue(percentage);
-            m_statusLabel->setText(QString("Scanning... %1/%2 (%3%)")
-                                   .arg(current).arg(total).arg(percentage));
+            m_statusLabel->setText(QString("Scanning... %1/%2 (%3%) - %4 found")
+                                   .arg(current).arg(total).arg(percentage).arg(m_discoveredCamerasWidget->count()));
         }
     }
     
@@ -901,6 +947,16 @@ private slots:
         addCameraToList(camera);
     }
     
+    void onCameraUpdated(const DiscoveredCamera& camera)
+    {
+        QListWidgetItem* item = m_cameraItems.value(camera.ipAddress);
+        if (item) {
+            updateCameraItem(item, camera);
+        } else {
+            addCameraToList(camera);
+        }
+    }
+    
     void onSelectionChanged()
     {
         m_selectedCameras.clear();
@@ -942,9 +998,22 @@ private:
         
         m_networkEdit = new QLineEdit(this);
         m_networkEdit->setText(CameraDiscovery::detectNetworkRange());
-        m_networkEdit->setPlaceholderText("e.g., 192.168.1.0/24");
+        m_networkEdit->setPlaceholderText("e.g., 192.168.1.0/24, 10.0.0.0/22, !10.0.1.0/28");
+        m_networkEdit->setToolTip("Comma-separated CIDR blocks, address ranges (a.b.c.d-a.b.c.e) or single addresses.\n"
+                                  "Prefix an entry with ! to exclude it.");
         networkLayout->addRow("Network Range:", m_networkEdit);
         
+        // Used to try the candidate RTSP paths on each camera found
+        m_usernameEdit = new QLineEdit(this);
+        m_usernameEdit->setText("admin");
+        m_usernameEdit->setToolTip("Camera login used to verify RTSP stream URLs during the scan");
+        networkLayout->addRow("Camera Username:", m_usernameEdit);
+        
+        m_passwordEdit = new QLineEdit(this);
+        m_passwordEdit->setEchoMode(QLineEdit::Password);
+        m_passwordEdit->setPlaceholderText("Leave empty to only find streams that need no login");
+        networkLayout->addRow("Camera Password:", m_passwordEdit);
+        
         mainLayout->addWidget(networkGroup);
         
         // Control buttons
@@ -959,6 +1028,11 @@ private:
         });
         controlLayout->addWidget(m_scanButton);
         
+        m_resumeButton = new QPushButton("Resume Scan", this);
+        m_resumeButton->setVisible(false);
+        connect(m_resumeButton, &QPushButton::clicked, this, [this]() { resumeDiscovery(); });
+        controlLayout->addWidget(m_resumeButton);
+        
         m_statusLabel = new QLabel("Ready to scan", this);
         controlLayout->addWidget(m_statusLabel);
         controlLayout->addStretch();
@@ -1009,6 +1083,7 @@ private:
         connect(m_discovery, &CameraDiscovery::discoveryFinished, this, &CameraDiscoveryDialog::onDiscoveryFinished);
         connect(m_discovery, &CameraDiscovery::discoveryProgress, this, &CameraDiscoveryDialog::onDiscoveryProgress);
         connect(m_discovery, &CameraDiscovery::cameraDiscovered, this, &CameraDiscoveryDialog::onCameraDiscovered);
+        connect(m_discovery, &CameraDiscovery::cameraUpdated, this, &CameraDiscoveryDialog::onCameraUpdated);
     }
     
     void addCameraToList(const DiscoveredCamera& camera)
@@ -1016,7 +1091,14 @@ private:
         QListWidgetItem* item = new QListWidgetItem(m_discoveredCamerasWidget);
         item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
         item->setCheckState(Qt::Unchecked);
+        updateCameraItem(item, camera);
         
+        m_cameraItems.insert(camera.ipAddress, item);
+        m_discoveredCamerasWidget->addItem(item);
+    }
+    
+    void updateCameraItem(QListWidgetItem* item, const DiscoveredCamera& camera)
+    {
         // Create display text with brand, IP, and model info
         QString displayText = QString("[%1] %2:%3")
                               .arg(camera.brand, camera.ipAddress).arg(camera.port);
@@ -1031,6 +1113,22 @@ private:
         
         // Add RTSP URL hint
         displayText += QString("\nRTSP: %1").arg(camera.rtspUrl);
+        if (camera.rtspVerified) {
+            displayText += QString(" (verified");
+            if (!camera.videoCodec.isEmpty()) {
+                displayText += QString(", %1").arg(camera.videoCodec);
+            }
+            if (camera.videoWidth > 0) {
+                displayText += QString(" %1x%2").arg(camera.videoWidth).arg(camera.videoHeight);
+            }
+            displayText += ")";
+        }
+        if (!camera.macAddress.isEmpty()) {
+            displayText += QString("  MAC: %1").arg(camera.macAddress);
+        }
+        if (camera.responseTime >= 0) {
+            displayText += QString("  RTT: %1 ms").arg(camera.responseTime);
+        }
         
         item->setText(displayText);
         
@@ -1045,8 +1143,6 @@ private:
         
         // Store camera data
         item->setData(Qt::UserRole, QVariant::fromValue(camera));
-        
-        m_discoveredCamerasWidget->addItem(item);
     }
 
 private:
@@ -1056,10 +1152,14 @@ private:
     
     // UI elements
     QLineEdit* m_networkEdit;
+    QLineEdit* m_usernameEdit;
+    QLineEdit* m_passwordEdit;
     QPushButton* m_scanButton;
+    QPushButton* m_resumeButton;
     QLabel* m_statusLabel;
     QProgressBar* m_progressBar;
     QListWidget* m_discoveredCamerasWidget;
+    QHash<QString, QListWidgetItem*> m_cameraItems;   // IP -> list entry, refined as probes answer
     QLabel* m_selectedCountLabel;
     QPushButton* m_addSelectedButton;
 };
@@ -1168,6 +1268,9 @@ MainWindow::MainWindow(QWidget *parent)
     if (m_cameraManager->getPortForwarder()) {
         m_cameraManager->getPortForwarder()->setNetworkInterfaceManager(m_networkManager);
     }
+    if (m_cameraManager->getApiService()) {
+        m_cameraManager->getApiService()->setNetworkInterfaceManager(m_networkManager);
+    }
     
     // Start network interface monitoring
     LOG_INFO("Starting network interface monitoring...", "MainWindow");
@@ -1475,13 +1578,20 @@ void MainWindow::discoverCameras()
             
             camera.setName(cameraName);
             camera.setIpAddress(discoveredCamera.ipAddress);
-            camera.setPort(discoveredCamera.port == 80 ? 554 : discoveredCamera.port); // Default to RTSP port
+            if (discoveredCamera.rtspVerified) {
+                camera.setPort(QUrl(discoveredCamera.rtspUrl).port(554));
+            } else {
+                camera.setPort(discoveredCamera.port == 80 ? 554 : discoveredCamera.port); // Default to RTSP port
+            }
             camera.setBrand(discoveredCamera.brand);
             camera.setModel(discoveredCamera.model);
             camera.setEnabled(true);
             
-            // Set default credentials based on brand
-            if (discoveredCamera.brand == "Hikvision") {
+            // The login the scan verified the stream with, else defaults based on brand
+            if (!dialog.username().isEmpty()) {
+                camera.setUsername(dialog.username());
+                camera.setPassword(dialog.password());
+            } else if (discoveredCamera.brand == "Hikvision") {
                 camera.setUsername("admin");
                 camera.setPassword("admin");
             } else if (discoveredCamera.brand == "CP Plus") {
@@ -1506,9 +1616,9 @@ void MainWindow::discoverCameras()
         
         if (addedCount > 0) {
             // Show a message with RTSP URL information
-            QString rtspInfo = "Discovered cameras have been added with suggested RTSP URLs:\n\n";
+            QString rtspInfo = "Discovered cameras have been added with these RTSP URLs:\n\n";
             for (const DiscoveredCamera& cam : selectedCameras) {
-                rtspInfo += QString("• %1: %2\n").arg(cam.brand, cam.rtspUrl);
+                rtspInfo += QString("• %1: %2%3\n").arg(cam.brand, cam.rtspUrl, cam.rtspVerified ? "" : " (suggested)");
             }
             rtspInfo += "\nYou may need to adjust usernames, passwords, and RTSP paths for your specific cameras.";
             
@@ -1642,6 +1752,29 @@ void MainWindow::showAbout()
                       "• Comprehensive logging");
 }
 
+void MainWindow::exportStatistics()
+{
+    QString fileName = QFileDialog::getSaveFileName(this, "Export Statistics",
+                                                    QString("visco-connect-stats-%1.json")
+                                                    .arg(QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss")),
+                                                    "JSON files (*.json)");
+    if (fileName.isEmpty()) {
+        return;
+    }
+    
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+        file.write(QJsonDocument(m_cameraManager->exportStatistics()).toJson()) < 0) {
+        QMessageBox::warning(this, "Visco Connect - Export Failed",
+                             QString("Could not write %1:\n\n%2").arg(fileName, file.errorString()));
+        return;
+    }
+    
+    LOG_INFO(QString("Statistics exported to %1; API requests: %2")
+             .arg(fileName, m_cameraManager->getApiService()->requestStatistics().summary()), "MainWindow");
+    showMessage(QString("Statistics exported to %1").arg(fileName));
+}
+
 void MainWindow::onCameraSelectionChanged()
 {
     updateButtons();
@@ -1721,8 +1854,14 @@ void MainWindow::refreshConnectionStatistics()
             dataItem->setText(dataTransferred);
         }
         
+        // Update stream estimate (column 9)
+        QTableWidgetItem* streamItem = m_cameraTable->item(i, 9);
+        if (streamItem) {
+            updateStreamItem(streamItem, cameraId, isRunning);
+        }
+        
         // Update action buttons state
-        QWidget* actionWidget = m_cameraTable->cellWidget(i, 10);
+        QWidget* actionWidget = m_cameraTable->cellWidget(i, 11);
         if (actionWidget) {
             // Find the start/stop button and update its state
             QPushButton* startStopBtn = actionWidget->findChild<QPushButton*>();
@@ -1885,6 +2024,11 @@ void MainWindow::createMenuBar()
     // File menu
     m_fileMenu = menuBar()->addMenu("&File");
     
+    m_exportStatisticsAction = new QAction("Export &Statistics...", this);
+    connect(m_exportStatisticsAction, &QAction::triggered, this, &MainWindow::exportStatistics);
+    m_fileMenu->addAction(m_exportStatisticsAction);
+    m_fileMenu->addSeparator();
+    
     m_exitAction = new QAction("E&xit", this);
     m_exitAction->setShortcut(QKeySequence::Quit);
     connect(m_exitAction, &QAction::triggered, this, &QWidget::close);
@@ -1966,8 +2110,8 @@ void MainWindow::createCentralWidget()
     // Camera management group
     m_cameraGroupBox = new QGroupBox("Camera Configuration");
     QVBoxLayout* cameraLayout = new QVBoxLayout(m_cameraGroupBox);    // Camera table
-    m_cameraTable = new QTableWidget(0, 11);
-    QStringList headers = {"#", "Name", "Brand", "Model", "IP Address", "Port", "External Port", "Status", "Data Transferred", "Preview", "Actions"};
+    m_cameraTable = new QTableWidget(0, 12);
+    QStringList headers = {"#", "Name", "Brand", "Model", "IP Address", "Port", "External Port", "Status", "Data Transferred", "Stream", "Preview", "Actions"};
     m_cameraTable->setHorizontalHeaderLabels(headers);
     m_cameraTable->setSelectionBehavior(QAbstractItemView::SelectRows);
     m_cameraTable->setAlternatingRowColors(true);
@@ -1982,7 +2126,8 @@ void MainWindow::createCentralWidget()
     m_cameraTable->setColumnWidth(6, 90);   // External Port
     m_cameraTable->setColumnWidth(7, 80);   // Status
     m_cameraTable->setColumnWidth(8, 120);  // Data Transferred
-    m_cameraTable->setColumnWidth(9, 80);  // Preview
+    m_cameraTable->setColumnWidth(9, 150);  // Stream
+    m_cameraTable->setColumnWidth(10, 80);  // Preview
     // Actions column will stretch to fill remaining space
     m_cameraTable->horizontalHeader()->setStretchLastSection(true);
     
@@ -2192,6 +2337,48 @@ void MainWindow::setupConnections()
             this, &MainWindow::onLogMessage);
 }
 
+void MainWindow::updateStreamItem(QTableWidgetItem* item, const QString& cameraId, bool isRunning)
+{
+    PortForwarder* forwarder = m_cameraManager->getPortForwarder();
+    StreamEstimate current;
+    if (isRunning && forwarder) {
+        current = forwarder->getStreamEstimate(cameraId, StreamAnalyzer::WindowSecond);
+    }
+    
+    if (current.coveredSeconds <= 0.0 || current.bitsPerSecond == 0) {
+        item->setText("-");
+        item->setToolTip("No video is being relayed");
+        return;
+    }
+    
+    auto formatEstimate = [](const StreamEstimate& estimate) {
+        if (estimate.coveredSeconds <= 0.0) {
+            return QString("collecting...");
+        }
+        QString text = QString("%1 Mbps, %2 fps")
+                       .arg(estimate.bitsPerSecond / 1000000.0, 0, 'f', 2)
+                       .arg(estimate.framesPerSecond, 0, 'f', 1);
+        if (estimate.gopFrames > 0.0) {
+            text += QString(", GOP %1 (%2 s)").arg(estimate.gopFrames, 0, 'f', 0)
+                    .arg(estimate.keyframeIntervalSeconds, 0, 'f', 1);
+        }
+        return text;
+    };
+    
+    // Last minute in the cell, all three windows in the tooltip
+    StreamEstimate minute = forwarder->getStreamEstimate(cameraId, StreamAnalyzer::WindowMinute);
+    StreamEstimate hour = forwarder->getStreamEstimate(cameraId, StreamAnalyzer::WindowHour);
+    QString text = QString("%1 Mbps / %2 fps").arg(minute.bitsPerSecond / 1000000.0, 0, 'f', 1)
+                   .arg(minute.framesPerSecond, 0, 'f', 0);
+    qint64 keyframeMs = forwarder->getKeyframeIntervalMs(cameraId);
+    if (keyframeMs > 0) {
+        text += QString(" / GOP %1 s").arg(keyframeMs / 1000.0, 0, 'f', 1);
+    }
+    item->setText(text);
+    item->setToolTip(QString("Last second: %1\nLast minute: %2\nLast hour: %3")
+                     .arg(formatEstimate(current)).arg(formatEstimate(minute)).arg(formatEstimate(hour)));
+}
+
 void MainWindow::updateCameraTable()
 {
     m_cameraTable->setRowCount(0);
@@ -2277,6 +2464,12 @@ void MainWindow::updateCameraTable()
         dataItem->setTextAlignment(Qt::AlignCenter);
         m_cameraTable->setItem(i, 8, dataItem);
         
+        // Stream column - bitrate, frame rate and GOP measured by the relay
+        QTableWidgetItem* streamItem = new QTableWidgetItem();
+        streamItem->setTextAlignment(Qt::AlignCenter);
+        updateStreamItem(streamItem, camera.id(), isRunning);
+        m_cameraTable->setItem(i, 9, streamItem);
+        
         // Preview column - preview button for each camera
         QWidget* previewWidget = new QWidget();
         QHBoxLayout* previewLayout = new QHBoxLayout(previewWidget);
@@ -2307,7 +2500,7 @@ void MainWindow::updateCameraTable()
         previewLayout->addWidget(previewBtn);
         previewLayout->addStretch();
         
-        m_cameraTable->setCellWidget(i, 9, previewWidget);
+        m_cameraTable->setCellWidget(i, 10, previewWidget);
         
         // Actions column - control buttons for each camera
         // Actions column - control buttons for each camera
@@ -2341,7 +2534,7 @@ void MainWindow::updateCameraTable()
         actionLayout->addWidget(refreshBtn);
         actionLayout->addStretch();
         
-        m_cameraTable->setCellWidget(i, 10, actionWidget);
+        m_cameraTable->setCellWidget(i, 11, actionWidget);
     }
     
     // Resize columns to content
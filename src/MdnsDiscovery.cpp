@@ -0,0 +1,321 @@
+#include "MdnsDiscovery.h"
+#include "Logger.h"
+#include "NetworkInterfaceManager.h"
+#include <QNetworkDatagram>
+#include <QtEndian>
+
+namespace {
+const QLatin1String MULTICAST_ADDRESS("224.0.0.251");
+
+enum RecordType {
+    TypeA = 1,
+    TypePtr = 12,
+    TypeTxt = 16,
+    TypeSrv = 33
+};
+
+quint16 readUInt16(const QByteArray& packet, int offset)
+{
+    return qFromBigEndian<quint16>(reinterpret_cast<const uchar*>(packet.constData()) + offset);
+}
+}
+
+QString MdnsService::displayName() const
+{
+    int dot = instanceName.indexOf('.');
+    return dot > 0 ? instanceName.left(dot) : instanceName;
+}
+
+MdnsDiscovery::MdnsDiscovery(QObject *parent)
+    : QObject(parent)
+    , m_querySocket(nullptr)
+    , m_listenSocket(nullptr)
+    , m_windowTimer(nullptr)
+    , m_serviceCount(0)
+{
+    m_windowTimer = new QTimer(this);
+    m_windowTimer->setSingleShot(true);
+    connect(m_windowTimer, &QTimer::timeout, this, &MdnsDiscovery::onWindowElapsed);
+}
+
+QStringList MdnsDiscovery::cameraServiceTypes()
+{
+    return {"_rtsp._tcp.local", "_axis-video._tcp.local"};
+}
+
+bool MdnsDiscovery::startListening()
+{
+    if (m_listenSocket) {
+        return true;
+    }
+
+    // The system responder (Bonjour, Avahi) owns port 5353 as well
+    m_listenSocket = new QUdpSocket(this);
+    if (!m_listenSocket->bind(QHostAddress::AnyIPv4, MDNS_PORT,
+                              QAbstractSocket::ShareAddress | QAbstractSocket::ReuseAddressHint)) {
+        LOG_WARNING(QString("Cannot listen for mDNS announcements: %1").arg(m_listenSocket->errorString()),
+                    "MdnsDiscovery");
+        m_listenSocket->deleteLater();
+        m_listenSocket = nullptr;
+        return false;
+    }
+
+    const QHostAddress group{QString(MULTICAST_ADDRESS)};
+    int joined = 0;
+    for (const QNetworkInterface& interface : NetworkInterfaceManager::getMulticastInterfaces()) {
+        if (m_listenSocket->joinMulticastGroup(group, interface)) {
+            joined++;
+        }
+    }
+    if (joined == 0 && !m_listenSocket->joinMulticastGroup(group)) {
+        LOG_WARNING("Cannot join the mDNS multicast group", "MdnsDiscovery");
+    }
+
+    connect(m_listenSocket, &QUdpSocket::readyRead, this, &MdnsDiscovery::readDatagrams);
+    LOG_INFO(QString("Listening for mDNS announcements on %1 interface(s)").arg(joined), "MdnsDiscovery");
+    return true;
+}
+
+void MdnsDiscovery::query(int windowMs)
+{
+    if (!m_querySocket) {
+        m_querySocket = new QUdpSocket(this);
+        if (!m_querySocket->bind(QHostAddress::AnyIPv4, 0)) {
+            LOG_WARNING(QString("Cannot open mDNS query socket: %1").arg(m_querySocket->errorString()),
+                        "MdnsDiscovery");
+            m_querySocket->deleteLater();
+            m_querySocket = nullptr;
+            return;
+        }
+        m_querySocket->setSocketOption(QAbstractSocket::MulticastTtlOption, 255);
+        connect(m_querySocket, &QUdpSocket::readyRead, this, &MdnsDiscovery::readDatagrams);
+    }
+
+    m_seenInstances.clear();
+    m_serviceCount = 0;
+
+    const QByteArray payload = buildQuery(cameraServiceTypes());
+    const QHostAddress group{QString(MULTICAST_ADDRESS)};
+    const QList<QNetworkInterface> interfaces = NetworkInterfaceManager::getMulticastInterfaces();
+    for (const QNetworkInterface& interface : interfaces) {
+        m_querySocket->setMulticastInterface(interface);
+        m_querySocket->writeDatagram(payload, group, MDNS_PORT);
+    }
+    if (interfaces.isEmpty()) {
+        m_querySocket->writeDatagram(payload, group, MDNS_PORT);
+    }
+    m_windowTimer->start(windowMs);
+}
+
+void MdnsDiscovery::stop()
+{
+    m_windowTimer->stop();
+    if (m_querySocket) {
+        m_querySocket->close();
+        m_querySocket->deleteLater();
+        m_querySocket = nullptr;
+    }
+}
+
+bool MdnsDiscovery::isActive() const
+{
+    return m_windowTimer->isActive();
+}
+
+void MdnsDiscovery::readDatagrams()
+{
+    QUdpSocket* socket = qobject_cast<QUdpSocket*>(sender());
+    const QStringList serviceTypes = cameraServiceTypes();
+
+    while (socket && socket->hasPendingDatagrams()) {
+        QNetworkDatagram datagram = socket->receiveDatagram(MAX_DATAGRAM_SIZE);
+        if (!datagram.isValid()) {
+            continue;
+        }
+
+        // The listener hears every service on the segment; only camera types are of interest
+        for (const MdnsService& service : parseResponse(datagram.data(), datagram.senderAddress())) {
+            if (!serviceTypes.contains(service.serviceType, Qt::CaseInsensitive)) {
+                continue;
+            }
+            QString key = service.instanceName.toLower();
+            if (m_seenInstances.contains(key)) {
+                continue;
+            }
+            m_seenInstances.insert(key);
+            m_serviceCount++;
+            emit serviceFound(service);
+        }
+    }
+}
+
+void MdnsDiscovery::onWindowElapsed()
+{
+    stop();
+    LOG_INFO(QString("mDNS query finished, %1 camera service(s) answered").arg(m_serviceCount), "MdnsDiscovery");
+    emit finished(m_serviceCount);
+}
+
+QByteArray MdnsDiscovery::buildQuery(const QStringList& serviceTypes)
+{
+    QByteArray packet(12, '\0');
+    qToBigEndian<quint16>(quint16(serviceTypes.size()), reinterpret_cast<uchar*>(packet.data()) + 4);
+
+    for (const QString& serviceType : serviceTypes) {
+        for (const QString& label : serviceType.split('.', Qt::SkipEmptyParts)) {
+            QByteArray bytes = label.toUtf8().left(63);
+            packet.append(char(bytes.size()));
+            packet.append(bytes);
+        }
+        packet.append('\0');
+
+        uchar tail[4];
+        qToBigEndian<quint16>(TypePtr, tail);
+        qToBigEndian<quint16>(1, tail + 2);     // IN
+        packet.append(reinterpret_cast<const char*>(tail), 4);
+    }
+    return packet;
+}
+
+bool MdnsDiscovery::readName(const QByteArray& packet, int& offset, QString& name)
+{
+    // Labels, possibly ending in a compression pointer to an earlier name
+    QStringList labels;
+    int position = offset;
+    int end = -1;
+    int jumps = 0;
+
+    while (true) {
+        if (position >= packet.size()) {
+            return false;
+        }
+        const quint8 length = quint8(packet.at(position));
+        if (length == 0) {
+            position++;
+            break;
+        }
+        if ((length & 0xC0) == 0xC0) {
+            if (position + 1 >= packet.size() || ++jumps > 16) {
+                return false;
+            }
+            if (end < 0) {
+                end = position + 2;
+            }
+            position = readUInt16(packet, position) & 0x3FFF;
+            continue;
+        }
+        if (position + 1 + length > packet.size()) {
+            return false;
+        }
+        labels.append(QString::fromUtf8(packet.constData() + position + 1, length));
+        position += 1 + length;
+    }
+
+    name = labels.join('.');
+    offset = end >= 0 ? end : position;
+    return true;
+}
+
+QList<MdnsService> MdnsDiscovery::parseResponse(const QByteArray& packet, const QHostAddress& sender)
+{
+    QList<MdnsService> services;
+    if (packet.size() < 12 || !(readUInt16(packet, 2) & 0x8000)) {
+        return services;    // Too short, or a question rather than an answer
+    }
+
+    const int questions = readUInt16(packet, 4);
+    const int records = readUInt16(packet, 6) + readUInt16(packet, 8) + readUInt16(packet, 10);
+    int offset = 12;
+    QString name;
+
+    for (int i = 0; i < questions; ++i) {
+        if (!readName(packet, offset, name)) {
+            return services;
+        }
+        offset += 4;
+    }
+
+    // Answers and additional records together describe each instance; names are case-insensitive
+    QStringList instances;
+    QHash<QString, QPair<QString, int>> targets;
+    QHash<QString, QHash<QString, QString>> texts;
+    QHash<QString, QString> addresses;
+
+    for (int i = 0; i < records; ++i) {
+        if (!readName(packet, offset, name) || offset + 10 > packet.size()) {
+            break;
+        }
+        const int type = readUInt16(packet, offset);
+        const int dataLength = readUInt16(packet, offset + 8);
+        const bool goodbye = qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(packet.constData()) + offset + 4) == 0;
+        offset += 10;
+        if (offset + dataLength > packet.size()) {
+            break;
+        }
+
+        const QString key = name.toLower();
+        int dataOffset = offset;
+        QString target;
+        if (goodbye) {
+            // Service going away
+        } else if (type == TypePtr) {
+            if (readName(packet, dataOffset, target) && !instances.contains(target, Qt::CaseInsensitive)) {
+                instances.append(target);
+            }
+        } else if (type == TypeSrv && dataLength >= 6) {
+            const int port = readUInt16(packet, offset + 4);
+            dataOffset += 6;
+            if (readName(packet, dataOffset, target)) {
+                targets.insert(key, qMakePair(target, port));
+            }
+        } else if (type == TypeTxt) {
+            QHash<QString, QString>& entries = texts[key];
+            int position = offset;
+            while (position < offset + dataLength) {
+                const int length = quint8(packet.at(position));
+                if (position + 1 + length > offset + dataLength) {
+                    break;
+                }
+                QString entry = QString::fromUtf8(packet.constData() + position + 1, length);
+                int equals = entry.indexOf('=');
+                if (equals > 0) {
+                    entries.insert(entry.left(equals).toLower(), entry.mid(equals + 1));
+                } else if (!entry.isEmpty()) {
+                    entries.insert(entry.toLower(), QString());
+                }
+                position += 1 + length;
+            }
+        } else if (type == TypeA && dataLength == 4) {
+            addresses.insert(key, QHostAddress(qFromBigEndian<quint32>(
+                reinterpret_cast<const uchar*>(packet.constData()) + offset)).toString());
+        }
+        offset += dataLength;
+    }
+
+    // Instances announced without a PTR still count when their SRV is present
+    for (auto it = targets.constBegin(); it != targets.constEnd(); ++it) {
+        if (!instances.contains(it.key(), Qt::CaseInsensitive)) {
+            instances.append(it.key());
+        }
+    }
+
+    for (const QString& instance : instances) {
+        auto target = targets.constFind(instance.toLower());
+        if (target == targets.constEnd()) {
+            continue;   // Port unknown until the SRV record arrives
+        }
+
+        MdnsService service;
+        service.instanceName = instance;
+        int dot = instance.indexOf('.');
+        service.serviceType = dot > 0 ? instance.mid(dot + 1) : QString();
+        service.hostName = target.value().first;
+        service.port = target.value().second;
+        service.txt = texts.value(instance.toLower());
+        service.ipAddress = addresses.value(service.hostName.toLower(),
+                                            QHostAddress(sender.toIPv4Address()).toString());
+        service.macAddress = service.txt.value("mac", service.txt.value("macaddress"));
+        services.append(service);
+    }
+    return services;
+}
@@ -0,0 +1,102 @@
+#include "MultiPatternMatcher.h"
+#include <QQueue>
+
+namespace {
+inline uchar foldCase(uchar c)
+{
+    return (c >= 'A' && c <= 'Z') ? uchar(c + ('a' - 'A')) : c;
+}
+}
+
+int MultiPatternMatcher::addPattern(const QByteArray& pattern)
+{
+    Q_ASSERT(m_patterns.size() < MAX_PATTERNS);
+    Q_ASSERT(!pattern.isEmpty());
+    m_patterns.append(pattern.toLower());
+    return m_patterns.size() - 1;
+}
+
+void MultiPatternMatcher::build()
+{
+    // Only bytes that occur in some pattern need a column of their own
+    std::fill(std::begin(m_classes), std::end(m_classes), quint8(0));
+    m_classCount = 1;
+    for (const QByteArray& pattern : m_patterns) {
+        for (char c : pattern) {
+            uchar byte = uchar(c);
+            if (m_classes[byte] == 0) {
+                m_classes[byte] = quint8(m_classCount++);
+            }
+        }
+    }
+    for (int c = 'A'; c <= 'Z'; ++c) {
+        m_classes[c] = m_classes[foldCase(uchar(c))];
+    }
+
+    // Trie; -1 marks a missing edge until the failure pass fills it in
+    m_transitions = QVector<qint32>(m_classCount, -1);
+    m_outputs = QVector<QVector<int>>(1);
+    for (int id = 0; id < m_patterns.size(); ++id) {
+        int state = 0;
+        for (char c : m_patterns.at(id)) {
+            qint32& next = m_transitions[state * m_classCount + m_classes[uchar(c)]];
+            if (next < 0) {
+                next = m_outputs.size();
+                m_outputs.append(QVector<int>());
+                m_transitions.resize(m_transitions.size() + m_classCount);
+                std::fill(m_transitions.end() - m_classCount, m_transitions.end(), -1);
+            }
+            state = m_transitions[state * m_classCount + m_classes[uchar(c)]];
+        }
+        m_outputs[state].append(id);
+    }
+
+    // Breadth-first: every missing edge becomes the edge of the failure state, which is
+    // shallower and therefore already complete; outputs inherit the failure state's
+    QVector<int> failure(m_outputs.size(), 0);
+    QQueue<int> queue;
+    for (int c = 0; c < m_classCount; ++c) {
+        qint32& next = m_transitions[c];
+        if (next < 0) {
+            next = 0;
+        } else {
+            queue.enqueue(next);
+        }
+    }
+    while (!queue.isEmpty()) {
+        const int state = queue.dequeue();
+        for (int c = 0; c < m_classCount; ++c) {
+            const int index = state * m_classCount + c;
+            const int fallback = m_transitions[failure[state] * m_classCount + c];
+            if (m_transitions[index] < 0) {
+                m_transitions[index] = fallback;
+                continue;
+            }
+            const int child = m_transitions[index];
+            failure[child] = fallback;
+            m_outputs[child] += m_outputs[fallback];
+            queue.enqueue(child);
+        }
+    }
+}
+
+int MultiPatternMatcher::scan(const char* data, int length, int state, Matches& matches) const
+{
+    const qint32* transitions = m_transitions.constData();
+    const int classCount = m_classCount;
+    for (int i = 0; i < length; ++i) {
+        state = transitions[state * classCount + m_classes[uchar(data[i])]];
+        const QVector<int>& outputs = m_outputs.at(state);
+        for (int id : outputs) {
+            matches.set(id);
+        }
+    }
+    return state;
+}
+
+MultiPatternMatcher::Matches MultiPatternMatcher::scan(const QByteArray& text) const
+{
+    Matches matches;
+    scan(text.constData(), text.size(), 0, matches);
+    return matches;
+}
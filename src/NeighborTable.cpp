@@ -0,0 +1,157 @@
+#include "NeighborTable.h"
+#include "Logger.h"
+#include <QFile>
+#include <QHostAddress>
+#include <QNetworkInterface>
+#include <QRegularExpression>
+#include <QStringList>
+
+#ifdef Q_OS_WIN
+#include <winsock2.h>
+#include <ws2ipdef.h>
+#include <iphlpapi.h>
+#pragma comment(lib, "iphlpapi.lib")
+#endif
+
+namespace {
+// ATF_COM in /proc/net/arp flags: the entry has a resolved hardware address
+const int ARP_FLAG_COMPLETE = 0x2;
+}
+
+bool NeighborTable::load()
+{
+    QList<NeighborEntry> entries;
+
+#if defined(Q_OS_LINUX)
+    QFile file("/proc/net/arp");
+    if (!file.open(QIODevice::ReadOnly)) {
+        LOG_WARNING(QString("Cannot read neighbor table: %1").arg(file.errorString()), "CameraDiscovery");
+        return false;
+    }
+    entries = parseProcNetArp(file.readAll());
+#elif defined(Q_OS_WIN)
+    PMIB_IPNET_TABLE2 table = nullptr;
+    DWORD result = GetIpNetTable2(AF_INET, &table);
+    if (result != NO_ERROR) {
+        LOG_WARNING(QString("Cannot read neighbor table: GetIpNetTable2 failed (%1)").arg(result), "CameraDiscovery");
+        return false;
+    }
+
+    for (ULONG i = 0; i < table->NumEntries; ++i) {
+        const MIB_IPNET_ROW2& row = table->Table[i];
+        NeighborEntry entry;
+        entry.address = ntohl(row.Address.Ipv4.sin_addr.s_addr);
+        entry.interfaceName = QNetworkInterface::interfaceNameFromIndex(int(row.InterfaceIndex));
+
+        switch (row.State) {
+        case NlnsUnreachable:
+            entry.state = NeighborEntry::Failed;
+            break;
+        case NlnsIncomplete:
+            entry.state = NeighborEntry::Incomplete;
+            break;
+        default:
+            entry.state = NeighborEntry::Reachable;
+            break;
+        }
+
+        if (entry.state == NeighborEntry::Reachable && row.PhysicalAddressLength == 6) {
+            QStringList octets;
+            for (int b = 0; b < 6; ++b) {
+                octets.append(QString("%1").arg(row.PhysicalAddress[b], 2, 16, QChar('0')).toUpper());
+            }
+            entry.macAddress = octets.join(':');
+        }
+        entries.append(entry);
+    }
+    FreeMibTable(table);
+#else
+    return false;
+#endif
+
+    m_entries.clear();
+    for (const NeighborEntry& entry : entries) {
+        // Broadcast and multicast mappings are not hosts
+        if (entry.macAddress == "FF:FF:FF:FF:FF:FF" || entry.macAddress.startsWith("01:00:5E")) {
+            continue;
+        }
+        m_entries.insert(entry.address, entry);
+    }
+    m_loaded.start();
+    return true;
+}
+
+bool NeighborTable::refreshIfOlderThan(qint64 milliseconds)
+{
+    if (m_loaded.isValid() && m_loaded.elapsed() < milliseconds) {
+        return true;
+    }
+    return load();
+}
+
+QList<quint32> NeighborTable::liveAddresses() const
+{
+    QList<quint32> addresses;
+    for (const NeighborEntry& entry : m_entries) {
+        if (entry.state == NeighborEntry::Reachable) {
+            addresses.append(entry.address);
+        }
+    }
+    return addresses;
+}
+
+QList<quint32> NeighborTable::failedAddresses() const
+{
+    QList<quint32> addresses;
+    for (const NeighborEntry& entry : m_entries) {
+        if (entry.state == NeighborEntry::Failed) {
+            addresses.append(entry.address);
+        }
+    }
+    return addresses;
+}
+
+QString NeighborTable::macAddress(quint32 address) const
+{
+    auto it = m_entries.constFind(address);
+    return it == m_entries.constEnd() ? QString() : it.value().macAddress;
+}
+
+QList<NeighborEntry> NeighborTable::parseProcNetArp(const QByteArray& text)
+{
+    // IP address       HW type     Flags       HW address            Mask     Device
+    // 192.168.1.64     0x1         0x2         bc:ad:28:12:34:56     *        eth0
+    QList<NeighborEntry> entries;
+    const QList<QByteArray> lines = text.split('\n');
+    for (int i = 1; i < lines.size(); ++i) {
+        const QStringList fields = QString::fromLatin1(lines.at(i)).split(QRegularExpression("\\s+"), Qt::SkipEmptyParts);
+        if (fields.size() < 6) {
+            continue;
+        }
+
+        QHostAddress host;
+        if (!host.setAddress(fields.at(0)) || host.protocol() != QAbstractSocket::IPv4Protocol) {
+            continue;
+        }
+
+        bool ok = false;
+        const int flags = fields.at(2).toInt(&ok, 16);
+        if (!ok) {
+            continue;
+        }
+
+        // The kernel lists unresolved entries with flags 0 and a zero address; by the
+        // time the table is read, almost all of them are resolutions that failed
+        NeighborEntry entry;
+        entry.address = host.toIPv4Address();
+        entry.interfaceName = fields.at(5);
+        if (flags & ARP_FLAG_COMPLETE) {
+            entry.state = NeighborEntry::Reachable;
+            entry.macAddress = fields.at(3).toUpper();
+        } else {
+            entry.state = NeighborEntry::Failed;
+        }
+        entries.append(entry);
+    }
+    return entries;
+}
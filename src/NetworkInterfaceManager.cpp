@@ -68,6 +68,31 @@ QList<QNetworkInterface> NetworkInterfaceManager::getActiveInterfaces() const
     return activeInterfaces;
 }
 
+QList<QNetworkInterface> NetworkInterfaceManager::getMulticastInterfaces()
+{
+    QList<QNetworkInterface> multicastInterfaces;
+    const auto interfaces = QNetworkInterface::allInterfaces();
+    
+    for (const QNetworkInterface& netInterface : interfaces) {
+        if (!(netInterface.flags() & QNetworkInterface::IsUp) ||
+            !(netInterface.flags() & QNetworkInterface::IsRunning) ||
+            !(netInterface.flags() & QNetworkInterface::CanMulticast) ||
+            netInterface.flags() & QNetworkInterface::IsLoopBack) {
+            continue;
+        }
+        
+        const auto entries = netInterface.addressEntries();
+        for (const QNetworkAddressEntry& entry : entries) {
+            if (entry.ip().protocol() == QAbstractSocket::IPv4Protocol) {
+                multicastInterfaces.append(netInterface);
+                break;
+            }
+        }
+    }
+    
+    return multicastInterfaces;
+}
+
 QNetworkInterface NetworkInterfaceManager::getWireGuardInterface() const
 {
     const auto interfaces = QNetworkInterface::allInterfaces();
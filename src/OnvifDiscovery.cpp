@@ -0,0 +1,263 @@
+#include "OnvifDiscovery.h"
+#include "Logger.h"
+#include "NetworkInterfaceManager.h"
+#include <QNetworkDatagram>
+#include <QXmlStreamReader>
+#include <QRegularExpression>
+#include <QUrl>
+#include <QUuid>
+
+namespace {
+const QLatin1String MULTICAST_ADDRESS("239.255.255.250");
+const QLatin1String ONVIF_SCOPE_PREFIX("onvif://www.onvif.org/");
+}
+
+OnvifDiscovery::OnvifDiscovery(QObject *parent)
+    : QObject(parent)
+    , m_socket(nullptr)
+    , m_windowTimer(nullptr)
+    , m_deviceCount(0)
+{
+    m_windowTimer = new QTimer(this);
+    m_windowTimer->setSingleShot(true);
+    connect(m_windowTimer, &QTimer::timeout, this, &OnvifDiscovery::onWindowElapsed);
+}
+
+void OnvifDiscovery::probe(int windowMs)
+{
+    if (!ensureSocket()) {
+        return;
+    }
+
+    QByteArray payload = buildProbe("uuid:" + QUuid::createUuid().toString(QUuid::WithoutBraces));
+    int interfaces = sendMulticast(payload);
+    LOG_INFO(QString("WS-Discovery probe sent on %1 interface(s)").arg(interfaces), "OnvifDiscovery");
+
+    QTimer::singleShot(REPEAT_DELAY_MS, this, [this, payload]() {
+        if (isActive()) {
+            sendMulticast(payload);
+        }
+    });
+    extendWindow(windowMs);
+}
+
+void OnvifDiscovery::probeHost(const QHostAddress& address, int windowMs)
+{
+    if (!ensureSocket()) {
+        return;
+    }
+
+    QByteArray payload = buildProbe("uuid:" + QUuid::createUuid().toString(QUuid::WithoutBraces));
+    m_socket->writeDatagram(payload, address, DISCOVERY_PORT);
+    extendWindow(windowMs);
+}
+
+void OnvifDiscovery::stop()
+{
+    m_windowTimer->stop();
+    if (m_socket) {
+        m_socket->close();
+        m_socket->deleteLater();
+        m_socket = nullptr;
+    }
+    m_seenEndpoints.clear();
+    m_deviceCount = 0;
+}
+
+bool OnvifDiscovery::isActive() const
+{
+    return m_windowTimer->isActive();
+}
+
+bool OnvifDiscovery::ensureSocket()
+{
+    if (m_socket) {
+        return true;
+    }
+
+    // Replies are unicast back to the probe's source port, so any free port will do
+    m_socket = new QUdpSocket(this);
+    if (!m_socket->bind(QHostAddress::AnyIPv4, 0)) {
+        LOG_WARNING(QString("Cannot open WS-Discovery socket: %1").arg(m_socket->errorString()), "OnvifDiscovery");
+        m_socket->deleteLater();
+        m_socket = nullptr;
+        return false;
+    }
+    m_socket->setSocketOption(QAbstractSocket::MulticastTtlOption, 1);
+    connect(m_socket, &QUdpSocket::readyRead, this, &OnvifDiscovery::readDatagrams);
+    return true;
+}
+
+void OnvifDiscovery::extendWindow(int windowMs)
+{
+    if (!m_windowTimer->isActive() || m_windowTimer->remainingTime() < windowMs) {
+        m_windowTimer->start(windowMs);
+    }
+}
+
+int OnvifDiscovery::sendMulticast(const QByteArray& payload)
+{
+    const QHostAddress group{QString(MULTICAST_ADDRESS)};
+    int sent = 0;
+
+    // The default route only reaches one segment; send out of every IPv4 interface
+    for (const QNetworkInterface& interface : NetworkInterfaceManager::getMulticastInterfaces()) {
+        m_socket->setMulticastInterface(interface);
+        if (m_socket->writeDatagram(payload, group, DISCOVERY_PORT) == payload.size()) {
+            sent++;
+        }
+    }
+
+    if (sent == 0 && m_socket->writeDatagram(payload, group, DISCOVERY_PORT) == payload.size()) {
+        sent = 1;
+    }
+    return sent;
+}
+
+void OnvifDiscovery::readDatagrams()
+{
+    while (m_socket && m_socket->hasPendingDatagrams()) {
+        QNetworkDatagram datagram = m_socket->receiveDatagram(MAX_DATAGRAM_SIZE);
+        if (!datagram.isValid()) {
+            continue;
+        }
+
+        for (const OnvifDevice& device : parseProbeMatches(datagram.data(), datagram.senderAddress())) {
+            // Devices answer both the probe and its repeat
+            QString key = device.endpoint.isEmpty() ? device.ipAddress : device.endpoint;
+            if (m_seenEndpoints.contains(key)) {
+                continue;
+            }
+            m_seenEndpoints.insert(key);
+            m_deviceCount++;
+            emit deviceFound(device);
+        }
+    }
+}
+
+void OnvifDiscovery::onWindowElapsed()
+{
+    int deviceCount = m_deviceCount;
+    stop();
+
+    LOG_INFO(QString("WS-Discovery finished, %1 ONVIF device(s) answered").arg(deviceCount), "OnvifDiscovery");
+    emit finished(deviceCount);
+}
+
+QByteArray OnvifDiscovery::buildProbe(const QString& messageId)
+{
+    return QString(
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+        "<s:Envelope xmlns:s=\"http://www.w3.org/2003/05/soap-envelope\""
+        " xmlns:a=\"http://schemas.xmlsoap.org/ws/2004/08/addressing\""
+        " xmlns:d=\"http://schemas.xmlsoap.org/ws/2005/04/discovery\""
+        " xmlns:dn=\"http://www.onvif.org/ver10/network/wsdl\">"
+        "<s:Header>"
+        "<a:MessageID>%1</a:MessageID>"
+        "<a:To s:mustUnderstand=\"1\">urn:schemas-xmlsoap-org:ws:2005:04:discovery</a:To>"
+        "<a:Action s:mustUnderstand=\"1\">http://schemas.xmlsoap.org/ws/2005/04/discovery/Probe</a:Action>"
+        "</s:Header>"
+        "<s:Body>"
+        "<d:Probe><d:Types>dn:NetworkVideoTransmitter</d:Types></d:Probe>"
+        "</s:Body>"
+        "</s:Envelope>").arg(messageId).toUtf8();
+}
+
+QList<OnvifDevice> OnvifDiscovery::parseProbeMatches(const QByteArray& xml, const QHostAddress& sender)
+{
+    QList<OnvifDevice> devices;
+    QXmlStreamReader reader(xml);
+    const QRegularExpression whitespace("\\s+");
+
+    // Vendors use different namespace prefixes, so elements are matched on local names only
+    OnvifDevice current;
+    bool inMatch = false;
+    while (!reader.atEnd()) {
+        reader.readNext();
+
+        if (reader.isStartElement()) {
+            if (reader.name() == QLatin1String("ProbeMatch")) {
+                current = OnvifDevice();
+                inMatch = true;
+            } else if (!inMatch) {
+                continue;
+            } else if (reader.name() == QLatin1String("Address")) {
+                current.endpoint = reader.readElementText().trimmed();
+            } else if (reader.name() == QLatin1String("Scopes")) {
+                for (const QString& scope : reader.readElementText().split(whitespace, Qt::SkipEmptyParts)) {
+                    current.scopes.append(scope);
+                    applyScope(current, scope);
+                }
+            } else if (reader.name() == QLatin1String("XAddrs")) {
+                current.xaddrs = reader.readElementText().split(whitespace, Qt::SkipEmptyParts);
+            }
+        } else if (reader.isEndElement() && inMatch && reader.name() == QLatin1String("ProbeMatch")) {
+            inMatch = false;
+            resolveAddress(current, sender);
+            if (!current.ipAddress.isEmpty()) {
+                devices.append(current);
+            }
+        }
+    }
+
+    if (reader.hasError() && devices.isEmpty()) {
+        LOG_WARNING(QString("Malformed WS-Discovery reply from %1: %2")
+                    .arg(sender.toString(), reader.errorString()), "OnvifDiscovery");
+    }
+    return devices;
+}
+
+void OnvifDiscovery::applyScope(OnvifDevice& device, const QString& scope)
+{
+    // onvif://www.onvif.org/<category>/<value>, values percent-encoded
+    if (!scope.startsWith(ONVIF_SCOPE_PREFIX, Qt::CaseInsensitive)) {
+        return;
+    }
+
+    QString path = scope.mid(ONVIF_SCOPE_PREFIX.size());
+    int slash = path.indexOf('/');
+    if (slash <= 0) {
+        return;
+    }
+
+    QString category = path.left(slash).toLower();
+    QString value = QUrl::fromPercentEncoding(path.mid(slash + 1).toUtf8()).trimmed();
+    if (value.isEmpty()) {
+        return;
+    }
+
+    if (category == "name") {
+        device.name = value;
+    } else if (category == "hardware") {
+        device.hardware = value;
+    } else if (category == "mfr" || category == "manufacturer") {
+        device.manufacturer = value;
+    } else if (category == "location") {
+        device.location = value.replace('/', ' ');
+    }
+}
+
+void OnvifDiscovery::resolveAddress(OnvifDevice& device, const QHostAddress& sender)
+{
+    // Cameras often keep a factory default address in XAddrs; trust the address the
+    // reply came from and take the port from the XAddr that matches it (or the first)
+    QUrl chosen;
+    for (const QString& xaddr : device.xaddrs) {
+        QUrl url(xaddr);
+        QHostAddress host(url.host());
+        if (host.protocol() != QAbstractSocket::IPv4Protocol) {
+            continue;
+        }
+        if (chosen.isEmpty() || (!sender.isNull() && host.isEqual(sender, QHostAddress::TolerantConversion))) {
+            chosen = url;
+        }
+    }
+
+    if (!sender.isNull()) {
+        QHostAddress ipv4(sender.toIPv4Address());
+        device.ipAddress = ipv4.toString();
+    } else if (!chosen.isEmpty()) {
+        device.ipAddress = chosen.host();
+    }
+    device.port = chosen.isEmpty() ? 80 : chosen.port(chosen.scheme() == "https" ? 443 : 80);
+}
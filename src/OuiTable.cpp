@@ -0,0 +1,57 @@
+#include "OuiTable.h"
+#include <algorithm>
+#include <iterator>
+
+namespace {
+constexpr OuiTable::Entry OUI_TABLE[] = {
+#include "CameraOuiTable.inc"
+};
+
+constexpr bool isStrictlySorted()
+{
+    for (std::size_t i = 1; i < std::size(OUI_TABLE); ++i) {
+        if (OUI_TABLE[i - 1].oui >= OUI_TABLE[i].oui) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(isStrictlySorted(), "CameraOuiTable.inc must be sorted by OUI without duplicates");
+}
+
+const char* OuiTable::brandFor(quint32 oui)
+{
+    auto it = std::lower_bound(std::begin(OUI_TABLE), std::end(OUI_TABLE), oui,
+                               [](const Entry& entry, quint32 value) { return entry.oui < value; });
+    return (it != std::end(OUI_TABLE) && it->oui == oui) ? it->brand : nullptr;
+}
+
+QString OuiTable::brandForMac(const QString& macAddress)
+{
+    // The first six hex digits, whatever the separators
+    quint32 oui = 0;
+    int digits = 0;
+    for (QChar c : macAddress) {
+        int value = c.isDigit() ? c.digitValue()
+                  : (c.toUpper() >= 'A' && c.toUpper() <= 'F') ? c.toUpper().unicode() - 'A' + 10 : -1;
+        if (value < 0) {
+            continue;
+        }
+        oui = (oui << 4) | quint32(value);
+        if (++digits == 6) {
+            break;
+        }
+    }
+    if (digits < 6) {
+        return QString();
+    }
+
+    const char* brand = brandFor(oui);
+    return brand ? QString::fromLatin1(brand) : QString();
+}
+
+int OuiTable::size()
+{
+    return int(std::size(OUI_TABLE));
+}
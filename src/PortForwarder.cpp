@@ -1,19 +1,43 @@
 #include "PortForwarder.h"
 #include "Logger.h"
 #include "NetworkInterfaceManager.h"
+#include "RtspProtocol.h"
 #include <QNetworkProxy>
 #include <QTimer>
+#include <QJsonObject>
+#include <QtEndian>
 #include <QNetworkInterface>
+#include <cstring>
 
 PortForwarder::PortForwarder(QObject *parent)
     : QObject(parent)
     , m_networkManager(nullptr)
+    , m_drainTimeoutMs(DRAIN_TIMEOUT_MS)
+    , m_memoryBudget(DEFAULT_MEMORY_BUDGET_BYTES)
+    , m_maxViewersPerCamera(DEFAULT_MAX_VIEWERS_PER_CAMERA)
+    , m_maxConnectionsPerSourceIp(DEFAULT_MAX_CONNECTIONS_PER_SOURCE_IP)
+    , m_refusedMaxViewers(0)
+    , m_refusedSourceIpLimit(0)
+    , m_refusedMemoryBudget(0)
+    , m_backpressureEvents(0)
 {
+    // Firmware known to hold the TCP connection open after RTP stops gets a shorter fuse
+    m_stallTimeouts["hikvision"] = 6000;
+    m_stallTimeouts["dahua"] = 6000;
+    m_stallTimeouts["cp plus"] = 6000;
+    m_stallTimeouts["cpplus"] = 6000;
+    m_stallTimeouts["axis"] = 8000;
+    m_stallTimeouts["generic"] = DEFAULT_STALL_TIMEOUT_MS;
 }
 
 PortForwarder::~PortForwarder()
 {
-    stopAllForwarding();
+    stopAllForwarding(false);
+    
+    // Connections still draining from an earlier stop cannot outlive the forwarder
+    while (!m_drainingConnections.isEmpty()) {
+        finishDrain(m_drainingConnections.first(), false);
+    }
 }
 
 bool PortForwarder::startForwarding(const CameraConfig& camera)
@@ -65,6 +89,15 @@ bool PortForwarder::startForwarding(const CameraConfig& camera)
     session->healthCheckTimer->setInterval(HEALTH_CHECK_INTERVAL_MS);
     connect(session->healthCheckTimer, &QTimer::timeout, this, &PortForwarder::handleHealthCheck);
     
+    // Set up media stall watchdog
+    session->stallTimer = new QTimer(this);
+    session->stallTimer->setInterval(STALL_CHECK_INTERVAL_MS);
+    session->stallCount = 0;
+    session->upstreamReconnects = 0;
+    session->substreamSwitches = 0;
+    session->substreamUnsupported = false;
+    connect(session->stallTimer, &QTimer::timeout, this, &PortForwarder::handleStreamWatchdog);
+    
     // Connect server signals
     connect(session->server, &QTcpServer::newConnection, this, &PortForwarder::handleNewConnection);
     
@@ -79,6 +112,7 @@ bool PortForwarder::startForwarding(const CameraConfig& camera)
         delete session->server;
         delete session->reconnectTimer;
         delete session->healthCheckTimer;
+        delete session->stallTimer;
         delete session;
         
         emit forwardingError(cameraId, QString("Failed to bind port %1: %2").arg(externalPort).arg(errorMsg));
@@ -90,6 +124,7 @@ bool PortForwarder::startForwarding(const CameraConfig& camera)
     
     // Start health check timer
     session->healthCheckTimer->start();
+    session->stallTimer->start();
     
     // Update status
     updateSessionStatus(cameraId, "Active - Listening");
@@ -103,7 +138,7 @@ bool PortForwarder::startForwarding(const CameraConfig& camera)
     return true;
 }
 
-void PortForwarder::stopForwarding(const QString& cameraId)
+void PortForwarder::stopForwarding(const QString& cameraId, bool drain)
 {
     if (!m_sessions.contains(cameraId)) {
         LOG_DEBUG(QString("No active forwarding session found for camera: %1").arg(cameraId), "PortForwarder");
@@ -131,19 +166,45 @@ void PortForwarder::stopForwarding(const QString& cameraId)
         session->reconnectTimer = nullptr;
     }
     
+    // Stop stall watchdog
+    if (session->stallTimer) {
+        session->stallTimer->stop();
+        session->stallTimer->deleteLater();
+        session->stallTimer = nullptr;
+    }
+    
+    // Stop accepting new clients before closing existing connections
+    if (session->server) {
+        session->server->close();
+        LOG_DEBUG(QString("Server stopped listening on port %1")
+                  .arg(session->camera.externalPort()), "PortForwarder");
+        session->server->deleteLater();
+        session->server = nullptr;
+    }
+    
     // Close all connections with detailed logging
     int connectionCount = session->connections.size();
-    LOG_INFO(QString("Closing %1 active connections for camera: %2")
+    bool graceful = drain && m_drainTimeoutMs > 0;
+    LOG_INFO(QString("%1 %2 active connections for camera: %3")
+             .arg(graceful ? "Draining" : "Closing")
              .arg(connectionCount).arg(session->camera.name()), "PortForwarder");
     
     for (auto it = session->connections.begin(); it != session->connections.end(); ++it) {
         QTcpSocket* clientSocket = it.key();
         ConnectionInfo* connInfo = it.value();
         
+        if (connInfo && graceful) {
+            logConnectionDetails(cameraId, connInfo, "Draining");
+            beginDrain(cameraId, connInfo);
+            continue;
+        }
+        
         if (connInfo) {
             logConnectionDetails(cameraId, connInfo, "Closing");
+            cancelUpstreamReplay(connInfo);
             
             if (connInfo->targetSocket) {
+                m_socketToCameraMap.remove(connInfo->targetSocket);
                 connInfo->targetSocket->disconnectFromHost();
                 connInfo->targetSocket->deleteLater();
             }
@@ -159,15 +220,6 @@ void PortForwarder::stopForwarding(const QString& cameraId)
     }
     session->connections.clear();
     
-    // Stop and cleanup server
-    if (session->server) {
-        session->server->close();
-        LOG_DEBUG(QString("Server stopped listening on port %1")
-                  .arg(session->camera.externalPort()), "PortForwarder");
-        session->server->deleteLater();
-        session->server = nullptr;
-    }
-    
     // Log final statistics
     LOG_INFO(QString("Final statistics for camera '%1': %2 bytes transferred, %3 connections handled")
              .arg(session->camera.name())
@@ -179,12 +231,64 @@ void PortForwarder::stopForwarding(const QString& cameraId)
     emit forwardingStopped(cameraId);
 }
 
-void PortForwarder::stopAllForwarding()
+void PortForwarder::stopAllForwarding(bool drain)
 {
     QStringList cameraIds = m_sessions.keys();
     for (const QString& cameraId : cameraIds) {
-        stopForwarding(cameraId);
+        stopForwarding(cameraId, drain);
+    }
+}
+
+void PortForwarder::setDrainTimeout(int milliseconds)
+{
+    m_drainTimeoutMs = qMax(0, milliseconds);
+    LOG_INFO(QString("Connection drain timeout set to %1 ms%2")
+             .arg(m_drainTimeoutMs)
+             .arg(m_drainTimeoutMs == 0 ? " (draining disabled)" : ""), "PortForwarder");
+}
+
+void PortForwarder::setMemoryBudget(qint64 bytes)
+{
+    m_memoryBudget = qMax(qint64(0), bytes);
+    LOG_INFO(QString("Relay memory budget set to %1 KB").arg(m_memoryBudget / 1024), "PortForwarder");
+}
+
+void PortForwarder::setMaxViewersPerCamera(int viewers)
+{
+    m_maxViewersPerCamera = qMax(0, viewers);
+    LOG_INFO(QString("Max viewers per camera set to %1").arg(m_maxViewersPerCamera), "PortForwarder");
+}
+
+void PortForwarder::setMaxConnectionsPerSourceIp(int connections)
+{
+    m_maxConnectionsPerSourceIp = qMax(0, connections);
+    LOG_INFO(QString("Max connections per source IP set to %1").arg(m_maxConnectionsPerSourceIp), "PortForwarder");
+}
+
+void PortForwarder::setStallTimeout(const QString& brand, int milliseconds)
+{
+    m_stallTimeouts[brand.toLower()] = qMax(0, milliseconds);
+    LOG_INFO(QString("Stall timeout for brand '%1' set to %2 ms").arg(brand).arg(qMax(0, milliseconds)), "PortForwarder");
+}
+
+int PortForwarder::stallTimeout(const QString& brand) const
+{
+    QString key = brand.toLower();
+    if (m_stallTimeouts.contains(key)) {
+        return m_stallTimeouts.value(key);
     }
+    
+    for (auto it = m_stallTimeouts.constBegin(); it != m_stallTimeouts.constEnd(); ++it) {
+        if (it.key() != "generic" && key.contains(it.key())) {
+            return it.value();
+        }
+    }
+    return m_stallTimeouts.value("generic", DEFAULT_STALL_TIMEOUT_MS);
+}
+
+int PortForwarder::stallTimeoutFor(const CameraConfig& camera) const
+{
+    return stallTimeout(camera.brand());
 }
 
 bool PortForwarder::isForwarding(const QString& cameraId) const
@@ -321,6 +425,10 @@ void PortForwarder::handleNewConnection()
         return;
     }
     
+    if (!admitConnection(cameraId, session, clientSocket)) {
+        return;
+    }
+    
     QString clientAddress = QString("%1:%2")
         .arg(clientSocket->peerAddress().toString())
         .arg(clientSocket->peerPort());
@@ -336,6 +444,28 @@ void PortForwarder::handleNewConnection()
     connInfo->bytesTransferred = 0;
     connInfo->connectedTime = QDateTime::currentDateTime();
     connInfo->isTargetConnected = false;
+    connInfo->lastCSeq = 0;
+    connInfo->clientReadPaused = false;
+    connInfo->targetReadPaused = false;
+    connInfo->handshakeComplete = false;
+    connInfo->interleaved = false;
+    connInfo->playing = false;
+    connInfo->lastMediaMs = 0;
+    connInfo->upstreamReconnecting = false;
+    connInfo->reconnectFailures = 0;
+    for (RtpChannelState& channel : connInfo->rtpChannels) {
+        channel = RtpChannelState();
+    }
+    connInfo->rtpRewrite = false;
+    connInfo->upstreamNonceCount = 0;
+    connInfo->onSubstream = false;
+    connInfo->pressureTicks = 0;
+    connInfo->headroomTicks = 0;
+    connInfo->switchHoldoffMs = SUBSTREAM_MIN_HOLDOFF_MS;
+    connInfo->lastSwitchMs = 0;
+    connInfo->videoPayloadType = -1;
+    connInfo->videoCodec = RtpInterleavedParser::CodecUnknown;
+    connInfo->analyzed = false;
       // Store connection mapping
     session->connections[clientSocket] = connInfo;
     m_socketToCameraMap[clientSocket] = cameraId;
@@ -358,14 +488,7 @@ void PortForwarder::handleNewConnection()
     // Connect target socket signals
     connect(connInfo->targetSocket, &QTcpSocket::connected, 
             this, &PortForwarder::handleTargetConnected);
-    connect(connInfo->targetSocket, &QTcpSocket::disconnected, 
-            this, &PortForwarder::handleTargetDisconnected);
-    connect(connInfo->targetSocket, &QTcpSocket::readyRead, 
-            this, &PortForwarder::handleTargetDataReady);
-    connect(connInfo->targetSocket, &QTcpSocket::bytesWritten,  // Non-blocking write buffer flushing
-            this, &PortForwarder::handleBytesWritten);
-    connect(connInfo->targetSocket, QOverload<QAbstractSocket::SocketError>::of(&QAbstractSocket::errorOccurred),
-            this, &PortForwarder::handleConnectionError);
+    connectTargetSignals(connInfo->targetSocket);
     // Attempt connection to target camera
     LOG_DEBUG(QString("Connecting to target camera %1:%2 for client %3")
               .arg(session->camera.ipAddress())
@@ -373,18 +496,7 @@ void PortForwarder::handleNewConnection()
               .arg(clientAddress), "PortForwarder");
     
     // Explicitly bind to the correct local interface to prevent Source IP routing issues
-    if (m_networkManager) {
-        QHostAddress cameraIp(session->camera.ipAddress());
-        QHostAddress bindAddress = m_networkManager->getBestLocalAddress(cameraIp);
-        
-        if (!bindAddress.isNull() && bindAddress != QHostAddress::Any) {
-            if (connInfo->targetSocket->bind(bindAddress)) {
-                LOG_INFO(QString("Bound outgoing connection to local interface: %1").arg(bindAddress.toString()), "PortForwarder");
-            } else {
-                LOG_WARNING(QString("Failed to bind to local interface %1: %2").arg(bindAddress.toString()).arg(connInfo->targetSocket->errorString()), "PortForwarder");
-            }
-        }
-    }
+    bindTargetSocket(connInfo->targetSocket, session->camera);
 
     // Set connection timeout for RTSP (extended timeout for better reliability)
     connInfo->targetSocket->connectToHost(session->camera.ipAddress(), session->camera.port());
@@ -447,20 +559,28 @@ void PortForwarder::handleClientDisconnected()
     // Log connection details before cleanup
     logConnectionDetails(cameraId, connInfo, "Client Disconnected");
     
+    // Remove from session
+    session->connections.remove(clientSocket);
+    
+    // Update session status
+    updateSessionStatus(cameraId, QString("Active - %1 connections").arg(session->connections.size()));
+    
+    if (m_drainTimeoutMs > 0) {
+        // Tear down the camera-side RTSP session instead of leaving it half-open
+        beginDrain(cameraId, connInfo);
+        emit connectionClosed(cameraId, clientAddress);
+        return;
+    }
+    
     // Cleanup target socket
+    cancelUpstreamReplay(connInfo);
     if (connInfo->targetSocket) {
         m_socketToCameraMap.remove(connInfo->targetSocket);
         connInfo->targetSocket->disconnectFromHost();
         connInfo->targetSocket->deleteLater();
     }
-    
-    // Remove from session
-    session->connections.remove(clientSocket);
     m_socketToCameraMap.remove(clientSocket);
     
-    // Update session status
-    updateSessionStatus(cameraId, QString("Active - %1 connections").arg(session->connections.size()));
-    
     // Clean up connection info
     delete connInfo;
     
@@ -488,8 +608,13 @@ void PortForwarder::handleClientDataReady()
     if (!connInfo || !connInfo->targetSocket) {
         LOG_ERROR("No target connection found for client data", "PortForwarder");
         return;
+    }
+    
+    // Camera side is backed up; leave the data in the socket until it drains
+    if (connInfo->clientReadPaused) {
+        return;
     }      if (connInfo->targetSocket->state() == QAbstractSocket::ConnectedState) {
-        forwardData(clientSocket, connInfo->targetSocket, cameraId, "client->target");
+        forwardData(connInfo, clientSocket, connInfo->targetSocket, cameraId, "client->target");
     } else if (connInfo->targetSocket->state() == QAbstractSocket::ConnectingState) {
         // Buffer initial RTSP request data while target is connecting
         QByteArray data = clientSocket->readAll();
@@ -539,6 +664,7 @@ void PortForwarder::handleTargetConnected()
             if (!info->pendingClientData.isEmpty()) {
                 LOG_INFO(QString("Sending %1 bytes of buffered data to camera %2")
                          .arg(info->pendingClientData.size()).arg(cameraId), "PortForwarder");
+                inspectRtspMessage(info, info->pendingClientData, "client->target");
                 
                 qint64 bytesWritten = targetSocket->write(info->pendingClientData);
                 if (bytesWritten == -1) {
@@ -586,19 +712,42 @@ void PortForwarder::handleTargetDisconnected()
     ForwardingSession* session = m_sessions[cameraId];
       // Find and disconnect corresponding client
     QTcpSocket* clientSocket = nullptr;
+    ConnectionInfo* connInfo = nullptr;
     for (auto it = session->connections.begin(); it != session->connections.end(); ++it) {
         if (it.value()->targetSocket == targetSocket) {
             clientSocket = it.key();
+            connInfo = it.value();
             break;
         }
     }
     
+    // A stall replay is already replacing this socket
+    if (connInfo && connInfo->upstreamReconnecting) {
+        return;
+    }
+    
+    // Camera dropped a playing stream; bring it back without disconnecting the viewer
+    if (connInfo && connInfo->playing && connInfo->interleaved && !connInfo->handshakeRequests.isEmpty() &&
+        connInfo->reconnectFailures < MAX_UPSTREAM_RECONNECT_ATTEMPTS) {
+        session->stallCount++;
+        LOG_WARNING(QString("Camera %1 closed the stream for client %2, reconnecting upstream")
+                    .arg(session->camera.name()).arg(connInfo->clientAddress), "PortForwarder");
+        emit upstreamStalled(cameraId, connInfo->clientAddress, session->stallCount);
+        startUpstreamReconnect(cameraId, connInfo);
+        if (connInfo->upstreamReconnecting) {
+            return;
+        }
+    }
+    
     if (clientSocket) {
         session->connections.remove(clientSocket);
         m_socketToCameraMap.remove(clientSocket);
         clientSocket->disconnectFromHost();
         clientSocket->deleteLater();
     }
+    if (connInfo) {
+        delete connInfo;
+    }
     
     m_socketToCameraMap.remove(targetSocket);
     targetSocket->deleteLater();
@@ -643,8 +792,13 @@ void PortForwarder::handleTargetDataReady()
         return;
     }
     
+    // Viewer is backed up; leave the data in the socket so TCP flow control slows the camera
+    if (connInfo->targetReadPaused) {
+        return;
+    }
+    
     if (clientSocket->state() == QAbstractSocket::ConnectedState) {
-        forwardData(targetSocket, clientSocket, cameraId, "target->client");
+        forwardData(connInfo, targetSocket, clientSocket, cameraId, "target->client");
     } else {
         LOG_DEBUG(QString("Client not connected, dropping data for camera: %1").arg(cameraId), "PortForwarder");
     }
@@ -725,9 +879,9 @@ void PortForwarder::setupReconnectTimer(const QString& cameraId)
     LOG_INFO(QString("Setup reconnect timer for camera: %1").arg(session->camera.name()), "PortForwarder");
 }
 
-void PortForwarder::forwardData(QTcpSocket* from, QTcpSocket* to, const QString& cameraId, const QString& direction)
+void PortForwarder::forwardData(ConnectionInfo* info, QTcpSocket* from, QTcpSocket* to, const QString& cameraId, const QString& direction)
 {
-    if (!from || !to || !from->isReadable() || !to->isWritable()) {
+    if (!info || !from || !to || !from->isReadable() || !to->isWritable()) {
         return;
     }
     
@@ -736,6 +890,51 @@ void PortForwarder::forwardData(QTcpSocket* from, QTcpSocket* to, const QString&
     if (data.isEmpty()) {
         return;
     }
+    
+    // After an upstream reconnect the camera issues a new session ID; the client keeps its own.
+    // Requests are rewritten before inspection, responses after, so state always holds upstream IDs.
+    bool sessionRemapped = !info->clientSessionId.isEmpty() && !info->rtspSessionId.isEmpty() &&
+                           info->clientSessionId != info->rtspSessionId;
+    if (direction == "client->target") {
+        if (sessionRemapped) {
+            RtspProtocol::replaceSessionId(data, info->clientSessionId, info->rtspSessionId);
+        }
+        inspectRtspMessage(info, data, direction);
+        
+        if (info->rtpRewrite && RtspProtocol::isRequest(data)) {
+            // The client keeps addressing the main stream it negotiated
+            QByteArray url = RtspProtocol::requestUrl(data);
+            if (info->onSubstream) {
+                QByteArray substream = RtspProtocol::substreamUrl(url);
+                if (!substream.isEmpty()) {
+                    url = substream;
+                    data = RtspProtocol::withRequestUrl(data, url);
+                }
+            }
+            
+            // Its Digest answers sign the old URI and the old connection's nonce
+            QByteArray authorization = RtspProtocol::headerValue(data, "Authorization");
+            ForwardingSession* session = m_sessions.value(cameraId);
+            if (!authorization.isEmpty() && !info->upstreamChallenges.isEmpty() && session) {
+                authorization = RtspProtocol::authorization(info->upstreamChallenges, RtspProtocol::requestMethod(data), url,
+                                                            session->camera.username(), session->camera.password(),
+                                                            ++info->upstreamNonceCount);
+                data = RtspProtocol::withHeader(data, "Authorization", authorization);
+            } else if (authorization.toLower().startsWith("digest")) {
+                data = RtspProtocol::withHeader(data, "Authorization", QByteArray());
+            }
+        }
+    } else {
+        inspectRtspMessage(info, data, direction);
+        if (sessionRemapped) {
+            RtspProtocol::replaceSessionId(data, info->rtspSessionId, info->clientSessionId);
+        }
+        
+        processTargetMedia(info, data, streamAnalyzerFor(m_sessions.value(cameraId), info));
+        if (data.isEmpty()) {
+            return;
+        }
+    }
       // Log detailed information for RTSP debugging
     if (data.size() > 0) {
         // Enhanced RTSP protocol detection
@@ -789,27 +988,19 @@ void PortForwarder::forwardData(QTcpSocket* from, QTcpSocket* to, const QString&
     // If we couldn't write all data at once, buffer the remaining data
     // The OS will notify us via bytesWritten() signal when more buffer space is available
     if (totalWritten < dataSize) {
-        // Find connection info to buffer remaining data
-        for (auto it = m_sessions[cameraId]->connections.begin(); 
-             it != m_sessions[cameraId]->connections.end(); ++it) {
-            ConnectionInfo* info = it.value();
-            if ((direction == "client->target" && info->clientSocket == from && info->targetSocket == to) ||
-                (direction == "target->client" && info->targetSocket == from && info->clientSocket == to)) {
-                
-                QByteArray* writeBuffer = (direction == "client->target") ? 
-                    &info->pendingClientWrite : &info->pendingTargetWrite;
-                
-                // Append remaining data to buffer
-                writeBuffer->append(data.constData() + totalWritten, dataSize - totalWritten);
-                
-                LOG_DEBUG(QString("Buffered %1 bytes (socket write buffer full) %2 for camera %3. Total buffered: %4")
-                          .arg(dataSize - totalWritten).arg(direction).arg(cameraId).arg(writeBuffer->size()), 
-                          "PortForwarder");
-                break;
-            }
-        }
+        QByteArray* writeBuffer = (direction == "client->target") ? 
+            &info->pendingClientWrite : &info->pendingTargetWrite;
+        
+        // Append remaining data to buffer
+        writeBuffer->append(data.constData() + totalWritten, dataSize - totalWritten);
+        
+        LOG_DEBUG(QString("Buffered %1 bytes (socket write buffer full) %2 for camera %3. Total buffered: %4")
+                  .arg(dataSize - totalWritten).arg(direction).arg(cameraId).arg(writeBuffer->size()), 
+                  "PortForwarder");
     }
     
+    applyBackpressure(info, to, cameraId, direction);
+    
     // Try to flush data for real-time streaming, but don't spam logs if it fails
     // Note: flush() failure is normal for high-throughput video streaming due to TCP buffering
     if (totalWritten > 0) {
@@ -837,18 +1028,7 @@ void PortForwarder::forwardData(QTcpSocket* from, QTcpSocket* to, const QString&
             session->lastActivity = QDateTime::currentDateTime();
             
             // Update connection-specific stats
-            QString socketCameraId = m_socketToCameraMap.value(from);
-            if (socketCameraId == cameraId) {
-                // Find the connection info
-                for (auto it = session->connections.begin(); it != session->connections.end(); ++it) {
-                    ConnectionInfo* info = it.value();
-                    if ((direction == "client->target" && info->clientSocket == from) ||
-                        (direction == "target->client" && info->targetSocket == from)) {
-                        info->bytesTransferred += totalWritten;
-                        break;
-                    }
-                }
-            }
+            info->bytesTransferred += totalWritten;
         }
         
         // Emit data transfer signal (throttled logging)
@@ -1027,8 +1207,16 @@ void PortForwarder::cleanupConnection(const QString& cameraId, QTcpSocket* clien
     ForwardingSession* session = m_sessions[cameraId];
     ConnectionInfo* connInfo = session->connections.value(clientSocket);
     
+    if (connInfo && m_drainTimeoutMs > 0) {
+        logConnectionDetails(cameraId, connInfo, "Cleanup (draining)");
+        session->connections.remove(clientSocket);
+        beginDrain(cameraId, connInfo);
+        return;
+    }
+    
     if (connInfo) {
         logConnectionDetails(cameraId, connInfo, "Cleanup");
+        cancelUpstreamReplay(connInfo);
         
         if (connInfo->targetSocket) {
             // Also disconnect target socket signals
@@ -1145,10 +1333,12 @@ void PortForwarder::handleBytesWritten()
             QByteArray* writeBuffer = nullptr;
             QString direction;
             
-            if (info->clientSocket == writableSocket && !info->pendingClientWrite.isEmpty()) {
+            // pendingClientWrite holds client->target data and drains into the target socket,
+            // pendingTargetWrite holds target->client data and drains into the client socket
+            if (info->targetSocket == writableSocket && !info->pendingClientWrite.isEmpty()) {
                 writeBuffer = &info->pendingClientWrite;
                 direction = "client->target (buffered)";
-            } else if (info->targetSocket == writableSocket && !info->pendingTargetWrite.isEmpty()) {
+            } else if (info->clientSocket == writableSocket && !info->pendingTargetWrite.isEmpty()) {
                 writeBuffer = &info->pendingTargetWrite;
                 direction = "target->client (buffered)";
             }
@@ -1171,6 +1361,26 @@ void PortForwarder::handleBytesWritten()
                 }
                 // Continue checking other buffers for this socket
             }
+            
+            // Resume reading the opposite side once this socket's queue has drained
+            qint64 queued = writableSocket->bytesToWrite() + (writeBuffer ? writeBuffer->size() : 0);
+            if (queued > BACKPRESSURE_LOW_WATERMARK) {
+                continue;
+            }
+            if (info->clientSocket == writableSocket && info->targetReadPaused) {
+                info->targetReadPaused = false;
+                LOG_DEBUG(QString("Resumed reading from camera %1 for client %2")
+                          .arg(sessionIt.key()).arg(info->clientAddress), "PortForwarder");
+                forwardData(info, info->targetSocket, info->clientSocket, sessionIt.key(), "target->client");
+                return;
+            }
+            if (info->targetSocket == writableSocket && info->clientReadPaused) {
+                info->clientReadPaused = false;
+                LOG_DEBUG(QString("Resumed reading from client %1 for camera %2")
+                          .arg(info->clientAddress).arg(sessionIt.key()), "PortForwarder");
+                forwardData(info, info->clientSocket, info->targetSocket, sessionIt.key(), "client->target");
+                return;
+            }
         }
     }
 }
@@ -1200,3 +1410,1256 @@ QString PortForwarder::getBindingInfo(const QString& cameraId) const
     
     return info;
 }
+
+void PortForwarder::inspectRtspMessage(ConnectionInfo* info, const QByteArray& data, const QString& direction)
+{
+    if (direction == "client->target") {
+        if (!RtspProtocol::isRequest(data)) {
+            return;
+        }
+        
+        QByteArray url = RtspProtocol::requestUrl(data);
+        if (!url.isEmpty() && url != "*") {
+            info->rtspUrl = url;
+        }
+        
+        int cseq = RtspProtocol::cseq(data);
+        if (cseq >= 0) {
+            info->lastCSeq = cseq;
+        }
+        
+        QByteArray method = RtspProtocol::requestMethod(data);
+        
+        // Remember the handshake so a stalled upstream can be rebuilt behind the client's back
+        if (method == "DESCRIBE") {
+            info->handshakeRequests.clear();
+            info->handshakeComplete = false;
+        }
+        if (!info->handshakeComplete && (method == "DESCRIBE" || method == "SETUP" || method == "PLAY")) {
+            // A request re-sent after a 401 replaces the rejected one
+            QByteArray url = RtspProtocol::requestUrl(data);
+            for (int i = info->handshakeRequests.size() - 1; i >= 0; --i) {
+                const QByteArray& recorded = info->handshakeRequests.at(i);
+                if (RtspProtocol::requestMethod(recorded) == method && RtspProtocol::requestUrl(recorded) == url) {
+                    info->handshakeRequests.removeAt(i);
+                }
+            }
+            int headerEnd = data.indexOf("\r\n\r\n");
+            info->handshakeRequests.append(headerEnd < 0 ? data : data.left(headerEnd + 4));
+        }
+        if (method == "SETUP" && RtspProtocol::headerValue(data, "Transport").contains("interleaved")) {
+            info->interleaved = true;
+        }
+        
+        if (method == "PLAY") {
+            info->handshakeComplete = true;
+            info->playing = true;
+            info->lastMediaMs = QDateTime::currentMSecsSinceEpoch();
+        } else if (method == "PAUSE") {
+            info->playing = false;
+        } else if (method == "TEARDOWN") {
+            // Client tore the session down itself, nothing left to release on drain
+            info->playing = false;
+            info->rtspSessionId.clear();
+            info->clientSessionId.clear();
+        }
+    } else {
+        if (!RtspProtocol::isResponse(data)) {
+            return;
+        }
+        
+        QByteArray sessionId = RtspProtocol::sessionId(data);
+        if (!sessionId.isEmpty()) {
+            info->rtspSessionId = sessionId;
+            if (info->clientSessionId.isEmpty()) {
+                info->clientSessionId = sessionId;
+            }
+        }
+        
+        // Codec the client's decoder was set up for; a substream must match it
+        int bodyStart = data.indexOf("\r\n\r\n");
+        int payloadType = -1;
+        QByteArray encoding;
+        if (bodyStart >= 0 && RtspProtocol::sdpVideoFormat(data.mid(bodyStart + 4), payloadType, encoding)) {
+            info->videoEncoding = encoding;
+            info->videoPayloadType = payloadType;
+            info->videoCodec = videoCodecFor(encoding);
+        }
+    }
+}
+
+void PortForwarder::beginDrain(const QString& cameraId, ConnectionInfo* info)
+{
+    cancelUpstreamReplay(info);
+    
+    QTcpSocket* clientSocket = info->clientSocket;
+    QTcpSocket* targetSocket = info->targetSocket;
+    
+    // Detach both sockets from the regular forwarding slots
+    clientSocket->disconnect(this);
+    m_socketToCameraMap.remove(clientSocket);
+    if (targetSocket) {
+        targetSocket->disconnect(this);
+        m_socketToCameraMap.remove(targetSocket);
+    }
+    
+    DrainingConnection* drain = new DrainingConnection;
+    drain->cameraId = cameraId;
+    drain->info = info;
+    drain->teardownCSeq = -1;
+    drain->teardownSent = false;
+    drain->deadlineTimer = new QTimer(this);
+    drain->deadlineTimer->setSingleShot(true);
+    m_drainingConnections.append(drain);
+    
+    connect(drain->deadlineTimer, &QTimer::timeout, this, [this, drain]() {
+        LOG_WARNING(QString("Drain deadline of %1 ms exceeded for client %2 on camera %3, aborting")
+                    .arg(m_drainTimeoutMs).arg(drain->info->clientAddress).arg(drain->cameraId), "PortForwarder");
+        finishDrain(drain, false);
+    });
+    
+    // New client requests are no longer relayed; only data already queued is flushed
+    connect(clientSocket, &QTcpSocket::readyRead, this, [clientSocket]() {
+        clientSocket->readAll();
+    });
+    connect(clientSocket, &QTcpSocket::bytesWritten, this, [this, drain]() {
+        checkDrainComplete(drain);
+    });
+    connect(clientSocket, &QTcpSocket::disconnected, this, [this, drain]() {
+        checkDrainComplete(drain);
+    });
+    
+    if (targetSocket) {
+        connect(targetSocket, &QTcpSocket::readyRead, this, [this, drain]() {
+            handleDrainTargetData(drain);
+        });
+        connect(targetSocket, &QTcpSocket::bytesWritten, this, [this, drain]() {
+            checkDrainComplete(drain);
+        });
+        connect(targetSocket, &QTcpSocket::disconnected, this, [this, drain]() {
+            drain->teardownCSeq = -1;
+            checkDrainComplete(drain);
+        });
+    }
+    
+    bool clientConnected = clientSocket->state() == QAbstractSocket::ConnectedState;
+    bool targetConnected = targetSocket && targetSocket->state() == QAbstractSocket::ConnectedState;
+    
+    // Flush whatever the non-blocking writers and the RTP rewriter still hold
+    if (clientConnected && !info->pendingTargetWrite.isEmpty()) {
+        clientSocket->write(info->pendingTargetWrite);
+    }
+    if (clientConnected && !info->rtpCarry.isEmpty()) {
+        clientSocket->write(info->rtpCarry);
+    }
+    info->pendingTargetWrite.clear();
+    info->rtpCarry.clear();
+    
+    if (targetConnected) {
+        if (!info->pendingClientWrite.isEmpty()) {
+            targetSocket->write(info->pendingClientWrite);
+        }
+        
+        // Release the camera-side session so it does not linger until its own timeout
+        if (!info->rtspSessionId.isEmpty() && !info->rtspUrl.isEmpty()) {
+            drain->teardownCSeq = info->lastCSeq + 1;
+            drain->teardownSent = true;
+            RtspProtocol::HeaderList headers;
+            headers.append(qMakePair(QByteArray("Session"), info->rtspSessionId));
+            targetSocket->write(RtspProtocol::buildRequest("TEARDOWN", upstreamUrl(info), drain->teardownCSeq, headers));
+            LOG_DEBUG(QString("Sent TEARDOWN (CSeq %1, session %2) for camera %3")
+                      .arg(drain->teardownCSeq).arg(QString::fromLatin1(info->rtspSessionId)).arg(cameraId), 
+                      "PortForwarder");
+        }
+    } else if (targetSocket) {
+        targetSocket->abort();
+    }
+    info->pendingClientWrite.clear();
+    
+    drain->deadlineTimer->start(m_drainTimeoutMs);
+    
+    // Data held back by backpressure will not raise another readyRead
+    if (targetConnected && targetSocket->bytesAvailable() > 0) {
+        handleDrainTargetData(drain);
+    } else {
+        checkDrainComplete(drain);
+    }
+}
+
+void PortForwarder::handleDrainTargetData(DrainingConnection* drain)
+{
+    ConnectionInfo* info = drain->info;
+    QByteArray data = info->targetSocket->readAll();
+    if (data.isEmpty()) {
+        return;
+    }
+    
+    // Anything after our TEARDOWN was sent is only relayed up to the camera's reply
+    bool forward = !drain->teardownSent || drain->teardownCSeq >= 0;
+    if (drain->teardownCSeq >= 0) {
+        int pos = data.indexOf("RTSP/1.0");
+        while (pos >= 0) {
+            QByteArray response = data.mid(pos);
+            if (RtspProtocol::cseq(response) == drain->teardownCSeq) {
+                LOG_DEBUG(QString("Camera %1 answered TEARDOWN with status %2")
+                          .arg(drain->cameraId).arg(RtspProtocol::statusCode(response)), "PortForwarder");
+                // The reply belongs to the relay, not to the client
+                data.truncate(pos);
+                drain->teardownCSeq = -1;
+                break;
+            }
+            pos = data.indexOf("RTSP/1.0", pos + 8);
+        }
+    }
+    
+    if (forward && !data.isEmpty() && info->clientSocket->state() == QAbstractSocket::ConnectedState) {
+        info->clientSocket->write(data);
+    }
+    
+    checkDrainComplete(drain);
+}
+
+void PortForwarder::checkDrainComplete(DrainingConnection* drain)
+{
+    ConnectionInfo* info = drain->info;
+    
+    bool clientFlushed = info->clientSocket->state() != QAbstractSocket::ConnectedState ||
+                         info->clientSocket->bytesToWrite() == 0;
+    bool targetFlushed = !info->targetSocket ||
+                         info->targetSocket->state() != QAbstractSocket::ConnectedState ||
+                         info->targetSocket->bytesToWrite() == 0;
+    
+    if (clientFlushed && targetFlushed && drain->teardownCSeq < 0) {
+        finishDrain(drain, true);
+    }
+}
+
+void PortForwarder::finishDrain(DrainingConnection* drain, bool clean)
+{
+    if (!m_drainingConnections.removeOne(drain)) {
+        return;
+    }
+    
+    drain->deadlineTimer->stop();
+    drain->deadlineTimer->deleteLater();
+    
+    ConnectionInfo* info = drain->info;
+    if (info->clientSocket) {
+        info->clientSocket->disconnect(this);
+        if (clean) {
+            info->clientSocket->disconnectFromHost();
+        } else {
+            info->clientSocket->abort();
+        }
+        info->clientSocket->deleteLater();
+    }
+    if (info->targetSocket) {
+        info->targetSocket->disconnect(this);
+        if (clean) {
+            info->targetSocket->disconnectFromHost();
+        } else {
+            info->targetSocket->abort();
+        }
+        info->targetSocket->deleteLater();
+    }
+    
+    logConnectionDetails(drain->cameraId, info, clean ? "Drained" : "Drain Aborted");
+    emit connectionDrained(drain->cameraId, info->clientAddress, clean);
+    
+    delete info;
+    delete drain;
+}
+
+bool PortForwarder::admitConnection(const QString& cameraId, ForwardingSession* session, QTcpSocket* clientSocket)
+{
+    QString clientAddress = QString("%1:%2")
+        .arg(clientSocket->peerAddress().toString())
+        .arg(clientSocket->peerPort());
+    
+    if (m_maxViewersPerCamera > 0 && session->connections.size() >= m_maxViewersPerCamera) {
+        m_refusedMaxViewers++;
+        LOG_WARNING(QString("Refusing client %1 for camera '%2': viewer limit of %3 reached")
+                    .arg(clientAddress).arg(session->camera.name()).arg(m_maxViewersPerCamera), "PortForwarder");
+        refuseConnection(cameraId, clientSocket, 453, "Not Enough Bandwidth");
+        return false;
+    }
+    
+    if (m_maxConnectionsPerSourceIp > 0 &&
+        countConnectionsFrom(clientSocket->peerAddress()) >= m_maxConnectionsPerSourceIp) {
+        m_refusedSourceIpLimit++;
+        LOG_WARNING(QString("Refusing client %1 for camera '%2': per-source limit of %3 connections reached")
+                    .arg(clientAddress).arg(session->camera.name()).arg(m_maxConnectionsPerSourceIp), "PortForwarder");
+        refuseConnection(cameraId, clientSocket, 503, "Service Unavailable");
+        return false;
+    }
+    
+    // Every admitted connection may grow up to the high watermark before backpressure kicks in
+    qint64 buffered = totalBufferedBytes();
+    if (m_memoryBudget > 0 && buffered + BACKPRESSURE_HIGH_WATERMARK > m_memoryBudget) {
+        m_refusedMemoryBudget++;
+        LOG_WARNING(QString("Refusing client %1 for camera '%2': relay buffers at %3 KB of %4 KB budget")
+                    .arg(clientAddress).arg(session->camera.name())
+                    .arg(buffered / 1024).arg(m_memoryBudget / 1024), "PortForwarder");
+        refuseConnection(cameraId, clientSocket, 503, "Service Unavailable");
+        return false;
+    }
+    
+    return true;
+}
+
+void PortForwarder::refuseConnection(const QString& cameraId, QTcpSocket* clientSocket, int statusCode, const QByteArray& reason)
+{
+    QString clientAddress = QString("%1:%2")
+        .arg(clientSocket->peerAddress().toString())
+        .arg(clientSocket->peerPort());
+    emit connectionRefused(cameraId, clientAddress, statusCode, QString::fromLatin1(reason));
+    
+    // Answer the client's first request so players show a proper error instead of retrying blindly
+    connect(clientSocket, &QTcpSocket::readyRead, clientSocket, [clientSocket, statusCode, reason]() {
+        QByteArray request = clientSocket->peek(clientSocket->bytesAvailable());
+        if (!request.contains("\r\n\r\n") && request.size() < 4096) {
+            return;
+        }
+        clientSocket->readAll();
+        QObject::disconnect(clientSocket, &QTcpSocket::readyRead, nullptr, nullptr);
+        
+        RtspProtocol::HeaderList headers;
+        if (statusCode == 503) {
+            headers.append(qMakePair(QByteArray("Retry-After"), QByteArray("5")));
+        }
+        clientSocket->write(RtspProtocol::buildResponse(statusCode, reason, RtspProtocol::cseq(request), headers));
+        clientSocket->disconnectFromHost();
+    });
+    connect(clientSocket, &QTcpSocket::disconnected, clientSocket, &QObject::deleteLater);
+    
+    // Clients that never send a request are dropped without a reply
+    QTimer::singleShot(REFUSAL_TIMEOUT_MS, clientSocket, [clientSocket]() {
+        clientSocket->abort();
+        clientSocket->deleteLater();
+    });
+}
+
+int PortForwarder::countConnectionsFrom(const QHostAddress& address) const
+{
+    int count = 0;
+    for (auto sessionIt = m_sessions.constBegin(); sessionIt != m_sessions.constEnd(); ++sessionIt) {
+        for (auto connIt = sessionIt.value()->connections.constBegin();
+             connIt != sessionIt.value()->connections.constEnd(); ++connIt) {
+            if (connIt.key()->peerAddress().isEqual(address, QHostAddress::TolerantConversion)) {
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+qint64 PortForwarder::connectionBufferedBytes(const ConnectionInfo* info)
+{
+    qint64 bytes = info->pendingClientData.size() + info->pendingClientWrite.size() + info->pendingTargetWrite.size();
+    if (info->clientSocket) {
+        bytes += info->clientSocket->bytesToWrite() + info->clientSocket->bytesAvailable();
+    }
+    if (info->targetSocket) {
+        bytes += info->targetSocket->bytesToWrite() + info->targetSocket->bytesAvailable();
+    }
+    return bytes;
+}
+
+qint64 PortForwarder::totalBufferedBytes() const
+{
+    qint64 total = 0;
+    for (auto sessionIt = m_sessions.constBegin(); sessionIt != m_sessions.constEnd(); ++sessionIt) {
+        for (const ConnectionInfo* info : sessionIt.value()->connections) {
+            total += connectionBufferedBytes(info);
+        }
+    }
+    for (const DrainingConnection* drain : m_drainingConnections) {
+        total += connectionBufferedBytes(drain->info);
+    }
+    return total;
+}
+
+qint64 PortForwarder::getBufferedBytes(const QString& cameraId) const
+{
+    if (!m_sessions.contains(cameraId)) {
+        return 0;
+    }
+    
+    qint64 total = 0;
+    for (const ConnectionInfo* info : m_sessions[cameraId]->connections) {
+        total += connectionBufferedBytes(info);
+    }
+    return total;
+}
+
+void PortForwarder::applyBackpressure(ConnectionInfo* info, QTcpSocket* to, const QString& cameraId, const QString& direction)
+{
+    bool toClient = (direction == "target->client");
+    const QByteArray& pending = toClient ? info->pendingTargetWrite : info->pendingClientWrite;
+    if (to->bytesToWrite() + pending.size() <= BACKPRESSURE_HIGH_WATERMARK) {
+        return;
+    }
+    
+    bool& paused = toClient ? info->targetReadPaused : info->clientReadPaused;
+    if (!paused) {
+        paused = true;
+        m_backpressureEvents++;
+        LOG_DEBUG(QString("Backpressure on %1 for camera %2 (client %3): %4 KB queued, pausing reads")
+                  .arg(direction).arg(cameraId).arg(info->clientAddress)
+                  .arg((to->bytesToWrite() + pending.size()) / 1024), "PortForwarder");
+    }
+}
+
+RelayStatistics PortForwarder::getRelayStatistics() const
+{
+    RelayStatistics stats;
+    stats.activeSessions = m_sessions.size();
+    stats.drainingConnections = m_drainingConnections.size();
+    stats.memoryBudget = m_memoryBudget;
+    stats.maxViewersPerCamera = m_maxViewersPerCamera;
+    stats.maxConnectionsPerSourceIp = m_maxConnectionsPerSourceIp;
+    stats.refusedMaxViewers = m_refusedMaxViewers;
+    stats.refusedSourceIpLimit = m_refusedSourceIpLimit;
+    stats.refusedMemoryBudget = m_refusedMemoryBudget;
+    stats.backpressureEvents = m_backpressureEvents;
+    stats.bufferedBytes = totalBufferedBytes();
+    
+    for (auto sessionIt = m_sessions.constBegin(); sessionIt != m_sessions.constEnd(); ++sessionIt) {
+        stats.activeConnections += sessionIt.value()->connections.size();
+        stats.upstreamStalls += sessionIt.value()->stallCount;
+        stats.upstreamReconnects += sessionIt.value()->upstreamReconnects;
+        stats.substreamSwitches += sessionIt.value()->substreamSwitches;
+        for (const ConnectionInfo* info : sessionIt.value()->connections) {
+            if (info->clientReadPaused || info->targetReadPaused) {
+                stats.pausedConnections++;
+            }
+            if (info->onSubstream) {
+                stats.connectionsOnSubstream++;
+            }
+        }
+    }
+    
+    return stats;
+}
+
+QJsonObject RelayStatistics::toJson() const
+{
+    QJsonObject json;
+    json["activeSessions"] = activeSessions;
+    json["activeConnections"] = activeConnections;
+    json["drainingConnections"] = drainingConnections;
+    json["bufferedBytes"] = bufferedBytes;
+    json["memoryBudget"] = memoryBudget;
+    json["maxViewersPerCamera"] = maxViewersPerCamera;
+    json["maxConnectionsPerSourceIp"] = maxConnectionsPerSourceIp;
+    json["pausedConnections"] = pausedConnections;
+    json["refusedMaxViewers"] = refusedMaxViewers;
+    json["refusedSourceIpLimit"] = refusedSourceIpLimit;
+    json["refusedMemoryBudget"] = refusedMemoryBudget;
+    json["backpressureEvents"] = backpressureEvents;
+    json["upstreamStalls"] = upstreamStalls;
+    json["upstreamReconnects"] = upstreamReconnects;
+    json["substreamSwitches"] = substreamSwitches;
+    json["connectionsOnSubstream"] = connectionsOnSubstream;
+    return json;
+}
+
+void PortForwarder::bindTargetSocket(QTcpSocket* socket, const CameraConfig& camera)
+{
+    if (!m_networkManager) {
+        return;
+    }
+    
+    QHostAddress cameraIp(camera.ipAddress());
+    QHostAddress bindAddress = m_networkManager->getBestLocalAddress(cameraIp);
+    
+    if (!bindAddress.isNull() && bindAddress != QHostAddress::Any) {
+        if (socket->bind(bindAddress)) {
+            LOG_INFO(QString("Bound outgoing connection to local interface: %1").arg(bindAddress.toString()), "PortForwarder");
+        } else {
+            LOG_WARNING(QString("Failed to bind to local interface %1: %2").arg(bindAddress.toString()).arg(socket->errorString()), "PortForwarder");
+        }
+    }
+}
+
+void PortForwarder::connectTargetSignals(QTcpSocket* socket)
+{
+    connect(socket, &QTcpSocket::disconnected, 
+            this, &PortForwarder::handleTargetDisconnected);
+    connect(socket, &QTcpSocket::readyRead, 
+            this, &PortForwarder::handleTargetDataReady);
+    connect(socket, &QTcpSocket::bytesWritten,  // Non-blocking write buffer flushing
+            this, &PortForwarder::handleBytesWritten);
+    connect(socket, QOverload<QAbstractSocket::SocketError>::of(&QAbstractSocket::errorOccurred),
+            this, &PortForwarder::handleConnectionError);
+}
+
+int PortForwarder::getStallCount(const QString& cameraId) const
+{
+    if (!m_sessions.contains(cameraId)) {
+        return 0;
+    }
+    return m_sessions[cameraId]->stallCount;
+}
+
+int PortForwarder::getUpstreamReconnectCount(const QString& cameraId) const
+{
+    if (!m_sessions.contains(cameraId)) {
+        return 0;
+    }
+    return m_sessions[cameraId]->upstreamReconnects;
+}
+
+void PortForwarder::handleStreamWatchdog()
+{
+    QTimer* timer = qobject_cast<QTimer*>(sender());
+    if (!timer) return;
+    
+    // Find which camera this timer belongs to
+    QString cameraId;
+    for (auto it = m_sessions.begin(); it != m_sessions.end(); ++it) {
+        if (it.value()->stallTimer == timer) {
+            cameraId = it.key();
+            break;
+        }
+    }
+    
+    if (cameraId.isEmpty()) {
+        return;
+    }
+    
+    ForwardingSession* session = m_sessions[cameraId];
+    checkStreamPressure(cameraId, session);
+    
+    int timeoutMs = stallTimeoutFor(session->camera);
+    if (timeoutMs <= 0) {
+        return;
+    }
+    
+    // Only interleaved sessions carry their media through the relay; UDP transport is not watched
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QList<ConnectionInfo*> stalled;
+    for (ConnectionInfo* info : session->connections) {
+        if (info->playing && info->interleaved && !info->upstreamReconnecting && !info->targetReadPaused &&
+            now - info->lastMediaMs > timeoutMs) {
+            stalled.append(info);
+        }
+    }
+    
+    for (ConnectionInfo* info : stalled) {
+        session->stallCount++;
+        LOG_WARNING(QString("No media from camera '%1' for %2 ms (client %3), reconnecting upstream")
+                    .arg(session->camera.name()).arg(now - info->lastMediaMs).arg(info->clientAddress), 
+                    "PortForwarder");
+        emit upstreamStalled(cameraId, info->clientAddress, session->stallCount);
+        startUpstreamReconnect(cameraId, info);
+    }
+}
+
+void PortForwarder::startUpstreamReconnect(const QString& cameraId, ConnectionInfo* info)
+{
+    ForwardingSession* session = m_sessions.value(cameraId);
+    if (!session || info->upstreamReconnecting) {
+        return;
+    }
+    
+    if (info->handshakeRequests.isEmpty() || info->reconnectFailures >= MAX_UPSTREAM_RECONNECT_ATTEMPTS) {
+        // Nothing to replay or the camera keeps failing; let the player reconnect on its own
+        LOG_WARNING(QString("Giving up on upstream for client %1 of camera '%2' after %3 failed attempts")
+                    .arg(info->clientAddress).arg(session->camera.name()).arg(info->reconnectFailures), 
+                    "PortForwarder");
+        info->playing = false;
+        info->clientSocket->disconnectFromHost();
+        return;
+    }
+    
+    // Stay on whichever stream the client is currently being fed
+    QList<QByteArray> requests = info->onSubstream ? substreamHandshake(info->handshakeRequests)
+                                                   : info->handshakeRequests;
+    UpstreamReplay* replay = beginUpstreamReplay(cameraId, info, requests);
+    
+    LOG_INFO(QString("Reconnecting upstream for client %1 of camera '%2' (%3 handshake requests to replay)")
+             .arg(info->clientAddress).arg(session->camera.name()).arg(replay->requests.size()), "PortForwarder");
+}
+
+PortForwarder::UpstreamReplay* PortForwarder::beginUpstreamReplay(const QString& cameraId, ConnectionInfo* info,
+                                                                  const QList<QByteArray>& requests)
+{
+    ForwardingSession* session = m_sessions.value(cameraId);
+    info->upstreamReconnecting = true;
+    
+    UpstreamReplay* replay = new UpstreamReplay;
+    replay->cameraId = cameraId;
+    replay->info = info;
+    replay->requests = requests;
+    replay->index = 0;
+    replay->cseq = 0;
+    replay->authRetried = false;
+    replay->nonceCount = 0;
+    replay->streamSwitch = false;
+    replay->toSubstream = false;
+    replay->awaitingKeyframe = false;
+    replay->videoCodec = RtpInterleavedParser::CodecUnknown;
+    replay->videoPayloadType = -1;
+    replay->socket = new QTcpSocket(this);
+    replay->deadlineTimer = new QTimer(this);
+    replay->deadlineTimer->setSingleShot(true);
+    m_upstreamReplays.append(replay);
+    
+    optimizeSocketForStreaming(replay->socket);
+    bindTargetSocket(replay->socket, session->camera);
+    
+    connect(replay->deadlineTimer, &QTimer::timeout, this, [this, replay]() {
+        LOG_WARNING(QString("Upstream handshake replay timed out for camera %1").arg(replay->cameraId), "PortForwarder");
+        finishUpstreamReplay(replay, false);
+    });
+    connect(replay->socket, &QTcpSocket::connected, this, [this, replay]() {
+        sendReplayRequest(replay);
+    });
+    connect(replay->socket, &QTcpSocket::readyRead, this, [this, replay]() {
+        handleReplayData(replay);
+    });
+    connect(replay->socket, QOverload<QAbstractSocket::SocketError>::of(&QAbstractSocket::errorOccurred),
+            this, [this, replay](QAbstractSocket::SocketError) {
+        LOG_WARNING(QString("Upstream reconnect to camera %1 failed: %2")
+                    .arg(replay->cameraId).arg(replay->socket->errorString()), "PortForwarder");
+        finishUpstreamReplay(replay, false);
+    });
+    
+    replay->deadlineTimer->start(UPSTREAM_REPLAY_TIMEOUT_MS);
+    replay->socket->connectToHost(session->camera.ipAddress(), session->camera.port());
+    return replay;
+}
+
+void PortForwarder::sendReplayRequest(UpstreamReplay* replay)
+{
+    ForwardingSession* session = m_sessions.value(replay->cameraId);
+    if (!session) {
+        return;
+    }
+    
+    QByteArray request = replay->requests.at(replay->index);
+    QByteArray method = RtspProtocol::requestMethod(request);
+    QByteArray url = RtspProtocol::requestUrl(request);
+    
+    request = RtspProtocol::withHeader(request, "CSeq", QByteArray::number(++replay->cseq));
+    request = RtspProtocol::withHeader(request, "Session", replay->sessionId);
+    
+    // Digest answers from the client are bound to the old connection's nonce
+    QByteArray authorization = RtspProtocol::headerValue(request, "Authorization");
+    if (!replay->challenges.isEmpty()) {
+        authorization = RtspProtocol::authorization(replay->challenges, method, url,
+                                                    session->camera.username(), session->camera.password(),
+                                                    ++replay->nonceCount);
+    } else if (authorization.toLower().startsWith("digest")) {
+        authorization.clear();
+    }
+    request = RtspProtocol::withHeader(request, "Authorization", authorization);
+    
+    LOG_DEBUG(QString("Replaying %1 %2 to camera %3").arg(QString::fromLatin1(method))
+              .arg(QString::fromLatin1(url)).arg(replay->cameraId), "PortForwarder");
+    replay->socket->write(request);
+}
+
+void PortForwarder::handleReplayData(UpstreamReplay* replay)
+{
+    replay->buffer.append(replay->socket->readAll());
+    
+    while (!replay->awaitingKeyframe && replay->index < replay->requests.size()) {
+        int length = RtspProtocol::messageLength(replay->buffer);
+        if (length < 0) {
+            if (replay->buffer.size() > 65536) {
+                LOG_WARNING(QString("Oversized reply during upstream replay for camera %1").arg(replay->cameraId), "PortForwarder");
+                finishUpstreamReplay(replay, false);
+            }
+            return;
+        }
+        
+        QByteArray response = replay->buffer.left(length);
+        replay->buffer.remove(0, length);
+        QByteArray method = RtspProtocol::requestMethod(replay->requests.at(replay->index));
+        
+        int status = RtspProtocol::statusCode(response);
+        if (status == 401 && !replay->authRetried) {
+            replay->authRetried = true;
+            replay->challenges = RtspProtocol::headerValues(response, "WWW-Authenticate");
+            replay->nonceCount = 0;
+            sendReplayRequest(replay);
+            continue;
+        }
+        
+        if (status != 200) {
+            LOG_WARNING(QString("Camera %1 answered replayed %2 with status %3")
+                        .arg(replay->cameraId).arg(QString::fromLatin1(method)).arg(status), "PortForwarder");
+            if (replay->streamSwitch && replay->toSubstream && method == "DESCRIBE" && m_sessions.contains(replay->cameraId)) {
+                m_sessions[replay->cameraId]->substreamUnsupported = true;
+            }
+            finishUpstreamReplay(replay, false);
+            return;
+        }
+        
+        if (method == "DESCRIBE") {
+            QByteArray encoding;
+            const QByteArray sdp = response.mid(response.indexOf("\r\n\r\n") + 4);
+            RtspProtocol::sdpVideoFormat(sdp, replay->videoPayloadType, encoding);
+            replay->videoCodec = videoCodecFor(encoding);
+            replay->parameterSets = RtspProtocol::sdpParameterSets(sdp);
+            
+            // A decoder set up for one codec cannot continue on another mid-stream
+            const QByteArray& clientEncoding = replay->info->videoEncoding;
+            if (replay->streamSwitch && !clientEncoding.isEmpty() && !encoding.isEmpty() && encoding != clientEncoding) {
+                LOG_WARNING(QString("Substream of camera %1 uses %2 but the client negotiated %3, disabling substream switching")
+                            .arg(replay->cameraId).arg(QString::fromLatin1(encoding))
+                            .arg(QString::fromLatin1(clientEncoding)), "PortForwarder");
+                if (m_sessions.contains(replay->cameraId)) {
+                    m_sessions[replay->cameraId]->substreamUnsupported = true;
+                }
+                finishUpstreamReplay(replay, false);
+                return;
+            }
+        }
+        
+        QByteArray sessionId = RtspProtocol::sessionId(response);
+        if (!sessionId.isEmpty()) {
+            replay->sessionId = sessionId;
+        }
+        
+        replay->authRetried = false;
+        replay->index++;
+        if (replay->index < replay->requests.size()) {
+            sendReplayRequest(replay);
+        } else if (replay->streamSwitch && replay->videoCodec != RtpInterleavedParser::CodecUnknown) {
+            // Keep the old stream on screen until the new one can start with a keyframe
+            replay->awaitingKeyframe = true;
+            replay->keyframeScanner.setHoldIncompleteFrames(true);
+            replay->deadlineTimer->start(KEYFRAME_WAIT_MS);
+        }
+    }
+    
+    if (replay->awaitingKeyframe && !scanForKeyframe(replay)) {
+        return;
+    }
+    
+    // PLAY answered; whatever follows the reply in the buffer is already media
+    finishUpstreamReplay(replay, true);
+}
+
+bool PortForwarder::scanForKeyframe(UpstreamReplay* replay)
+{
+    // The client's decoder still holds the old stream's SPS/PPS (often only from the
+    // SDP it was given), so the cut has to bring the new ones: an access unit that
+    // starts with SPS (VPS for H.265), or an IDR led by the sets from the new SDP
+    int keyframeOffset = -1;
+    int keyframeChannel = -1;
+    unsigned char keyframeHeader[12];
+    bool injectParameterSets = false;
+    char* base = replay->buffer.data();
+    const int payloadType = replay->videoPayloadType;
+    const RtpInterleavedParser::VideoCodec codec = replay->videoCodec;
+    const bool haveParameterSets = !replay->parameterSets.isEmpty();
+    
+    int consumed = replay->keyframeScanner.feed(base, replay->buffer.size(),
+        [&](int channel, unsigned char* prefix, int length, int, bool) {
+            if (keyframeOffset >= 0 || length < 12 || (prefix[1] & 0x7F) != payloadType ||
+                !RtpInterleavedParser::isKeyframeStart(prefix, length, codec)) {
+                return;
+            }
+            const bool leadsWithParameterSets = RtpInterleavedParser::isParameterSetStart(prefix, length, codec);
+            if (!leadsWithParameterSets && !haveParameterSets) {
+                return;                 // Wait for one that carries SPS in-band
+            }
+            keyframeOffset = static_cast<int>(reinterpret_cast<char*>(prefix) - base) - 4;
+            keyframeChannel = channel;
+            injectParameterSets = !leadsWithParameterSets;
+            std::memcpy(keyframeHeader, prefix, sizeof(keyframeHeader));
+        });
+    
+    if (keyframeOffset >= 0) {
+        replay->buffer.remove(0, keyframeOffset);
+        if (injectParameterSets) {
+            replay->buffer.prepend(parameterSetPackets(replay->parameterSets, keyframeChannel, keyframeHeader));
+        }
+        return true;
+    }
+    
+    // Nothing before the keyframe is decodable; keep only an incomplete trailing frame
+    replay->buffer.remove(0, consumed);
+    return false;
+}
+
+QByteArray PortForwarder::parameterSetPackets(const QList<QByteArray>& parameterSets, int channel,
+                                              const unsigned char* keyframeHeader)
+{
+    // One single-NAL packet per set, numbered just ahead of the keyframe's first
+    // packet and sharing its timestamp and SSRC; the RTP rewrite renumbers them
+    // with the rest of the new stream
+    const quint16 keyframeSeq = qFromBigEndian<quint16>(keyframeHeader + 2);
+    QByteArray packets;
+    quint16 seq = quint16(keyframeSeq - parameterSets.size());
+    for (const QByteArray& nal : parameterSets) {
+        const int length = 12 + nal.size();
+        if (length > 0xFFFF) {
+            continue;
+        }
+        unsigned char header[16];
+        header[0] = '$';
+        header[1] = static_cast<unsigned char>(channel);
+        qToBigEndian(quint16(length), header + 2);
+        header[4] = 0x80;                               // RTP version 2, no padding/extension/CSRC
+        header[5] = keyframeHeader[1] & 0x7F;           // Payload type, marker clear
+        qToBigEndian(seq++, header + 6);
+        std::memcpy(header + 8, keyframeHeader + 4, 8);   // Timestamp and SSRC
+        packets.append(reinterpret_cast<const char*>(header), sizeof(header));
+        packets.append(nal);
+    }
+    return packets;
+}
+
+void PortForwarder::finishUpstreamReplay(UpstreamReplay* replay, bool success)
+{
+    if (!m_upstreamReplays.removeOne(replay)) {
+        return;
+    }
+    
+    replay->deadlineTimer->stop();
+    replay->deadlineTimer->deleteLater();
+    replay->socket->disconnect(this);
+    
+    ConnectionInfo* info = replay->info;
+    info->upstreamReconnecting = false;
+    info->lastMediaMs = QDateTime::currentMSecsSinceEpoch();  // Full stall period before judging again
+    
+    ForwardingSession* session = m_sessions.value(replay->cameraId);
+    if (!success || !session) {
+        replay->socket->abort();
+        replay->socket->deleteLater();
+        
+        if (replay->streamSwitch) {
+            // The current stream keeps playing; wait out the cooldown before trying again
+            info->lastSwitchMs = QDateTime::currentMSecsSinceEpoch();
+            info->pressureTicks = 0;
+            info->headroomTicks = 0;
+        } else {
+            info->reconnectFailures++;
+            
+            // The old upstream is gone for good; retry now rather than waiting for the watchdog
+            if (session && (!info->targetSocket || info->targetSocket->state() != QAbstractSocket::ConnectedState)) {
+                startUpstreamReconnect(replay->cameraId, info);
+            }
+        }
+        delete replay;
+        return;
+    }
+    
+    // Later client requests are signed against the new upstream's challenge
+    info->upstreamChallenges = replay->challenges;
+    info->upstreamNonceCount = replay->nonceCount;
+    
+    // The new upstream may number its video payload differently
+    if (replay->videoPayloadType >= 0) {
+        info->videoPayloadType = replay->videoPayloadType;
+        info->videoCodec = replay->videoCodec;
+    }
+    
+    // A stalled upstream is abandoned; a healthy one being switched away from is torn down properly
+    cutOverUpstream(replay->cameraId, info, replay->socket, replay->sessionId, replay->buffer, replay->streamSwitch);
+    
+    if (replay->streamSwitch) {
+        info->onSubstream = replay->toSubstream;
+        info->lastSwitchMs = QDateTime::currentMSecsSinceEpoch();
+        session->substreamSwitches++;
+        LOG_INFO(QString("Client %1 of camera '%2' switched to the %3 stream")
+                 .arg(info->clientAddress).arg(session->camera.name())
+                 .arg(info->onSubstream ? "sub" : "main"), "PortForwarder");
+        emit substreamSwitched(replay->cameraId, info->clientAddress, info->onSubstream);
+    } else {
+        info->reconnectFailures = 0;
+        session->upstreamReconnects++;
+        LOG_INFO(QString("Upstream for client %1 of camera '%2' restored (session %3 -> %4)")
+                 .arg(info->clientAddress).arg(session->camera.name())
+                 .arg(QString::fromLatin1(info->clientSessionId)).arg(QString::fromLatin1(info->rtspSessionId)), 
+                 "PortForwarder");
+        emit upstreamReconnected(replay->cameraId, info->clientAddress);
+    }
+    
+    delete replay;
+}
+
+void PortForwarder::cancelUpstreamReplay(ConnectionInfo* info)
+{
+    for (UpstreamReplay* replay : m_upstreamReplays) {
+        if (replay->info != info) {
+            continue;
+        }
+        
+        m_upstreamReplays.removeOne(replay);
+        replay->deadlineTimer->stop();
+        replay->deadlineTimer->deleteLater();
+        replay->socket->disconnect(this);
+        replay->socket->abort();
+        replay->socket->deleteLater();
+        info->upstreamReconnecting = false;
+        delete replay;
+        return;
+    }
+}
+
+void PortForwarder::cutOverUpstream(const QString& cameraId, ConnectionInfo* info, QTcpSocket* socket,
+                                    const QByteArray& sessionId, QByteArray initialData, bool retireOld)
+{
+    QTcpSocket* clientSocket = info->clientSocket;
+    bool clientConnected = clientSocket->state() == QAbstractSocket::ConnectedState;
+    
+    // Close the frame the client is in the middle of so its interleaved framing stays aligned
+    if (clientConnected) {
+        if (!info->pendingTargetWrite.isEmpty()) {
+            clientSocket->write(info->pendingTargetWrite);
+        }
+        
+        unsigned char header[4];
+        int padding = 0;
+        int headerBytes = info->rtpParser.frameCompletion(header, padding);
+        if (headerBytes > 0 || padding > 0) {
+            QByteArray completion(reinterpret_cast<const char*>(header), headerBytes);
+            completion.append(QByteArray(padding, '\0'));
+            clientSocket->write(completion);
+            LOG_DEBUG(QString("Padded %1 bytes to finish the interrupted frame for client %2")
+                      .arg(completion.size()).arg(info->clientAddress), "PortForwarder");
+        }
+    }
+    info->pendingTargetWrite.clear();
+    info->rtpCarry.clear();
+    
+    QTcpSocket* oldSocket = info->targetSocket;
+    if (oldSocket) {
+        m_socketToCameraMap.remove(oldSocket);
+        oldSocket->disconnect(this);
+        if (retireOld) {
+            retireUpstream(info, oldSocket);
+        } else {
+            oldSocket->abort();
+            oldSocket->deleteLater();
+        }
+    }
+    
+    info->targetSocket = socket;
+    info->isTargetConnected = true;
+    info->targetReadPaused = false;
+    info->clientReadPaused = false;
+    info->pendingClientWrite.clear();
+    info->rtspSessionId = sessionId;
+    info->lastMediaMs = QDateTime::currentMSecsSinceEpoch();
+    m_socketToCameraMap[socket] = cameraId;
+    connectTargetSignals(socket);
+    
+    // From here on the client is fed from a different upstream; keep its RTP numbering continuous
+    info->rtpRewrite = true;
+    info->rtpParser.reset();
+    info->rtpParser.setHoldIncompleteFrames(true);
+    for (RtpChannelState& channel : info->rtpChannels) {
+        channel.remapPending = channel.seen;
+    }
+    if (info->analyzed && m_sessions.contains(cameraId)) {
+        m_sessions[cameraId]->analyzer.setVideoFormat(info->videoPayloadType, info->videoCodec);
+    }
+    
+    processTargetMedia(info, initialData, streamAnalyzerFor(m_sessions.value(cameraId), info));
+    if (clientConnected && !initialData.isEmpty()) {
+        clientSocket->write(initialData);
+    }
+    if (socket->bytesAvailable() > 0) {
+        forwardData(info, socket, clientSocket, cameraId, "target->client");
+    }
+}
+
+void PortForwarder::retireUpstream(ConnectionInfo* info, QTcpSocket* socket)
+{
+    if (socket->state() != QAbstractSocket::ConnectedState ||
+        info->rtspSessionId.isEmpty() || info->rtspUrl.isEmpty()) {
+        socket->abort();
+        socket->deleteLater();
+        return;
+    }
+    
+    // Release the camera-side session; disconnectFromHost() flushes the TEARDOWN first
+    RtspProtocol::HeaderList headers;
+    headers.append(qMakePair(QByteArray("Session"), info->rtspSessionId));
+    socket->write(RtspProtocol::buildRequest("TEARDOWN", upstreamUrl(info), info->lastCSeq + 1, headers));
+    connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+    socket->disconnectFromHost();
+    
+    QTimer::singleShot(DRAIN_TIMEOUT_MS, socket, [socket]() {
+        socket->abort();
+        socket->deleteLater();
+    });
+}
+
+void PortForwarder::processTargetMedia(ConnectionInfo* info, QByteArray& data, StreamAnalyzer* analyzer)
+{
+    if (!info->interleaved || data.isEmpty()) {
+        return;
+    }
+    
+    // Only RTP counts as media for the stall watchdog; RTCP on the odd channels keeps
+    // flowing from cameras whose encoder has stopped
+    RtpChannelState* channels = info->rtpChannels;
+    const bool rewrite = info->rtpRewrite;
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    qint64& lastMediaMs = info->lastMediaMs;
+    auto onFrame = [channels, rewrite, analyzer, now, &lastMediaMs](int channel, unsigned char* prefix, int length, int frameLength, bool inPlace) {
+        if (channel % 2 == 0) {
+            lastMediaMs = now;
+        }
+        if (analyzer) {
+            analyzer->addPacket(now, channel, prefix, length, frameLength);
+        }
+        updateRtpChannel(channels, channel, prefix, length, rewrite && inPlace);
+    };
+    
+    if (!rewrite) {
+        info->rtpParser.feed(data.data(), data.size(), onFrame);
+        return;
+    }
+    
+    // Headers are rewritten in place, so a frame whose prefix is split waits for the next read
+    if (!info->rtpCarry.isEmpty()) {
+        data.prepend(info->rtpCarry);
+        info->rtpCarry.clear();
+    }
+    int consumed = info->rtpParser.feed(data.data(), data.size(), onFrame);
+    if (consumed < data.size()) {
+        info->rtpCarry = data.mid(consumed);
+        data.truncate(consumed);
+    }
+}
+
+StreamAnalyzer* PortForwarder::streamAnalyzerFor(ForwardingSession* session, ConnectionInfo* info)
+{
+    if (!session || !info->playing) {
+        return nullptr;
+    }
+    if (info->analyzed) {
+        return &session->analyzer;
+    }
+    
+    // All viewers of a camera receive the same stream; only one of them is measured
+    for (const ConnectionInfo* other : session->connections) {
+        if (other->analyzed) {
+            return nullptr;
+        }
+    }
+    
+    // History is kept across viewers; only the format follows the new source
+    info->analyzed = true;
+    session->analyzer.setVideoFormat(info->videoPayloadType, info->videoCodec);
+    return &session->analyzer;
+}
+
+RtpInterleavedParser::VideoCodec PortForwarder::videoCodecFor(const QByteArray& encoding)
+{
+    if (encoding == "H264") {
+        return RtpInterleavedParser::CodecH264;
+    }
+    if (encoding == "H265" || encoding == "HEVC") {
+        return RtpInterleavedParser::CodecH265;
+    }
+    return RtpInterleavedParser::CodecUnknown;
+}
+
+void PortForwarder::updateRtpChannel(RtpChannelState* channels, int channel, unsigned char* prefix, int length, bool rewrite)
+{
+    if (channel >= RTP_TRACKED_CHANNELS) {
+        return;
+    }
+    
+    // RTCP on the odd channel: keep the sender SSRC consistent with the rewritten RTP
+    if (channel % 2 == 1) {
+        const RtpChannelState& rtp = channels[channel - 1];
+        if (rewrite && rtp.seen && length >= 8) {
+            qToBigEndian(rtp.ssrc, prefix + 4);
+        }
+        return;
+    }
+    
+    if (length < 12 || (prefix[0] >> 6) != 2) {
+        return;
+    }
+    
+    RtpChannelState& state = channels[channel];
+    quint16 seq = qFromBigEndian<quint16>(prefix + 2);
+    quint32 timestamp = qFromBigEndian<quint32>(prefix + 4);
+    
+    if (!state.seen) {
+        state = RtpChannelState();
+        state.seen = true;
+        state.ssrc = qFromBigEndian<quint32>(prefix + 8);
+        state.lastSeq = quint16(seq - 1);
+        state.lastTimestamp = timestamp;
+    }
+    
+    if (rewrite) {
+        if (state.remapPending) {
+            quint32 step = state.timestampStep ? state.timestampStep : quint32(DEFAULT_RTP_TIMESTAMP_STEP);
+            state.seqOffset = quint16(state.lastSeq + 1 - seq);
+            state.timestampOffset = state.lastTimestamp + step - timestamp;
+            state.remapPending = false;
+        }
+        seq = quint16(seq + state.seqOffset);
+        timestamp += state.timestampOffset;
+        qToBigEndian(seq, prefix + 2);
+        qToBigEndian(timestamp, prefix + 4);
+        qToBigEndian(state.ssrc, prefix + 8);
+    }
+    
+    quint32 delta = timestamp - state.lastTimestamp;
+    if (delta != 0 && delta < 90000) {
+        state.timestampStep = delta;
+    }
+    state.lastSeq = seq;
+    state.lastTimestamp = timestamp;
+}
+
+QByteArray PortForwarder::upstreamUrl(const ConnectionInfo* info)
+{
+    if (info->onSubstream) {
+        QByteArray url = RtspProtocol::substreamUrl(info->rtspUrl);
+        if (!url.isEmpty()) {
+            return url;
+        }
+    }
+    return info->rtspUrl;
+}
+
+QList<QByteArray> PortForwarder::substreamHandshake(const QList<QByteArray>& requests)
+{
+    QList<QByteArray> rewritten;
+    for (const QByteArray& request : requests) {
+        QByteArray url = RtspProtocol::substreamUrl(RtspProtocol::requestUrl(request));
+        if (url.isEmpty()) {
+            // The presentation URL must follow a known convention; relative track URLs may not
+            if (RtspProtocol::requestMethod(request) == "DESCRIBE") {
+                return QList<QByteArray>();
+            }
+            rewritten.append(request);
+        } else {
+            rewritten.append(RtspProtocol::withRequestUrl(request, url));
+        }
+    }
+    return rewritten;
+}
+
+void PortForwarder::checkStreamPressure(const QString& cameraId, ForwardingSession* session)
+{
+    if (!session->camera.adaptiveSubstream() || session->substreamUnsupported) {
+        return;
+    }
+    
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QList<QPair<ConnectionInfo*, bool>> switches;
+    
+    for (ConnectionInfo* info : session->connections) {
+        if (!info->playing || !info->interleaved || info->upstreamReconnecting) {
+            continue;
+        }
+        
+        // Client-side queueing is the throughput signal: the tunnel drains slower than the camera fills it
+        qint64 queued = info->clientSocket->bytesToWrite() + info->pendingTargetWrite.size();
+        if (queued > PRESSURE_QUEUE_BYTES || info->targetReadPaused) {
+            info->pressureTicks++;
+            info->headroomTicks = 0;
+        } else if (queued < HEADROOM_QUEUE_BYTES) {
+            info->headroomTicks++;
+            info->pressureTicks = 0;
+        }
+        
+        if (!info->onSubstream && info->pressureTicks >= PRESSURE_TICKS &&
+            now - info->lastSwitchMs >= SWITCH_COOLDOWN_MS) {
+            switches.append(qMakePair(info, true));
+        } else if (info->onSubstream &&
+                   qint64(info->headroomTicks) * STALL_CHECK_INTERVAL_MS >= info->switchHoldoffMs) {
+            switches.append(qMakePair(info, false));
+        }
+    }
+    
+    for (const auto& entry : switches) {
+        startStreamSwitch(cameraId, entry.first, entry.second);
+    }
+}
+
+void PortForwarder::startStreamSwitch(const QString& cameraId, ConnectionInfo* info, bool toSubstream)
+{
+    ForwardingSession* session = m_sessions.value(cameraId);
+    if (!session || info->upstreamReconnecting || info->handshakeRequests.isEmpty()) {
+        return;
+    }
+    
+    QList<QByteArray> requests = toSubstream ? substreamHandshake(info->handshakeRequests)
+                                             : info->handshakeRequests;
+    if (requests.isEmpty()) {
+        LOG_WARNING(QString("Camera '%1' stream URL has no known substream form, adaptive switching disabled")
+                    .arg(session->camera.name()), "PortForwarder");
+        session->substreamUnsupported = true;
+        return;
+    }
+    
+    if (toSubstream) {
+        // Falling back again soon after returning to main means the link still cannot carry it
+        qint64 now = QDateTime::currentMSecsSinceEpoch();
+        if (info->lastSwitchMs > 0 && now - info->lastSwitchMs < 2 * qint64(info->switchHoldoffMs)) {
+            info->switchHoldoffMs = qMin(info->switchHoldoffMs * 2, int(SUBSTREAM_MAX_HOLDOFF_MS));
+        } else {
+            info->switchHoldoffMs = SUBSTREAM_MIN_HOLDOFF_MS;
+        }
+    }
+    
+    info->pressureTicks = 0;
+    info->headroomTicks = 0;
+    
+    LOG_INFO(QString("%1 for client %2 of camera '%3' (hold-off %4 s)")
+             .arg(toSubstream ? "Client queue is backing up, switching to substream"
+                              : "Headroom recovered, switching back to main stream")
+             .arg(info->clientAddress).arg(session->camera.name()).arg(info->switchHoldoffMs / 1000), 
+             "PortForwarder");
+    
+    UpstreamReplay* replay = beginUpstreamReplay(cameraId, info, requests);
+    replay->streamSwitch = true;
+    replay->toSubstream = toSubstream;
+}
+
+int PortForwarder::getSubstreamSwitchCount(const QString& cameraId) const
+{
+    if (!m_sessions.contains(cameraId)) {
+        return 0;
+    }
+    return m_sessions[cameraId]->substreamSwitches;
+}
+
+bool PortForwarder::isOnSubstream(const QString& cameraId) const
+{
+    if (!m_sessions.contains(cameraId)) {
+        return false;
+    }
+    
+    for (const ConnectionInfo* info : m_sessions[cameraId]->connections) {
+        if (info->onSubstream) {
+            return true;
+        }
+    }
+    return false;
+}
+
+StreamEstimate PortForwarder::getStreamEstimate(const QString& cameraId, StreamAnalyzer::Window window) const
+{
+    if (!m_sessions.contains(cameraId)) {
+        return StreamEstimate();
+    }
+    return m_sessions[cameraId]->analyzer.estimate(window, QDateTime::currentMSecsSinceEpoch());
+}
+
+qint64 PortForwarder::getKeyframeIntervalMs(const QString& cameraId) const
+{
+    if (!m_sessions.contains(cameraId)) {
+        return 0;
+    }
+    return m_sessions[cameraId]->analyzer.lastKeyframeIntervalMs();
+}
@@ -0,0 +1,645 @@
+#include "RtspProtocol.h"
+#include <QCryptographicHash>
+#include <QHash>
+#include <QRandomGenerator>
+#include <QRegularExpression>
+
+namespace {
+
+const char* const kRequestMethods[] = {
+    "OPTIONS ", "DESCRIBE ", "SETUP ", "PLAY ", "PAUSE ", "TEARDOWN ",
+    "RECORD ", "ANNOUNCE ", "REDIRECT ", "GET_PARAMETER ", "SET_PARAMETER "
+};
+
+int headerSectionEnd(const QByteArray& message)
+{
+    int end = message.indexOf("\r\n\r\n");
+    return end < 0 ? message.size() : end;
+}
+
+QByteArray firstLine(const QByteArray& message)
+{
+    int end = message.indexOf("\r\n");
+    return end < 0 ? message : message.left(end);
+}
+
+QByteArray md5Hex(const QByteArray& data)
+{
+    return QCryptographicHash::hash(data, QCryptographicHash::Md5).toHex();
+}
+
+// Parses 'Digest realm="x", nonce="y", qop="auth"' into lower-case keys
+QHash<QByteArray, QByteArray> parseAuthParams(const QByteArray& challenge)
+{
+    QHash<QByteArray, QByteArray> params;
+    int pos = challenge.indexOf(' ');
+    if (pos < 0) {
+        return params;
+    }
+
+    while (pos < challenge.size()) {
+        while (pos < challenge.size() && (challenge[pos] == ' ' || challenge[pos] == ',')) {
+            pos++;
+        }
+        int equals = challenge.indexOf('=', pos);
+        if (equals < 0) {
+            break;
+        }
+
+        QByteArray key = challenge.mid(pos, equals - pos).trimmed().toLower();
+        QByteArray value;
+        pos = equals + 1;
+        if (pos < challenge.size() && challenge[pos] == '"') {
+            int close = challenge.indexOf('"', pos + 1);
+            if (close < 0) {
+                close = challenge.size();
+            }
+            value = challenge.mid(pos + 1, close - pos - 1);
+            pos = close + 1;
+        } else {
+            int comma = challenge.indexOf(',', pos);
+            if (comma < 0) {
+                comma = challenge.size();
+            }
+            value = challenge.mid(pos, comma - pos).trimmed();
+            pos = comma;
+        }
+        params.insert(key, value);
+    }
+    return params;
+}
+
+// Exp-Golomb reader over an RBSP (emulation prevention bytes already removed)
+class BitReader
+{
+public:
+    explicit BitReader(const QByteArray& data) : m_data(data), m_bit(0), m_failed(false) {}
+
+    bool atEnd() const { return m_bit >= m_data.size() * 8; }
+    bool failed() const { return m_failed; }   // A code longer than 32 bits was read
+
+    quint32 bits(int count)
+    {
+        quint32 value = 0;
+        for (int i = 0; i < count; ++i) {
+            value = (value << 1) | bit();
+        }
+        return value;
+    }
+
+    quint32 ue()
+    {
+        int zeros = 0;
+        while (!atEnd() && bit() == 0) {
+            if (++zeros > 31) {
+                m_failed = true;
+                return 0;
+            }
+        }
+        return ((1u << zeros) - 1) + bits(zeros);
+    }
+
+    qint32 se()
+    {
+        quint32 code = ue();
+        return (code & 1) ? qint32((code + 1) / 2) : -qint32(code / 2);
+    }
+
+private:
+    quint32 bit()
+    {
+        if (atEnd()) {
+            return 0;
+        }
+        quint32 value = (uchar(m_data.at(m_bit / 8)) >> (7 - m_bit % 8)) & 1;
+        m_bit++;
+        return value;
+    }
+
+    QByteArray m_data;
+    int m_bit;
+    bool m_failed;
+};
+
+// Cropped picture size from an H.264 sequence parameter set NAL unit (ITU-T H.264 7.3.2.1.1)
+bool h264SpsResolution(const QByteArray& nal, int& width, int& height)
+{
+    if (nal.size() < 4 || (nal.at(0) & 0x1f) != 7) {
+        return false;
+    }
+
+    QByteArray rbsp;
+    rbsp.reserve(nal.size());
+    int zeros = 0;
+    for (int i = 1; i < nal.size(); ++i) {
+        const char byte = nal.at(i);
+        if (zeros >= 2 && byte == 0x03) {
+            zeros = 0;
+            continue;
+        }
+        zeros = byte == 0 ? zeros + 1 : 0;
+        rbsp.append(byte);
+    }
+
+    BitReader reader(rbsp);
+    const quint32 profile = reader.bits(8);
+    reader.bits(16);                            // Constraint flags, level_idc
+    reader.ue();                                // seq_parameter_set_id
+
+    quint32 chromaFormat = 1;
+    if (profile == 100 || profile == 110 || profile == 122 || profile == 244 || profile == 44 ||
+        profile == 83 || profile == 86 || profile == 118 || profile == 128 || profile == 138 ||
+        profile == 139 || profile == 134 || profile == 135) {
+        chromaFormat = reader.ue();
+        if (chromaFormat == 3) {
+            reader.bits(1);                     // separate_colour_plane_flag
+        }
+        reader.ue();                            // bit_depth_luma_minus8
+        reader.ue();                            // bit_depth_chroma_minus8
+        reader.bits(1);                         // qpprime_y_zero_transform_bypass_flag
+        if (reader.bits(1)) {                   // seq_scaling_matrix_present_flag
+            const int lists = chromaFormat == 3 ? 12 : 8;
+            for (int i = 0; i < lists; ++i) {
+                if (!reader.bits(1)) {
+                    continue;
+                }
+                const int size = i < 6 ? 16 : 64;
+                int lastScale = 8;
+                int nextScale = 8;
+                for (int j = 0; j < size; ++j) {
+                    if (nextScale != 0) {
+                        nextScale = (lastScale + reader.se() + 256) % 256;
+                    }
+                    lastScale = nextScale == 0 ? lastScale : nextScale;
+                }
+            }
+        }
+    }
+
+    reader.ue();                                // log2_max_frame_num_minus4
+    const quint32 pocType = reader.ue();
+    if (pocType == 0) {
+        reader.ue();                            // log2_max_pic_order_cnt_lsb_minus4
+    } else if (pocType == 1) {
+        reader.bits(1);                         // delta_pic_order_always_zero_flag
+        reader.se();                            // offset_for_non_ref_pic
+        reader.se();                            // offset_for_top_to_bottom_field
+        const quint32 cycle = reader.ue();
+        for (quint32 i = 0; i < cycle && !reader.atEnd(); ++i) {
+            reader.se();
+        }
+    }
+
+    reader.ue();                                // max_num_ref_frames
+    reader.bits(1);                             // gaps_in_frame_num_value_allowed_flag
+    const quint32 widthInMbs = reader.ue() + 1;
+    const quint32 heightInMapUnits = reader.ue() + 1;
+    const quint32 frameMbsOnly = reader.bits(1);
+    if (!frameMbsOnly) {
+        reader.bits(1);                         // mb_adaptive_frame_field_flag
+    }
+    reader.bits(1);                             // direct_8x8_inference_flag
+
+    quint32 cropLeft = 0, cropRight = 0, cropTop = 0, cropBottom = 0;
+    if (reader.bits(1)) {
+        cropLeft = reader.ue();
+        cropRight = reader.ue();
+        cropTop = reader.ue();
+        cropBottom = reader.ue();
+    }
+    if (reader.atEnd() || reader.failed()) {
+        return false;
+    }
+
+    const quint32 cropUnitX = chromaFormat == 0 ? 1 : (chromaFormat == 3 ? 1 : 2);
+    const quint32 cropUnitY = (chromaFormat == 1 ? 2 : 1) * (2 - frameMbsOnly);
+    const qint64 w = qint64(widthInMbs) * 16 - qint64(cropUnitX) * (cropLeft + cropRight);
+    const qint64 h = qint64(heightInMapUnits) * 16 * (2 - frameMbsOnly) - qint64(cropUnitY) * (cropTop + cropBottom);
+    if (w <= 0 || h <= 0 || w > 16384 || h > 16384) {
+        return false;
+    }
+    width = int(w);
+    height = int(h);
+    return true;
+}
+
+}
+
+bool RtspProtocol::isRequest(const QByteArray& data)
+{
+    for (const char* method : kRequestMethods) {
+        if (data.startsWith(method)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool RtspProtocol::isResponse(const QByteArray& data)
+{
+    return data.startsWith("RTSP/");
+}
+
+QByteArray RtspProtocol::requestMethod(const QByteArray& message)
+{
+    if (!isRequest(message)) {
+        return QByteArray();
+    }
+    return message.left(message.indexOf(' '));
+}
+
+QByteArray RtspProtocol::requestUrl(const QByteArray& message)
+{
+    if (!isRequest(message)) {
+        return QByteArray();
+    }
+
+    QList<QByteArray> parts = firstLine(message).split(' ');
+    return parts.size() >= 2 ? parts.at(1) : QByteArray();
+}
+
+int RtspProtocol::statusCode(const QByteArray& message)
+{
+    if (!isResponse(message)) {
+        return -1;
+    }
+
+    QList<QByteArray> parts = firstLine(message).split(' ');
+    return parts.size() >= 2 ? parts.at(1).toInt() : -1;
+}
+
+QByteArray RtspProtocol::headerValue(const QByteArray& message, const QByteArray& name)
+{
+    QList<QByteArray> values = headerValues(message, name);
+    return values.isEmpty() ? QByteArray() : values.first();
+}
+
+QList<QByteArray> RtspProtocol::headerValues(const QByteArray& message, const QByteArray& name)
+{
+    QList<QByteArray> values;
+    const int end = headerSectionEnd(message);
+    const QByteArray lowerName = name.toLower();
+
+    int lineStart = message.indexOf("\r\n");
+    while (lineStart >= 0 && lineStart < end) {
+        lineStart += 2;
+        int lineEnd = message.indexOf("\r\n", lineStart);
+        if (lineEnd < 0 || lineEnd > end) {
+            lineEnd = end;
+        }
+
+        int colon = message.indexOf(':', lineStart);
+        if (colon > lineStart && colon < lineEnd &&
+            message.mid(lineStart, colon - lineStart).trimmed().toLower() == lowerName) {
+            values.append(message.mid(colon + 1, lineEnd - colon - 1).trimmed());
+        }
+
+        lineStart = (lineEnd < end) ? lineEnd : -1;
+    }
+
+    return values;
+}
+
+int RtspProtocol::cseq(const QByteArray& message)
+{
+    bool ok = false;
+    int value = headerValue(message, "CSeq").toInt(&ok);
+    return ok ? value : -1;
+}
+
+QByteArray RtspProtocol::sessionId(const QByteArray& message)
+{
+    QByteArray session = headerValue(message, "Session");
+    int semicolon = session.indexOf(';');
+    if (semicolon >= 0) {
+        session.truncate(semicolon);
+    }
+    return session.trimmed();
+}
+
+int RtspProtocol::contentLength(const QByteArray& message)
+{
+    bool ok = false;
+    int value = headerValue(message, "Content-Length").toInt(&ok);
+    return ok ? value : 0;
+}
+
+int RtspProtocol::messageLength(const QByteArray& buffer)
+{
+    int headerEnd = buffer.indexOf("\r\n\r\n");
+    if (headerEnd < 0) {
+        return -1;
+    }
+
+    int total = headerEnd + 4 + contentLength(buffer.left(headerEnd + 4));
+    return total <= buffer.size() ? total : -1;
+}
+
+QByteArray RtspProtocol::withHeader(const QByteArray& message, const QByteArray& name, const QByteArray& value)
+{
+    const int end = headerSectionEnd(message);
+    const QByteArray lowerName = name.toLower();
+
+    QByteArray result = firstLine(message);
+    int lineStart = message.indexOf("\r\n");
+    while (lineStart >= 0 && lineStart < end) {
+        lineStart += 2;
+        int lineEnd = message.indexOf("\r\n", lineStart);
+        if (lineEnd < 0 || lineEnd > end) {
+            lineEnd = end;
+        }
+
+        QByteArray line = message.mid(lineStart, lineEnd - lineStart);
+        int colon = line.indexOf(':');
+        if (!line.isEmpty() && !(colon > 0 && line.left(colon).trimmed().toLower() == lowerName)) {
+            result += "\r\n" + line;
+        }
+
+        lineStart = (lineEnd < end) ? lineEnd : -1;
+    }
+
+    if (!value.isEmpty()) {
+        result += "\r\n" + name + ": " + value;
+    }
+    return result + message.mid(end);
+}
+
+bool RtspProtocol::replaceSessionId(QByteArray& data, const QByteArray& from, const QByteArray& to)
+{
+    if (from.isEmpty() || from == to || !(isRequest(data) || isResponse(data))) {
+        return false;
+    }
+
+    // Only the Session header's value, up to ";timeout=": a short numeric ID also
+    // turns up in URLs, CSeq values and nonces
+    const int end = headerSectionEnd(data);
+    int lineStart = data.indexOf("\r\n");
+    while (lineStart >= 0 && lineStart < end) {
+        lineStart += 2;
+        int lineEnd = data.indexOf("\r\n", lineStart);
+        if (lineEnd < 0 || lineEnd > end) {
+            lineEnd = end;
+        }
+
+        int colon = data.indexOf(':', lineStart);
+        if (colon > lineStart && colon < lineEnd &&
+            data.mid(lineStart, colon - lineStart).trimmed().toLower() == "session") {
+            int valueStart = colon + 1;
+            while (valueStart < lineEnd && (data.at(valueStart) == ' ' || data.at(valueStart) == '\t')) {
+                valueStart++;
+            }
+            int valueEnd = data.indexOf(';', valueStart);
+            if (valueEnd < 0 || valueEnd > lineEnd) {
+                valueEnd = lineEnd;
+            }
+            while (valueEnd > valueStart && (data.at(valueEnd - 1) == ' ' || data.at(valueEnd - 1) == '\t')) {
+                valueEnd--;
+            }
+            if (data.mid(valueStart, valueEnd - valueStart) != from) {
+                return false;
+            }
+            data.replace(valueStart, valueEnd - valueStart, to);
+            return true;
+        }
+
+        lineStart = (lineEnd < end) ? lineEnd : -1;
+    }
+    return false;
+}
+
+QByteArray RtspProtocol::withRequestUrl(const QByteArray& request, const QByteArray& url)
+{
+    int urlStart = request.indexOf(' ');
+    int lineEnd = request.indexOf("\r\n");
+    int urlEnd = request.indexOf(' ', urlStart + 1);
+    if (urlStart < 0 || urlEnd < 0 || (lineEnd >= 0 && urlEnd > lineEnd)) {
+        return request;
+    }
+
+    QByteArray result = request;
+    result.replace(urlStart + 1, urlEnd - urlStart - 1, url);
+    return result;
+}
+
+QByteArray RtspProtocol::substreamUrl(const QByteArray& url)
+{
+    // Group 1 marks the part that selects the main stream
+    static const QRegularExpression patterns[] = {
+        QRegularExpression("/Streaming/Channels/\\d*(01)(?=/|\\?|$)", QRegularExpression::CaseInsensitiveOption),
+        QRegularExpression("[?&]subtype=(0)(?=&|/|$)", QRegularExpression::CaseInsensitiveOption),
+        QRegularExpression("/(main)(?=/|$)", QRegularExpression::CaseInsensitiveOption),
+        QRegularExpression("/stream(1)(?=/|\\?|$)", QRegularExpression::CaseInsensitiveOption)
+    };
+    static const char* const replacements[] = { "02", "1", "sub", "2" };
+
+    QString rewritten = QString::fromUtf8(url);
+    for (int i = 0; i < 4; ++i) {
+        QRegularExpressionMatch match = patterns[i].match(rewritten);
+        if (match.hasMatch()) {
+            rewritten.replace(match.capturedStart(1), match.capturedLength(1), replacements[i]);
+            return rewritten.toUtf8();
+        }
+    }
+    return QByteArray();
+}
+
+bool RtspProtocol::sdpVideoFormat(const QByteArray& sdp, int& payloadType, QByteArray& encoding)
+{
+    payloadType = -1;
+    encoding.clear();
+
+    const QList<QByteArray> lines = sdp.split('\n');
+    bool inVideo = false;
+    for (QByteArray line : lines) {
+        line = line.trimmed();
+        if (line.startsWith("m=")) {
+            if (inVideo) {
+                break;
+            }
+            inVideo = line.startsWith("m=video");
+            QList<QByteArray> fields = line.split(' ');
+            if (inVideo && fields.size() >= 4) {
+                payloadType = fields.at(3).toInt();
+            }
+        } else if (inVideo && line.startsWith("a=rtpmap:")) {
+            int space = line.indexOf(' ');
+            if (space > 0 && line.mid(9, space - 9).toInt() == payloadType) {
+                encoding = line.mid(space + 1).split('/').first().toUpper();
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool RtspProtocol::sdpVideoResolution(const QByteArray& sdp, int& width, int& height)
+{
+    width = 0;
+    height = 0;
+
+    const QList<QByteArray> lines = sdp.split('\n');
+    bool inVideo = false;
+    QByteArray sps;
+    for (QByteArray line : lines) {
+        line = line.trimmed();
+        if (line.startsWith("m=")) {
+            if (inVideo) {
+                break;
+            }
+            inVideo = line.startsWith("m=video");
+            continue;
+        }
+        if (!inVideo) {
+            continue;
+        }
+
+        // a=framesize:96 1920-1080 / a=x-dimensions:1920,1080
+        QByteArray dimensions;
+        char separator = 0;
+        if (line.startsWith("a=framesize:")) {
+            dimensions = line.mid(line.indexOf(' ') + 1);
+            separator = '-';
+        } else if (line.startsWith("a=x-dimensions:")) {
+            dimensions = line.mid(15);
+            separator = ',';
+        }
+        if (separator) {
+            QList<QByteArray> parts = dimensions.split(separator);
+            if (parts.size() == 2 && parts.at(0).trimmed().toInt() > 0 && parts.at(1).trimmed().toInt() > 0) {
+                width = parts.at(0).trimmed().toInt();
+                height = parts.at(1).trimmed().toInt();
+                return true;
+            }
+        }
+
+        int sprop = line.indexOf("sprop-parameter-sets=");
+        if (line.startsWith("a=fmtp:") && sprop >= 0 && sps.isEmpty()) {
+            QByteArray sets = line.mid(sprop + 21);
+            int end = sets.indexOf(';');
+            for (const QByteArray& set : sets.left(end < 0 ? sets.size() : end).split(',')) {
+                QByteArray nal = QByteArray::fromBase64(set.trimmed());
+                if (!nal.isEmpty() && (nal.at(0) & 0x1f) == 7) {
+                    sps = nal;
+                    break;
+                }
+            }
+        }
+    }
+
+    return !sps.isEmpty() && h264SpsResolution(sps, width, height);
+}
+
+QList<QByteArray> RtspProtocol::sdpParameterSets(const QByteArray& sdp)
+{
+    QList<QByteArray> sets;
+    const QList<QByteArray> lines = sdp.split('\n');
+    bool inVideo = false;
+    for (QByteArray line : lines) {
+        line = line.trimmed();
+        if (line.startsWith("m=")) {
+            if (inVideo) {
+                break;
+            }
+            inVideo = line.startsWith("m=video");
+            continue;
+        }
+        if (!inVideo || !line.startsWith("a=fmtp:")) {
+            continue;
+        }
+
+        // a=fmtp:96 packetization-mode=1;sprop-parameter-sets=Z0IAKeKQ...,aM4G4g==
+        QHash<QByteArray, QByteArray> params;
+        for (const QByteArray& param : line.mid(line.indexOf(' ') + 1).split(';')) {
+            int equals = param.indexOf('=');
+            if (equals > 0) {
+                params.insert(param.left(equals).trimmed().toLower(), param.mid(equals + 1).trimmed());
+            }
+        }
+        for (const char* key : { "sprop-vps", "sprop-sps", "sprop-pps", "sprop-parameter-sets" }) {
+            for (const QByteArray& set : params.value(key).split(',')) {
+                QByteArray nal = QByteArray::fromBase64(set.trimmed());
+                if (!nal.isEmpty()) {
+                    sets.append(nal);
+                }
+            }
+        }
+        if (!sets.isEmpty()) {
+            break;
+        }
+    }
+    return sets;
+}
+
+QByteArray RtspProtocol::authorization(const QList<QByteArray>& challenges, const QByteArray& method,
+                                       const QByteArray& uri, const QString& username, const QString& password,
+                                       int nonceCount)
+{
+    const QByteArray user = username.toUtf8();
+    const QByteArray pass = password.toUtf8();
+
+    for (const QByteArray& challenge : challenges) {
+        if (!challenge.toLower().startsWith("digest")) {
+            continue;
+        }
+
+        QHash<QByteArray, QByteArray> params = parseAuthParams(challenge);
+        const QByteArray realm = params.value("realm");
+        const QByteArray nonce = params.value("nonce");
+        const QByteArray ha1 = md5Hex(user + ':' + realm + ':' + pass);
+        const QByteArray ha2 = md5Hex(method + ':' + uri);
+
+        QByteArray header = "Digest username=\"" + user + "\", realm=\"" + realm +
+                            "\", nonce=\"" + nonce + "\", uri=\"" + uri + "\"";
+
+        bool qopAuth = false;
+        for (const QByteArray& qop : params.value("qop").split(',')) {
+            qopAuth = qopAuth || qop.trimmed().toLower() == "auth";
+        }
+        if (qopAuth) {
+            const QByteArray nc = QByteArray::number(qMax(1, nonceCount), 16).rightJustified(8, '0');
+            const QByteArray cnonce = QByteArray::number(QRandomGenerator::global()->generate64(), 16);
+            const QByteArray response = md5Hex(ha1 + ':' + nonce + ':' + nc + ':' + cnonce + ":auth:" + ha2);
+            header += ", response=\"" + response + "\", qop=auth, nc=" + nc + ", cnonce=\"" + cnonce + "\"";
+        } else {
+            header += ", response=\"" + md5Hex(ha1 + ':' + nonce + ':' + ha2) + "\"";
+        }
+        if (params.contains("opaque")) {
+            header += ", opaque=\"" + params.value("opaque") + "\"";
+        }
+        return header;
+    }
+
+    for (const QByteArray& challenge : challenges) {
+        if (challenge.toLower().startsWith("basic")) {
+            return "Basic " + (user + ':' + pass).toBase64();
+        }
+    }
+
+    return QByteArray();
+}
+
+QByteArray RtspProtocol::buildRequest(const QByteArray& method, const QByteArray& url, int cseq,
+                                      const HeaderList& headers)
+{
+    QByteArray request = method + ' ' + url + " RTSP/1.0\r\n";
+    request += "CSeq: " + QByteArray::number(cseq) + "\r\n";
+    for (const auto& header : headers) {
+        request += header.first + ": " + header.second + "\r\n";
+    }
+    request += "User-Agent: ViscoConnect\r\n\r\n";
+    return request;
+}
+
+QByteArray RtspProtocol::buildResponse(int statusCode, const QByteArray& reason, int cseq,
+                                       const HeaderList& headers)
+{
+    QByteArray response = "RTSP/1.0 " + QByteArray::number(statusCode) + ' ' + reason + "\r\n";
+    if (cseq >= 0) {
+        response += "CSeq: " + QByteArray::number(cseq) + "\r\n";
+    }
+    for (const auto& header : headers) {
+        response += header.first + ": " + header.second + "\r\n";
+    }
+    response += "Server: ViscoConnect\r\n\r\n";
+    return response;
+}
@@ -0,0 +1,266 @@
+#include "RtspUrlProber.h"
+#include "RtspProtocol.h"
+#include "Logger.h"
+#include <QTimer>
+
+RtspUrlProber::RtspUrlProber(QObject *parent)
+    : QObject(parent)
+    , m_timeout(DEFAULT_TIMEOUT_MS)
+    , m_maxParallelPerHost(DEFAULT_MAX_PARALLEL_PER_HOST)
+    , m_maxParallel(DEFAULT_MAX_PARALLEL)
+    , m_inFlight(0)
+{
+}
+
+void RtspUrlProber::setCredentials(const QString& username, const QString& password)
+{
+    m_username = username;
+    m_password = password;
+}
+
+void RtspUrlProber::probe(const QString& ipAddress, int port, const QStringList& paths)
+{
+    const QString key = QString("%1:%2").arg(ipAddress).arg(port);
+    if (m_hosts.contains(key)) {
+        return;
+    }
+
+    HostProbe probe;
+    probe.result.ipAddress = ipAddress;
+    probe.result.port = port;
+    probe.paths = paths;
+    for (int i = 0; i < paths.size(); ++i) {
+        probe.states.append(Pending);
+        probe.sdps.append(QByteArray());
+    }
+    probe.nextPath = 0;
+    probe.inFlight = 0;
+
+    if (paths.isEmpty()) {
+        emit probeFinished(probe.result);
+        return;
+    }
+
+    m_hosts.insert(key, probe);
+    m_hostOrder.append(key);
+    launchAttempts();
+}
+
+void RtspUrlProber::stop()
+{
+    for (auto it = m_attempts.begin(); it != m_attempts.end(); ++it) {
+        it.key()->disconnect(this);
+        it.key()->abort();
+        it.key()->deleteLater();
+    }
+    m_attempts.clear();
+    m_hosts.clear();
+    m_hostOrder.clear();
+    m_inFlight = 0;
+}
+
+void RtspUrlProber::launchAttempts()
+{
+    const QStringList hosts = m_hostOrder;
+    for (const QString& key : hosts) {
+        if (m_inFlight >= m_maxParallel) {
+            return;
+        }
+        auto it = m_hosts.find(key);
+        if (it == m_hosts.end()) {
+            continue;
+        }
+        while (m_inFlight < m_maxParallel && it.value().inFlight < m_maxParallelPerHost &&
+               it.value().nextPath < it.value().paths.size()) {
+            startAttempt(it.value(), key);
+        }
+    }
+}
+
+void RtspUrlProber::startAttempt(HostProbe& probe, const QString& key)
+{
+    Attempt attempt;
+    attempt.host = key;
+    attempt.candidate = probe.nextPath++;
+    attempt.url = QString("rtsp://%1:%2%3").arg(probe.result.ipAddress).arg(probe.result.port)
+                      .arg(probe.paths.at(attempt.candidate)).toUtf8();
+    attempt.cseq = 1;
+    attempt.authorized = false;
+    attempt.started.start();
+    probe.inFlight++;
+    m_inFlight++;
+
+    QTcpSocket* socket = new QTcpSocket(this);
+    m_attempts.insert(socket, attempt);
+
+    QTimer* timer = new QTimer(socket);
+    timer->setSingleShot(true);
+    connect(timer, &QTimer::timeout, this, [this, socket]() { finishAttempt(socket, Failed); });
+    timer->start(m_timeout);
+
+    connect(socket, &QTcpSocket::connected, this, [this, socket]() {
+        auto it = m_attempts.find(socket);
+        if (it == m_attempts.end()) {
+            return;
+        }
+        auto host = m_hosts.find(it.value().host);
+        if (host != m_hosts.end()) {
+            const int connectMs = int(it.value().started.elapsed());
+            int& fastest = host.value().result.connectMs;
+            fastest = fastest < 0 ? connectMs : qMin(fastest, connectMs);
+        }
+        socket->write(describeRequest(it.value(), QList<QByteArray>()));
+    });
+    connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { handleReply(socket); });
+    connect(socket, &QAbstractSocket::errorOccurred, this, [this, socket]() { finishAttempt(socket, Failed); });
+
+    socket->connectToHost(probe.result.ipAddress, probe.result.port);
+}
+
+QByteArray RtspUrlProber::describeRequest(const Attempt& attempt, const QList<QByteArray>& challenges) const
+{
+    RtspProtocol::HeaderList headers;
+    headers.append(qMakePair(QByteArray("Accept"), QByteArray("application/sdp")));
+    if (!challenges.isEmpty()) {
+        headers.append(qMakePair(QByteArray("Authorization"),
+                                 RtspProtocol::authorization(challenges, "DESCRIBE", attempt.url, m_username, m_password)));
+    }
+    return RtspProtocol::buildRequest("DESCRIBE", attempt.url, attempt.cseq, headers);
+}
+
+void RtspUrlProber::handleReply(QTcpSocket* socket)
+{
+    auto it = m_attempts.find(socket);
+    if (it == m_attempts.end()) {
+        return;
+    }
+    Attempt& attempt = it.value();
+
+    attempt.buffer += socket->readAll();
+    const int length = RtspProtocol::messageLength(attempt.buffer);
+    if (length < 0) {
+        if (attempt.buffer.size() > MAX_REPLY_SIZE) {
+            finishAttempt(socket, Failed);
+        }
+        return;
+    }
+
+    const QByteArray reply = attempt.buffer.left(length);
+    attempt.buffer.remove(0, length);
+    if (!RtspProtocol::isResponse(reply)) {
+        finishAttempt(socket, Failed);
+        return;
+    }
+
+    const int status = RtspProtocol::statusCode(reply);
+    if (status == 401) {
+        const QList<QByteArray> challenges = RtspProtocol::headerValues(reply, "WWW-Authenticate");
+        if (attempt.authorized || m_username.isEmpty() || challenges.isEmpty()) {
+            auto host = m_hosts.find(attempt.host);
+            if (host != m_hosts.end()) {
+                host.value().result.authFailed = true;
+            }
+            finishAttempt(socket, Failed);
+            return;
+        }
+
+        // Answer the challenge on the same connection
+        attempt.cseq++;
+        attempt.authorized = true;
+        socket->write(describeRequest(attempt, challenges));
+        return;
+    }
+
+    const int bodyStart = reply.indexOf("\r\n\r\n");
+    const QByteArray sdp = bodyStart < 0 ? QByteArray() : reply.mid(bodyStart + 4);
+    int payloadType = -1;
+    QByteArray encoding;
+    if (status == 200 && RtspProtocol::sdpVideoFormat(sdp, payloadType, encoding)) {
+        finishAttempt(socket, Described, sdp);
+    } else {
+        finishAttempt(socket, Failed);
+    }
+}
+
+void RtspUrlProber::finishAttempt(QTcpSocket* socket, CandidateState state, const QByteArray& sdp)
+{
+    auto it = m_attempts.find(socket);
+    if (it == m_attempts.end()) {
+        return;
+    }
+    const Attempt attempt = it.value();
+    m_attempts.erase(it);
+
+    socket->disconnect(this);
+    socket->abort();
+    socket->deleteLater();
+    m_inFlight--;
+
+    auto host = m_hosts.find(attempt.host);
+    if (host != m_hosts.end()) {
+        host.value().inFlight--;
+        host.value().states[attempt.candidate] = state;
+        host.value().sdps[attempt.candidate] = sdp;
+        settleHost(attempt.host);
+    }
+
+    launchAttempts();
+}
+
+void RtspUrlProber::settleHost(const QString& key)
+{
+    auto it = m_hosts.find(key);
+    if (it == m_hosts.end()) {
+        return;
+    }
+    HostProbe& probe = it.value();
+
+    // Candidates are launched in list order, so an answer can only be accepted once
+    // every candidate before it has failed
+    for (int i = 0; i < probe.states.size(); ++i) {
+        if (probe.states.at(i) == Failed) {
+            continue;
+        }
+        if (probe.states.at(i) == Pending) {
+            return;
+        }
+
+        const QByteArray& sdp = probe.sdps.at(i);
+        int payloadType = -1;
+        QByteArray encoding;
+        RtspProtocol::sdpVideoFormat(sdp, payloadType, encoding);
+        probe.result.url = QString("rtsp://%1:%2%3").arg(probe.result.ipAddress).arg(probe.result.port)
+                               .arg(probe.paths.at(i));
+        probe.result.codec = QString::fromLatin1(encoding);
+        RtspProtocol::sdpVideoResolution(sdp, probe.result.width, probe.result.height);
+        break;
+    }
+
+    // Later candidates still in flight are no longer needed
+    QList<QTcpSocket*> sockets;
+    for (auto attempt = m_attempts.cbegin(); attempt != m_attempts.cend(); ++attempt) {
+        if (attempt.value().host == key) {
+            sockets.append(attempt.key());
+        }
+    }
+    for (QTcpSocket* socket : sockets) {
+        m_attempts.remove(socket);
+        socket->disconnect(this);
+        socket->abort();
+        socket->deleteLater();
+        m_inFlight--;
+    }
+
+    RtspProbeResult result = probe.result;
+    m_hosts.erase(it);
+    m_hostOrder.removeOne(key);
+
+    if (result.url.isEmpty()) {
+        LOG_INFO(QString("No RTSP path answered DESCRIBE on %1%2")
+                 .arg(key, result.authFailed ? " (authentication failed)" : ""), "RtspUrlProber");
+    } else {
+        LOG_INFO(QString("RTSP stream found at %1: %2 %3x%4")
+                 .arg(result.url, result.codec).arg(result.width).arg(result.height), "RtspUrlProber");
+    }
+    emit probeFinished(result);
+}
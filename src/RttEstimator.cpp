@@ -0,0 +1,60 @@
+#include "RttEstimator.h"
+#include <QHostAddress>
+#include <QStringList>
+#include <algorithm>
+
+RttEstimator::RttEstimator(int fallbackTimeout)
+    : m_fallbackTimeout(qMax(1, fallbackTimeout))
+{
+}
+
+void RttEstimator::addSample(quint32 address, int milliseconds)
+{
+    Subnet& subnet = m_subnets[subnetOf(address)];
+    if (subnet.samples.size() < MAX_SAMPLES) {
+        subnet.samples.append(qMax(0, milliseconds));
+    } else {
+        subnet.samples[subnet.next] = qMax(0, milliseconds);
+        subnet.next = (subnet.next + 1) % MAX_SAMPLES;
+    }
+
+    if (subnet.samples.size() < MIN_SAMPLES) {
+        return;
+    }
+
+    // At most 64 samples, so a partial sort per sample is cheap
+    QList<int> sorted = subnet.samples;
+    const int rank = (sorted.size() * 95 + 99) / 100 - 1;
+    std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+    subnet.p95 = sorted.at(rank);
+    subnet.timeout = qBound(MIN_TIMEOUT_MS, subnet.p95 * TIMEOUT_P95_MULTIPLE, MAX_TIMEOUT_MS);
+}
+
+int RttEstimator::timeoutFor(quint32 address) const
+{
+    auto it = m_subnets.constFind(subnetOf(address));
+    if (it == m_subnets.constEnd() || it.value().p95 < 0) {
+        return m_fallbackTimeout;
+    }
+    return it.value().timeout;
+}
+
+int RttEstimator::p95(quint32 address) const
+{
+    auto it = m_subnets.constFind(subnetOf(address));
+    return it == m_subnets.constEnd() ? -1 : it.value().p95;
+}
+
+QString RttEstimator::summary() const
+{
+    QStringList parts;
+    for (auto it = m_subnets.constBegin(); it != m_subnets.constEnd(); ++it) {
+        if (it.value().p95 < 0) {
+            continue;
+        }
+        parts.append(QString("%1/24 p95 %2 ms -> %3 ms").arg(QHostAddress(it.key()).toString())
+                     .arg(it.value().p95).arg(it.value().timeout));
+    }
+    parts.sort();
+    return parts.isEmpty() ? QString("no subnet measured") : parts.join(", ");
+}
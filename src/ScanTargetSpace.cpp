@@ -0,0 +1,234 @@
+#include "ScanTargetSpace.h"
+#include <QHostAddress>
+#include <QRegularExpression>
+#include <QStringList>
+#include <algorithm>
+
+bool ScanTargetSpace::parse(const QString& spec, QString* error)
+{
+    clear();
+
+    QList<Interval> included;
+    QList<Interval> excluded;
+    const QStringList entries = spec.split(QRegularExpression("[,;\\s]+"), Qt::SkipEmptyParts);
+    for (QString entry : entries) {
+        bool exclude = entry.startsWith('!');
+        if (exclude) {
+            entry.remove(0, 1);
+        }
+
+        Interval interval;
+        if (!parseEntry(entry, interval, error)) {
+            return false;
+        }
+        (exclude ? excluded : included).append(interval);
+    }
+
+    if (included.isEmpty()) {
+        if (error) {
+            *error = "No address range to scan";
+        }
+        return false;
+    }
+
+    m_intervals = subtract(merged(included), merged(excluded));
+    for (const Interval& interval : m_intervals) {
+        m_offsets.append(m_hostCount);
+        m_hostCount += quint64(interval.second) - interval.first + 1;
+    }
+    return true;
+}
+
+void ScanTargetSpace::clear()
+{
+    m_intervals.clear();
+    m_offsets.clear();
+    m_hostCount = 0;
+}
+
+quint32 ScanTargetSpace::hostAt(quint64 index) const
+{
+    // Last interval starting at or before the index
+    auto it = std::upper_bound(m_offsets.begin(), m_offsets.end(), index);
+    int position = int(it - m_offsets.begin()) - 1;
+    return m_intervals.at(position).first + quint32(index - m_offsets.at(position));
+}
+
+bool ScanTargetSpace::contains(quint32 address) const
+{
+    for (const Interval& interval : m_intervals) {
+        if (address >= interval.first && address <= interval.second) {
+            return true;
+        }
+    }
+    return false;
+}
+
+QString ScanTargetSpace::description() const
+{
+    QStringList parts;
+    for (const Interval& interval : m_intervals) {
+        if (interval.first == interval.second) {
+            parts.append(QHostAddress(interval.first).toString());
+        } else {
+            parts.append(QString("%1-%2").arg(QHostAddress(interval.first).toString(),
+                                              QHostAddress(interval.second).toString()));
+        }
+    }
+    return parts.join(", ");
+}
+
+bool ScanTargetSpace::parseEntry(const QString& entry, Interval& interval, QString* error)
+{
+    auto fail = [&](const QString& message) {
+        if (error) {
+            *error = QString("%1: %2").arg(entry, message);
+        }
+        return false;
+    };
+
+    auto toAddress = [](const QString& text, quint32& address) {
+        QHostAddress host;
+        if (!host.setAddress(text.trimmed()) || host.protocol() != QAbstractSocket::IPv4Protocol) {
+            return false;
+        }
+        address = host.toIPv4Address();
+        return true;
+    };
+
+    int slash = entry.indexOf('/');
+    int dash = entry.indexOf('-');
+
+    if (slash >= 0) {
+        quint32 address;
+        bool ok = false;
+        int prefix = entry.mid(slash + 1).toInt(&ok);
+        if (!toAddress(entry.left(slash), address)) {
+            return fail("invalid address");
+        }
+        if (!ok || prefix < MIN_PREFIX_LENGTH || prefix > 32) {
+            return fail(QString("prefix length must be between %1 and 32").arg(MIN_PREFIX_LENGTH));
+        }
+
+        quint32 mask = prefix == 0 ? 0 : ~quint32(0) << (32 - prefix);
+        interval.first = address & mask;
+        interval.second = interval.first | ~mask;
+
+        // Network and broadcast addresses are not hosts
+        if (prefix <= 30) {
+            interval.first++;
+            interval.second--;
+        }
+        return true;
+    }
+
+    if (dash >= 0) {
+        if (!toAddress(entry.left(dash), interval.first) || !toAddress(entry.mid(dash + 1), interval.second)) {
+            return fail("invalid address");
+        }
+        if (interval.first > interval.second) {
+            return fail("range end is before its start");
+        }
+        if (interval.second - interval.first >= (quint32(1) << (32 - MIN_PREFIX_LENGTH))) {
+            return fail(QString("range is larger than a /%1").arg(MIN_PREFIX_LENGTH));
+        }
+        return true;
+    }
+
+    if (!toAddress(entry, interval.first)) {
+        return fail("invalid address");
+    }
+    interval.second = interval.first;
+    return true;
+}
+
+QList<ScanTargetSpace::Interval> ScanTargetSpace::merged(QList<Interval> intervals)
+{
+    std::sort(intervals.begin(), intervals.end());
+
+    QList<Interval> result;
+    for (const Interval& interval : intervals) {
+        if (!result.isEmpty() && quint64(interval.first) <= quint64(result.last().second) + 1) {
+            result.last().second = qMax(result.last().second, interval.second);
+        } else {
+            result.append(interval);
+        }
+    }
+    return result;
+}
+
+QList<ScanTargetSpace::Interval> ScanTargetSpace::subtract(const QList<Interval>& from, const QList<Interval>& excluded)
+{
+    QList<Interval> result;
+    for (Interval interval : from) {
+        bool remaining = true;
+        for (const Interval& cut : excluded) {
+            if (cut.second < interval.first || cut.first > interval.second) {
+                continue;
+            }
+            if (cut.first > interval.first) {
+                result.append(Interval(interval.first, cut.first - 1));
+            }
+            if (cut.second >= interval.second) {
+                remaining = false;
+                break;
+            }
+            interval.first = cut.second + 1;
+        }
+        if (remaining) {
+            result.append(interval);
+        }
+    }
+    return result;
+}
+
+ScanOrder::ScanOrder(quint64 size, quint64 seed)
+    : m_size(size)
+    , m_steps(0)
+{
+    m_bits = 1;
+    while (m_bits < 63 && (quint64(1) << m_bits) < size) {
+        m_bits++;
+    }
+    m_mask = (quint64(1) << m_bits) - 1;
+
+    // Any odd increment gives a full period with a multiplier of 1 mod 4
+    m_increment = ((seed * 2) | 1) & m_mask;
+    m_start = (seed >> 17) & m_mask;
+    m_state = m_start;
+}
+
+quint64 ScanOrder::mix(quint64 x) const
+{
+    // Each step is a bijection on m_bits-bit values
+    const int shift = (m_bits + 1) / 2;
+    x ^= x >> shift;
+    x = (x * 0x9E3779B97F4A7C15ULL) & m_mask;
+    x ^= x >> shift;
+    return x;
+}
+
+bool ScanOrder::next(quint64& value)
+{
+    while (m_steps <= m_mask) {
+        m_state = (m_state * 6364136223846793005ULL + m_increment) & m_mask;
+        m_steps++;
+        quint64 candidate = mix(m_state);
+        if (candidate < m_size) {
+            value = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ScanOrder::seek(quint64 position)
+{
+    // At most 2^bits steps; even a /8 sweep replays in well under a second
+    m_state = m_start;
+    m_steps = 0;
+    while (m_steps < position && m_steps <= m_mask) {
+        m_state = (m_state * 6364136223846793005ULL + m_increment) & m_mask;
+        m_steps++;
+    }
+}
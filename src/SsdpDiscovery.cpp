@@ -0,0 +1,315 @@
+#include "SsdpDiscovery.h"
+#include "Logger.h"
+#include "NetworkInterfaceManager.h"
+#include <QNetworkDatagram>
+#include <QNetworkRequest>
+#include <QXmlStreamReader>
+#include <QUrl>
+
+namespace {
+const QLatin1String MULTICAST_ADDRESS("239.255.255.250");
+const int REPEAT_DELAY_MS = 150;
+}
+
+SsdpDiscovery::SsdpDiscovery(QObject *parent)
+    : QObject(parent)
+    , m_searchSocket(nullptr)
+    , m_listenSocket(nullptr)
+    , m_networkManager(nullptr)
+    , m_windowTimer(nullptr)
+    , m_searching(false)
+    , m_deviceCount(0)
+{
+    m_networkManager = new QNetworkAccessManager(this);
+
+    m_windowTimer = new QTimer(this);
+    m_windowTimer->setSingleShot(true);
+    connect(m_windowTimer, &QTimer::timeout, this, &SsdpDiscovery::onWindowElapsed);
+}
+
+bool SsdpDiscovery::startListening()
+{
+    if (m_listenSocket) {
+        return true;
+    }
+
+    // Other UPnP stacks usually hold port 1900 as well, so the port must be shared
+    m_listenSocket = new QUdpSocket(this);
+    if (!m_listenSocket->bind(QHostAddress::AnyIPv4, SSDP_PORT,
+                              QAbstractSocket::ShareAddress | QAbstractSocket::ReuseAddressHint)) {
+        LOG_WARNING(QString("Cannot listen for SSDP announcements: %1").arg(m_listenSocket->errorString()),
+                    "SsdpDiscovery");
+        m_listenSocket->deleteLater();
+        m_listenSocket = nullptr;
+        return false;
+    }
+
+    const QHostAddress group{QString(MULTICAST_ADDRESS)};
+    int joined = 0;
+    for (const QNetworkInterface& interface : NetworkInterfaceManager::getMulticastInterfaces()) {
+        if (m_listenSocket->joinMulticastGroup(group, interface)) {
+            joined++;
+        }
+    }
+    if (joined == 0 && !m_listenSocket->joinMulticastGroup(group)) {
+        LOG_WARNING("Cannot join the SSDP multicast group", "SsdpDiscovery");
+    }
+
+    connect(m_listenSocket, &QUdpSocket::readyRead, this, &SsdpDiscovery::readDatagrams);
+    LOG_INFO(QString("Listening for SSDP announcements on %1 interface(s)").arg(joined), "SsdpDiscovery");
+    return true;
+}
+
+void SsdpDiscovery::search(int windowMs)
+{
+    if (!m_searchSocket) {
+        m_searchSocket = new QUdpSocket(this);
+        if (!m_searchSocket->bind(QHostAddress::AnyIPv4, 0)) {
+            LOG_WARNING(QString("Cannot open SSDP search socket: %1").arg(m_searchSocket->errorString()),
+                        "SsdpDiscovery");
+            m_searchSocket->deleteLater();
+            m_searchSocket = nullptr;
+            return;
+        }
+        m_searchSocket->setSocketOption(QAbstractSocket::MulticastTtlOption, 2);
+        connect(m_searchSocket, &QUdpSocket::readyRead, this, &SsdpDiscovery::readDatagrams);
+    }
+
+    m_seenLocations.clear();
+    m_deviceCount = 0;
+    m_searching = true;
+
+    // Devices spread their responses over MX seconds
+    const QByteArray payload = buildSearch(qMax(1, windowMs / 1000));
+    auto send = [this, payload]() {
+        if (!m_searchSocket) {
+            return;
+        }
+        const QHostAddress group{QString(MULTICAST_ADDRESS)};
+        const QList<QNetworkInterface> interfaces = NetworkInterfaceManager::getMulticastInterfaces();
+        for (const QNetworkInterface& interface : interfaces) {
+            m_searchSocket->setMulticastInterface(interface);
+            m_searchSocket->writeDatagram(payload, group, SSDP_PORT);
+        }
+        if (interfaces.isEmpty()) {
+            m_searchSocket->writeDatagram(payload, group, SSDP_PORT);
+        }
+    };
+    send();
+    QTimer::singleShot(REPEAT_DELAY_MS, this, send);
+    m_windowTimer->start(windowMs);
+}
+
+void SsdpDiscovery::stop()
+{
+    m_windowTimer->stop();
+    m_searching = false;
+
+    QList<QNetworkReply*> replies = m_pendingDescriptions.keys();
+    m_pendingDescriptions.clear();
+    for (QNetworkReply* reply : replies) {
+        reply->disconnect(this);
+        reply->abort();
+        reply->deleteLater();
+    }
+
+    if (m_searchSocket) {
+        m_searchSocket->close();
+        m_searchSocket->deleteLater();
+        m_searchSocket = nullptr;
+    }
+}
+
+bool SsdpDiscovery::isActive() const
+{
+    return m_searching;
+}
+
+void SsdpDiscovery::readDatagrams()
+{
+    QUdpSocket* socket = qobject_cast<QUdpSocket*>(sender());
+    while (socket && socket->hasPendingDatagrams()) {
+        QNetworkDatagram datagram = socket->receiveDatagram(MAX_DATAGRAM_SIZE);
+        if (datagram.isValid()) {
+            handleMessage(datagram.data(), datagram.senderAddress());
+        }
+    }
+}
+
+void SsdpDiscovery::handleMessage(const QByteArray& message, const QHostAddress& sender)
+{
+    QByteArray startLine;
+    QHash<QByteArray, QByteArray> headers = parseHeaders(message, &startLine);
+
+    // Search responses and alive announcements; other control points' M-SEARCHes and byebyes are skipped
+    if (startLine.startsWith("NOTIFY")) {
+        if (headers.value("nts") != "ssdp:alive") {
+            return;
+        }
+    } else if (!startLine.startsWith("HTTP/1.1 200") && !startLine.startsWith("HTTP/1.0 200")) {
+        return;
+    }
+
+    SsdpDevice device;
+    device.ipAddress = QHostAddress(sender.toIPv4Address()).toString();
+    device.usn = QString::fromUtf8(headers.value("usn"));
+    device.location = QString::fromUtf8(headers.value("location"));
+    device.server = QString::fromUtf8(headers.value("server"));
+
+    // A device answers once per advertised type; its description only needs reading once
+    QString key = device.location.isEmpty() ? device.ipAddress : device.location;
+    if (m_seenLocations.contains(key)) {
+        return;
+    }
+    m_seenLocations.insert(key);
+
+    // Only follow LOCATIONs that point back at the announcing host
+    QUrl url(device.location);
+    if (url.isValid() && url.scheme() == "http" &&
+        QHostAddress(url.host()).isEqual(sender, QHostAddress::TolerantConversion)) {
+        fetchDescription(device);
+        return;
+    }
+
+    m_deviceCount++;
+    emit deviceFound(device);
+}
+
+void SsdpDiscovery::fetchDescription(const SsdpDevice& device)
+{
+    QNetworkRequest request{QUrl(device.location)};
+    request.setTransferTimeout(DESCRIPTION_TIMEOUT_MS);
+
+    QNetworkReply* reply = m_networkManager->get(request);
+    m_pendingDescriptions.insert(reply, device);
+    connect(reply, &QNetworkReply::finished, this, &SsdpDiscovery::onDescriptionReply);
+}
+
+void SsdpDiscovery::onDescriptionReply()
+{
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    if (!reply) {
+        return;
+    }
+    reply->deleteLater();
+
+    auto it = m_pendingDescriptions.find(reply);
+    if (it == m_pendingDescriptions.end()) {
+        return;
+    }
+    SsdpDevice device = it.value();
+    m_pendingDescriptions.erase(it);
+
+    if (reply->error() == QNetworkReply::NoError) {
+        parseDescription(reply->readAll(), device);
+    }
+
+    m_deviceCount++;
+    emit deviceFound(device);
+    checkFinished();
+}
+
+void SsdpDiscovery::onWindowElapsed()
+{
+    checkFinished();
+}
+
+void SsdpDiscovery::checkFinished()
+{
+    if (!m_searching || m_windowTimer->isActive() || !m_pendingDescriptions.isEmpty()) {
+        return;
+    }
+
+    m_searching = false;
+    LOG_INFO(QString("SSDP search finished, %1 UPnP device(s) answered").arg(m_deviceCount), "SsdpDiscovery");
+    emit finished(m_deviceCount);
+}
+
+QByteArray SsdpDiscovery::buildSearch(int maxWaitSeconds)
+{
+    // Root devices only: one response per device instead of one per embedded service
+    return QString("M-SEARCH * HTTP/1.1\r\n"
+                   "HOST: %1:%2\r\n"
+                   "MAN: \"ssdp:discover\"\r\n"
+                   "MX: %3\r\n"
+                   "ST: upnp:rootdevice\r\n"
+                   "\r\n").arg(QString(MULTICAST_ADDRESS)).arg(SSDP_PORT).arg(maxWaitSeconds).toUtf8();
+}
+
+QHash<QByteArray, QByteArray> SsdpDiscovery::parseHeaders(const QByteArray& message, QByteArray* startLine)
+{
+    QHash<QByteArray, QByteArray> headers;
+    const QList<QByteArray> lines = message.split('\n');
+    for (int i = 0; i < lines.size(); ++i) {
+        QByteArray line = lines.at(i).trimmed();
+        if (i == 0) {
+            if (startLine) {
+                *startLine = line;
+            }
+            continue;
+        }
+        if (line.isEmpty()) {
+            break;
+        }
+
+        int colon = line.indexOf(':');
+        if (colon > 0) {
+            headers.insert(line.left(colon).trimmed().toLower(), line.mid(colon + 1).trimmed());
+        }
+    }
+    return headers;
+}
+
+bool SsdpDiscovery::parseDescription(const QByteArray& xml, SsdpDevice& device)
+{
+    QXmlStreamReader reader(xml);
+
+    // The root device comes first; embedded devices and services are nested lists inside it
+    bool inDevice = false;
+    bool found = false;
+    while (!reader.atEnd()) {
+        reader.readNext();
+        if (reader.isEndElement() && reader.name() == QLatin1String("device")) {
+            break;
+        }
+        if (!reader.isStartElement()) {
+            continue;
+        }
+
+        const QString name = reader.name().toString();
+        if (name == "device") {
+            inDevice = true;
+            continue;
+        }
+        if (!inDevice) {
+            continue;
+        }
+        if (name == "deviceList" || name == "serviceList" || name == "iconList") {
+            reader.skipCurrentElement();
+            continue;
+        }
+
+        QString value = reader.readElementText(QXmlStreamReader::SkipChildElements).trimmed();
+        if (name == "deviceType") {
+            device.deviceType = value;
+        } else if (name == "friendlyName") {
+            device.friendlyName = value;
+        } else if (name == "manufacturer") {
+            device.manufacturer = value;
+        } else if (name == "modelName") {
+            device.modelName = value;
+        } else if (name == "modelNumber") {
+            device.modelNumber = value;
+        } else if (name == "serialNumber") {
+            device.serialNumber = value;
+        } else if (name == "presentationURL") {
+            device.presentationUrl = value;
+        } else if (name.compare("macAddress", Qt::CaseInsensitive) == 0) {
+            device.macAddress = value;
+        } else {
+            continue;
+        }
+        found = true;
+    }
+    return found;
+}
@@ -0,0 +1,159 @@
+#include "StreamAnalyzer.h"
+#include <QtEndian>
+
+QJsonObject StreamEstimate::toJson() const
+{
+    QJsonObject json;
+    json["bitsPerSecond"] = bitsPerSecond;
+    json["framesPerSecond"] = framesPerSecond;
+    json["gopFrames"] = gopFrames;
+    json["keyframeIntervalSeconds"] = keyframeIntervalSeconds;
+    json["coveredSeconds"] = coveredSeconds;
+    return json;
+}
+
+StreamAnalyzer::StreamAnalyzer()
+{
+    reset();
+}
+
+void StreamAnalyzer::reset()
+{
+    for (int i = 0; i < RING_SIZE; ++i) {
+        m_seconds[i] = Bucket();
+        m_minutes[i] = Bucket();
+    }
+
+    m_payloadType = -1;
+    m_codec = RtpInterleavedParser::CodecUnknown;
+    m_firstMs = -1;
+    m_havePacket = false;
+    m_lastMarker = false;
+    m_lastTimestamp = 0;
+    m_lastKeyframeTimestamp = 0;
+    m_haveKeyframe = false;
+    m_framesSinceKeyframe = 0;
+    m_lastGopFrames = 0;
+    m_lastKeyframeIntervalMs = 0;
+}
+
+void StreamAnalyzer::setVideoFormat(int payloadType, RtpInterleavedParser::VideoCodec codec)
+{
+    m_payloadType = payloadType;
+    m_codec = codec;
+}
+
+StreamAnalyzer::Bucket& StreamAnalyzer::slot(Bucket* ring, qint64 index)
+{
+    Bucket& bucket = ring[index % RING_SIZE];
+    if (bucket.index != index) {
+        bucket = Bucket();
+        bucket.index = index;
+    }
+    return bucket;
+}
+
+void StreamAnalyzer::countFrame(qint64 nowMs)
+{
+    slot(m_seconds, nowMs / 1000).frames++;
+    slot(m_minutes, nowMs / 60000).frames++;
+    m_framesSinceKeyframe++;
+}
+
+void StreamAnalyzer::addPacket(qint64 nowMs, int channel, const unsigned char* prefix, int prefixLength, int packetLength)
+{
+    // Video RTP only: even channel, version 2, the payload type announced in the SDP
+    if ((channel & 1) || m_payloadType < 0 || prefixLength < 12 || (prefix[0] >> 6) != 2 ||
+        (prefix[1] & 0x7F) != m_payloadType) {
+        return;
+    }
+
+    if (m_firstMs < 0) {
+        m_firstMs = nowMs;
+    }
+
+    slot(m_seconds, nowMs / 1000).bytes += packetLength;
+    slot(m_minutes, nowMs / 60000).bytes += packetLength;
+
+    // A frame ends at the marker bit; a timestamp change also closes one for cameras that omit it
+    const bool marker = (prefix[1] & 0x80) != 0;
+    const quint32 timestamp = qFromBigEndian<quint32>(prefix + 4);
+    if (m_havePacket && timestamp != m_lastTimestamp && !m_lastMarker) {
+        countFrame(nowMs);
+    }
+
+    // SPS and IDR of the same access unit share a timestamp and count once
+    if (RtpInterleavedParser::isKeyframeStart(prefix, prefixLength, m_codec) &&
+        (!m_haveKeyframe || timestamp != m_lastKeyframeTimestamp)) {
+        if (m_haveKeyframe) {
+            m_lastGopFrames = m_framesSinceKeyframe;
+            m_lastKeyframeIntervalMs = qint64(quint32(timestamp - m_lastKeyframeTimestamp)) * 1000 / VIDEO_CLOCK_RATE;
+        }
+        m_haveKeyframe = true;
+        m_lastKeyframeTimestamp = timestamp;
+        m_framesSinceKeyframe = 0;
+        slot(m_seconds, nowMs / 1000).keyframes++;
+        slot(m_minutes, nowMs / 60000).keyframes++;
+    }
+
+    if (marker) {
+        countFrame(nowMs);
+    }
+
+    m_havePacket = true;
+    m_lastMarker = marker;
+    m_lastTimestamp = timestamp;
+}
+
+void StreamAnalyzer::sumBuckets(const Bucket* ring, qint64 first, qint64 last, Bucket& total)
+{
+    for (qint64 index = first; index <= last; ++index) {
+        const Bucket& bucket = ring[index % RING_SIZE];
+        if (bucket.index == index) {
+            total.bytes += bucket.bytes;
+            total.frames += bucket.frames;
+            total.keyframes += bucket.keyframes;
+        }
+    }
+}
+
+StreamEstimate StreamAnalyzer::estimate(Window window, qint64 nowMs) const
+{
+    StreamEstimate result;
+    if (m_firstMs < 0) {
+        return result;
+    }
+
+    // Completed buckets only, so a window never mixes in a partially filled second or minute
+    qint64 bucketMs = 1000;
+    int buckets = 1;
+    const Bucket* ring = m_seconds;
+    if (window == WindowMinute) {
+        buckets = WINDOW_BUCKETS;
+    } else if (window == WindowHour) {
+        bucketMs = 60000;
+        buckets = WINDOW_BUCKETS;
+        ring = m_minutes;
+    }
+
+    const qint64 current = nowMs / bucketMs;
+    const qint64 windowStartMs = (current - buckets) * bucketMs;
+    const qint64 windowEndMs = current * bucketMs;
+    const qint64 coveredMs = windowEndMs - qMax(windowStartMs, m_firstMs);
+    if (coveredMs <= 0) {
+        return result;
+    }
+
+    Bucket total;
+    sumBuckets(ring, current - buckets, current - 1, total);
+
+    const double seconds = coveredMs / 1000.0;
+    result.coveredSeconds = seconds;
+    result.bitsPerSecond = qint64(total.bytes * 8 / seconds);
+    result.framesPerSecond = total.frames / seconds;
+    if (total.keyframes > 0) {
+        result.gopFrames = double(total.frames) / total.keyframes;
+        result.keyframeIntervalSeconds = seconds / total.keyframes;
+    }
+    return result;
+}
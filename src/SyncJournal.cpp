@@ -0,0 +1,345 @@
+#include "SyncJournal.h"
+#include "CameraApiService.h"
+#include "Logger.h"
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QMap>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTimer>
+#include <algorithm>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+quint32 crc32(const QByteArray& data)
+{
+    static quint32 table[256] = {};
+    static bool tableReady = false;
+    if (!tableReady) {
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 c = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+        tableReady = true;
+    }
+
+    quint32 crc = 0xFFFFFFFFu;
+    for (char byte : data) {
+        crc = table[(crc ^ quint8(byte)) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+bool syncToDisk(QFile& file)
+{
+    if (!file.flush()) {
+        return false;
+    }
+#ifdef Q_OS_WIN
+    return _commit(file.handle()) == 0;
+#else
+    return ::fsync(file.handle()) == 0;
+#endif
+}
+
+bool decodeOperation(QDataStream& in, SyncOperation& operation)
+{
+    qint32 type = 0;
+    QByteArray camera;
+    qint32 timestamp = 0;
+    in >> type >> operation.localCameraId >> camera >> operation.status >> operation.serverCameraId >> timestamp;
+    if (in.status() != QDataStream::Ok ||
+        type < static_cast<int>(SyncOperationType::CREATE) || type > static_cast<int>(SyncOperationType::START_STREAM)) {
+        return false;
+    }
+    operation.type = static_cast<SyncOperationType>(type);
+    operation.camera.fromJson(QJsonDocument::fromJson(camera).object());
+    operation.timestamp = timestamp;
+    return true;
+}
+}
+
+SyncJournal::SyncJournal(const QString& filePath, QObject *parent)
+    : QThread(parent)
+    , m_filePath(filePath)
+    , m_lastJournalId(0)
+    , m_liveBytes(0)
+    , m_fileBytes(0)
+    , m_flushTimer(new QTimer(this))
+    , m_stopping(false)
+{
+    m_flushTimer->setSingleShot(true);
+    m_flushTimer->setInterval(FLUSH_DELAY_MS);
+    connect(m_flushTimer, &QTimer::timeout, this, &SyncJournal::flushBatch);
+}
+
+SyncJournal::~SyncJournal()
+{
+    close();
+}
+
+QString SyncJournal::defaultFilePath()
+{
+    QString appDataPath = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
+    return appDataPath + "/sync_journal.dat";
+}
+
+QByteArray SyncJournal::fileHeader()
+{
+    QByteArray header;
+    QDataStream out(&header, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << FILE_MAGIC << FILE_VERSION;
+    return header;
+}
+
+QByteArray SyncJournal::frame(const QByteArray& payload)
+{
+    QByteArray record;
+    QDataStream out(&record, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << quint32(payload.size()) << crc32(payload);
+    record.append(payload);
+    return record;
+}
+
+QList<SyncOperation> SyncJournal::replay()
+{
+    m_live.clear();
+    m_liveBytes = 0;
+    const QByteArray header = fileHeader();
+    m_fileBytes = header.size();
+
+    QFile file(m_filePath);
+    if (!file.exists()) {
+        return QList<SyncOperation>();
+    }
+    if (!file.open(QIODevice::ReadWrite)) {
+        LOG_WARNING(QString("Cannot open sync journal %1: %2").arg(m_filePath, file.errorString()), "SyncJournal");
+        return QList<SyncOperation>();
+    }
+    const QByteArray data = file.readAll();
+    if (!data.startsWith(header)) {
+        if (!data.isEmpty()) {
+            LOG_WARNING(QString("Discarding sync journal %1: unknown format").arg(m_filePath), "SyncJournal");
+        }
+        file.resize(0);
+        return QList<SyncOperation>();
+    }
+
+    // Records up to the first one that is short or fails its checksum; anything
+    // after that is a write the previous run did not finish
+    QMap<quint64, SyncOperation> pending;
+    qint64 offset = header.size();
+    while (offset + 8 <= data.size()) {
+        QDataStream frameHeader(data.mid(offset, 8));
+        frameHeader.setVersion(QDataStream::Qt_6_0);
+        quint32 length = 0;
+        quint32 checksum = 0;
+        frameHeader >> length >> checksum;
+        if (length > quint32(MAX_RECORD_SIZE) || offset + 8 + length > data.size()) {
+            break;
+        }
+        const QByteArray payload = data.mid(offset + 8, length);
+        if (crc32(payload) != checksum) {
+            break;
+        }
+
+        QDataStream in(payload);
+        in.setVersion(QDataStream::Qt_6_0);
+        quint8 kind = 0;
+        quint64 journalId = 0;
+        in >> kind >> journalId;
+        if (kind == PutRecord) {
+            SyncOperation operation;
+            if (!decodeOperation(in, operation)) {
+                break;
+            }
+            operation.journalId = journalId;
+            pending.insert(journalId, operation);
+            const QByteArray record = data.mid(offset, 8 + length);
+            m_liveBytes += record.size() - m_live.value(journalId).size();
+            m_live.insert(journalId, record);
+        } else if (kind == RemoveRecord && in.status() == QDataStream::Ok) {
+            pending.remove(journalId);
+            m_liveBytes -= m_live.take(journalId).size();
+        } else {
+            break;
+        }
+        m_lastJournalId = qMax(m_lastJournalId, journalId);
+        offset += 8 + length;
+    }
+
+    if (offset < data.size()) {
+        LOG_WARNING(QString("Sync journal %1 has %2 unreadable bytes at its end; dropping them")
+                    .arg(m_filePath).arg(data.size() - offset), "SyncJournal");
+        file.resize(offset);
+    }
+    m_fileBytes = offset;
+    return pending.values();
+}
+
+void SyncJournal::put(const SyncOperation& operation)
+{
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << quint8(PutRecord) << operation.journalId << qint32(operation.type) << operation.localCameraId
+        << QJsonDocument(operation.camera.toJson()).toJson(QJsonDocument::Compact)
+        << operation.status << operation.serverCameraId << qint32(operation.timestamp);
+
+    const QByteArray record = frame(payload);
+    m_liveBytes += record.size() - m_live.value(operation.journalId).size();
+    m_live.insert(operation.journalId, record);
+    m_lastJournalId = qMax(m_lastJournalId, operation.journalId);
+    append(record);
+}
+
+void SyncJournal::remove(quint64 journalId)
+{
+    auto live = m_live.find(journalId);
+    if (live == m_live.end()) {
+        return;
+    }
+    m_liveBytes -= live.value().size();
+    m_live.erase(live);
+
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << quint8(RemoveRecord) << journalId;
+    append(frame(payload));
+}
+
+void SyncJournal::append(const QByteArray& record)
+{
+    m_batch.append(record);
+    m_fileBytes += record.size();
+    if (!m_flushTimer->isActive()) {
+        m_flushTimer->start();
+    }
+}
+
+void SyncJournal::flushBatch()
+{
+    m_flushTimer->stop();
+    if (m_batch.isEmpty()) {
+        return;
+    }
+
+    Batch batch{m_batch, QByteArray()};
+    m_batch.clear();
+    const QByteArray header = fileHeader();
+    if (m_fileBytes > COMPACT_MIN_BYTES && m_fileBytes > COMPACT_DEAD_RATIO * (header.size() + m_liveBytes)) {
+        // The live records alone, in journal ID order, replace the whole file
+        QList<quint64> ids = m_live.keys();
+        std::sort(ids.begin(), ids.end());
+        batch.snapshot = header;
+        for (quint64 journalId : ids) {
+            batch.snapshot.append(m_live.value(journalId));
+        }
+        m_fileBytes = batch.snapshot.size();
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_batches.append(batch);
+    m_wakeWriter.wakeOne();
+}
+
+void SyncJournal::close()
+{
+    if (!isRunning()) {
+        return;
+    }
+    flushBatch();
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopping = true;
+        m_wakeWriter.wakeOne();
+    }
+    wait();
+}
+
+void SyncJournal::run()
+{
+    QDir().mkpath(QFileInfo(m_filePath).absolutePath());
+
+    QFile file(m_filePath);
+    auto openForAppend = [this, &file]() {
+        file.close();
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+            LOG_WARNING(QString("Cannot open sync journal %1: %2").arg(m_filePath, file.errorString()), "SyncJournal");
+            return;
+        }
+        if (file.size() == 0) {
+            file.write(fileHeader());
+        }
+    };
+    openForAppend();
+
+    forever {
+        QList<Batch> batches;
+        bool stopping = false;
+        {
+            QMutexLocker locker(&m_mutex);
+            while (m_batches.isEmpty() && !m_stopping) {
+                m_wakeWriter.wait(&m_mutex);
+            }
+            batches.swap(m_batches);
+            stopping = m_stopping;
+        }
+
+        // A snapshot already holds everything queued before it
+        int compaction = -1;
+        for (int i = 0; i < batches.size(); ++i) {
+            if (!batches.at(i).snapshot.isEmpty()) {
+                compaction = i;
+            }
+        }
+
+        bool written = false;
+        if (compaction >= 0) {
+            QByteArray data = batches.at(compaction).snapshot;
+            for (int i = compaction + 1; i < batches.size(); ++i) {
+                data.append(batches.at(i).records);
+            }
+            file.close();
+            QSaveFile compacted(m_filePath);
+            written = compacted.open(QIODevice::WriteOnly) && compacted.write(data) == data.size() && compacted.commit();
+            if (!written) {
+                LOG_WARNING(QString("Cannot compact sync journal %1: %2; appending instead")
+                            .arg(m_filePath, compacted.errorString()), "SyncJournal");
+            }
+            openForAppend();
+        }
+
+        QByteArray data;
+        for (const Batch& batch : batches) {
+            data.append(batch.records);
+        }
+        if (!written && !data.isEmpty() && file.isOpen()) {
+            // One write and one fsync for everything batched since the last pass
+            if (file.write(data) != data.size() || !syncToDisk(file)) {
+                LOG_WARNING(QString("Cannot write sync journal %1: %2").arg(m_filePath, file.errorString()),
+                            "SyncJournal");
+            }
+        }
+
+        if (stopping) {
+            break;
+        }
+    }
+    file.close();
+}